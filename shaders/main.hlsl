@@ -9,23 +9,67 @@
 //
 //*********************************************************
 
+// Dequantization of the SNORM16 positions of the mesh being drawn, set as
+// root constants
+cbuffer MeshConstants : register(b0)
+{
+    float4 position_scale;
+    float4 position_bias;
+};
+
+// First element of objects used by the draw, set as a root constant since
+// SV_InstanceID does not include the start instance
+cbuffer DrawConstants : register(b1)
+{
+    uint first_object;
+};
+
+// Matches ObjectData of vertex.h
+struct ObjectData
+{
+    float2 offset;
+    float2 scale;
+    float4 color;
+};
+
+// Every object of the frame, bound once per frame through a descriptor table
+StructuredBuffer<ObjectData> objects : register(t0);
+
+// The members are generated by the application from the vertex layout of
+// Vertex, so they always match the input layout
+struct VSInput
+{
+    VERTEX_INPUT_MEMBERS
+};
+
 struct PSInput
 {
     float4 position : SV_POSITION;
     float4 color : COLOR;
 };
 
-PSInput VSMain(float4 position : POSITION, float4 color : COLOR)
+PSInput VSMain(VSInput input, uint instance_id : SV_InstanceID)
 {
     PSInput result;
+    ObjectData object = objects[first_object + instance_id];
 
-    result.position = position;
-    result.color = color;
+    // Restore the position from the mesh bounds, then scale by the object
+    // and offset it
+    float3 position = input.position.xyz * position_scale.xyz +
+                      position_bias.xyz;
+    result.position = float4(position.xy * object.scale + object.offset,
+                             position.z, 1.0f);
+    result.color = input.color * object.color;
 
     return result;
 }
 
 float4 PSMain(PSInput input) : SV_TARGET
 {
+#ifdef WIREFRAME
+    // Edges in white, so they stand out against any object color
+    return float4(1.0f, 1.0f, 1.0f, 1.0f);
+#else
     return input.color;
+#endif
 }
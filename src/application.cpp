@@ -1,14 +1,39 @@
 #include "application.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
-
+#include <thread>
+
+#include "core/builtin_meshes.h"
+#include "core/hash.h"
+#include "core/mesh_file.h"
+#include "core/mesh_processing.h"
+#include "core/profiler.h"
+#include "core/string_utils.h"
+#include "core/task_graph.h"
+#include "input_layout.h"
 #include "iostream"
 
 namespace {
-void GetHardwareAdapter(IDXGIFactory1 *factory,
-                        IDXGIAdapter1 **hardware_adapter,
-                        bool request_high_performance = false) {
+const char kShaderCacheDirectory[] = "shader_cache";
+// Half size of the scattered scene, the view covers [-1, 1] of it
+const float kScatteredSceneExtent = 8.0f;
+const float kCameraPathRadius = 4.0f;
+// The occlusion buffer has a pixel per 4x4 pixels of the viewport
+const uint32_t kOcclusionBufferDivisor = 4;
+// Offscreen render targets are created with it for fast clears
+const float kClearColor[] = {0.0f, 0.2f, 0.4f, 1.0f};
+
+// Create the device on the first hardware adapter that supports it. The
+// device of the chosen adapter is kept instead of being created a second time.
+void CreateHardwareDevice(IDXGIFactory1 *factory,
+                          IDXGIAdapter1 **hardware_adapter,
+                          ID3D12Device **device,
+                          bool request_high_performance = false) {
   *hardware_adapter = nullptr;
+  *device = nullptr;
   ComPtr<IDXGIAdapter1> adapter;
   ComPtr<IDXGIFactory6> factory6;
 
@@ -27,13 +52,13 @@ void GetHardwareAdapter(IDXGIFactory1 *factory,
         continue;
       }
       if (SUCCEEDED(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0,
-                                      _uuidof(ID3D12Device), nullptr))) {
+                                      IID_PPV_ARGS(device)))) {
         break;
       }
     }
   }
 
-  if (adapter.Get() == nullptr) {
+  if (*device == nullptr) {
     for (uint32_t adapter_index = 0;
          DXGI_ERROR_NOT_FOUND !=
          factory->EnumAdapters1(adapter_index, &adapter);
@@ -44,13 +69,15 @@ void GetHardwareAdapter(IDXGIFactory1 *factory,
         continue;
       }
       if (SUCCEEDED(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0,
-                                      _uuidof(ID3D12Device), nullptr))) {
+                                      IID_PPV_ARGS(device)))) {
         break;
       }
     }
   }
 
-  *hardware_adapter = adapter.Detach();
+  if (*device != nullptr) {
+    *hardware_adapter = adapter.Detach();
+  }
 }
 
 std::string WStringToString(const std::wstring &wstr) {
@@ -62,32 +89,13 @@ std::string WStringToString(const std::wstring &wstr) {
                       size_needed, nullptr, nullptr);
   return str_to;
 }
-
-std::string DataSizeToStringNotation(size_t sz) {
-  // Convert the size to human readable notation, from B to TB, reserve 2 digits
-  // after the decimal point
-  std::string notation;
-  if (sz < 1024) {
-    notation = std::to_string(sz) + " B";
-  } else if (sz < 1024 * 1024) {
-    notation = std::to_string(sz / 1024.0).substr(0, 6) + " KB";
-  } else if (sz < 1024 * 1024 * 1024) {
-    notation = std::to_string(sz / 1024.0 / 1024.0).substr(0, 6) + " MB";
-  } else {
-    notation =
-        std::to_string(sz / 1024.0 / 1024.0 / 1024.0).substr(0, 6) + " GB";
-  }
-  return notation;
-}
 }  // namespace
 
 Application::Application(const std::string_view &title,
                          uint32_t width,
-                         uint32_t height) {
-  glfwInit();
-  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  window_ = glfwCreateWindow(width, height, title.data(), nullptr, nullptr);
-
+                         uint32_t height,
+                         const ApplicationSettings &settings)
+    : settings_(settings) {
   // Set Scissor Rect and Viewport
   scissor_rect_.left = 0;
   scissor_rect_.top = 0;
@@ -100,6 +108,14 @@ Application::Application(const std::string_view &title,
   viewport_.MinDepth = 0.0f;
   viewport_.MaxDepth = 1.0f;
 
+  // Offscreen frames keep the size they were created with
+  if (settings_.offscreen) {
+    return;
+  }
+  glfwInit();
+  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+  window_ = glfwCreateWindow(width, height, title.data(), nullptr, nullptr);
+
   // Set auto refill on Framebuffer resize
   glfwSetFramebufferSizeCallback(
       window_, [](GLFWwindow *window, int width, int height) {
@@ -111,12 +127,8 @@ Application::Application(const std::string_view &title,
         app->viewport_.Height = static_cast<float>(height);
 
         // Recreate swap chain
-        app->WaitForPreviousFrame();
-        app->swap_chain_.Reset();
-        // Reset render target views
-        for (int i = 0; i < kFrameCount; i++) {
-          app->render_targets_[i].Reset();
-        }
+        app->frame_scheduler_->WaitForIdle();
+        app->ReleaseSwapchain();
         app->BuildSwapchain(width, height);
       });
 
@@ -125,47 +137,591 @@ Application::Application(const std::string_view &title,
 }
 
 Application::~Application() {
-  glfwDestroyWindow(window_);
-  glfwTerminate();
+  // Stop updating before the state the update thread reads goes away
+  update_thread_.reset();
+  if (window_) {
+    ReleaseSwapchain();
+    glfwDestroyWindow(window_);
+    glfwTerminate();
+  }
 }
 
 void Application::Run() {
   OnInitialize();
-  while (!glfwWindowShouldClose(window_)) {
+  while (settings_.offscreen
+             ? frame_scheduler_->GetFrameNumber() < settings_.frame_count
+             : !glfwWindowShouldClose(window_)) {
+    WaitForNextFrame();
+    if (window_) {
+      glfwPollEvents();
+    }
     OnUpdate();
     OnRender();
-    glfwPollEvents();
   }
   OnClose();
 }
 
 void Application::OnInitialize() {
-  LoadPipeline();
-  LoadAssets();
+  // The workers run the startup tasks and later record the frames
+  job_system_ = std::make_unique<JobSystem>(
+      std::max(std::thread::hardware_concurrency(), 1u));
+  draw_queue_ = std::make_unique<DrawQueue>(sizeof(ObjectData));
+  // Threaded updates create their culler on the update thread
+  if (settings_.update_rate_hz <= 0.0) {
+    scene_culler_ = std::make_unique<SceneCuller>(job_system_.get());
+  }
+  shader_cache_ =
+      std::make_unique<ShaderCache>(kShaderCacheDirectory, &shader_compiler_);
+  pipeline_readiness_.Add();
+  pipeline_readiness_.Add(kSolidPipeline);
+  pipeline_states_.resize(pipeline_readiness_.GetPipelineCount());
+
+  ShaderCompileRequest vertex_request;
+  vertex_request.path = "../../shaders/main.hlsl";
+  vertex_request.entry_point = "VSMain";
+  vertex_request.target = "vs_5_0";
+  vertex_request.defines = {
+      {"VERTEX_INPUT_MEMBERS", BuildHlslInputMembers<Vertex>()}};
+#ifdef _DEBUG
+  vertex_request.compile_flags =
+      D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+  ShaderCompileRequest pixel_request = vertex_request;
+  pixel_request.entry_point = "PSMain";
+  pixel_request.target = "ps_5_0";
+  ShaderCompileRequest wireframe_pixel_request = pixel_request;
+  wireframe_pixel_request.defines.push_back({"WIREFRAME", "1"});
+
+  // Results handed from task to task, every task writes its own
+  std::vector<uint8_t> vertex_shader;
+  std::vector<uint8_t> pixel_shader;
+  MeshView mesh_view;
+  BoundingSphere mesh_bounds;
+  std::vector<InstanceData> instances;
+
+  // Everything the first frame needs, as independent of each other as the
+  // APIs allow. Shaders and meshes load from disk while the device is being
+  // created.
+  TaskGraph startup;
+  const uint32_t create_device =
+      startup.AddTask("CreateDevice", {}, [&] { CreateDevice(); });
+  const uint32_t create_queues = startup.AddTask(
+      "CreateQueues", {create_device}, [&] { CreateQueues(); });
+  const uint32_t create_root_signature = startup.AddTask(
+      "CreateRootSignature", {create_device}, [&] { CreateRootSignature(); });
+  const uint32_t open_pipeline_cache =
+      startup.AddTask("OpenPipelineCache", {create_device}, [&] {
+        pipeline_cache_ = std::make_unique<PipelineCache>(
+            device_.Get(), shader_cache_.get());
+      });
+  const uint32_t compile_vertex_shader =
+      startup.AddTask("CompileVertexShader", {}, [&] {
+        vertex_shader = shader_cache_->GetShader(vertex_request);
+      });
+  const uint32_t compile_pixel_shader =
+      startup.AddTask("CompilePixelShader", {}, [&] {
+        pixel_shader = shader_cache_->GetShader(pixel_request);
+      });
+  startup.AddTask("CreateSolidPipeline",
+                  {create_root_signature, open_pipeline_cache,
+                   compile_vertex_shader, compile_pixel_shader},
+                  [&] {
+                    CreatePipeline(kSolidPipeline, D3D12_FILL_MODE_SOLID,
+                                   vertex_request, vertex_shader,
+                                   pixel_request, pixel_shader);
+                  });
+  const uint32_t load_mesh = startup.AddTask("LoadMesh", {}, [&] {
+    if (settings_.mesh_path.empty()) {
+      builtin_mesh_ = BuildTriangleMesh();
+      mesh_view = builtin_mesh_.GetView();
+    } else {
+      // Finer LODs keep streaming out of the mapping
+      mesh_file_ = std::make_unique<MeshFile>(settings_.mesh_path);
+      mesh_view = mesh_file_->GetView();
+    }
+    // Meshes that were not processed offline get their LODs now
+    if (mesh_view.lod_count < 2) {
+      processed_mesh_ = ProcessMesh(mesh_view);
+      mesh_view = processed_mesh_.GetView();
+    }
+    mesh_bounds = ComputeBoundingSphere(mesh_view);
+  });
+  const uint32_t upload_mesh =
+      startup.AddTask("UploadMesh", {load_mesh, create_queues},
+                      [&] { scene_mesh_ = LoadMesh(mesh_view); });
+  const uint32_t build_instances =
+      startup.AddTask("BuildInstances", {}, [&] {
+        if (settings_.scene_object_count > 0) {
+          instances = BuildScatteredInstances(settings_.scene_object_count,
+                                              kScatteredSceneExtent);
+        } else if (settings_.grid_size > 0) {
+          instances = BuildTriangleGridInstances(settings_.grid_size);
+        } else {
+          instances = {{{0.0f, 0.0f}, {1.0f, 1.0f}}};
+        }
+      });
+  startup.AddTask("BuildScene", {upload_mesh, build_instances}, [&] {
+    for (const auto &instance : instances) {
+      scene_.AddObject(scene_mesh_, instance, mesh_bounds);
+    }
+  });
+  startup.Run(job_system_.get());
+  std::cout << "Startup timeline:" << std::endl
+            << startup.GetTimelineReport();
+
+  if (settings_.offscreen) {
+    BuildOffscreenTargets(static_cast<uint32_t>(viewport_.Width),
+                          static_cast<uint32_t>(viewport_.Height));
+  } else {
+    // DXGI may send messages to the window, so the swap chain is created on
+    // the thread that owns it
+    int window_frame_width, window_frame_height;
+    glfwGetFramebufferSize(window_, &window_frame_width,
+                           &window_frame_height);
+    BuildSwapchain(window_frame_width, window_frame_height);
+  }
+
+  // The wireframe pipeline is only drawn when asked for, and until it is
+  // ready the solid one stands in for it
+  job_system_->Schedule(
+      &pipeline_jobs_,
+      [this, vertex_request, vertex_shader,
+       wireframe_pixel_request](uint32_t) {
+        try {
+          CreatePipeline(kWireframePipeline, D3D12_FILL_MODE_WIREFRAME,
+                         vertex_request, vertex_shader,
+                         wireframe_pixel_request,
+                         shader_cache_->GetShader(wireframe_pixel_request));
+        } catch (const std::exception &e) {
+          pipeline_readiness_.MarkFailed(kWireframePipeline);
+          std::cerr << "Wireframe pipeline unavailable: " << e.what()
+                    << std::endl;
+        }
+      });
+
+  if (!settings_.mesh_path.empty()) {
+    std::cout << "Loaded " << settings_.mesh_path << ": "
+              << mesh_view.vertex_count << " vertices, "
+              << mesh_view.index_count << " indices in "
+              << mesh_view.lod_count << " LODs, " << mesh_view.meshlet_count
+              << " meshlets, "
+              << DataSizeToStringNotation(mesh_file_->GetFileSize())
+              << std::endl;
+  }
+  const ShaderCacheStats shader_stats = shader_cache_->GetStats();
+  const PipelineCacheStats pipeline_stats = pipeline_cache_->GetStats();
+  std::cout << "Shader cache: " << shader_stats.hits << " hits, "
+            << shader_stats.misses << " misses, "
+            << shader_stats.compile_time_ns / 1000000 << " ms compiling, "
+            << shader_stats.time_saved_ns / 1000000 << " ms saved"
+            << std::endl;
+  std::cout << "Pipeline cache: " << pipeline_stats.hits << " hits, "
+            << pipeline_stats.misses << " misses" << std::endl;
+
+  // Meshes submitted their own copies, nothing is left to wait for here.
+  // Frames wait on the GPU for the copies of the meshes they draw.
+  upload_ring_->Submit();
+
+  const RingAllocatorStats &upload_stats = upload_ring_->GetStats();
+  std::cout << "Upload ring: peak usage "
+            << DataSizeToStringNotation(upload_stats.peak_usage) << " of "
+            << DataSizeToStringNotation(upload_ring_->GetCapacity()) << ", "
+            << upload_stats.full_stalls << " stalls" << std::endl;
+  std::cout << "GPU memory: " << gpu_memory_->GetUsageReport();
+  start_time_ = std::chrono::steady_clock::now();
+
+  // The scene is complete and stays unchanged, so updates may read it from
+  // their own thread. Frames start once there is a snapshot to draw.
+  if (settings_.update_rate_hz > 0.0) {
+    update_thread_ = std::make_unique<UpdateThread>(
+        [this](uint64_t update, SceneSnapshot *snapshot) {
+          Update(update, snapshot);
+        },
+        settings_.update_rate_hz, 0,
+        [this] {
+          // Culling gets workers of its own, the render thread's are busy
+          // recording the frames
+          update_job_system_ = std::make_unique<JobSystem>(
+              std::max(std::thread::hardware_concurrency(), 1u));
+          scene_culler_ =
+              std::make_unique<SceneCuller>(update_job_system_.get());
+        });
+    while (!update_thread_->AcquireSnapshot()) {
+      std::this_thread::yield();
+    }
+  }
 }
 
 void Application::OnUpdate() {
+  if (update_thread_) {
+    // Without a newer snapshot the frame draws the one the last frame drew
+    update_thread_->AcquireSnapshot();
+    snapshot_ = &update_thread_->GetSnapshot();
+    return;
+  }
+  lockstep_snapshot_.update = frame_scheduler_->GetFrameNumber();
+  lockstep_snapshot_.update_start = std::chrono::steady_clock::now();
+  Update(lockstep_snapshot_.update, &lockstep_snapshot_);
+  snapshot_ = &lockstep_snapshot_;
+}
+
+void Application::Update(uint64_t, SceneSnapshot *snapshot) {
+  PROFILE_SCOPE("Update");
+  // Circle over the scattered scene
+  if (settings_.scene_object_count > 0) {
+    const float time = std::chrono::duration<float>(
+                           snapshot->update_start - start_time_)
+                           .count();
+    snapshot->camera.position =
+        glm::vec2(std::cos(time * 0.5f) * kCameraPathRadius,
+                  std::sin(time * 0.5f) * kCameraPathRadius);
+  }
+  const std::vector<uint32_t> &visible = scene_culler_->Cull(
+      scene_, ExtractFrustum(snapshot->camera.GetViewProjection()));
+  snapshot->visible_objects.assign(visible.begin(), visible.end());
+  snapshot->culling = scene_culler_->GetStats();
+}
+
+void Application::WaitForNextFrame() {
+  const auto now_ns = [] {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  };
+  FrameStartWaits waits;
+  if (frame_latency_waitable_) {
+    PROFILE_SCOPE("WaitForSwapChain");
+    const bool blocked =
+        WaitForSingleObjectEx(frame_latency_waitable_, 0, TRUE) ==
+        WAIT_TIMEOUT;
+    if (blocked) {
+      WaitForSingleObjectEx(frame_latency_waitable_, 1000, TRUE);
+    }
+    waits.OnWaitEnd(now_ns(), blocked);
+  }
+  // Only blocks when the allocator of the oldest frame in flight is still in
+  // use by the GPU
+  const uint64_t stalls = frame_scheduler_->GetStats().stalls;
+  {
+    PROFILE_SCOPE("WaitForPreviousFrame");
+    frame_scheduler_->BeginFrame();
+  }
+  waits.OnWaitEnd(now_ns(), frame_scheduler_->GetStats().stalls != stalls);
+  // The frame that used the slot before completed, buffers released up to
+  // it are free again and heap blocks left empty are destroyed
+  gpu_memory_->Collect();
+  frame_cpu_start_ = std::chrono::steady_clock::now();
+  if (settings_.present_mode == PresentMode::kVsync) {
+    return;
+  }
+
+  frame_pacer_.OnWaitEnd(waits.GetEndTime(), waits.IsBlocked());
+  const uint64_t delay_ns = frame_pacer_.GetDelay();
+  if (delay_ns > 0) {
+    PROFILE_SCOPE("FramePacing");
+    WaitUntil(frame_cpu_start_ + std::chrono::nanoseconds(delay_ns));
+    frame_cpu_start_ = std::chrono::steady_clock::now();
+  }
+  frame_pacer_.OnDelay(delay_ns);
 }
 
 void Application::OnRender() {
-  PopulateCommandList();
+  if (readback_ring_) {
+    PROFILE_SCOPE("AcquireReadback");
+    readback_ring_->BeginFrame(frame_sink_.get());
+  }
+  const uint32_t frame_slot = frame_scheduler_->GetFrameSlot();
+  const auto frame_start = std::chrono::steady_clock::now();
+  if (frame_scheduler_->GetFrameNumber() > 0) {
+    frame_times_.AddFrame(std::chrono::duration<double, std::milli>(
+                              frame_start - last_frame_start_)
+                              .count());
+  }
+  last_frame_start_ = frame_start;
+#ifdef ENABLE_PROFILER
+  // The frame that used the slot before has completed, and so have its
+  // timestamp queries
+  gpu_profiler_->CollectFrame(frame_slot);
+  Profiler::Get().Collect();
+#endif
 
-  // Execute the command list
-  ID3D12CommandList *command_lists[] = {command_list_.Get()};
-  command_queue_->ExecuteCommandLists(_countof(command_lists), command_lists);
+  // Compact the buffer heaps a little every frame, so that blocks left
+  // sparse by evicted LODs are eventually released
+  {
+    PROFILE_SCOPE("DefragmentGpuMemory");
+    if (gpu_memory_->Defragment(upload_ring_.get(),
+                                kDefragmentBytesPerFrame) > 0) {
+      RebindMeshBuffers();
+    }
+  }
 
-  // Present the frame
-  if (FAILED(swap_chain_->Present(1, 0))) {
-    throw std::runtime_error("Failed to present the frame");
+  // Submit every visible object on its own at the LOD its size on screen
+  // needs, unless larger objects occlude it. The queue sorts them by state
+  // and merges equal meshes into instanced draws.
+  {
+    PROFILE_SCOPE("BuildDrawQueue");
+    const uint32_t pipeline = pipeline_readiness_.Resolve(
+        settings_.wireframe ? kWireframePipeline : kSolidPipeline);
+    UpdateStreaming();
+    frame_items_.clear();
+    frame_objects_.clear();
+    for (uint32_t object : snapshot_->visible_objects) {
+      const ObjectData object_data = {
+          snapshot_->camera.ToClipSpace(scene_.GetInstance(object)),
+          scene_.GetColor(object)};
+      const uint32_t mesh = scene_.GetMesh(object);
+      const std::vector<MeshLod> &lods = mesh_lods_[mesh];
+      const float pixels_per_unit =
+          0.5f * std::max(std::abs(object_data.transform.scale.x) *
+                              viewport_.Width,
+                          std::abs(object_data.transform.scale.y) *
+                              viewport_.Height);
+      uint32_t lod =
+          SelectLod(lods.data(), static_cast<uint32_t>(lods.size()),
+                    pixels_per_unit, settings_.lod_error_pixels);
+      // Until the LOD streams in the finest resident one stands in for it
+      const uint32_t resource = mesh_resources_[mesh];
+      streaming_->Request(resource, lod, pixels_per_unit);
+      lod = std::max(lod, streaming_->GetResidentLevel(resource));
+      frame_items_.push_back({0, pipeline, mesh + lod});
+      frame_objects_.push_back(object_data);
+    }
+    // Wireframe objects hide nothing behind them
+    if (settings_.occluder_count > 0 && pipeline == kSolidPipeline) {
+      CullOccludedObjects();
+    } else {
+      occlusion_culler_.reset();
+    }
+
+    draw_queue_->Reset();
+    lod_triangles_ = 0;
+    full_detail_triangles_ = 0;
+    for (size_t i = 0; i < frame_items_.size(); i++) {
+      if (occlusion_culler_ && !occlusion_visible_[i]) {
+        continue;
+      }
+      const uint32_t mesh = scene_.GetMesh(snapshot_->visible_objects[i]);
+      const std::vector<MeshLod> &lods = mesh_lods_[mesh];
+      lod_triangles_ += lods[frame_items_[i].mesh - mesh].index_count / 3;
+      full_detail_triangles_ += lods[0].index_count / 3;
+      draw_queue_->Push(frame_items_[i], &frame_objects_[i]);
+    }
+    draw_queue_->Build();
+  }
+  // Batches index the objects of the frame in place, nothing is bound per
+  // draw but one root constant
+  const std::vector<uint8_t> &object_data = draw_queue_->GetInstanceData();
+  object_buffer_->Write(frame_slot, object_data.data(), object_data.size());
+  UpdateObjectTable(frame_slot);
+  {
+    PROFILE_SCOPE("CompileRenderGraph");
+    BuildRenderGraph();
   }
 
-  WaitForPreviousFrame();
+  // Record chunks of the frame's draws on the workers, the first chunk
+  // clears and the last one records the passes after the scene
+  const std::vector<DrawChunk> chunks = PartitionDraws(
+      static_cast<uint32_t>(draw_queue_->GetBatches().size()),
+      command_recorder_->GetMaxChunks(), kMinDrawsPerChunk);
+  const std::vector<ID3D12CommandList *> &command_lists =
+      command_recorder_->Record(
+          frame_slot, chunks, nullptr,
+          [&](ID3D12GraphicsCommandList *command_list, uint32_t chunk_index,
+              const DrawChunk &chunk) {
+            PopulateCommandList(command_list, chunk_index,
+                                static_cast<uint32_t>(chunks.size()), chunk);
+          });
+
+  // Fill the descriptor tables recorded by the chunks with one copy
+  descriptor_ring_->Flush();
+
+  // Order the frame after the copies of the meshes it draws, on the GPU only
+  for (const DrawBatch &batch : draw_queue_->GetBatches()) {
+    upload_sync_->Require(mesh_upload_fences_[batch.mesh]);
+  }
+  upload_sync_->BeforeSubmit();
+
+  // Execute every chunk in one batch, lists run in submission order
+  {
+    PROFILE_SCOPE("ExecuteCommandLists");
+    command_queue_->ExecuteCommandLists(
+        static_cast<UINT>(command_lists.size()), command_lists.data());
+  }
+  if (settings_.present_mode != PresentMode::kVsync) {
+    frame_pacer_.OnFrameSubmitted(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - frame_cpu_start_)
+            .count());
+  }
+
+  // Present the frame
+  if (swap_chain_) {
+    PROFILE_SCOPE("Present");
+    const bool unlocked = settings_.present_mode == PresentMode::kUnlocked;
+    if (FAILED(swap_chain_->Present(
+            unlocked ? 0 : 1,
+            unlocked && tearing_supported_ ? DXGI_PRESENT_ALLOW_TEARING
+                                           : 0))) {
+      throw std::runtime_error("Failed to present the frame");
+    }
+  }
+  update_latencies_.AddFrame(std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() -
+                                 snapshot_->update_start)
+                                 .count());
+
+  const uint64_t frame_number = frame_scheduler_->GetFrameNumber();
+  const uint64_t fence_value = frame_scheduler_->EndFrame();
+  descriptor_ring_->FinishFrame(fence_value);
+  gpu_memory_->FinishFrame(fence_value);
+  if (readback_ring_) {
+    // Writes out the earlier frames whose copies completed meanwhile
+    PROFILE_SCOPE("WriteCapturedFrames");
+    readback_ring_->EndFrame(frame_number, fence_value, frame_sink_.get());
+  }
+  frame_index_ = swap_chain_ ? swap_chain_->GetCurrentBackBufferIndex()
+                             : (frame_index_ + 1) % kFrameCount;
+  bundle_cache_->Collect(frame_scheduler_->GetFrameNumber());
+
+  // Report the submission counters of the latest frame once per second
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_stats_report_ >= std::chrono::seconds(1)) {
+    last_stats_report_ = now;
+    const DrawQueueStats &queue_stats = draw_queue_->GetStats();
+    std::cout << "Frame " << frame_scheduler_->GetFrameNumber() << ": "
+              << queue_stats.items << " items, " << queue_stats.draw_calls
+              << " draw calls, " << queue_stats.root_signature_changes
+              << " root signature changes, " << queue_stats.pipeline_changes
+              << " pipeline changes, " << queue_stats.vertex_buffer_changes
+              << " vertex buffer changes" << std::endl;
+    std::cout << "LODs: " << lod_triangles_ << " of "
+              << full_detail_triangles_ << " full detail triangles drawn"
+              << std::endl;
+    std::cout << "Streaming: " << streaming_->GetUsageReport() << std::endl;
+    std::cout << "Frame time: p50 " << frame_times_.GetPercentile(50.0)
+              << " ms, p99 " << frame_times_.GetPercentile(99.0) << " ms"
+              << std::endl;
+    const CullingStats &culling_stats = snapshot_->culling;
+    std::cout << "Culling ("
+              << GetSimdLevelName(scene_culler_->GetSimdLevel())
+              << "): " << culling_stats.visible << " of "
+              << culling_stats.objects << " objects visible in "
+              << culling_stats.time_ns / 1000 << " us" << std::endl;
+    std::cout << "Update to present latency: p50 "
+              << update_latencies_.GetPercentile(50.0) << " ms, p99 "
+              << update_latencies_.GetPercentile(99.0) << " ms";
+    if (update_thread_) {
+      // Updates and frames run at their own rates, the frame count is the
+      // number of the latest frame
+      const UpdateThreadStats update_stats = update_thread_->GetStats();
+      std::cout << ", " << update_stats.updates << " updates on their own "
+                << "thread for " << frame_scheduler_->GetFrameNumber()
+                << " frames, " << update_stats.late_updates << " late, "
+                << update_stats.update_time_ns / 1e6 /
+                       std::max<uint64_t>(update_stats.updates, 1)
+                << " ms/update";
+    }
+    std::cout << std::endl;
+    if (occlusion_culler_) {
+      const OcclusionStats &occlusion_stats = occlusion_culler_->GetStats();
+      std::cout << "Occlusion ("
+                << GetSimdLevelName(occlusion_culler_->GetSimdLevel())
+                << "): " << occlusion_stats.occluded << " of "
+                << occlusion_stats.objects << " objects occluded by "
+                << occlusion_stats.occluders << " in "
+                << (occlusion_stats.rasterize_time_ns +
+                    occlusion_stats.test_time_ns) /
+                       1000
+                << " us" << std::endl;
+    }
+    const ReplayCacheStats bundle_stats = bundle_cache_->GetStats();
+    std::cout << "Bundles: " << bundle_cache_->GetSize() << " cached, "
+              << bundle_stats.hits << " of " << bundle_stats.lookups
+              << " lookups replayed, "
+              << bundle_stats.time_saved_ns / 1000000
+              << " ms recording saved, "
+              << bundle_stats.record_time_ns / 1000000 << " ms recording"
+              << std::endl;
+  }
 }
 
 void Application::OnClose() {
+  update_thread_.reset();
+  job_system_->Wait(&pipeline_jobs_);
+  pipeline_cache_->Save();
+  frame_scheduler_->WaitForIdle();
+  copy_timeline_->WaitForValue(copy_timeline_->Signal());
+  if (readback_ring_) {
+    readback_ring_->Flush(frame_sink_.get());
+    const ReadbackQueueStats &readback_stats = readback_ring_->GetStats();
+    const FrameSinkStats &sink_stats = frame_sink_->GetStats();
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start_time_)
+                               .count();
+    std::cout << "Capture: " << sink_stats.frames << " frames, "
+              << DataSizeToStringNotation(sink_stats.bytes) << " written to "
+              << settings_.capture_path << ", "
+              << sink_stats.frames / seconds << " frames/s, "
+              << readback_stats.stalls << " stalls, latency up to "
+              << readback_stats.max_latency_frames << " frames" << std::endl;
+  }
+
+  if (settings_.present_mode != PresentMode::kVsync) {
+    const FramePacerStats &pacer_stats = frame_pacer_.GetStats();
+    std::cout << "Frame pacing: " << pacer_stats.delayed_frames << " of "
+              << pacer_stats.frames << " frames delayed by "
+              << pacer_stats.delay_ns / 1000000 << " ms in total, "
+              << pacer_stats.late_frames << " late, GPU "
+              << frame_pacer_.PredictGpuTime() / 1e6 << " ms, CPU "
+              << frame_pacer_.PredictCpuTime() / 1e6 << " ms" << std::endl;
+  }
+  std::cout << "Render graph of the last frame:" << std::endl
+            << render_graph_->GetGraph().GetReport();
+  const auto print_heap = [](const char *name, const DescriptorHeap &heap) {
+    const DescriptorAllocatorStats &stats = heap.GetStats();
+    std::cout << name << " heap: " << stats.used << " of " << stats.capacity
+              << " descriptors in use, peak " << stats.peak_used << std::endl;
+  };
+  print_heap("RTV", *rtv_heap_);
+  print_heap("CBV/SRV/UAV", *cbv_srv_uav_heap_);
+  print_heap("DSV", *dsv_heap_);
+  const RingAllocatorStats &ring_stats = descriptor_ring_->GetStats();
+  std::cout << "Descriptor ring: peak " << ring_stats.peak_usage << " of "
+            << descriptor_ring_->GetCapacity() << " descriptors, "
+            << ring_stats.allocations << " tables, " << ring_stats.full_stalls
+            << " stalls" << std::endl;
+  const QueueSyncStats &upload_sync_stats = upload_sync_->GetStats();
+  std::cout << "Copy queue: " << upload_sync_stats.gpu_waits
+            << " GPU waits in " << upload_sync_stats.submissions
+            << " frames drawing uploads" << std::endl;
+  const PipelineReadinessStats pipeline_stats =
+      pipeline_readiness_.GetStats();
+  std::cout << "Pipelines: " << pipeline_stats.ready << " of "
+            << pipeline_readiness_.GetPipelineCount() << " ready, "
+            << pipeline_stats.failed << " failed, "
+            << pipeline_stats.fallbacks << " frames drew a fallback"
+            << std::endl;
+
+#ifdef ENABLE_PROFILER
+  // Pick up the timestamps of the frames still in the slots
+  for (uint32_t slot = 0; slot < frame_scheduler_->GetFramesInFlight();
+       slot++) {
+    gpu_profiler_->CollectFrame(slot);
+  }
+  Profiler::Get().Collect();
+  const ProfilerStats profiler_stats = Profiler::Get().GetStats();
+  std::cout << "Profiler: " << profiler_stats.collected_events
+            << " events, " << profiler_stats.dropped_events << " dropped"
+            << std::endl;
+  if (!settings_.trace_path.empty()) {
+    Profiler::Get().WriteChromeTrace(settings_.trace_path);
+    std::cout << "Wrote trace to " << settings_.trace_path << std::endl;
+  }
+#endif
 }
 
-void Application::LoadPipeline() {
+void Application::CreateDevice() {
   uint32_t dxgi_factory_flags = 0;
 #ifdef _DEBUG
   ComPtr<ID3D12Debug> debug_controller;
@@ -180,10 +736,8 @@ void Application::LoadPipeline() {
   }
 
   ComPtr<IDXGIAdapter1> hardware_adapter;
-  GetHardwareAdapter(factory_.Get(), &hardware_adapter);
-
-  if (FAILED(D3D12CreateDevice(hardware_adapter.Get(), D3D_FEATURE_LEVEL_11_0,
-                               IID_PPV_ARGS(&device_)))) {
+  CreateHardwareDevice(factory_.Get(), &hardware_adapter, &device_);
+  if (!device_) {
     throw std::runtime_error("Failed to create D3D12 device");
   }
 
@@ -192,7 +746,15 @@ void Application::LoadPipeline() {
   hardware_adapter->GetDesc1(&adapter_desc);
   std::cout << "Selected Device: " << WStringToString(adapter_desc.Description)
             << std::endl;
+  video_memory_ = adapter_desc.DedicatedVideoMemory != 0
+                      ? adapter_desc.DedicatedVideoMemory
+                      : adapter_desc.SharedSystemMemory;
+  // The budget of the OS follows what other processes use, streaming
+  // follows it when available
+  hardware_adapter.As(&adapter_);
+}
 
+void Application::CreateQueues() {
   // Create command queue
   D3D12_COMMAND_QUEUE_DESC command_queue_desc = {};
   command_queue_desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
@@ -202,273 +764,570 @@ void Application::LoadPipeline() {
     throw std::runtime_error("Failed to create command queue");
   }
 
-  // Get Window Frame height and width from GLFW
-  int window_frame_width, window_frame_height;
-  glfwGetFramebufferSize(window_, &window_frame_width, &window_frame_height);
+  // Create the copy queue for uploads, which run beside rendering
+  D3D12_COMMAND_QUEUE_DESC copy_queue_desc = {};
+  copy_queue_desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+  copy_queue_desc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+  if (FAILED(device_->CreateCommandQueue(&copy_queue_desc,
+                                         IID_PPV_ARGS(&copy_queue_)))) {
+    throw std::runtime_error("Failed to create copy queue");
+  }
 
-  // Create descriptor heap for render target view
-  {
-    D3D12_DESCRIPTOR_HEAP_DESC rtv_heap_desc = {};
-    rtv_heap_desc.NumDescriptors = kFrameCount;
-    rtv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-    rtv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    if (FAILED(device_->CreateDescriptorHeap(&rtv_heap_desc,
-                                             IID_PPV_ARGS(&rtv_heap_)))) {
-      throw std::runtime_error(
-          "Failed to create descriptor heap for render target view");
-    }
-    rtv_descriptor_size_ = device_->GetDescriptorHandleIncrementSize(
-        D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+  // Create the fence timelines and the frame scheduler on top of them
+  timeline_ =
+      std::make_unique<D3D12GpuTimeline>(device_.Get(), command_queue_.Get());
+  copy_timeline_ =
+      std::make_unique<D3D12GpuTimeline>(device_.Get(), copy_queue_.Get());
+  frame_scheduler_ = std::make_unique<FrameScheduler>(
+      timeline_.get(), settings_.frames_in_flight);
+  upload_ring_ = std::make_unique<UploadRing>(
+      device_.Get(), copy_queue_.Get(), copy_timeline_.get());
+  upload_sync_ =
+      std::make_unique<QueueSync>(copy_timeline_.get(), timeline_.get());
+  gpu_memory_ = std::make_unique<GpuMemoryManager>(
+      device_.Get(), timeline_.get(), video_memory_);
+  StreamingSettings streaming_settings;
+  streaming_settings.budget = settings_.streaming_budget != 0
+                                  ? settings_.streaming_budget
+                                  : video_memory_;
+  streaming_ = std::make_unique<StreamingManager>(streaming_settings);
+  render_graph_ =
+      std::make_unique<D3D12RenderGraph>(device_.Get(), timeline_.get());
+
+  // Create the descriptor heaps, swap chain buffers keep their render target
+  // view slots across resizes
+  rtv_heap_ = std::make_unique<DescriptorHeap>(
+      device_.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, kRtvHeapCapacity);
+  for (uint32_t i = 0; i < kFrameCount; i++) {
+    rtv_descriptors_[i] = rtv_heap_->Allocate();
+  }
+  cbv_srv_uav_heap_ = std::make_unique<DescriptorHeap>(
+      device_.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+      kCbvSrvUavHeapCapacity);
+  dsv_heap_ = std::make_unique<DescriptorHeap>(
+      device_.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV, kDsvHeapCapacity);
+  descriptor_ring_ = std::make_unique<ShaderVisibleDescriptorRing>(
+      device_.Get(), timeline_.get());
+
+  // Create a command list per worker, each with one allocator per frame in
+  // flight
+  command_recorder_ = std::make_unique<ParallelCommandRecorder>(
+      device_.Get(), job_system_.get(), settings_.frames_in_flight,
+      job_system_->GetThreadCount());
+  chunk_streams_.resize(command_recorder_->GetMaxChunks());
+#ifdef ENABLE_PROFILER
+  gpu_profiler_ = std::make_unique<GpuProfiler>(
+      device_.Get(), command_queue_.Get(), settings_.frames_in_flight,
+      command_recorder_->GetMaxChunks() + 1);
+#endif
+  bundle_cache_ =
+      std::make_unique<BundleCache>(device_.Get(), kMaxUnusedBundleFrames);
+
+  // One upload buffer of object data per frame in flight
+  object_buffer_ = std::make_unique<FrameUploadBuffer>(
+      device_.Get(), settings_.frames_in_flight);
+  object_srvs_.resize(settings_.frames_in_flight);
+  for (uint32_t &srv : object_srvs_) {
+    srv = cbv_srv_uav_heap_->Allocate();
   }
+  object_table_capacities_.assign(settings_.frames_in_flight, 0);
+}
 
-  // Create swap chain
-  BuildSwapchain(window_frame_width, window_frame_height);
+void Application::CreateRootSignature() {
+  // The mesh constants, the first object of the draw and the table of the
+  // objects buffer
+  CD3DX12_DESCRIPTOR_RANGE object_range;
+  object_range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+  CD3DX12_ROOT_PARAMETER root_parameters[3];
+  root_parameters[kMeshConstantsParameter].InitAsConstants(
+      kMeshConstantCount, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+  root_parameters[kDrawConstantsParameter].InitAsConstants(
+      kDrawConstantCount, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+  root_parameters[kObjectTableParameter].InitAsDescriptorTable(
+      1, &object_range, D3D12_SHADER_VISIBILITY_VERTEX);
+
+  D3D12_ROOT_SIGNATURE_DESC root_signature_desc = {};
+  root_signature_desc.NumParameters = _countof(root_parameters);
+  root_signature_desc.pParameters = root_parameters;
+  root_signature_desc.NumStaticSamplers = 0;
+  root_signature_desc.pStaticSamplers = nullptr;
+  root_signature_desc.Flags =
+      D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+
+  ComPtr<ID3DBlob> signature;
+  ComPtr<ID3DBlob> error;
+  ComPtr<ID3D12RootSignature> root_signature;
+  if (FAILED(D3D12SerializeRootSignature(&root_signature_desc,
+                                         D3D_ROOT_SIGNATURE_VERSION_1,
+                                         &signature, &error))) {
+    throw std::runtime_error("Failed to serialize root signature");
+  }
 
-  // Create commandAllocator
-  if (FAILED(device_->CreateCommandAllocator(
-          D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&command_allocator_)))) {
-    throw std::runtime_error("Failed to create command allocator");
+  if (FAILED(device_->CreateRootSignature(0, signature->GetBufferPointer(),
+                                          signature->GetBufferSize(),
+                                          IID_PPV_ARGS(&root_signature)))) {
+    throw std::runtime_error("Failed to create root signature");
   }
+  root_signatures_.push_back(root_signature);
 }
 
-void Application::LoadAssets() {
-  // Create an empty root signature
-  {
-    D3D12_ROOT_SIGNATURE_DESC root_signature_desc = {};
-    root_signature_desc.NumParameters = 0;
-    root_signature_desc.pParameters = nullptr;
-    root_signature_desc.NumStaticSamplers = 0;
-    root_signature_desc.pStaticSamplers = nullptr;
-    root_signature_desc.Flags =
-        D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
-
-    ComPtr<ID3DBlob> signature;
-    ComPtr<ID3DBlob> error;
-    if (FAILED(D3D12SerializeRootSignature(&root_signature_desc,
-                                           D3D_ROOT_SIGNATURE_VERSION_1,
-                                           &signature, &error))) {
-      throw std::runtime_error("Failed to serialize root signature");
-    }
+void Application::CreatePipeline(
+    uint32_t pipeline,
+    D3D12_FILL_MODE fill_mode,
+    const ShaderCompileRequest &vertex_request,
+    const std::vector<uint8_t> &vertex_shader,
+    const ShaderCompileRequest &pixel_request,
+    const std::vector<uint8_t> &pixel_shader) {
+  // Generate the input layout from the vertex layout, per object data is
+  // read from the objects buffer instead
+  std::vector<D3D12_INPUT_ELEMENT_DESC> input_element_descs;
+  AppendInputElements<Vertex>(0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+                              &input_element_descs);
+
+  // Describe and create the graphics pipeline state object (PSO)
+  D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
+  pso_desc.InputLayout = {input_element_descs.data(),
+                          static_cast<UINT>(input_element_descs.size())};
+  pso_desc.pRootSignature = root_signatures_[0].Get();
+  pso_desc.VS = {vertex_shader.data(), vertex_shader.size()};
+  pso_desc.PS = {pixel_shader.data(), pixel_shader.size()};
+  pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+  pso_desc.RasterizerState.FillMode = fill_mode;
+  pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+  pso_desc.DepthStencilState.DepthEnable = FALSE;
+  pso_desc.DepthStencilState.StencilEnable = FALSE;
+  pso_desc.SampleMask = UINT_MAX;
+  pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+  pso_desc.NumRenderTargets = 1;
+  pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+  pso_desc.SampleDesc.Count = 1;
+
+  // The description only varies with the shaders and the fill mode, so
+  // they name it
+  const std::string pipeline_name =
+      std::string(fill_mode == D3D12_FILL_MODE_WIREFRAME ? "wireframe_"
+                                                         : "main_") +
+      HashToString(shader_cache_->ComputeKey(vertex_request)) + "_" +
+      HashToString(shader_cache_->ComputeKey(pixel_request));
+  pipeline_states_[pipeline] =
+      pipeline_cache_->GetGraphicsPipeline(pipeline_name, pso_desc);
+  pipeline_readiness_.MarkReady(pipeline);
+}
 
-    if (FAILED(device_->CreateRootSignature(0, signature->GetBufferPointer(),
-                                            signature->GetBufferSize(),
-                                            IID_PPV_ARGS(&root_signature_)))) {
-      throw std::runtime_error("Failed to create root signature");
+uint32_t Application::LoadMesh(const MeshView &mesh) {
+  const uint64_t vertex_buffer_size =
+      uint64_t(mesh.vertex_count) * sizeof(Vertex);
+
+  // Sub-allocate the buffer from default heap blocks
+  vertex_buffer_ = gpu_memory_->CreateBuffer(vertex_buffer_size);
+
+  // Stage the data in the upload ring and schedule copies into the default
+  // heap. The view may point into a file mapping, then the staging copy is
+  // the only one the data goes through. The block buffers are promoted to
+  // COPY_DEST by the copies and decay back to COMMON, from which frames read
+  // them without a barrier.
+  upload_ring_->UploadBuffer(gpu_memory_->GetResource(vertex_buffer_),
+                             gpu_memory_->GetOffset(vertex_buffer_),
+                             mesh.vertices, vertex_buffer_size);
+
+  // Every LOD indexes the one vertex buffer through an index buffer of its
+  // own, bound once resident
+  MeshBufferBindings buffers;
+  buffers.vertex_buffer = {gpu_memory_->GetGpuAddress(vertex_buffer_),
+                           static_cast<uint32_t>(vertex_buffer_size),
+                           sizeof(Vertex)};
+  buffers.index_buffer = {
+      0, 0,
+      mesh.index_size == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT};
+  const uint8_t *indices = static_cast<const uint8_t *>(mesh.indices);
+  std::vector<StreamingLevel> levels;
+  uint32_t mesh_id = 0;
+  for (uint32_t lod = 0; lod < mesh.lod_count; lod++) {
+    const uint32_t buffer_id = static_cast<uint32_t>(mesh_buffers_.size());
+    mesh_buffers_.push_back(buffers);
+    const uint32_t lod_mesh_id =
+        draw_queue_->AddMesh({buffer_id, 0, mesh.lods[lod].index_count, 0});
+    if (lod == 0) {
+      mesh_id = lod_mesh_id;
     }
+    levels.push_back(
+        {indices + uint64_t(mesh.lods[lod].first_index) * mesh.index_size,
+         uint64_t(mesh.lods[lod].index_count) * mesh.index_size});
   }
+  const uint32_t mesh_count = mesh_id + mesh.lod_count;
+  mesh_quantizations_.resize(mesh_count, mesh.quantization);
+  mesh_lods_.resize(mesh_count);
+  mesh_lods_[mesh_id].assign(mesh.lods, mesh.lods + mesh.lod_count);
+  mesh_views_.resize(mesh_count);
+  mesh_views_[mesh_id] = mesh;
+  mesh_resources_.resize(mesh_count);
+  lod_index_buffers_.resize(mesh_count, GpuMemoryManager::kInvalidBuffer);
+
+  // The coarsest LOD is resident from the start, the streaming manager
+  // brings in the others as objects need them
+  const uint32_t resource = streaming_->AddResource(levels);
+  mesh_resources_[mesh_id] = resource;
+  streamed_meshes_.resize(resource + 1);
+  streamed_meshes_[resource] = mesh_id;
+  const StreamingLevel &coarsest = levels.back();
+  UploadLodIndices(mesh_count - 1, coarsest.source, coarsest.size);
+
+  // Start the copies right away instead of batching them with later meshes
+  mesh_upload_fences_.resize(mesh_count, upload_ring_->Submit());
+  return mesh_id;
+}
 
-  // Create the pipeline state, which includes compiling and loading shaders
-  {
-    ComPtr<ID3DBlob> vertex_shader;
-    ComPtr<ID3DBlob> pixel_shader;
-    ComPtr<ID3DBlob> error;
-#ifdef _DEBUG
-    uint32_t compile_flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-    uint32_t compile_flags = 0;
-#endif
-
-    if (FAILED(D3DCompileFromFile(L"../../shaders/main.hlsl", nullptr, nullptr,
-                                  "VSMain", "vs_5_0", compile_flags, 0,
-                                  &vertex_shader, &error))) {
-      throw std::runtime_error("Failed to compile vertex shader");
-    }
+void Application::UploadLodIndices(uint32_t mesh_id,
+                                   const uint8_t *data,
+                                   uint64_t size) {
+  const GpuBufferHandle index_buffer = gpu_memory_->CreateBuffer(size);
+  upload_ring_->UploadBuffer(gpu_memory_->GetResource(index_buffer),
+                             gpu_memory_->GetOffset(index_buffer), data,
+                             size);
+  lod_index_buffers_[mesh_id] = index_buffer;
+  SetIndexBufferCommand &binding =
+      mesh_buffers_[draw_queue_->GetMesh(mesh_id).vertex_buffer]
+          .index_buffer;
+  binding.address = gpu_memory_->GetGpuAddress(index_buffer);
+  binding.size = static_cast<uint32_t>(size);
+}
 
-    if (FAILED(D3DCompileFromFile(L"../../shaders/main.hlsl", nullptr, nullptr,
-                                  "PSMain", "ps_5_0", compile_flags, 0,
-                                  &pixel_shader, &error))) {
-      throw std::runtime_error("Failed to compile pixel shader");
+void Application::RebindMeshBuffers() {
+  for (uint32_t mesh_id = 0; mesh_id < lod_index_buffers_.size();
+       mesh_id++) {
+    MeshBufferBindings &buffers =
+        mesh_buffers_[draw_queue_->GetMesh(mesh_id).vertex_buffer];
+    buffers.vertex_buffer.address = gpu_memory_->GetGpuAddress(vertex_buffer_);
+    if (lod_index_buffers_[mesh_id] != GpuMemoryManager::kInvalidBuffer) {
+      buffers.index_buffer.address =
+          gpu_memory_->GetGpuAddress(lod_index_buffers_[mesh_id]);
     }
+  }
+}
 
-    // Define the vertex input layout
-    D3D12_INPUT_ELEMENT_DESC input_element_descs[] = {
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
-         static_cast<UINT>(offsetof(Vertex, position)),
-         D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-        {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
-         static_cast<UINT>(offsetof(Vertex, color)),
-         D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
-
-    // Describe and create the graphics pipeline state object (PSO)
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
-    pso_desc.InputLayout = {input_element_descs, _countof(input_element_descs)};
-    pso_desc.pRootSignature = root_signature_.Get();
-    //        pso_desc.VS = {reinterpret_cast<UINT8
-    //        *>(vertex_shader->GetBufferPointer()),
-    //        vertex_shader->GetBufferSize()}; pso_desc.PS =
-    //        {reinterpret_cast<UINT8 *>(pixel_shader->GetBufferPointer()),
-    //        pixel_shader->GetBufferSize()};
-    pso_desc.VS = CD3DX12_SHADER_BYTECODE(vertex_shader.Get());
-    pso_desc.PS = CD3DX12_SHADER_BYTECODE(pixel_shader.Get());
-    pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-    pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-    pso_desc.DepthStencilState.DepthEnable = FALSE;
-    pso_desc.DepthStencilState.StencilEnable = FALSE;
-    pso_desc.SampleMask = UINT_MAX;
-    pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-    pso_desc.NumRenderTargets = 1;
-    pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-    pso_desc.SampleDesc.Count = 1;
-
-    if (FAILED(device_->CreateGraphicsPipelineState(
-            &pso_desc, IID_PPV_ARGS(&pipeline_state_)))) {
-      throw std::runtime_error("Failed to create graphics pipeline state");
+void Application::UpdateStreaming() {
+  PROFILE_SCOPE("UpdateStreaming");
+  if (settings_.streaming_budget == 0 && adapter_) {
+    // Streaming gets what the OS grants the process beyond everything else
+    // the process uses
+    DXGI_QUERY_VIDEO_MEMORY_INFO memory_info;
+    if (SUCCEEDED(adapter_->QueryVideoMemoryInfo(
+            0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memory_info))) {
+      const StreamingStats &stats = streaming_->GetStats();
+      const uint64_t streamed = stats.resident_bytes + stats.pending_bytes;
+      const uint64_t other_usage = memory_info.CurrentUsage > streamed
+                                       ? memory_info.CurrentUsage - streamed
+                                       : 0;
+      streaming_->SetBudget(memory_info.Budget > other_usage
+                                ? memory_info.Budget - other_usage
+                                : 0);
     }
   }
-
-  // Create Command List
-  if (FAILED(device_->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-                                        command_allocator_.Get(), nullptr,
-                                        IID_PPV_ARGS(&command_list_)))) {
-    throw std::runtime_error("Failed to create command list");
+  streaming_->Update();
+
+  // Frames in flight may still draw evicted LODs, their ranges are reused
+  // once the GPU is done with them
+  for (const StreamedLevel &level : streaming_->GetEvictedLevels()) {
+    const uint32_t mesh_id = streamed_meshes_[level.resource] + level.level;
+    gpu_memory_->ReleaseBuffer(lod_index_buffers_[mesh_id]);
+    lod_index_buffers_[mesh_id] = GpuMemoryManager::kInvalidBuffer;
   }
-
-  // Create vertex buffer
-  {
-    Vertex triangle_vertices[] = {
-        {{0.0f, 0.25f * 2, 0.0f}, {1.0f, 0.0f, 0.0f}},
-        {{0.25f * 2, -0.25f * 2, 0.0f}, {0.0f, 1.0f, 0.0f}},
-        {{-0.25f * 2, -0.25f * 2, 0.0f}, {0.0f, 0.0f, 1.0f}}};
-    const uint32_t vertex_buffer_size = sizeof(triangle_vertices);
-
-    CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_DEFAULT);
-    CD3DX12_RESOURCE_DESC buffer_desc =
-        CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size);
-
-    // Create default heap
-    if (FAILED(device_->CreateCommittedResource(
-            &heap_properties, D3D12_HEAP_FLAG_NONE, &buffer_desc,
-            D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-            IID_PPV_ARGS(&vertex_buffer_)))) {
-      throw std::runtime_error("Failed to create vertex buffer");
-    }
-
-    // Create upload heap
-    ComPtr<ID3D12Resource> vertex_buffer_upload;
-    heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size);
-    if (FAILED(device_->CreateCommittedResource(
-            &heap_properties, D3D12_HEAP_FLAG_NONE, &buffer_desc,
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-            IID_PPV_ARGS(&vertex_buffer_upload)))) {
-      throw std::runtime_error("Failed to create vertex buffer upload");
-    }
-
-    // Copy data to the intermediate upload heap and then schedule a copy
-    D3D12_SUBRESOURCE_DATA vertex_data = {};
-    vertex_data.pData = reinterpret_cast<UINT8 *>(triangle_vertices);
-    vertex_data.RowPitch = vertex_buffer_size;
-    vertex_data.SlicePitch = vertex_data.RowPitch;
-
-    UpdateSubresources(command_list_.Get(), vertex_buffer_.Get(),
-                       vertex_buffer_upload.Get(), 0, 0, 1, &vertex_data);
-
-    // Transition the vertex buffer from copy destination state to vertex buffer
-    // state
-    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-        vertex_buffer_.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
-        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-    command_list_->ResourceBarrier(1, &barrier);
-
-    // Initialize vertex buffer view
-    vertex_buffer_view_.BufferLocation = vertex_buffer_->GetGPUVirtualAddress();
-    vertex_buffer_view_.StrideInBytes = sizeof(Vertex);
-    vertex_buffer_view_.SizeInBytes = vertex_buffer_size;
-
-    // Close the command list and execute it to begin the vertex buffer copy
-    // into the default heap
-    if (FAILED(command_list_->Close())) {
-      throw std::runtime_error("Failed to close command list");
-    }
-    ID3D12CommandList *command_lists[] = {command_list_.Get()};
-    command_queue_->ExecuteCommandLists(_countof(command_lists), command_lists);
-
-    // Create synchronization event and wait for the vertex buffer copy to
-    // complete
-    if (FAILED(device_->CreateFence(0, D3D12_FENCE_FLAG_NONE,
-                                    IID_PPV_ARGS(&fence_)))) {
-      throw std::runtime_error("Failed to create fence");
-    }
-    fence_value_ = 1;
-    fence_event_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (fence_event_ == nullptr) {
-      throw std::runtime_error("Failed to create fence event");
+  const std::vector<StreamedLevel> &loaded = streaming_->GetLoadedLevels();
+  for (const StreamedLevel &level : loaded) {
+    UploadLodIndices(streamed_meshes_[level.resource] + level.level,
+                     streaming_->GetLevelData(level.resource, level.level),
+                     streaming_->GetLevelSize(level.resource, level.level));
+  }
+  if (!loaded.empty()) {
+    // Frames drawing the LODs wait for the copies on the GPU
+    const uint64_t fence_value = upload_ring_->Submit();
+    for (const StreamedLevel &level : loaded) {
+      mesh_upload_fences_[streamed_meshes_[level.resource] + level.level] =
+          fence_value;
     }
-
-    WaitForPreviousFrame();
   }
 }
 
-void Application::WaitForPreviousFrame() {
-  // WAITING FOR THE FRAME TO COMPLETE BEFORE CONTINUING IS NOT BEST PRACTICE.
-  // This is code implemented as such for simplicity. More advanced samples
-  // illustrate how to use fences for efficient resource usage.
-
-  // Signal and increment the fence value.
-  const uint64_t fence = fence_value_;
-  if (FAILED(command_queue_->Signal(fence_.Get(), fence))) {
-    throw std::runtime_error("Failed to signal fence");
+void Application::CullOccludedObjects() {
+  PROFILE_SCOPE("OcclusionCulling");
+  const uint32_t width = std::max(
+      static_cast<uint32_t>(viewport_.Width) / kOcclusionBufferDivisor, 1u);
+  const uint32_t height = std::max(
+      static_cast<uint32_t>(viewport_.Height) / kOcclusionBufferDivisor, 1u);
+  if (!occlusion_culler_ || occlusion_culler_->GetWidth() != width ||
+      occlusion_culler_->GetHeight() != height) {
+    occlusion_culler_ =
+        std::make_unique<OcclusionCuller>(job_system_.get(), width, height);
   }
-  fence_value_++;
 
-  // Wait until the previous frame is finished.
-  if (fence_->GetCompletedValue() < fence) {
-    if (FAILED(fence_->SetEventOnCompletion(fence, fence_event_))) {
-      throw std::runtime_error("Failed to set event on completion");
-    }
-    WaitForSingleObjectEx(fence_event_, INFINITE, FALSE);
+  // Without depth testing what is drawn later covers what was drawn before,
+  // so the draw order is the depth
+  const uint32_t count = static_cast<uint32_t>(frame_items_.size());
+  frame_depths_.resize(count);
+  ComputeDrawOrderDepths(*draw_queue_, frame_items_.data(), count,
+                         frame_depths_.data());
+
+  // The largest objects on screen hide the most
+  occluders_.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    occluders_[i] = i;
+  }
+  const auto screen_area = [this](uint32_t i) {
+    const InstanceData &transform = frame_objects_[i].transform;
+    return std::abs(transform.scale.x * transform.scale.y);
+  };
+  const uint32_t occluder_count = std::min(settings_.occluder_count, count);
+  std::nth_element(occluders_.begin(), occluders_.begin() + occluder_count,
+                   occluders_.end(), [&](uint32_t a, uint32_t b) {
+                     return screen_area(a) > screen_area(b);
+                   });
+  occlusion_culler_->BeginFrame();
+  for (uint32_t i = 0; i < occluder_count; i++) {
+    const uint32_t object = occluders_[i];
+    const uint32_t mesh = scene_.GetMesh(snapshot_->visible_objects[object]);
+    const uint32_t lod = frame_items_[object].mesh - mesh;
+    const MeshView &view = mesh_views_[mesh];
+    const MeshLod &mesh_lod = mesh_lods_[mesh][lod];
+    // The object is drawn at a resident LOD, whose indices are read straight
+    // out of the mesh file the streaming manager faulted in
+    const OccluderMesh occluder = {
+        view.vertices,
+        view.vertex_count,
+        static_cast<const uint8_t *>(view.indices) +
+            uint64_t(mesh_lod.first_index) * view.index_size,
+        mesh_lod.index_count,
+        view.index_size,
+        view.quantization};
+    occlusion_culler_->AddOccluder(occluder, frame_objects_[object].transform,
+                                   frame_depths_[object]);
   }
+  occlusion_culler_->Rasterize();
 
-  frame_index_ = swap_chain_->GetCurrentBackBufferIndex();
+  occlusion_queries_.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    occlusion_queries_[i] = {frame_objects_[i].transform,
+                             mesh_quantizations_[frame_items_[i].mesh],
+                             frame_depths_[i]};
+  }
+  occlusion_culler_->Test(occlusion_queries_.data(), count,
+                          &occlusion_visible_);
 }
 
-void Application::PopulateCommandList() {
-  // Reset the command allocator
-  if (FAILED(command_allocator_->Reset())) {
-    throw std::runtime_error("Failed to reset command allocator");
+void Application::UpdateObjectTable(uint32_t frame_slot) {
+  const D3D12_CPU_DESCRIPTOR_HANDLE srv =
+      cbv_srv_uav_heap_->GetCpuHandle(object_srvs_[frame_slot]);
+  const uint64_t capacity = object_buffer_->GetCapacity(frame_slot);
+  if (object_table_capacities_[frame_slot] != capacity) {
+    // Shaders read the copy in the table of their frame, rewriting the view
+    // leaves frames in flight alone
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srv_desc.Shader4ComponentMapping =
+        D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Buffer.FirstElement = 0;
+    srv_desc.Buffer.NumElements =
+        static_cast<UINT>(capacity / sizeof(ObjectData));
+    srv_desc.Buffer.StructureByteStride = sizeof(ObjectData);
+    srv_desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    device_->CreateShaderResourceView(object_buffer_->GetBuffer(frame_slot),
+                                      &srv_desc, srv);
+    object_table_capacities_[frame_slot] = capacity;
   }
+  // Copied by the Flush after recording
+  object_table_ = descriptor_ring_->AllocateTable(&srv, 1);
+}
 
-  // Reset the command list
-  if (FAILED(command_list_->Reset(command_allocator_.Get(),
-                                  pipeline_state_.Get()))) {
-    throw std::runtime_error("Failed to reset command list");
+void Application::PopulateCommandList(ID3D12GraphicsCommandList *command_list,
+                                      uint32_t chunk_index,
+                                      uint32_t chunk_count,
+                                      const DrawChunk &chunk) {
+  PROFILE_SCOPE("PopulateCommandList");
+  const uint32_t frame_slot = frame_scheduler_->GetFrameSlot();
+#ifdef ENABLE_PROFILER
+  if (chunk_index == 0) {
+    gpu_profiler_->BeginScope(command_list, frame_slot, 0, "Frame");
   }
+  gpu_profiler_->BeginScope(command_list, frame_slot, chunk_index + 1,
+                            "Chunk");
+#endif
 
-  // Set necessary state
-  command_list_->SetGraphicsRootSignature(root_signature_.Get());
-  command_list_->RSSetViewports(1, &viewport_);
-  command_list_->RSSetScissorRects(1, &scissor_rect_);
-
-  // Indicate that the back buffer will be used as a render target
-  CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-      render_targets_[frame_index_].Get(), D3D12_RESOURCE_STATE_PRESENT,
-      D3D12_RESOURCE_STATE_RENDER_TARGET);
-  command_list_->ResourceBarrier(1, &barrier);
+  // Bundles can not set the viewport, render targets or barriers and depend
+  // on the back buffer, so every frame records them directly
+  ID3D12DescriptorHeap *descriptor_heaps[] = {descriptor_ring_->GetHeap()};
+  command_list->SetDescriptorHeaps(_countof(descriptor_heaps),
+                                   descriptor_heaps);
+  command_list->RSSetViewports(1, &viewport_);
+  command_list->RSSetScissorRects(1, &scissor_rect_);
+
+  const D3D12_CPU_DESCRIPTOR_HANDLE rtv_handle =
+      rtv_heap_->GetCpuHandle(rtv_descriptors_[frame_index_]);
+  if (chunk_index == 0) {
+    render_graph_->RecordBarriers(command_list, 0);
+    command_list->ClearRenderTargetView(rtv_handle, kClearColor, 0, nullptr);
+  }
+  command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, nullptr);
+
+  // The draws only change with the scene, replay the bundle recorded by an
+  // earlier frame that encoded the same commands
+  CommandStream &stream = chunk_streams_[chunk_index];
+  DrawBindings bindings;
+  bindings.primitive_topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+  bindings.mesh_constants_parameter = kMeshConstantsParameter;
+  bindings.mesh_buffers = mesh_buffers_.data();
+  bindings.mesh_quantizations = mesh_quantizations_.data();
+  bindings.draw_constants_parameter = kDrawConstantsParameter;
+  bindings.object_table_parameter = kObjectTableParameter;
+  bindings.object_table = object_table_.gpu_handle.ptr;
+  EncodeDraws(*draw_queue_, bindings, chunk, &stream);
+  if (!stream.IsEmpty()) {
+    // Bundles setting the same root signature inherit the table
+    command_list->SetGraphicsRootSignature(
+        root_signatures_[draw_queue_->GetBatches()[chunk.first_draw]
+                             .root_signature]
+            .Get());
+    command_list->SetGraphicsRootDescriptorTable(kObjectTableParameter,
+                                                 object_table_.gpu_handle);
+    ID3D12GraphicsCommandList *bundle = bundle_cache_->GetBundle(
+        stream, frame_scheduler_->GetFrameNumber(),
+        [&](ID3D12GraphicsCommandList *bundle_list) {
+          // Bundles that set descriptor tables must set the heap of the
+          // lists executing them
+          bundle_list->SetDescriptorHeaps(_countof(descriptor_heaps),
+                                          descriptor_heaps);
+          ReplayCommandStream(stream, bundle_list);
+        });
+    command_list->ExecuteBundle(bundle);
+  }
 
-  CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(
-      rtv_heap_->GetCPUDescriptorHandleForHeapStart(), frame_index_,
-      rtv_descriptor_size_);
-  command_list_->OMSetRenderTargets(1, &rtv_handle, FALSE, nullptr);
+  if (chunk_index + 1 == chunk_count) {
+    for (uint32_t step = 1; step < render_graph_->GetStepCount(); step++) {
+      render_graph_->RecordPass(command_list, step);
+    }
+    render_graph_->RecordBarriers(command_list,
+                                  render_graph_->GetStepCount());
+  }
 
-  // Record commands
-  const float clear_color[] = {0.0f, 0.2f, 0.4f, 1.0f};
-  command_list_->ClearRenderTargetView(rtv_handle, clear_color, 0, nullptr);
-  command_list_->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-  command_list_->IASetVertexBuffers(0, 1, &vertex_buffer_view_);
-  command_list_->DrawInstanced(3, 1, 0, 0);
+#ifdef ENABLE_PROFILER
+  gpu_profiler_->EndScope(command_list, frame_slot, chunk_index + 1);
+  if (chunk_index + 1 == chunk_count) {
+    // Lists run in order, so the last one resolves the queries of them all
+    gpu_profiler_->EndScope(command_list, frame_slot, 0);
+    gpu_profiler_->ResolveFrame(command_list, frame_slot, chunk_count + 1);
+  }
+#endif
+}
 
-  // Indicate that the back buffer will now be used to present
-  barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-      render_targets_[frame_index_].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET,
-      D3D12_RESOURCE_STATE_PRESENT);
-  command_list_->ResourceBarrier(1, &barrier);
+void Application::ReplayCommandStream(
+    const CommandStream &stream,
+    ID3D12GraphicsCommandList *command_list) const {
+  CommandStreamReader reader(stream);
+  CommandType type;
+  while (reader.Next(&type)) {
+    switch (type) {
+      case CommandType::kSetRootSignature: {
+        const auto command = reader.GetPayload<SetRootSignatureCommand>();
+        command_list->SetGraphicsRootSignature(
+            root_signatures_[command.root_signature].Get());
+        break;
+      }
+      case CommandType::kSetPipelineState: {
+        const auto command = reader.GetPayload<SetPipelineStateCommand>();
+        command_list->SetPipelineState(
+            pipeline_states_[command.pipeline].Get());
+        break;
+      }
+      case CommandType::kSetPrimitiveTopology: {
+        const auto command = reader.GetPayload<SetPrimitiveTopologyCommand>();
+        command_list->IASetPrimitiveTopology(
+            static_cast<D3D12_PRIMITIVE_TOPOLOGY>(command.topology));
+        break;
+      }
+      case CommandType::kSetVertexBuffers: {
+        const auto command = reader.GetPayload<SetVertexBuffersCommand>();
+        D3D12_VERTEX_BUFFER_VIEW views[SetVertexBuffersCommand::kMaxBindings];
+        for (uint32_t i = 0; i < command.count; i++) {
+          views[i] = {command.bindings[i].address, command.bindings[i].size,
+                      command.bindings[i].stride};
+        }
+        command_list->IASetVertexBuffers(command.start_slot, command.count,
+                                         views);
+        break;
+      }
+      case CommandType::kSetIndexBuffer: {
+        const auto command = reader.GetPayload<SetIndexBufferCommand>();
+        const D3D12_INDEX_BUFFER_VIEW view = {
+            command.address, command.size,
+            static_cast<DXGI_FORMAT>(command.format)};
+        command_list->IASetIndexBuffer(&view);
+        break;
+      }
+      case CommandType::kSetGraphicsRoot32BitConstants: {
+        const auto command =
+            reader.GetPayload<SetGraphicsRoot32BitConstantsCommand>();
+        command_list->SetGraphicsRoot32BitConstants(
+            command.root_parameter, command.count, command.values, 0);
+        break;
+      }
+      case CommandType::kDrawInstanced: {
+        const auto command = reader.GetPayload<DrawInstancedCommand>();
+        command_list->DrawInstanced(command.vertex_count,
+                                    command.instance_count,
+                                    command.start_vertex,
+                                    command.start_instance);
+        break;
+      }
+      case CommandType::kDrawIndexedInstanced: {
+        const auto command = reader.GetPayload<DrawIndexedInstancedCommand>();
+        command_list->DrawIndexedInstanced(
+            command.index_count, command.instance_count, command.start_index,
+            command.base_vertex, command.start_instance);
+        break;
+      }
+      case CommandType::kSetGraphicsRootDescriptorTable: {
+        const auto command =
+            reader.GetPayload<SetGraphicsRootDescriptorTableCommand>();
+        command_list->SetGraphicsRootDescriptorTable(
+            command.root_parameter, {command.base_descriptor});
+        break;
+      }
+    }
+  }
+}
 
-  if (FAILED(command_list_->Close())) {
-    throw std::runtime_error("Failed to close command list");
+void Application::BuildRenderGraph() {
+  render_graph_->Reset();
+  ID3D12Resource *render_target = render_targets_[frame_index_].Get();
+  const uint32_t back_buffer = render_graph_->ImportResource(
+      "BackBuffer", render_target, ResourceState::kPresent,
+      ResourceState::kPresent);
+  render_graph_->AddPass("Scene",
+                         {{back_buffer, ResourceState::kRenderTarget}});
+  if (readback_ring_) {
+    // Copies into its readback slot, which the graph does not see
+    render_graph_->AddPass(
+        "Readback", {{back_buffer, ResourceState::kCopySource}},
+        [this, render_target](ID3D12GraphicsCommandList *command_list) {
+          readback_ring_->RecordCopy(command_list, render_target);
+        },
+        true);
   }
+  render_graph_->Compile();
 }
 
 void Application::BuildSwapchain(int width, int height) {
+  const bool paced = settings_.present_mode != PresentMode::kVsync;
+  if (settings_.present_mode == PresentMode::kUnlocked) {
+    ComPtr<IDXGIFactory5> factory;
+    BOOL allow_tearing = FALSE;
+    tearing_supported_ =
+        SUCCEEDED(factory_.As(&factory)) &&
+        SUCCEEDED(factory->CheckFeatureSupport(
+            DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allow_tearing,
+            sizeof(allow_tearing))) &&
+        allow_tearing;
+  }
+
   DXGI_SWAP_CHAIN_DESC1 swap_chain_desc = {};
   swap_chain_desc.BufferCount = kFrameCount;
   swap_chain_desc.Width = width;
@@ -477,6 +1336,12 @@ void Application::BuildSwapchain(int width, int height) {
   swap_chain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
   swap_chain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
   swap_chain_desc.SampleDesc.Count = 1;
+  if (paced) {
+    swap_chain_desc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+  }
+  if (tearing_supported_) {
+    swap_chain_desc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+  }
 
   ComPtr<IDXGISwapChain1> swap_chain;
   if (FAILED(factory_->CreateSwapChainForHwnd(
@@ -493,21 +1358,69 @@ void Application::BuildSwapchain(int width, int height) {
   if (FAILED(swap_chain.As(&swap_chain_))) {
     throw std::runtime_error("Failed to get swap chain");
   }
+  // As many frames queued as there are frames in flight. With fewer the
+  // latency wait serializes the CPU and the GPU, the FramePacer takes the
+  // latency out instead.
+  if (paced) {
+    if (FAILED(swap_chain_->SetMaximumFrameLatency(
+            std::min(settings_.frames_in_flight, kFrameCount)))) {
+      throw std::runtime_error("Failed to set the frame latency");
+    }
+    frame_latency_waitable_ = swap_chain_->GetFrameLatencyWaitableObject();
+  }
 
   frame_index_ = swap_chain_->GetCurrentBackBufferIndex();
 
   // Create frame resources
   {
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(
-        rtv_heap_->GetCPUDescriptorHandleForHeapStart());
     for (uint32_t i = 0; i < kFrameCount; i++) {
       if (FAILED(
               swap_chain_->GetBuffer(i, IID_PPV_ARGS(&render_targets_[i])))) {
         throw std::runtime_error("Failed to get swap chain buffer");
       }
-      device_->CreateRenderTargetView(render_targets_[i].Get(), nullptr,
-                                      rtv_handle);
-      rtv_handle.Offset(1, rtv_descriptor_size_);
+      device_->CreateRenderTargetView(
+          render_targets_[i].Get(), nullptr,
+          rtv_heap_->GetCpuHandle(rtv_descriptors_[i]));
     }
   }
 }
+
+void Application::ReleaseSwapchain() {
+  for (uint32_t i = 0; i < kFrameCount; i++) {
+    render_targets_[i].Reset();
+  }
+  if (frame_latency_waitable_) {
+    CloseHandle(frame_latency_waitable_);
+    frame_latency_waitable_ = nullptr;
+  }
+  swap_chain_.Reset();
+}
+
+void Application::BuildOffscreenTargets(uint32_t width, uint32_t height) {
+  CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_DEFAULT);
+  CD3DX12_RESOURCE_DESC texture_desc = CD3DX12_RESOURCE_DESC::Tex2D(
+      DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1, 1, 0,
+      D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+  CD3DX12_CLEAR_VALUE clear_value(DXGI_FORMAT_R8G8B8A8_UNORM, kClearColor);
+  for (uint32_t i = 0; i < kFrameCount; i++) {
+    if (FAILED(device_->CreateCommittedResource(
+            &heap_properties, D3D12_HEAP_FLAG_NONE, &texture_desc,
+            D3D12_RESOURCE_STATE_PRESENT, &clear_value,
+            IID_PPV_ARGS(&render_targets_[i])))) {
+      throw std::runtime_error("Failed to create offscreen render target");
+    }
+    device_->CreateRenderTargetView(
+        render_targets_[i].Get(), nullptr,
+        rtv_heap_->GetCpuHandle(rtv_descriptors_[i]));
+  }
+  frame_index_ = 0;
+
+  if (!settings_.capture_path.empty()) {
+    frame_sink_ = std::make_unique<FrameSink>(
+        settings_.capture_path,
+        FrameSink::GetFormatForPath(settings_.capture_path));
+    readback_ring_ = std::make_unique<ReadbackRing>(
+        device_.Get(), timeline_.get(), settings_.capture_depth, width,
+        height);
+  }
+}
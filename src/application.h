@@ -1,4 +1,9 @@
 #pragma once
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "D3Dcompiler.h"
 #include "GLFW/glfw3.h"
 #include "d3d12.h"
@@ -11,56 +16,309 @@
 #include "DirectXMath.h"
 #include "glm/glm.hpp"
 
+#include "core/command_stream.h"
+#include "core/draw_encoder.h"
+#include "core/draw_partition.h"
+#include "core/draw_queue.h"
+#include "core/frame_pacer.h"
+#include "core/frame_sink.h"
+#include "core/frame_scheduler.h"
+#include "core/frame_time_stats.h"
+#include "core/job_system.h"
+#include "core/mesh.h"
+#include "core/mesh_file.h"
+#include "core/occlusion_culling.h"
+#include "core/pipeline_readiness.h"
+#include "core/queue_sync.h"
+#include "core/scene.h"
+#include "core/shader_cache.h"
+#include "core/streaming_manager.h"
+#include "core/update_thread.h"
+#include "core/vertex.h"
+#include "bundle_cache.h"
+#include "d3d12_gpu_timeline.h"
+#include "d3d12_render_graph.h"
+#include "d3d_shader_compiler.h"
+#include "descriptor_heap.h"
+#include "frame_upload_buffer.h"
+#include "gpu_profiler.h"
+#include "gpu_memory_manager.h"
+#include "parallel_command_recorder.h"
+#include "pipeline_cache.h"
+#include "readback_ring.h"
+#include "upload_ring.h"
+
 using Microsoft::WRL::ComPtr;
 
-struct Vertex {
-  glm::vec3 position;
-  glm::vec3 color;
+enum class PresentMode {
+  // Present on vertical blank, frames queue up to the frames in flight
+  kVsync,
+  // Present on vertical blank, waiting on the swap chain for each frame, and
+  // hold the CPU work of GPU bound frames back with the FramePacer
+  kLowLatency,
+  // Present immediately, tearing where supported, paced like kLowLatency
+  kUnlocked,
+};
+
+struct ApplicationSettings {
+  uint32_t frames_in_flight{2};
+  PresentMode present_mode{PresentMode::kVsync};
+  // 0 draws the sample triangle, otherwise one object per grid cell
+  uint32_t grid_size{0};
+  // Objects scattered over a world larger than the view, replaces the grid
+  // and pans the camera so that culling has work to do
+  uint32_t scene_object_count{0};
+  // Mesh file drawn instead of the sample triangle when not empty
+  std::string mesh_path;
+  // Chrome trace of the last frames written on close when not empty, needs
+  // ENABLE_PROFILER
+  std::string trace_path;
+  // Draw with the wireframe pipeline, the solid one stands in until it is
+  // created
+  bool wireframe{false};
+  // Render into textures of the window size without creating a window or a
+  // swap chain, and close after frame_count frames
+  bool offscreen{false};
+  uint32_t frame_count{300};
+  // Offscreen frames are read back and streamed into this file or pipe when
+  // not empty, PPM for .ppm paths and raw R8G8B8A8 otherwise
+  std::string capture_path;
+  // Objects are drawn at the coarsest LOD whose error stays within this many
+  // pixels
+  float lod_error_pixels{1.0f};
+  // Bytes the LODs finer than the coarsest one stream in within, 0 follows
+  // the budget the adapter reports
+  uint64_t streaming_budget{0};
+  // Frames whose copies may be in flight before capturing waits for the GPU,
+  // more than frames_in_flight never waits
+  uint32_t capture_depth{3};
+  // The largest objects on screen occlude the others, 0 disables occlusion
+  // culling
+  uint32_t occluder_count{32};
+  // Updates run on a thread of their own at this rate, overlapping the
+  // frames, which draw the newest snapshot. 0 updates on the render thread
+  // before every frame.
+  double update_rate_hz{120.0};
 };
 
 class Application {
  public:
-  Application(const std::string_view &title, uint32_t width, uint32_t height);
+  Application(const std::string_view &title,
+              uint32_t width,
+              uint32_t height,
+              const ApplicationSettings &settings = ApplicationSettings());
   ~Application();
   void Run();
 
  private:
   void OnInitialize();
+  // Wait for the frame slot and the swap chain, then for the frame pacer, so
+  // that the input the frame samples is as recent as possible
+  void WaitForNextFrame();
+  // Take the snapshot the frame draws, updating first when there is no
+  // update thread
   void OnUpdate();
+  // Fill the snapshot of the update, on the update thread when there is one
+  void Update(uint64_t update, SceneSnapshot *snapshot);
   void OnRender();
   void OnClose();
 
-  void LoadPipeline();
-  void LoadAssets();
-
-  void WaitForPreviousFrame();
+  // Startup tasks, OnInitialize runs them as a task graph
+  void CreateDevice();
+  void CreateQueues();
+  void CreateRootSignature();
+  // Create the pipeline and mark it ready, safe to call on any thread once
+  // the root signature and the pipeline cache exist
+  void CreatePipeline(uint32_t pipeline,
+                      D3D12_FILL_MODE fill_mode,
+                      const ShaderCompileRequest &vertex_request,
+                      const std::vector<uint8_t> &vertex_shader,
+                      const ShaderCompileRequest &pixel_request,
+                      const std::vector<uint8_t> &pixel_shader);
+  // Upload the vertices and the index buffer of the coarsest LOD and stream
+  // the finer LODs into index buffers of their own. Returns the draw queue
+  // mesh id of the full detail LOD, LOD i has that id + i. The view has to
+  // stay valid while the streaming manager lives.
+  uint32_t LoadMesh(const MeshView &mesh);
+  // Point the LOD at a new index buffer holding the data
+  void UploadLodIndices(uint32_t mesh_id, const uint8_t *data, uint64_t size);
+  // Follow the budget of the adapter, release evicted LODs and upload those
+  // that finished loading
+  void UpdateStreaming();
+  // Point the bindings of every mesh at its buffers again after
+  // defragmentation moved them
+  void RebindMeshBuffers();
+  // Rasterize the largest frame objects as occluders and test every frame
+  // object against them into occlusion_visible_
+  void CullOccludedObjects();
+  // Recreate the SRV of the slot after its buffer was replaced and copy it
+  // into the frame's table of the descriptor ring
+  void UpdateObjectTable(uint32_t frame_slot);
 
-  void PopulateCommandList();
+  void PopulateCommandList(ID3D12GraphicsCommandList *command_list,
+                           uint32_t chunk_index,
+                           uint32_t chunk_count,
+                           const DrawChunk &chunk);
+  void ReplayCommandStream(const CommandStream &stream,
+                           ID3D12GraphicsCommandList *command_list) const;
+  // Passes of the frame into the current back buffer. The scene pass, whose
+  // draws the chunks record, is always the first step.
+  void BuildRenderGraph();
 
   void BuildSwapchain(int width, int height);
+  void ReleaseSwapchain();
+  // Render targets standing in for the swap chain buffers, left in the
+  // PRESENT state between frames like them
+  void BuildOffscreenTargets(uint32_t width, uint32_t height);
 
-  static const uint32_t kFrameCount = 2;
+  static constexpr uint32_t kFrameCount = 2;
+  // Room for the swap chain and offscreen render targets
+  static const uint32_t kRtvHeapCapacity = 64;
+  // Persistent views that tables of the descriptor ring are copied from
+  static const uint32_t kCbvSrvUavHeapCapacity = 1024;
+  // Room for depth targets, the scene draws in order without one so far
+  static const uint32_t kDsvHeapCapacity = 16;
+  // Below this a chunk costs more in command list overhead than it saves
+  static const uint32_t kMinDrawsPerChunk = 256;
+  // Bundles unused for this long are released, well beyond the frames in
+  // flight that may still execute them
+  static const uint32_t kMaxUnusedBundleFrames = 120;
+  // Buffers copied between heap blocks per frame, a fraction of a
+  // millisecond of copy bandwidth
+  static const uint64_t kDefragmentBytesPerFrame = 4 * 1024 * 1024;
+  // Root parameter of the MeshConstants of main.hlsl, kMeshConstantCount
+  // values
+  static const uint32_t kMeshConstantsParameter = 0;
+  // Root parameter of the DrawConstants of main.hlsl, kDrawConstantCount
+  // values
+  static const uint32_t kDrawConstantsParameter = 1;
+  // Root parameter of the table with the SRV of the objects buffer
+  static const uint32_t kObjectTableParameter = 2;
+  // Pipelines of main.hlsl, the solid one is created before the first frame
+  static const uint32_t kSolidPipeline = 0;
+  static const uint32_t kWireframePipeline = 1;
 
-  GLFWwindow *window_;
+  // Null when rendering offscreen
+  GLFWwindow *window_{nullptr};
   ComPtr<ID3D12Device> device_;
   ComPtr<ID3D12CommandQueue> command_queue_;
+  // Uploads run on their own queue and fence, frames wait on the GPU for the
+  // uploads they draw
+  ComPtr<ID3D12CommandQueue> copy_queue_;
+  std::unique_ptr<D3D12GpuTimeline> copy_timeline_;
+  std::unique_ptr<QueueSync> upload_sync_;
   ComPtr<IDXGISwapChain3> swap_chain_;
-  ComPtr<ID3D12DescriptorHeap> rtv_heap_;
+  // Signaled once the swap chain can queue another frame, null unless the
+  // present mode is paced
+  HANDLE frame_latency_waitable_{nullptr};
+  bool tearing_supported_{false};
+  FramePacer frame_pacer_;
+  // End of the pacing delay of the current frame
+  std::chrono::steady_clock::time_point frame_cpu_start_;
+  std::unique_ptr<DescriptorHeap> rtv_heap_;
+  uint32_t rtv_descriptors_[kFrameCount];
+  std::unique_ptr<DescriptorHeap> cbv_srv_uav_heap_;
+  std::unique_ptr<DescriptorHeap> dsv_heap_;
+  std::unique_ptr<ShaderVisibleDescriptorRing> descriptor_ring_;
   ComPtr<ID3D12Resource> render_targets_[kFrameCount];
-  ComPtr<ID3D12CommandAllocator> command_allocator_;
-  ComPtr<ID3D12GraphicsCommandList> command_list_;
-  ComPtr<ID3D12Fence> fence_;
-  ComPtr<ID3D12RootSignature> root_signature_;
-  ComPtr<ID3D12PipelineState> pipeline_state_;
-  ComPtr<ID3D12Resource> vertex_buffer_;
-  D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view_;
-  ComPtr<ID3D12Resource> index_buffer_;
+  // Capture of offscreen frames, both null unless a capture path is set
+  std::unique_ptr<ReadbackRing> readback_ring_;
+  std::unique_ptr<FrameSink> frame_sink_;
+  // Barriers of the frame, rebuilt by every frame
+  std::unique_ptr<D3D12RenderGraph> render_graph_;
+  std::unique_ptr<D3D12GpuTimeline> timeline_;
+  std::unique_ptr<FrameScheduler> frame_scheduler_;
+  std::unique_ptr<JobSystem> job_system_;
+  std::unique_ptr<ParallelCommandRecorder> command_recorder_;
+  // Draws of every chunk are encoded here before they are looked up in the
+  // bundle cache
+  std::vector<CommandStream> chunk_streams_;
+  std::unique_ptr<BundleCache> bundle_cache_;
+  std::unique_ptr<UploadRing> upload_ring_;
+  std::unique_ptr<GpuMemoryManager> gpu_memory_;
+  D3DShaderCompiler shader_compiler_;
+  std::unique_ptr<ShaderCache> shader_cache_;
+  std::unique_ptr<PipelineCache> pipeline_cache_;
+  // Tables indexed by the ids of draw items
+  std::vector<ComPtr<ID3D12RootSignature>> root_signatures_;
+  std::vector<ComPtr<ID3D12PipelineState>> pipeline_states_;
+  // Pipelines still being created after startup only replace their fallback
+  // once ready
+  PipelineReadiness pipeline_readiness_;
+  JobCounter pipeline_jobs_;
+  std::vector<MeshBufferBindings> mesh_buffers_;
+  // Indexed by draw queue mesh ids
+  std::vector<PositionQuantization> mesh_quantizations_;
+  // Copy timeline values after which the buffers of the mesh are filled
+  std::vector<uint64_t> mesh_upload_fences_;
+  // LODs of the mesh at the id of its full detail LOD, empty at the others
+  std::vector<std::vector<MeshLod>> mesh_lods_;
+  // Vertices of the mesh at the id of its full detail LOD, which occluders
+  // are rasterized from with the indices of the resident LODs
+  std::vector<MeshView> mesh_views_;
+  // Streaming resource of the mesh at the id of its full detail LOD, and the
+  // full detail mesh id of every resource
+  std::vector<uint32_t> mesh_resources_;
+  std::vector<uint32_t> streamed_meshes_;
+  // Index buffer of every resident LOD
+  std::vector<GpuBufferHandle> lod_index_buffers_;
+  // Sources of the scene mesh, which LODs keep streaming out of, so they are
+  // declared before and destroyed after the manager
+  Mesh builtin_mesh_;
+  std::unique_ptr<MeshFile> mesh_file_;
+  Mesh processed_mesh_;
+  std::unique_ptr<StreamingManager> streaming_;
+  GpuBufferHandle vertex_buffer_;
+  std::unique_ptr<DrawQueue> draw_queue_;
+  // ObjectData of every drawn object, one structured buffer per frame slot.
+  // Slot i is described by SRV object_srvs_[i] of the CBV/SRV/UAV heap
+  std::unique_ptr<FrameUploadBuffer> object_buffer_;
+  std::vector<uint32_t> object_srvs_;
+  // Buffer capacity each slot's SRV was created for, it only grows
+  std::vector<uint64_t> object_table_capacities_;
+  // Table of the current frame, bound by the lists before their bundles
+  DescriptorTable object_table_;
+  Scene scene_;
+  // Created on the update thread with workers of their own when updates
+  // are threaded, Schedule and Wait belong to the thread creating a system
+  std::unique_ptr<JobSystem> update_job_system_;
+  std::unique_ptr<SceneCuller> scene_culler_;
+  // Reset by OnClose and the destructor before anything updates read
+  std::unique_ptr<UpdateThread> update_thread_;
+  SceneSnapshot lockstep_snapshot_;
+  // Taken by OnUpdate, drawn by OnRender
+  const SceneSnapshot *snapshot_{nullptr};
+  // Time from the start of the update a frame draws to its present
+  FrameTimeStats update_latencies_;
+  // Objects inside the frustum at the LOD they are drawn with, before
+  // occlusion culling
+  std::vector<DrawItem> frame_items_;
+  std::vector<ObjectData> frame_objects_;
+  // A pixel per 4x4 of the viewport, null when occlusion culling is disabled
+  std::unique_ptr<OcclusionCuller> occlusion_culler_;
+  std::vector<float> frame_depths_;
+  std::vector<uint32_t> occluders_;
+  std::vector<OcclusionQuery> occlusion_queries_;
+  std::vector<uint8_t> occlusion_visible_;
+  std::chrono::steady_clock::time_point start_time_;
+  uint32_t scene_mesh_{0};
+  // Triangles of the latest frame, and those full detail would have drawn
+  uint64_t lod_triangles_{0};
+  uint64_t full_detail_triangles_{0};
+  std::chrono::steady_clock::time_point last_stats_report_;
+  // Time between the starts of consecutive frames
+  FrameTimeStats frame_times_;
+  std::chrono::steady_clock::time_point last_frame_start_;
+#ifdef ENABLE_PROFILER
+  // Scope 0 spans the frame, scope 1 + i the chunk i
+  std::unique_ptr<GpuProfiler> gpu_profiler_;
+#endif
   ComPtr<IDXGIFactory4> factory_;
-  D3D12_INDEX_BUFFER_VIEW index_buffer_view_;
-  HANDLE fence_event_;
-  uint64_t fence_value_;
+  // Null when the OS does not report memory budgets
+  ComPtr<IDXGIAdapter3> adapter_;
+  uint64_t video_memory_{0};
+  ApplicationSettings settings_;
   uint32_t frame_index_;
-  uint32_t rtv_descriptor_size_;
   bool is_initialized_;
   CD3DX12_VIEWPORT viewport_;
   CD3DX12_RECT scissor_rect_;
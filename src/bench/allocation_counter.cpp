@@ -0,0 +1,30 @@
+#include "bench/allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<uint64_t> allocation_count{0};
+}  // namespace
+
+uint64_t GetAllocationCount() {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+// Array and nothrow forms forward to these by default
+void *operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void *memory = malloc(size != 0 ? size : 1)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+  free(memory);
+}
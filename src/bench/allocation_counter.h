@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+
+// Number of calls to the global operator new so far, which the benchmark
+// binary replaces to count them
+uint64_t GetAllocationCount();
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/heap_block_allocator.h"
+#include "core/string_utils.h"
+#include "core/tlsf_allocator.h"
+
+namespace {
+// Only offsets are managed, the heap can be larger than any memory
+const uint64_t kHeapSize = 1ull << 40;
+const uint32_t kOperations = 1000000;
+// Buffer sizes of a scene, from small constant buffers to large meshes
+const uint64_t kMinSize = 256;
+const uint64_t kMaxSize = 4 << 20;
+const uint64_t kBlockSize = 64 << 20;
+const uint64_t kDefragmentBytes = 16 << 20;
+
+uint64_t RandomSize(std::mt19937 *random) {
+  const uint32_t bits = 8 + (*random)() % 15;
+  return std::uniform_int_distribution<uint64_t>(
+      kMinSize, std::min(uint64_t(1) << bits, kMaxSize))(*random);
+}
+
+// Replace random allocations of a heap holding live_count of them, one free
+// and one allocation per operation
+double MeasureTlsf(uint32_t live_count) {
+  TlsfAllocator allocator(kHeapSize);
+  std::mt19937 random(1);
+  std::vector<uint64_t> live;
+  for (uint32_t i = 0; i < live_count; i++) {
+    live.push_back(allocator.Allocate(RandomSize(&random), 256));
+  }
+  std::vector<uint32_t> victims(kOperations);
+  std::vector<uint64_t> sizes(kOperations);
+  for (uint32_t i = 0; i < kOperations; i++) {
+    victims[i] = random() % live_count;
+    sizes[i] = RandomSize(&random);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < kOperations; i++) {
+    allocator.Free(live[victims[i]]);
+    live[victims[i]] = allocator.Allocate(sizes[i], 256);
+  }
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         kOperations;
+}
+}  // namespace
+
+void RunAllocatorBenchmark(const BenchmarkOptions &) {
+  std::cout << "TLSF, " << kOperations << " frees and allocations of "
+            << DataSizeToStringNotation(kMinSize) << " to "
+            << DataSizeToStringNotation(kMaxSize) << std::endl;
+  std::cout << std::setw(12) << "live" << std::setw(16) << "ns/operation"
+            << std::endl;
+  for (uint32_t live_count : {1000u, 10000u, 100000u}) {
+    std::cout << std::setw(12) << live_count << std::setw(16)
+              << MeasureTlsf(live_count) / 2.0 << std::endl;
+  }
+
+  // Fill blocks, free most of what they hold at random and compact them
+  // again, as streaming out a part of the scene does
+  HeapBlockAllocator allocator(kBlockSize, ~uint64_t(0));
+  std::mt19937 random(2);
+  std::vector<uint32_t> live;
+  while (allocator.GetReservedSize() < 16 * kBlockSize) {
+    live.push_back(allocator.Allocate(RandomSize(&random), 256));
+  }
+  std::shuffle(live.begin(), live.end(), random);
+  for (size_t i = live.size() / 4; i < live.size(); i++) {
+    allocator.Free(live[i]);
+  }
+  const uint32_t blocks_before = allocator.GetBlockCount();
+  const uint64_t used = allocator.GetUsedSize();
+
+  uint32_t passes = 0;
+  uint64_t moves = 0;
+  uint64_t moved_bytes = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (;; passes++) {
+    const std::vector<HeapMove> pass =
+        allocator.PlanDefragmentation(kDefragmentBytes);
+    if (pass.empty()) {
+      break;
+    }
+    // Copies complete before the next pass, as they do on the GPU a frame
+    // later
+    for (const HeapMove &move : pass) {
+      allocator.FreeRange(move.source);
+      moved_bytes += move.source.size;
+    }
+    moves += pass.size();
+    allocator.ReleaseEmptyBlocks();
+  }
+  const double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  std::cout << "Defragmentation: " << DataSizeToStringNotation(used)
+            << " in " << blocks_before << " blocks compacted into "
+            << allocator.GetBlockCount() << " by " << moves << " moves of "
+            << DataSizeToStringNotation(moved_bytes) << " over " << passes
+            << " passes of at most "
+            << DataSizeToStringNotation(kDefragmentBytes) << ", " << ms
+            << " ms planning" << std::endl;
+}
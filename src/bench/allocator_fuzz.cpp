@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/heap_block_allocator.h"
+
+namespace {
+const uint64_t kBlockSize = 1 << 20;
+const uint64_t kBudget = 48 * kBlockSize;
+const uint32_t kSteps = 10000;
+const uint32_t kSeeds = 2;
+
+void Check(bool condition, uint32_t seed, uint32_t step, const char *what) {
+  if (!condition) {
+    throw std::runtime_error("Allocator fuzz seed " + std::to_string(seed) +
+                             ", step " + std::to_string(step) + ": " + what);
+  }
+}
+
+// Sizes spread evenly over the powers of two up to a bit more than a block,
+// so that dedicated blocks are among them
+uint64_t RandomSize(std::mt19937 *random) {
+  const uint32_t bits = (*random)() % 21;
+  const uint64_t size = std::uniform_int_distribution<uint64_t>(
+      1, uint64_t(1) << bits)(*random);
+  return (*random)() % 16 == 0 ? kBlockSize + size % 4096 : size;
+}
+
+struct FuzzResult {
+  uint64_t allocations{0};
+  uint64_t frees{0};
+  uint64_t moves{0};
+  uint64_t released_blocks{0};
+  uint64_t over_budget{0};
+};
+
+void RunSeed(uint32_t seed, FuzzResult *result) {
+  HeapBlockAllocator allocator(kBlockSize, kBudget);
+  std::mt19937 random(seed);
+  // What the allocator should hold, live allocations by id and the source
+  // ranges of moves that have not been freed yet
+  std::vector<uint32_t> live;
+  std::vector<HeapRange> expected;
+  std::vector<HeapRange> move_sources;
+  std::vector<HeapRange> ranges;
+
+  for (uint32_t step = 0; step < kSteps; step++) {
+    const uint32_t action = random() % 100;
+    if (action < 50) {
+      const uint64_t size = RandomSize(&random);
+      const uint64_t alignment = uint64_t(1) << (random() % 13);
+      const uint32_t id = allocator.Allocate(size, alignment);
+      if (id == HeapBlockAllocator::kInvalidAllocation) {
+        // Dedicated blocks are rounded up to the alignment at most
+        Check(allocator.GetReservedSize() + std::max(size, kBlockSize) +
+                      alignment >
+                  kBudget,
+              seed, step, "allocation failed below the budget");
+        result->over_budget++;
+      } else {
+        const HeapRange &range = allocator.Get(id);
+        Check(range.size == size &&
+                  range.offset % std::max<uint64_t>(alignment, 16) == 0,
+              seed, step, "allocation has the wrong size or alignment");
+        if (id >= expected.size()) {
+          expected.resize(id + 1);
+        }
+        expected[id] = range;
+        live.push_back(id);
+        result->allocations++;
+      }
+    } else if (action < 85 && !live.empty()) {
+      const size_t index = random() % live.size();
+      allocator.Free(live[index]);
+      live[index] = live.back();
+      live.pop_back();
+      result->frees++;
+    } else if (action < 95) {
+      const uint64_t max_bytes = RandomSize(&random) * 4;
+      for (const HeapMove &move : allocator.PlanDefragmentation(max_bytes)) {
+        const HeapRange &source = expected[move.allocation];
+        Check(source.block == move.source.block &&
+                  source.offset == move.source.offset &&
+                  move.source.size == move.destination.size,
+              seed, step, "move does not start at the allocation");
+        expected[move.allocation] = move.destination;
+        move_sources.push_back(move.source);
+        result->moves++;
+      }
+    } else {
+      // The GPU finished the copies of the moves
+      for (const HeapRange &source : move_sources) {
+        allocator.FreeRange(source);
+      }
+      move_sources.clear();
+      result->released_blocks += allocator.ReleaseEmptyBlocks().size();
+    }
+
+    Check(allocator.Validate(), seed, step, "bookkeeping is inconsistent");
+    ranges = move_sources;
+    for (uint32_t id : live) {
+      const HeapRange &range = allocator.Get(id);
+      Check(range.block == expected[id].block &&
+                range.offset == expected[id].offset,
+            seed, step, "allocation moved without a planned move");
+      ranges.push_back(range);
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const HeapRange &a, const HeapRange &b) {
+                return a.block != b.block ? a.block < b.block
+                                          : a.offset < b.offset;
+              });
+    for (size_t i = 1; i < ranges.size(); i++) {
+      Check(ranges[i].block != ranges[i - 1].block ||
+                ranges[i - 1].offset + ranges[i - 1].size <= ranges[i].offset,
+            seed, step, "live ranges overlap");
+    }
+  }
+}
+}  // namespace
+
+void RunAllocatorFuzz(const BenchmarkOptions &) {
+  FuzzResult result;
+  for (uint32_t seed = 1; seed <= kSeeds; seed++) {
+    RunSeed(seed, &result);
+  }
+  std::cout << kSeeds << " seeds of " << kSteps << " steps validated: "
+            << result.allocations << " allocations, " << result.frees
+            << " frees, " << result.moves << " moves, "
+            << result.released_blocks << " blocks released, "
+            << result.over_budget << " allocations over budget" << std::endl;
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/frame_scheduler.h"
+#include "core/queue_sync.h"
+#include "core/simulated_gpu_timeline.h"
+
+namespace {
+// A GPU bound frame with a large asset streamed in every few frames. Copy
+// and graphics work are assumed not to slow each other down.
+const uint64_t kCpuFrameNs = 4000000;
+const uint64_t kGpuFrameNs = 6000000;
+const uint64_t kUploadNs = 15000000;
+const uint32_t kUploadInterval = 8;
+const uint32_t kFramesInFlight = 2;
+
+enum class UploadMode {
+  // Copies recorded into the graphics queue, as before the copy queue
+  kGraphicsQueue,
+  // Copies on the copy queue, the next frame draws the asset and waits for
+  // its copy on the GPU
+  kCopyQueueWait,
+  // Copies on the copy queue, frames draw the asset once its copy completed
+  kCopyQueueStream,
+};
+
+const char *GetUploadModeName(UploadMode mode) {
+  switch (mode) {
+    case UploadMode::kGraphicsQueue:
+      return "graphics queue";
+    case UploadMode::kCopyQueueWait:
+      return "copy queue, GPU wait";
+    case UploadMode::kCopyQueueStream:
+      return "copy queue, streamed";
+  }
+  return "";
+}
+
+struct PendingUpload {
+  uint64_t fence_value;
+  uint64_t issue_time_ns;
+};
+
+struct UploadResult {
+  double ms_per_frame;
+  double worst_frame_ms;
+  double cpu_wait_ms;
+  uint64_t gpu_waits;
+  // From issuing the copy to submitting the first frame that draws it
+  double upload_latency_ms;
+};
+
+UploadResult SimulateUploads(UploadMode mode, uint32_t frame_count) {
+  SimulatedCpuClock clock;
+  SimulatedGpuTimeline graphics(&clock);
+  SimulatedGpuTimeline copy(&clock);
+  FrameScheduler frame_scheduler(&graphics, kFramesInFlight);
+  QueueSync upload_sync(&copy, &graphics);
+
+  std::vector<PendingUpload> pending;
+  uint64_t previous_frame_start = 0;
+  uint64_t worst_frame_ns = 0;
+  uint64_t latency_ns = 0;
+  uint32_t uploads = 0;
+  for (uint32_t frame = 0; frame < frame_count; frame++) {
+    frame_scheduler.BeginFrame();
+    if (frame > 0) {
+      worst_frame_ns =
+          std::max(worst_frame_ns, clock.time_ns - previous_frame_start);
+    }
+    previous_frame_start = clock.time_ns;
+    graphics.AdvanceCpu(kCpuFrameNs);
+
+    if (frame % kUploadInterval == 0) {
+      if (mode == UploadMode::kGraphicsQueue) {
+        graphics.Submit(kUploadNs);
+        uploads++;
+      } else {
+        copy.Submit(kUploadNs);
+        pending.push_back({copy.Signal(), clock.time_ns});
+      }
+    }
+
+    // Decide which uploaded assets this frame draws
+    for (auto it = pending.begin(); it != pending.end();) {
+      if (mode == UploadMode::kCopyQueueWait ||
+          upload_sync.IsComplete(it->fence_value)) {
+        upload_sync.Require(it->fence_value);
+        latency_ns += clock.time_ns - it->issue_time_ns;
+        uploads++;
+        it = pending.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    upload_sync.BeforeSubmit();
+    graphics.Submit(kGpuFrameNs);
+    frame_scheduler.EndFrame();
+  }
+  frame_scheduler.WaitForIdle();
+
+  UploadResult result;
+  result.ms_per_frame = clock.time_ns / 1e6 / frame_count;
+  result.worst_frame_ms = worst_frame_ns / 1e6;
+  result.cpu_wait_ms = clock.wait_ns / 1e6;
+  result.gpu_waits = upload_sync.GetStats().gpu_waits;
+  result.upload_latency_ms =
+      mode == UploadMode::kGraphicsQueue || uploads == 0
+          ? 0.0
+          : latency_ns / 1e6 / uploads;
+  return result;
+}
+}  // namespace
+
+void RunAsyncUploadBenchmark(const BenchmarkOptions &options) {
+  std::cout << "Simulated GPU, " << options.frame_count << " frames of "
+            << kGpuFrameNs / 1e6 << " ms GPU time, a " << kUploadNs / 1e6
+            << " ms copy every " << kUploadInterval << " frames" << std::endl;
+  std::cout << std::setw(22) << "uploads" << std::setw(12) << "ms/frame"
+            << std::setw(12) << "worst ms" << std::setw(14) << "CPU wait ms"
+            << std::setw(11) << "GPU waits" << std::setw(13) << "latency ms"
+            << std::endl;
+  const UploadMode modes[] = {UploadMode::kGraphicsQueue,
+                              UploadMode::kCopyQueueWait,
+                              UploadMode::kCopyQueueStream};
+  for (UploadMode mode : modes) {
+    const UploadResult result = SimulateUploads(mode, options.frame_count);
+    std::cout << std::setw(22) << GetUploadModeName(mode) << std::setw(12)
+              << result.ms_per_frame << std::setw(12) << result.worst_frame_ms
+              << std::setw(14) << result.cpu_wait_ms << std::setw(11)
+              << result.gpu_waits << std::setw(13) << result.upload_latency_ms
+              << std::endl;
+  }
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+struct BenchmarkOptions {
+  // 0 uses every hardware thread
+  uint32_t max_threads{0};
+  uint32_t frame_count{200};
+  uint32_t draw_count{20000};
+  uint32_t object_count{500000};
+  // Benchmarks with machine readable results write them here when set
+  std::string json_path;
+};
+
+// Cost of TLSF allocations at several numbers of live allocations, and the
+// blocks, moves and planning time of compacting fragmented heap blocks
+void RunAllocatorBenchmark(const BenchmarkOptions &options);
+
+// Random allocations, frees, defragmentation moves and block releases of the
+// HeapBlockAllocator, validating its bookkeeping after every step and
+// checking that no live ranges overlap. Throws at the first inconsistency.
+void RunAllocatorFuzz(const BenchmarkOptions &options);
+
+// Cold and warm ShaderCache lookups through a stub compiler, and the misses
+// a changed define, an edited include, changed flags and a new compiler
+// version cause. Throws when a pass compiles more or less than it should.
+void RunShaderCacheBenchmark(const BenchmarkOptions &options);
+
+// Cost of DescriptorFreeList frees and allocations at capacities up to a
+// million slots, which stays flat as it is O(1), and its occupancy and peak
+// counts. Throws when a slot is handed out twice or a full heap allocates.
+void RunDescriptorBenchmark(const BenchmarkOptions &options);
+
+// Draws recorded per second by 1, 2, 4, ... threads partitioning a frame into
+// per-thread command lists on the job system
+void RunRecordingBenchmark(const BenchmarkOptions &options);
+
+// Cost of sorting and merging a frame of draw items in the draw queue, and
+// the draw calls and state changes it saves over submission order
+void RunDrawQueueBenchmark(const BenchmarkOptions &options);
+
+// Load time and size of a large mesh as a mapped quantized mesh file compared
+// to float vertices read with stream I/O, up to the copy into upload memory
+void RunMeshLoadBenchmark(const BenchmarkOptions &options);
+
+// Objects frustum culled per second by every SIMD level the CPU supports, on
+// 1, 2, 4, ... threads
+void RunCullingBenchmark(const BenchmarkOptions &options);
+
+// Cost of a PROFILE_SCOPE on 1, 2, 4, ... threads recording at once, and of
+// collecting their rings once per frame
+void RunProfilerBenchmark(const BenchmarkOptions &options);
+
+// CPU cost of the frame loop of Application against a null device, for
+// several draw counts, frames in flight and thread counts: ns per draw,
+// frames per second and heap allocations per frame
+void RunFrameLoopBenchmark(const BenchmarkOptions &options);
+
+// Frame times of a GPU bound frame loop while assets stream in, with copies
+// on the graphics queue against a copy queue ordered by QueueSync, on
+// simulated GPU timelines
+void RunAsyncUploadBenchmark(const BenchmarkOptions &options);
+
+// Duration of the startup task graph of Application with simulated tasks on
+// 1, 2, 4, ... threads against running the tasks one after another, and its
+// critical path. Checks first that jobs throwing on any worker rethrow from
+// JobSystem::Wait.
+void RunStartupBenchmark(const BenchmarkOptions &options);
+
+// Captured frames per second of a GPU bound frame loop reading its frames
+// back through 1 to 4 readback slots into a file, on a simulated GPU
+// timeline, and the stalls too few slots cause
+void RunCaptureBenchmark(const BenchmarkOptions &options);
+
+// Culling, barriers and transient memory with and without aliasing of a
+// deferred frame in the render graph, and the cost of compiling it
+void RunRenderGraphBenchmark(const BenchmarkOptions &options);
+
+// Frames per second, input to completion latency and GPU utilization of a
+// frame loop queuing frames, serializing them or holding them back with the
+// FramePacer, also behind a swap chain latency wait, on a simulated GPU
+// timeline with and without jitter. Fails when the pacer never delays a GPU
+// bound frame.
+void RunFramePacingBenchmark(const BenchmarkOptions &options);
+
+// LOD chain, meshlets and vertex cache efficiency the mesh processing makes
+// of a shuffled quad grid, and triangles processed per second over many
+// meshes on 1, 2, 4, ... threads
+void RunMeshProcessingBenchmark(const BenchmarkOptions &options);
+
+// Peak memory, loads, evictions, I/O throughput and the share of requested
+// levels resident of the StreamingManager serving a viewer moving over a
+// grid of mip mapped textures read from a mapped file, at several budgets
+void RunStreamingBenchmark(const BenchmarkOptions &options);
+
+// Occluder triangles rasterized and objects tested per second by the
+// OcclusionCuller with scalar code and AVX2, on 1, 2, 4, ... threads, and
+// the objects it finds occluded
+void RunOcclusionBenchmark(const BenchmarkOptions &options);
+
+// Frames and updates per second and update to frame latency of a frame loop
+// updating and rendering on one thread against the UpdateThread publishing
+// snapshots to the render thread, with simulated update and render costs
+void RunUpdateThreadBenchmark(const BenchmarkOptions &options);
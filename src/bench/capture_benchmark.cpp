@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+#include "bench/benchmarks.h"
+#include "core/frame_scheduler.h"
+#include "core/frame_sink.h"
+#include "core/image.h"
+#include "core/readback_queue.h"
+#include "core/simulated_gpu_timeline.h"
+
+namespace {
+// A GPU bound frame whose copy into the readback slot is part of the GPU
+// work. Writing a frame out is real and spends the measured time on the
+// simulated CPU.
+const uint64_t kCpuFrameNs = 2000000;
+const uint64_t kGpuFrameNs = 4000000;
+const uint32_t kFramesInFlight = 2;
+const uint32_t kFrameWidth = 640;
+const uint32_t kFrameHeight = 360;
+const char kCapturePath[] = "capture_benchmark.out";
+
+struct CaptureResult {
+  double frames_per_second;
+  double write_ms_per_frame;
+  double megabytes_per_second;
+  uint64_t stalls;
+  uint64_t max_latency_frames;
+};
+
+CaptureResult SimulateCapture(uint32_t depth,
+                              FrameSinkFormat format,
+                              const Image &frame,
+                              uint32_t frame_count) {
+  SimulatedGpuTimeline timeline;
+  FrameScheduler frame_scheduler(&timeline, kFramesInFlight);
+  ReadbackQueue readback_queue(&timeline, depth);
+  FrameSink sink(kCapturePath, format);
+
+  // Every slot holds the same pixels, only the cost of writing them matters
+  const FrameView view = GetFrameView(frame);
+  const auto write = [&](uint32_t, uint64_t) {
+    const uint64_t write_start = sink.GetStats().write_time_ns;
+    sink.WriteFrame(view);
+    timeline.AdvanceCpu(sink.GetStats().write_time_ns - write_start);
+  };
+  for (uint32_t i = 0; i < frame_count; i++) {
+    frame_scheduler.BeginFrame();
+    readback_queue.Acquire(write);
+    timeline.AdvanceCpu(kCpuFrameNs);
+    timeline.Submit(kGpuFrameNs);
+    const uint64_t frame_number = frame_scheduler.GetFrameNumber();
+    readback_queue.Submit(frame_number, frame_scheduler.EndFrame());
+    readback_queue.ReadCompleted(write);
+  }
+  readback_queue.Flush(write);
+  sink.Flush();
+
+  const FrameSinkStats &sink_stats = sink.GetStats();
+  const double seconds = timeline.GetCpuTime() / 1e9;
+  CaptureResult result;
+  result.frames_per_second = sink_stats.frames / seconds;
+  result.write_ms_per_frame = sink_stats.write_time_ns / 1e6 /
+                              std::max<uint64_t>(sink_stats.frames, 1);
+  result.megabytes_per_second = sink_stats.bytes / 1e6 / seconds;
+  result.stalls = readback_queue.GetStats().stalls;
+  result.max_latency_frames = readback_queue.GetStats().max_latency_frames;
+  return result;
+}
+}  // namespace
+
+void RunCaptureBenchmark(const BenchmarkOptions &options) {
+  Image frame(kFrameWidth, kFrameHeight);
+  for (uint32_t y = 0; y < frame.height; y++) {
+    for (uint32_t x = 0; x < frame.width; x++) {
+      frame.Row(y)[x] = 0xff000000u | (y & 0xff) << 8 | (x & 0xff);
+    }
+  }
+
+  std::cout << "Simulated GPU, " << options.frame_count << " frames of "
+            << kGpuFrameNs / 1e6 << " ms GPU time, " << kFramesInFlight
+            << " frames in flight, " << kFrameWidth << "x" << kFrameHeight
+            << " frames written to " << kCapturePath << std::endl;
+  std::cout << std::setw(8) << "format" << std::setw(7) << "depth"
+            << std::setw(10) << "frames/s" << std::setw(12) << "write ms"
+            << std::setw(8) << "MB/s" << std::setw(8) << "stalls"
+            << std::setw(9) << "latency" << std::endl;
+  struct Config {
+    FrameSinkFormat format;
+    uint32_t depth;
+  };
+  const Config configs[] = {
+      {FrameSinkFormat::kRawRgba, 1}, {FrameSinkFormat::kRawRgba, 2},
+      {FrameSinkFormat::kRawRgba, 3}, {FrameSinkFormat::kRawRgba, 4},
+      {FrameSinkFormat::kPpm, 3},
+  };
+  for (const Config &config : configs) {
+    const CaptureResult result = SimulateCapture(
+        config.depth, config.format, frame, options.frame_count);
+    std::cout << std::setw(8)
+              << (config.format == FrameSinkFormat::kPpm ? "ppm" : "raw")
+              << std::setw(7) << config.depth << std::setw(10)
+              << result.frames_per_second << std::setw(12)
+              << result.write_ms_per_frame << std::setw(8)
+              << result.megabytes_per_second << std::setw(8) << result.stalls
+              << std::setw(9) << result.max_latency_frames << std::endl;
+  }
+  std::remove(kCapturePath);
+}
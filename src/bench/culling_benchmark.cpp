@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/builtin_meshes.h"
+#include "core/job_system.h"
+#include "core/scene.h"
+
+namespace {
+// The view sees about 1/64 of the scene, as when flying over a large world
+const float kSceneExtent = 8.0f;
+const SimdLevel kSimdLevels[] = {SimdLevel::kScalar, SimdLevel::kSse2,
+                                 SimdLevel::kAvx};
+}  // namespace
+
+void RunCullingBenchmark(const BenchmarkOptions &options) {
+  uint32_t max_threads = options.max_threads;
+  if (max_threads == 0) {
+    max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  Scene scene;
+  const BoundingSphere bounds = {glm::vec3(0.0f, 0.0f, 0.0f), 0.5f};
+  for (const auto &instance :
+       BuildScatteredInstances(options.object_count, kSceneExtent)) {
+    scene.AddObject(0, instance, bounds);
+  }
+  Camera2D camera;
+  const Frustum frustum = ExtractFrustum(camera.GetViewProjection());
+
+  std::vector<uint32_t> thread_counts;
+  for (uint32_t threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  std::cout << "Objects: " << options.object_count << ", best of "
+            << options.frame_count << " culls" << std::endl;
+  std::cout << std::setw(8) << "ISA" << std::setw(10) << "threads"
+            << std::setw(12) << "ms/cull" << std::setw(16) << "Mobjects/sec"
+            << std::setw(10) << "visible" << std::endl;
+  std::vector<uint32_t> reference;
+  for (SimdLevel level : kSimdLevels) {
+    if (level > GetSupportedSimdLevel()) {
+      std::cout << std::setw(8) << GetSimdLevelName(level)
+                << "  not supported" << std::endl;
+      continue;
+    }
+    for (uint32_t threads : thread_counts) {
+      JobSystem job_system(threads);
+      SceneCuller culler(&job_system, level);
+      // Warm up the visible lists and the worker threads
+      const std::vector<uint32_t> visible = culler.Cull(scene, frustum);
+      uint64_t best_ns = ~uint64_t(0);
+      for (uint32_t i = 0; i < options.frame_count; i++) {
+        culler.Cull(scene, frustum);
+        best_ns = std::min(best_ns, culler.GetStats().time_ns);
+      }
+
+      if (reference.empty()) {
+        reference = visible;
+      } else if (visible != reference) {
+        throw std::runtime_error(std::string(GetSimdLevelName(level)) +
+                                 " culling differs from scalar culling");
+      }
+      std::cout << std::setw(8) << GetSimdLevelName(level) << std::setw(10)
+                << threads << std::setw(12) << best_ns / 1e6 << std::setw(16)
+                << options.object_count / (best_ns / 1e9) / 1e6
+                << std::setw(10) << visible.size() << std::endl;
+    }
+  }
+}
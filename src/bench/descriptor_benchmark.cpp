@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/descriptor_free_list.h"
+
+namespace {
+const uint32_t kOperations = 1000000;
+// From a heap of render targets to a bindless heap of every resource
+const uint32_t kCapacities[] = {1024, 16384, 262144, 1 << 20};
+
+void Check(bool condition, uint32_t capacity, const std::string &what) {
+  if (!condition) {
+    throw std::runtime_error("Descriptor free list of " +
+                             std::to_string(capacity) + " slots: " + what);
+  }
+}
+
+struct FreeListResult {
+  double ns_per_operation;
+  // Live slots after the churn and the most there ever were
+  uint32_t used;
+  uint32_t peak_used;
+  uint64_t failed_allocations;
+};
+
+// Fill half of the heap, replace random slots and fill it up to the last
+// slot, checking that no slot is handed out twice
+FreeListResult MeasureFreeList(uint32_t capacity) {
+  DescriptorFreeList free_list(capacity);
+  std::vector<bool> allocated(capacity, false);
+  const auto allocate = [&] {
+    const uint32_t index = free_list.Allocate();
+    Check(index < capacity && !allocated[index], capacity,
+          "slot " + std::to_string(index) + " handed out while in use");
+    allocated[index] = true;
+    return index;
+  };
+  std::vector<uint32_t> live;
+  for (uint32_t i = 0; i < capacity / 2; i++) {
+    live.push_back(allocate());
+  }
+  std::mt19937 random(capacity);
+  std::vector<uint32_t> victims(kOperations);
+  for (uint32_t &victim : victims) {
+    victim = random() % live.size();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t victim : victims) {
+    free_list.Free(live[victim]);
+    live[victim] = free_list.Allocate();
+  }
+  const double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  // The timed loop skips the checks, verify its result afterwards
+  std::fill(allocated.begin(), allocated.end(), false);
+  for (uint32_t index : live) {
+    Check(index < capacity && !allocated[index], capacity,
+          "slot " + std::to_string(index) + " live twice after the churn");
+    allocated[index] = true;
+  }
+  FreeListResult result;
+  result.ns_per_operation = ns / (2.0 * kOperations);
+  result.used = free_list.GetStats().used;
+  Check(result.used == live.size(), capacity, "wrong used count");
+
+  while (free_list.GetStats().used < capacity) {
+    allocate();
+  }
+  Check(free_list.Allocate() == DescriptorFreeList::kInvalidIndex, capacity,
+        "allocation succeeded in a full heap");
+  const DescriptorAllocatorStats &stats = free_list.GetStats();
+  Check(stats.peak_used == capacity && stats.failed_allocations == 1,
+        capacity, "wrong peak or failure count");
+  result.peak_used = stats.peak_used;
+  result.failed_allocations = stats.failed_allocations;
+  return result;
+}
+}  // namespace
+
+void RunDescriptorBenchmark(const BenchmarkOptions &) {
+  std::cout << "DescriptorFreeList, " << kOperations
+            << " frees and allocations at half occupancy" << std::endl;
+  std::cout << std::setw(10) << "capacity" << std::setw(16) << "ns/operation"
+            << std::setw(12) << "occupancy" << std::setw(10) << "peak"
+            << std::setw(10) << "failed" << std::endl;
+  std::vector<double> costs;
+  for (uint32_t capacity : kCapacities) {
+    const FreeListResult result = MeasureFreeList(capacity);
+    costs.push_back(result.ns_per_operation);
+    std::cout << std::setw(10) << capacity << std::setw(16)
+              << result.ns_per_operation << std::setw(11)
+              << 100.0 * result.used / capacity << "%" << std::setw(10)
+              << result.peak_used << std::setw(10)
+              << result.failed_allocations << std::endl;
+  }
+  // Constant time shows as a flat cost, only caches grow it with the heap
+  std::cout << "Cost grows " << costs.back() / costs.front() << "x for a "
+            << kCapacities[std::size(kCapacities) - 1] / kCapacities[0]
+            << "x larger heap" << std::endl;
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/draw_queue.h"
+
+namespace {
+const uint32_t kRootSignatureCount = 2;
+const uint32_t kPipelineCount = 32;
+const uint32_t kVertexBufferCount = 16;
+const uint32_t kMeshCount = 500;
+
+struct InstanceTransform {
+  float world[12];
+};
+}  // namespace
+
+void RunDrawQueueBenchmark(const BenchmarkOptions &options) {
+  DrawQueue draw_queue(sizeof(InstanceTransform));
+  for (uint32_t mesh = 0; mesh < kMeshCount; mesh++) {
+    draw_queue.AddMesh({mesh % kVertexBufferCount, mesh * 36, 36, 0});
+  }
+
+  // Objects in scene traversal order, which is unrelated to their state
+  std::mt19937 random(1);
+  std::vector<DrawItem> items(options.draw_count);
+  std::vector<InstanceTransform> transforms(options.draw_count);
+  for (uint32_t i = 0; i < options.draw_count; i++) {
+    const uint32_t mesh = random() % kMeshCount;
+    items[i].root_signature = mesh % kRootSignatureCount;
+    items[i].pipeline = mesh % kPipelineCount;
+    items[i].mesh = mesh;
+    for (float &value : transforms[i].world) {
+      value = static_cast<float>(i);
+    }
+  }
+
+  // What submitting every item as its own draw would cost
+  DrawQueueStats unsorted;
+  unsorted.items = options.draw_count;
+  unsorted.draw_calls = options.draw_count;
+  for (uint32_t i = 0; i < options.draw_count; i++) {
+    const bool first = i == 0;
+    unsorted.root_signature_changes +=
+        first || items[i].root_signature != items[i - 1].root_signature;
+    unsorted.pipeline_changes +=
+        first || items[i].pipeline != items[i - 1].pipeline;
+    unsorted.vertex_buffer_changes +=
+        first || items[i].mesh % kVertexBufferCount !=
+                     items[i - 1].mesh % kVertexBufferCount;
+  }
+
+  const auto build_frame = [&] {
+    draw_queue.Reset();
+    for (uint32_t i = 0; i < options.draw_count; i++) {
+      draw_queue.Push(items[i], &transforms[i]);
+    }
+    draw_queue.Build();
+  };
+  // Warm up the queue's buffers
+  build_frame();
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < options.frame_count; frame++) {
+    build_frame();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  const DrawQueueStats &sorted = draw_queue.GetStats();
+  std::cout << "Items per frame: " << options.draw_count << ", "
+            << kMeshCount << " meshes, " << kPipelineCount << " pipelines"
+            << std::endl;
+  std::cout << "Build time: " << seconds * 1000.0 / options.frame_count
+            << " ms/frame, "
+            << double(options.draw_count) * options.frame_count / seconds / 1e6
+            << " M items/sec" << std::endl;
+  std::cout << "Submission order: " << unsorted.draw_calls << " draw calls, "
+            << unsorted.root_signature_changes << " root signature, "
+            << unsorted.pipeline_changes << " pipeline, "
+            << unsorted.vertex_buffer_changes << " vertex buffer changes"
+            << std::endl;
+  std::cout << "Draw queue: " << sorted.draw_calls << " draw calls, "
+            << sorted.root_signature_changes << " root signature, "
+            << sorted.pipeline_changes << " pipeline, "
+            << sorted.vertex_buffer_changes << " vertex buffer changes"
+            << std::endl;
+}
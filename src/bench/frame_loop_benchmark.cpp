@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bench/allocation_counter.h"
+#include "bench/benchmarks.h"
+#include "bench/null_device.h"
+#include "core/builtin_meshes.h"
+#include "core/draw_encoder.h"
+#include "core/draw_partition.h"
+#include "core/draw_queue.h"
+#include "core/frame_scheduler.h"
+#include "core/job_system.h"
+#include "core/mesh_processing.h"
+#include "core/occlusion_culling.h"
+#include "core/render_graph.h"
+#include "core/replay_cache.h"
+#include "core/scene.h"
+#include "core/streaming_manager.h"
+
+namespace {
+// Same as Application
+const uint32_t kMinDrawsPerChunk = 256;
+const uint32_t kMaxUnusedBundleFrames = 120;
+const uint32_t kMeshConstantsParameter = 0;
+const uint32_t kDrawConstantsParameter = 1;
+const uint32_t kObjectTableParameter = 2;
+const float kLodErrorPixels = 1.0f;
+const uint32_t kOccluderCount = 32;
+const uint32_t kOcclusionBufferDivisor = 4;
+// D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST and DXGI_FORMAT_R16_UINT
+const uint32_t kTriangleList = 4;
+const uint32_t kIndexFormatR16 = 57;
+// Scene content, meshes spread over a few vertex buffers and pipelines.
+// Every mesh has the LOD chain of a quad grid and streams its LODs.
+const uint32_t kMeshCount = 256;
+const uint32_t kQuadsPerSide = 32;
+const uint32_t kVertexBufferCount = 8;
+const uint32_t kPipelineCount = 4;
+const float kWidth = 1920.0f;
+const float kHeight = 1080.0f;
+
+struct FrameLoopConfig {
+  uint32_t draw_count;
+  uint32_t frames_in_flight;
+  uint32_t thread_count;
+};
+
+struct FrameLoopResult {
+  FrameLoopConfig config;
+  double ns_per_draw;
+  double frames_per_second;
+  double allocations_per_frame;
+  double bundle_hit_rate;
+};
+
+// The frame of Application with the D3D12 device replaced by NullDevice:
+// OnUpdate culls the scene, OnRender updates streaming, selects the LOD of
+// every visible object, culls occluded objects, builds the draw queue,
+// writes the object buffer of the slot, compiles the render graph, records
+// the chunks on the workers through the bundle cache, submits, presents and
+// signals the frame
+class NullFrameLoop {
+ public:
+  explicit NullFrameLoop(const FrameLoopConfig &config)
+      : job_system_(config.thread_count),
+        scene_culler_(&job_system_),
+        mesh_(ProcessMesh(BuildQuadGridMesh(kQuadsPerSide).GetView())),
+        occlusion_culler_(&job_system_,
+                          static_cast<uint32_t>(kWidth) /
+                              kOcclusionBufferDivisor,
+                          static_cast<uint32_t>(kHeight) /
+                              kOcclusionBufferDivisor),
+        draw_queue_(sizeof(ObjectData)),
+        frame_scheduler_(device_.GetTimeline(), config.frames_in_flight),
+        object_buffers_(config.frames_in_flight),
+        command_lists_(config.frames_in_flight) {
+    for (uint32_t buffer = 0; buffer < kVertexBufferCount; buffer++) {
+      const uint64_t address = (uint64_t(buffer) + 1) << 32;
+      mesh_buffers_.push_back(
+          {{address, 1 << 20, sizeof(Vertex)},
+           {address + (1 << 20), 1 << 20, kIndexFormatR16}});
+    }
+    // Like Application, the LODs of a mesh follow its full detail id and are
+    // the levels of a streamed resource, the coarsest resident from the start
+    const MeshView view = mesh_.GetView();
+    std::vector<StreamingLevel> levels;
+    for (const MeshLod &lod : mesh_.lods) {
+      levels.push_back({mesh_.index_data.data() +
+                            uint64_t(lod.first_index) * view.index_size,
+                        uint64_t(lod.index_count) * view.index_size});
+    }
+    for (uint32_t mesh = 0; mesh < kMeshCount; mesh++) {
+      for (const MeshLod &lod : mesh_.lods) {
+        draw_queue_.AddMesh({mesh % kVertexBufferCount, lod.first_index,
+                             lod.index_count, 0});
+        mesh_quantizations_.push_back(view.quantization);
+      }
+      mesh_resources_.push_back(streaming_.AddResource(levels));
+    }
+
+    // A grid filling the view, so every object is drawn
+    const uint32_t grid_size = static_cast<uint32_t>(
+        std::ceil(std::sqrt(static_cast<double>(config.draw_count))));
+    const float cell_size = 2.0f / grid_size;
+    for (uint32_t i = 0; i < config.draw_count; i++) {
+      const InstanceData instance = {
+          {-1.0f + cell_size * (i % grid_size + 0.5f),
+           -1.0f + cell_size * (i / grid_size + 0.5f)},
+          {cell_size * 0.4f, cell_size * 0.4f}};
+      scene_.AddObject(i % kMeshCount * GetLodCount(), instance,
+                       ComputeBoundingSphere(view));
+    }
+
+    chunk_streams_.resize(job_system_.GetThreadCount());
+    for (auto &lists : command_lists_) {
+      lists.resize(job_system_.GetThreadCount());
+    }
+  }
+
+  void RunFrame() {
+    OnUpdate();
+    OnRender();
+  }
+
+  ReplayCacheStats GetBundleStats() const {
+    return bundles_.GetStats();
+  }
+  // Loads in flight or just completed change the LODs of later frames
+  bool IsStreaming() const {
+    return streaming_.GetStats().pending_bytes > 0 ||
+           !streaming_.GetLoadedLevels().empty();
+  }
+
+ private:
+  uint32_t GetLodCount() const {
+    return static_cast<uint32_t>(mesh_.lods.size());
+  }
+
+  void OnUpdate() {
+    const Frustum frustum = ExtractFrustum(camera_.GetViewProjection());
+    visible_objects_ = &scene_culler_.Cull(scene_, frustum);
+  }
+
+  void OnRender() {
+    const uint32_t frame_slot = frame_scheduler_.BeginFrame();
+
+    // Levels load straight out of the mesh, there is nothing to upload
+    streaming_.Update();
+    frame_items_.clear();
+    frame_objects_.clear();
+    for (uint32_t object : *visible_objects_) {
+      const ObjectData object_data = {
+          camera_.ToClipSpace(scene_.GetInstance(object)),
+          scene_.GetColor(object)};
+      const uint32_t mesh = scene_.GetMesh(object);
+      const float pixels_per_unit =
+          0.5f * std::max(std::abs(object_data.transform.scale.x) * kWidth,
+                          std::abs(object_data.transform.scale.y) * kHeight);
+      uint32_t lod = SelectLod(mesh_.lods.data(), GetLodCount(),
+                               pixels_per_unit, kLodErrorPixels);
+      const uint32_t resource = mesh_resources_[mesh / GetLodCount()];
+      streaming_.Request(resource, lod, pixels_per_unit);
+      lod = std::max(lod, streaming_.GetResidentLevel(resource));
+      const uint32_t pipeline = mesh / GetLodCount() % kPipelineCount;
+      frame_items_.push_back({0, pipeline, mesh + lod});
+      frame_objects_.push_back(object_data);
+    }
+    CullOccludedObjects();
+
+    draw_queue_.Reset();
+    for (size_t i = 0; i < frame_items_.size(); i++) {
+      if (occlusion_visible_[i]) {
+        draw_queue_.Push(frame_items_[i], &frame_objects_[i]);
+      }
+    }
+    draw_queue_.Build();
+    const std::vector<uint8_t> &object_data = draw_queue_.GetInstanceData();
+    object_buffers_[frame_slot].assign(object_data.begin(),
+                                       object_data.end());
+
+    render_graph_.Reset();
+    const uint32_t back_buffer = render_graph_.ImportResource(
+        "BackBuffer", ResourceState::kPresent, ResourceState::kPresent);
+    render_graph_.AddPass("Scene",
+                          {{back_buffer, ResourceState::kRenderTarget}});
+    render_graph_.Compile();
+
+    DrawBindings bindings;
+    bindings.primitive_topology = kTriangleList;
+    bindings.mesh_constants_parameter = kMeshConstantsParameter;
+    bindings.mesh_buffers = mesh_buffers_.data();
+    bindings.mesh_quantizations = mesh_quantizations_.data();
+    bindings.draw_constants_parameter = kDrawConstantsParameter;
+    bindings.object_table_parameter = kObjectTableParameter;
+    // A new table of the descriptor ring every frame, like Application
+    bindings.object_table = (frame_scheduler_.GetFrameNumber() + 1) << 16;
+
+    const std::vector<DrawChunk> chunks = PartitionDraws(
+        static_cast<uint32_t>(draw_queue_.GetBatches().size()),
+        job_system_.GetThreadCount(), kMinDrawsPerChunk);
+    std::vector<NullCommandList> &lists = command_lists_[frame_slot];
+    const uint64_t frame = frame_scheduler_.GetFrameNumber();
+    job_system_.ParallelFor(
+        static_cast<uint32_t>(chunks.size()), [&](uint32_t chunk, uint32_t) {
+          PopulateCommandList(&lists[chunk], chunk,
+                              static_cast<uint32_t>(chunks.size()),
+                              chunks[chunk], bindings, frame);
+        });
+
+    submitted_lists_.clear();
+    for (uint32_t chunk = 0; chunk < chunks.size(); chunk++) {
+      submitted_lists_.push_back(&lists[chunk]);
+    }
+    device_.ExecuteCommandLists(submitted_lists_.data(),
+                                static_cast<uint32_t>(submitted_lists_.size()));
+    device_.Present();
+    frame_scheduler_.EndFrame();
+    bundles_.Collect(frame_scheduler_.GetFrameNumber(),
+                     kMaxUnusedBundleFrames);
+  }
+
+  // Application::CullOccludedObjects, with the occlusion buffer at a fixed
+  // size
+  void CullOccludedObjects() {
+    const uint32_t count = static_cast<uint32_t>(frame_items_.size());
+    frame_depths_.resize(count);
+    ComputeDrawOrderDepths(draw_queue_, frame_items_.data(), count,
+                           frame_depths_.data());
+
+    occluders_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+      occluders_[i] = i;
+    }
+    const auto screen_area = [this](uint32_t i) {
+      const InstanceData &transform = frame_objects_[i].transform;
+      return std::abs(transform.scale.x * transform.scale.y);
+    };
+    const uint32_t occluder_count = std::min(kOccluderCount, count);
+    std::nth_element(occluders_.begin(), occluders_.begin() + occluder_count,
+                     occluders_.end(), [&](uint32_t a, uint32_t b) {
+                       return screen_area(a) > screen_area(b);
+                     });
+    occlusion_culler_.BeginFrame();
+    const MeshView view = mesh_.GetView();
+    for (uint32_t i = 0; i < occluder_count; i++) {
+      const uint32_t object = occluders_[i];
+      const MeshLod &lod = mesh_.lods[frame_items_[object].mesh %
+                                      GetLodCount()];
+      const OccluderMesh occluder = {
+          view.vertices,
+          view.vertex_count,
+          mesh_.index_data.data() + uint64_t(lod.first_index) * view.index_size,
+          lod.index_count,
+          view.index_size,
+          view.quantization};
+      occlusion_culler_.AddOccluder(occluder,
+                                    frame_objects_[object].transform,
+                                    frame_depths_[object]);
+    }
+    occlusion_culler_.Rasterize();
+
+    occlusion_queries_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+      occlusion_queries_[i] = {frame_objects_[i].transform,
+                               mesh_quantizations_[frame_items_[i].mesh],
+                               frame_depths_[i]};
+    }
+    occlusion_culler_.Test(occlusion_queries_.data(), count,
+                           &occlusion_visible_);
+  }
+
+  void PopulateCommandList(NullCommandList *command_list,
+                           uint32_t chunk_index,
+                           uint32_t chunk_count,
+                           const DrawChunk &chunk,
+                           const DrawBindings &bindings,
+                           uint64_t frame) {
+    command_list->Reset();
+    command_list->SetViewport(kWidth, kHeight);
+    const uint64_t back_buffer = frame % 2 + 1;
+    if (chunk_index == 0) {
+      RecordBarriers(command_list, 0, back_buffer);
+      const float clear_color[] = {0.0f, 0.2f, 0.4f, 1.0f};
+      command_list->ClearRenderTarget(back_buffer, clear_color);
+    }
+    command_list->SetRenderTarget(back_buffer);
+
+    CommandStream &stream = chunk_streams_[chunk_index];
+    EncodeDraws(draw_queue_, bindings, chunk, &stream);
+    if (!stream.IsEmpty()) {
+      command_list->SetRootSignature(
+          draw_queue_.GetBatches()[chunk.first_draw].root_signature);
+      command_list->SetRootDescriptorTable(bindings.object_table_parameter,
+                                           bindings.object_table);
+      const NullCommandList *bundle = bundles_.Find(stream, frame);
+      if (!bundle) {
+        const auto start = std::chrono::steady_clock::now();
+        NullCommandList recorded;
+        recorded.Replay(stream);
+        const uint64_t record_time_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+        bundle = &bundles_.Insert(stream, std::move(recorded), record_time_ns,
+                                  frame);
+      }
+      command_list->ExecuteBundle(*bundle);
+    }
+
+    if (chunk_index + 1 == chunk_count) {
+      RecordBarriers(command_list, render_graph_.GetStepCount(), back_buffer);
+    }
+  }
+
+  // The back buffer is the only resource of the graph
+  void RecordBarriers(NullCommandList *command_list,
+                      uint32_t step,
+                      uint64_t back_buffer) const {
+    const GraphBarrierBatch batch = render_graph_.GetBarriers(step);
+    for (uint32_t i = 0; i < batch.count; i++) {
+      command_list->ResourceBarrier(
+          back_buffer, static_cast<uint32_t>(batch.barriers[i].before),
+          static_cast<uint32_t>(batch.barriers[i].after));
+    }
+  }
+
+  NullDevice device_;
+  JobSystem job_system_;
+  Scene scene_;
+  SceneCuller scene_culler_;
+  Camera2D camera_;
+  const std::vector<uint32_t> *visible_objects_{nullptr};
+  Mesh mesh_;
+  // Streaming resource of every mesh, in the order of the meshes
+  StreamingManager streaming_;
+  std::vector<uint32_t> mesh_resources_;
+  std::vector<DrawItem> frame_items_;
+  std::vector<ObjectData> frame_objects_;
+  OcclusionCuller occlusion_culler_;
+  std::vector<float> frame_depths_;
+  std::vector<uint32_t> occluders_;
+  std::vector<OcclusionQuery> occlusion_queries_;
+  std::vector<uint8_t> occlusion_visible_;
+  DrawQueue draw_queue_;
+  std::vector<MeshBufferBindings> mesh_buffers_;
+  std::vector<PositionQuantization> mesh_quantizations_;
+  FrameScheduler frame_scheduler_;
+  std::vector<std::vector<uint8_t>> object_buffers_;
+  RenderGraph render_graph_;
+  std::vector<CommandStream> chunk_streams_;
+  // Per frame slot and chunk, like the allocators of ParallelCommandRecorder
+  std::vector<std::vector<NullCommandList>> command_lists_;
+  std::vector<const NullCommandList *> submitted_lists_;
+  ReplayCache<NullCommandList> bundles_;
+};
+
+FrameLoopResult RunFrameLoop(const FrameLoopConfig &config,
+                             uint32_t frame_count) {
+  NullFrameLoop loop(config);
+  // Stream in the LODs, grow every buffer to its peak and fill the bundle
+  // cache of every slot before measuring
+  for (uint32_t settled = 0; settled < config.frames_in_flight * 2;) {
+    loop.RunFrame();
+    settled = loop.IsStreaming() ? 0 : settled + 1;
+  }
+
+  const ReplayCacheStats bundles_before = loop.GetBundleStats();
+  const uint64_t allocations_before = GetAllocationCount();
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < frame_count; i++) {
+    loop.RunFrame();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  const uint64_t allocations = GetAllocationCount() - allocations_before;
+  const ReplayCacheStats bundles = loop.GetBundleStats();
+
+  FrameLoopResult result;
+  result.config = config;
+  result.ns_per_draw =
+      seconds * 1e9 / (double(frame_count) * std::max(config.draw_count, 1u));
+  result.frames_per_second = frame_count / seconds;
+  result.allocations_per_frame = double(allocations) / frame_count;
+  const uint64_t lookups = bundles.lookups - bundles_before.lookups;
+  result.bundle_hit_rate =
+      lookups > 0 ? double(bundles.hits - bundles_before.hits) / lookups : 0.0;
+  return result;
+}
+
+void WriteJson(const std::string &path,
+               const BenchmarkOptions &options,
+               const std::vector<FrameLoopResult> &results) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+  fprintf(file, "{\n  \"benchmark\": \"frame_loop\",\n  \"frames\": %u,\n",
+          options.frame_count);
+  fprintf(file, "  \"results\": [");
+  for (size_t i = 0; i < results.size(); i++) {
+    const FrameLoopResult &result = results[i];
+    fprintf(file,
+            "%s\n    {\"draws\": %u, \"frames_in_flight\": %u, "
+            "\"threads\": %u, \"ns_per_draw\": %.3f, "
+            "\"frames_per_second\": %.3f, \"allocations_per_frame\": %.3f, "
+            "\"bundle_hit_rate\": %.3f}",
+            i == 0 ? "" : ",", result.config.draw_count,
+            result.config.frames_in_flight, result.config.thread_count,
+            result.ns_per_draw, result.frames_per_second,
+            result.allocations_per_frame, result.bundle_hit_rate);
+  }
+  fprintf(file, "\n  ]\n}\n");
+  const bool failed = ferror(file) != 0;
+  if (fclose(file) != 0 || failed) {
+    throw std::runtime_error("Failed to write " + path);
+  }
+}
+}  // namespace
+
+void RunFrameLoopBenchmark(const BenchmarkOptions &options) {
+  uint32_t max_threads = options.max_threads;
+  if (max_threads == 0) {
+    max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  std::vector<uint32_t> thread_counts;
+  for (uint32_t threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+  const uint32_t draw_counts[] = {std::max(options.draw_count / 10, 1u),
+                                  options.draw_count};
+  const uint32_t frames_in_flight[] = {FrameScheduler::kMinFramesInFlight,
+                                       FrameScheduler::kMinFramesInFlight + 1};
+
+  std::cout << "Null device, " << options.frame_count << " frames"
+            << std::endl;
+  std::cout << std::setw(8) << "draws" << std::setw(8) << "frames"
+            << std::setw(9) << "threads" << std::setw(13) << "ns/draw"
+            << std::setw(12) << "frames/sec" << std::setw(14) << "allocs/frame"
+            << std::setw(12) << "bundle hits" << std::endl;
+  std::vector<FrameLoopResult> results;
+  for (uint32_t draw_count : draw_counts) {
+    for (uint32_t frames : frames_in_flight) {
+      for (uint32_t threads : thread_counts) {
+        const FrameLoopResult result =
+            RunFrameLoop({draw_count, frames, threads}, options.frame_count);
+        results.push_back(result);
+        std::cout << std::setw(8) << draw_count << std::setw(8) << frames
+                  << std::setw(9) << threads << std::setw(13) << std::fixed
+                  << std::setprecision(1) << result.ns_per_draw
+                  << std::setw(12) << result.frames_per_second
+                  << std::setw(14) << std::setprecision(2)
+                  << result.allocations_per_frame << std::setw(12)
+                  << result.bundle_hit_rate << std::endl;
+      }
+    }
+  }
+
+  if (!options.json_path.empty()) {
+    WriteJson(options.json_path, options, results);
+    std::cout << "Wrote " << options.json_path << std::endl;
+  }
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "bench/benchmarks.h"
+#include "core/frame_pacer.h"
+#include "core/frame_scheduler.h"
+#include "core/frame_time_stats.h"
+#include "core/simulated_gpu_timeline.h"
+
+namespace {
+const uint32_t kFramesInFlight = 2;
+
+enum class PacingMode {
+  // Frames queue up behind the GPU as far as the frame slots allow
+  kQueued,
+  // Every frame waits for the previous one to complete, latency of one frame
+  // at the cost of the CPU and GPU never overlapping
+  kSerialized,
+  // Frames are held back by the FramePacer
+  kPaced,
+  // Paced behind a swap chain latency wait of the frames in flight, which
+  // ends before the frame slot wait could block, like Application does
+  kPacedSwapChain,
+};
+
+struct Scenario {
+  const char *name;
+  uint64_t cpu_frame_ns;
+  uint64_t gpu_frame_ns;
+  // Frame times vary uniformly by up to this much either way
+  uint64_t jitter_ns;
+};
+
+struct PacingResult {
+  double frames_per_second;
+  double mean_latency_ms;
+  double p99_latency_ms;
+  double gpu_busy;
+  uint64_t delayed_frames;
+  uint64_t late_frames;
+};
+
+const char *GetModeName(PacingMode mode) {
+  switch (mode) {
+    case PacingMode::kQueued:
+      return "queued";
+    case PacingMode::kSerialized:
+      return "serialized";
+    case PacingMode::kPaced:
+      return "paced";
+    case PacingMode::kPacedSwapChain:
+      return "paced swap";
+  }
+  return "";
+}
+
+// Latency runs from the start of the CPU work of a frame, where input is
+// sampled, to the GPU completing the frame
+PacingResult SimulatePacing(const Scenario &scenario,
+                            PacingMode mode,
+                            uint32_t frame_count) {
+  SimulatedGpuTimeline timeline;
+  FrameScheduler frame_scheduler(&timeline, kFramesInFlight);
+  FramePacer pacer;
+  FrameTimeStats latencies(frame_count);
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int64_t> jitter(
+      -static_cast<int64_t>(scenario.jitter_ns),
+      static_cast<int64_t>(scenario.jitter_ns));
+
+  // Fence values of the frames queued in the simulated swap chain, presents
+  // complete with the GPU work of their frame
+  std::deque<uint64_t> presented_frames;
+  uint64_t last_fence_value = 0;
+  uint64_t gpu_free_at_ns = 0;
+  double latency_sum_ms = 0.0;
+  for (uint32_t i = 0; i < frame_count; i++) {
+    FrameStartWaits waits;
+    if (mode == PacingMode::kPacedSwapChain &&
+        presented_frames.size() == kFramesInFlight) {
+      // Polled first like the frame latency waitable
+      const bool blocked =
+          timeline.GetCompletedValue() < presented_frames.front();
+      if (blocked) {
+        timeline.WaitForValue(presented_frames.front());
+      }
+      presented_frames.pop_front();
+      waits.OnWaitEnd(timeline.GetCpuTime(), blocked);
+    }
+    const uint64_t stalls = frame_scheduler.GetStats().stalls;
+    frame_scheduler.BeginFrame();
+    waits.OnWaitEnd(timeline.GetCpuTime(),
+                    frame_scheduler.GetStats().stalls != stalls);
+    if (mode == PacingMode::kSerialized) {
+      timeline.WaitForValue(last_fence_value);
+    }
+    if (mode == PacingMode::kPaced || mode == PacingMode::kPacedSwapChain) {
+      pacer.OnWaitEnd(waits.GetEndTime(), waits.IsBlocked());
+      const uint64_t delay = pacer.GetDelay();
+      timeline.AdvanceCpu(delay);
+      pacer.OnDelay(delay);
+    }
+
+    const uint64_t input_ns = timeline.GetCpuTime();
+    const uint64_t cpu_ns = scenario.cpu_frame_ns + jitter(random);
+    const uint64_t gpu_ns = scenario.gpu_frame_ns + jitter(random);
+    timeline.AdvanceCpu(cpu_ns);
+    timeline.Submit(gpu_ns);
+    last_fence_value = frame_scheduler.EndFrame();
+    presented_frames.push_back(last_fence_value);
+    pacer.OnFrameSubmitted(cpu_ns);
+
+    // Mirrors the timeline, which starts work once both sides are ready
+    gpu_free_at_ns = std::max(gpu_free_at_ns, timeline.GetCpuTime()) + gpu_ns;
+    const double latency_ms = (gpu_free_at_ns - input_ns) / 1e6;
+    latencies.AddFrame(latency_ms);
+    latency_sum_ms += latency_ms;
+  }
+  frame_scheduler.WaitForIdle();
+
+  const double seconds = timeline.GetCpuTime() / 1e9;
+  PacingResult result;
+  result.frames_per_second = frame_count / seconds;
+  result.mean_latency_ms = latency_sum_ms / std::max(frame_count, 1u);
+  result.p99_latency_ms = latencies.GetPercentile(99.0);
+  result.gpu_busy = timeline.GetGpuBusyTime() / 1e9 / seconds;
+  result.delayed_frames = pacer.GetStats().delayed_frames;
+  result.late_frames = pacer.GetStats().late_frames;
+  return result;
+}
+}  // namespace
+
+void RunFramePacingBenchmark(const BenchmarkOptions &options) {
+  const Scenario scenarios[] = {
+      {"GPU bound", 3000000, 8000000, 0},
+      {"GPU bound, jitter", 3000000, 8000000, 1500000},
+      {"CPU bound", 8000000, 3000000, 1000000},
+  };
+  const PacingMode modes[] = {PacingMode::kQueued, PacingMode::kSerialized,
+                              PacingMode::kPaced, PacingMode::kPacedSwapChain};
+
+  std::cout << "Simulated GPU, " << options.frame_count << " frames, "
+            << kFramesInFlight << " frames in flight" << std::endl;
+  for (const Scenario &scenario : scenarios) {
+    std::cout << scenario.name << ": " << scenario.cpu_frame_ns / 1e6
+              << " ms CPU, " << scenario.gpu_frame_ns / 1e6 << " ms GPU, +-"
+              << scenario.jitter_ns / 1e6 << " ms" << std::endl;
+    std::cout << std::setw(12) << "mode" << std::setw(10) << "frames/s"
+              << std::setw(12) << "latency ms" << std::setw(8) << "p99"
+              << std::setw(10) << "GPU busy" << std::setw(9) << "delayed"
+              << std::setw(6) << "late" << std::endl;
+    for (PacingMode mode : modes) {
+      const PacingResult result =
+          SimulatePacing(scenario, mode, options.frame_count);
+      std::cout << std::setw(12) << GetModeName(mode) << std::setw(10)
+                << result.frames_per_second << std::setw(12)
+                << result.mean_latency_ms << std::setw(8)
+                << result.p99_latency_ms << std::setw(9)
+                << result.gpu_busy * 100.0 << "%" << std::setw(9)
+                << result.delayed_frames << std::setw(6)
+                << result.late_frames << std::endl;
+      // The waits of a GPU bound frame block, so the pacer has to engage
+      const bool paced = mode == PacingMode::kPaced ||
+                         mode == PacingMode::kPacedSwapChain;
+      if (paced && scenario.gpu_frame_ns > scenario.cpu_frame_ns &&
+          result.delayed_frames == 0) {
+        throw std::runtime_error(std::string(scenario.name) + ", " +
+                                 GetModeName(mode) +
+                                 ": the pacer delayed no frame");
+      }
+    }
+  }
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bench/benchmarks.h"
+
+namespace {
+struct Benchmark {
+  const char *name;
+  void (*run)(const BenchmarkOptions &options);
+};
+
+const Benchmark kBenchmarks[] = {
+    {"allocator", RunAllocatorBenchmark},
+    {"allocator_fuzz", RunAllocatorFuzz},
+    {"shader_cache", RunShaderCacheBenchmark},
+    {"descriptors", RunDescriptorBenchmark},
+    {"recording", RunRecordingBenchmark},
+    {"draw_queue", RunDrawQueueBenchmark},
+    {"mesh_load", RunMeshLoadBenchmark},
+    {"culling", RunCullingBenchmark},
+    {"profiler", RunProfilerBenchmark},
+    {"frame_loop", RunFrameLoopBenchmark},
+    {"async_upload", RunAsyncUploadBenchmark},
+    {"startup", RunStartupBenchmark},
+    {"capture", RunCaptureBenchmark},
+    {"render_graph", RunRenderGraphBenchmark},
+    {"frame_pacing", RunFramePacingBenchmark},
+    {"mesh_processing", RunMeshProcessingBenchmark},
+    {"streaming", RunStreamingBenchmark},
+    {"occlusion", RunOcclusionBenchmark},
+    {"update_thread", RunUpdateThreadBenchmark},
+};
+
+void PrintUsage() {
+  std::cout << "Usage: hello_d3d12_bench [--threads N] [--frames N] "
+               "[--draws N] [--objects N] [--json file] [benchmark...]"
+            << std::endl
+            << "Benchmarks:";
+  for (const auto &benchmark : kBenchmarks) {
+    std::cout << " " << benchmark.name;
+  }
+  std::cout << std::endl;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  BenchmarkOptions options;
+  std::vector<std::string> selected;
+  for (int i = 1; i < argc; i++) {
+    const std::string option = argv[i];
+    if (option == "--help") {
+      PrintUsage();
+      return 0;
+    }
+    if (option.compare(0, 2, "--") != 0) {
+      selected.push_back(option);
+      continue;
+    }
+    if (i + 1 >= argc) {
+      PrintUsage();
+      return 1;
+    }
+    const char *value = argv[++i];
+    if (option == "--threads") {
+      options.max_threads = std::stoul(value);
+    } else if (option == "--frames") {
+      options.frame_count = std::stoul(value);
+    } else if (option == "--draws") {
+      options.draw_count = std::stoul(value);
+    } else if (option == "--objects") {
+      options.object_count = std::stoul(value);
+    } else if (option == "--json") {
+      options.json_path = value;
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  try {
+    bool ran = false;
+    for (const auto &benchmark : kBenchmarks) {
+      bool enabled = selected.empty();
+      for (const auto &name : selected) {
+        enabled |= name == benchmark.name;
+      }
+      if (enabled) {
+        std::cout << "== " << benchmark.name << " ==" << std::endl;
+        benchmark.run(options);
+        ran = true;
+      }
+    }
+    if (!ran) {
+      PrintUsage();
+      return 1;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
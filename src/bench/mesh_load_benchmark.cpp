@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/builtin_meshes.h"
+#include "core/mesh_file.h"
+#include "core/string_utils.h"
+
+namespace {
+const uint32_t kQuadsPerSide = 1024;
+const uint32_t kIterations = 10;
+const char kQuantizedPath[] = "mesh_load_benchmark.mesh";
+const char kFloatPath[] = "mesh_load_benchmark.bin";
+
+// The previous representation: float positions and colors, 32 bit indices,
+// read with stream I/O into vectors
+struct FloatMeshHeader {
+  uint32_t vertex_count;
+  uint32_t index_count;
+};
+
+void WriteFloatMesh(const std::string &path, const Mesh &mesh) {
+  std::vector<SourceVertex> vertices;
+  vertices.reserve(mesh.vertices.size());
+  for (const auto &vertex : mesh.vertices) {
+    const glm::vec4 color = DequantizeColor(vertex.color);
+    vertices.push_back(
+        {DequantizePosition(vertex.position, mesh.quantization),
+         glm::vec3(color.x, color.y, color.z)});
+  }
+  const MeshView view = mesh.GetView();
+  std::vector<uint32_t> indices(view.index_count);
+  for (uint32_t i = 0; i < view.index_count; i++) {
+    uint32_t index = 0;
+    memcpy(&index, &mesh.index_data[i * mesh.index_size], mesh.index_size);
+    indices[i] = index;
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  const FloatMeshHeader header = {static_cast<uint32_t>(vertices.size()),
+                                  static_cast<uint32_t>(indices.size())};
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(vertices.data()),
+             vertices.size() * sizeof(SourceVertex));
+  file.write(reinterpret_cast<const char *>(indices.data()),
+             indices.size() * sizeof(uint32_t));
+  if (!file) {
+    throw std::runtime_error("Failed to write " + path);
+  }
+}
+
+uint64_t GetFileSize(const std::string &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  return static_cast<uint64_t>(file.tellg());
+}
+
+template <typename Function>
+double MeasureMilliseconds(Function function) {
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < kIterations; i++) {
+    function();
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         kIterations;
+}
+}  // namespace
+
+void RunMeshLoadBenchmark(const BenchmarkOptions &) {
+  const Mesh mesh = BuildQuadGridMesh(kQuadsPerSide);
+  WriteMeshFile(kQuantizedPath, mesh.GetView());
+  WriteFloatMesh(kFloatPath, mesh);
+
+  // Stands in for the upload ring, both paths end with the data in it
+  std::vector<uint8_t> upload_memory(GetFileSize(kFloatPath));
+
+  const double float_ms = MeasureMilliseconds([&] {
+    std::ifstream file(kFloatPath, std::ios::binary);
+    FloatMeshHeader header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    std::vector<SourceVertex> vertices(header.vertex_count);
+    std::vector<uint32_t> indices(header.index_count);
+    file.read(reinterpret_cast<char *>(vertices.data()),
+              vertices.size() * sizeof(SourceVertex));
+    file.read(reinterpret_cast<char *>(indices.data()),
+              indices.size() * sizeof(uint32_t));
+    const size_t vertex_size = vertices.size() * sizeof(SourceVertex);
+    memcpy(upload_memory.data(), vertices.data(), vertex_size);
+    memcpy(upload_memory.data() + vertex_size, indices.data(),
+           indices.size() * sizeof(uint32_t));
+  });
+
+  const double quantized_ms = MeasureMilliseconds([&] {
+    const MeshFile file(kQuantizedPath);
+    const MeshView &view = file.GetView();
+    const size_t vertex_size = size_t(view.vertex_count) * sizeof(Vertex);
+    memcpy(upload_memory.data(), view.vertices, vertex_size);
+    memcpy(upload_memory.data() + vertex_size, view.indices,
+           size_t(view.index_count) * view.index_size);
+  });
+
+  const MeshView view = mesh.GetView();
+  std::cout << "Mesh: " << view.vertex_count << " vertices, "
+            << view.index_count << " indices" << std::endl;
+  std::cout << "Float vertices, stream read: "
+            << DataSizeToStringNotation(GetFileSize(kFloatPath)) << ", "
+            << sizeof(SourceVertex) << " bytes/vertex, " << float_ms
+            << " ms/load" << std::endl;
+  std::cout << "Quantized vertices, mapped: "
+            << DataSizeToStringNotation(GetFileSize(kQuantizedPath)) << ", "
+            << sizeof(Vertex) << " bytes/vertex, " << view.index_size
+            << " bytes/index, " << quantized_ms << " ms/load" << std::endl;
+
+  std::remove(kQuantizedPath);
+  std::remove(kFloatPath);
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/builtin_meshes.h"
+#include "core/job_system.h"
+#include "core/mesh_processing.h"
+
+namespace {
+const uint32_t kMeshCount = 16;
+const uint32_t kQuadsPerSide = 128;
+
+// Exported meshes rarely come in an order that suits the vertex cache, the
+// grid is in perfect row order, so its triangles are shuffled
+Mesh BuildShuffledGrid(uint32_t seed) {
+  Mesh mesh = BuildQuadGridMesh(kQuadsPerSide);
+  const uint32_t triangle_size = 3 * mesh.index_size;
+  const uint32_t triangle_count =
+      static_cast<uint32_t>(mesh.index_data.size() / triangle_size);
+  std::mt19937 random(seed);
+  std::vector<uint8_t> triangle(triangle_size);
+  for (uint32_t i = triangle_count; i-- > 1;) {
+    const uint32_t j = std::uniform_int_distribution<uint32_t>(0, i)(random);
+    uint8_t *a = &mesh.index_data[i * triangle_size];
+    uint8_t *b = &mesh.index_data[j * triangle_size];
+    memcpy(triangle.data(), a, triangle_size);
+    memcpy(a, b, triangle_size);
+    memcpy(b, triangle.data(), triangle_size);
+  }
+  return mesh;
+}
+}  // namespace
+
+void RunMeshProcessingBenchmark(const BenchmarkOptions &options) {
+  uint32_t max_threads = options.max_threads;
+  if (max_threads == 0) {
+    max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  std::vector<Mesh> meshes;
+  std::vector<MeshView> views;
+  for (uint32_t i = 0; i < kMeshCount; i++) {
+    meshes.push_back(BuildShuffledGrid(i + 1));
+  }
+  uint64_t triangles = 0;
+  for (const Mesh &mesh : meshes) {
+    views.push_back(mesh.GetView());
+    triangles += views.back().index_count / 3;
+  }
+
+  // What processing makes of one mesh
+  MeshProcessingStats stats;
+  const Mesh processed = ProcessMesh(views[0], {}, &stats);
+  std::cout << kQuadsPerSide << "x" << kQuadsPerSide << " quad grid, "
+            << stats.triangles << " triangles in shuffled order: ACMR "
+            << stats.acmr_before << " -> " << stats.acmr_after << ", "
+            << stats.meshlets << " meshlets, " << stats.lods << " LODs"
+            << std::endl;
+  std::cout << std::setw(6) << "LOD" << std::setw(12) << "triangles"
+            << std::setw(10) << "meshlets" << std::setw(12) << "error"
+            << std::endl;
+  for (uint32_t lod = 0; lod < processed.lods.size(); lod++) {
+    const MeshLod &mesh_lod = processed.lods[lod];
+    std::cout << std::setw(6) << lod << std::setw(12)
+              << mesh_lod.index_count / 3 << std::setw(10)
+              << mesh_lod.meshlet_count << std::setw(12) << mesh_lod.error
+              << std::endl;
+  }
+
+  std::vector<uint32_t> thread_counts;
+  for (uint32_t threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+  std::cout << kMeshCount << " meshes, " << triangles << " triangles"
+            << std::endl;
+  std::cout << std::setw(10) << "threads" << std::setw(12) << "ms"
+            << std::setw(16) << "Mtriangles/s" << std::endl;
+  for (uint32_t threads : thread_counts) {
+    JobSystem job_system(threads);
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<Mesh> results = ProcessMeshes(&job_system, views);
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    std::cout << std::setw(10) << threads << std::setw(12) << seconds * 1e3
+              << std::setw(16) << triangles / seconds / 1e6 << std::endl;
+  }
+}
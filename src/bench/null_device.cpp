@@ -0,0 +1,146 @@
+#include "bench/null_device.h"
+
+#include <cstring>
+
+namespace {
+enum Opcode : uint32_t {
+  kOpcodeViewport = 1,
+  kOpcodeBarrier,
+  kOpcodeClear,
+  kOpcodeRenderTarget,
+  // Replayed commands use kOpcodeCommand + CommandType
+  kOpcodeCommand = 16,
+};
+}  // namespace
+
+void NullCommandList::Reset() {
+  packets_.clear();
+}
+
+void NullCommandList::SetViewport(float width, float height) {
+  const float viewport[] = {0.0f, 0.0f, width, height, 0.0f, 1.0f};
+  Emit(kOpcodeViewport, viewport, sizeof(viewport));
+}
+
+void NullCommandList::ResourceBarrier(uint64_t resource,
+                                      uint32_t before,
+                                      uint32_t after) {
+  const uint32_t barrier[] = {static_cast<uint32_t>(resource),
+                              static_cast<uint32_t>(resource >> 32), before,
+                              after};
+  Emit(kOpcodeBarrier, barrier, sizeof(barrier));
+}
+
+void NullCommandList::ClearRenderTarget(uint64_t render_target,
+                                        const float color[4]) {
+  Emit(kOpcodeRenderTarget, &render_target, sizeof(render_target));
+  Emit(kOpcodeClear, color, 4 * sizeof(float));
+}
+
+void NullCommandList::SetRenderTarget(uint64_t render_target) {
+  Emit(kOpcodeRenderTarget, &render_target, sizeof(render_target));
+}
+
+void NullCommandList::SetRootSignature(uint32_t root_signature) {
+  const SetRootSignatureCommand command = {root_signature};
+  Emit(kOpcodeCommand + static_cast<uint32_t>(CommandType::kSetRootSignature),
+       &command, sizeof(command));
+}
+
+void NullCommandList::SetRootDescriptorTable(uint32_t root_parameter,
+                                             uint64_t table) {
+  const SetGraphicsRootDescriptorTableCommand command = {table,
+                                                         root_parameter, 1};
+  Emit(kOpcodeCommand +
+           static_cast<uint32_t>(CommandType::kSetGraphicsRootDescriptorTable),
+       &command, sizeof(command));
+}
+
+void NullCommandList::ExecuteBundle(const NullCommandList &bundle) {
+  packets_.insert(packets_.end(), bundle.packets_.begin(),
+                  bundle.packets_.end());
+}
+
+void NullCommandList::Replay(const CommandStream &stream) {
+  CommandStreamReader reader(stream);
+  CommandType type;
+  while (reader.Next(&type)) {
+    const uint32_t opcode = kOpcodeCommand + static_cast<uint32_t>(type);
+    switch (type) {
+      case CommandType::kSetRootSignature: {
+        const auto command = reader.GetPayload<SetRootSignatureCommand>();
+        Emit(opcode, &command, sizeof(command));
+        break;
+      }
+      case CommandType::kSetPipelineState: {
+        const auto command = reader.GetPayload<SetPipelineStateCommand>();
+        Emit(opcode, &command, sizeof(command));
+        break;
+      }
+      case CommandType::kSetPrimitiveTopology: {
+        const auto command = reader.GetPayload<SetPrimitiveTopologyCommand>();
+        Emit(opcode, &command, sizeof(command));
+        break;
+      }
+      case CommandType::kSetVertexBuffers: {
+        const auto command = reader.GetPayload<SetVertexBuffersCommand>();
+        Emit(opcode, command.bindings,
+             command.count * sizeof(VertexBufferBinding));
+        break;
+      }
+      case CommandType::kSetIndexBuffer: {
+        const auto command = reader.GetPayload<SetIndexBufferCommand>();
+        Emit(opcode, &command, sizeof(command));
+        break;
+      }
+      case CommandType::kSetGraphicsRoot32BitConstants: {
+        const auto command =
+            reader.GetPayload<SetGraphicsRoot32BitConstantsCommand>();
+        Emit(opcode, command.values, command.count * sizeof(uint32_t));
+        break;
+      }
+      case CommandType::kDrawInstanced: {
+        const auto command = reader.GetPayload<DrawInstancedCommand>();
+        Emit(opcode, &command, sizeof(command));
+        break;
+      }
+      case CommandType::kDrawIndexedInstanced: {
+        const auto command = reader.GetPayload<DrawIndexedInstancedCommand>();
+        Emit(opcode, &command, sizeof(command));
+        break;
+      }
+      case CommandType::kSetGraphicsRootDescriptorTable: {
+        const auto command =
+            reader.GetPayload<SetGraphicsRootDescriptorTableCommand>();
+        Emit(opcode, &command, sizeof(command));
+        break;
+      }
+    }
+  }
+}
+
+void NullCommandList::Emit(uint32_t opcode, const void *payload, size_t size) {
+  const size_t words = (size + 3) / 4;
+  const size_t offset = packets_.size();
+  packets_.resize(offset + 1 + words);
+  packets_[offset] = opcode << 24 | static_cast<uint32_t>(words);
+  memcpy(&packets_[offset + 1], payload, size);
+}
+
+void NullDevice::ExecuteCommandLists(const NullCommandList *const *lists,
+                                     uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    const std::vector<uint32_t> &packets = lists[i]->GetPackets();
+    for (size_t offset = 0; offset < packets.size();
+         offset += 1 + (packets[offset] & 0xffffff)) {
+      checksum_ += packets[offset];
+      stats_.executed_packets++;
+    }
+  }
+  stats_.executed_lists += count;
+  timeline_.Submit(0);
+}
+
+void NullDevice::Present() {
+  stats_.presents++;
+}
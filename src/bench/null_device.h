@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "core/command_stream.h"
+#include "core/simulated_gpu_timeline.h"
+
+// Command list of a device that executes nothing. Calls are encoded into a
+// packet stream the way drivers translate API calls into hardware commands,
+// so recording costs about what it costs against a real driver.
+class NullCommandList {
+ public:
+  void Reset();
+
+  void SetViewport(float width, float height);
+  void ResourceBarrier(uint64_t resource, uint32_t before, uint32_t after);
+  void ClearRenderTarget(uint64_t render_target, const float color[4]);
+  void SetRenderTarget(uint64_t render_target);
+  void SetRootSignature(uint32_t root_signature);
+  void SetRootDescriptorTable(uint32_t root_parameter, uint64_t table);
+  // Bundles are inlined, as drivers without bundle support do
+  void ExecuteBundle(const NullCommandList &bundle);
+
+  // Record the commands of the stream, as ReplayCommandStream does for
+  // D3D12 command lists
+  void Replay(const CommandStream &stream);
+
+  const std::vector<uint32_t> &GetPackets() const {
+    return packets_;
+  }
+
+ private:
+  void Emit(uint32_t opcode, const void *payload, size_t size);
+
+  std::vector<uint32_t> packets_;
+};
+
+struct NullDeviceStats {
+  uint64_t executed_lists{0};
+  uint64_t executed_packets{0};
+  uint64_t presents{0};
+};
+
+// Queue and swap chain of the null device. Submitted lists are walked once,
+// as a driver patching them at submission would, and complete immediately on
+// the simulated timeline, so frame pacing never waits on anything.
+class NullDevice {
+ public:
+  void ExecuteCommandLists(const NullCommandList *const *lists,
+                           uint32_t count);
+  void Present();
+
+  GpuTimeline *GetTimeline() {
+    return &timeline_;
+  }
+  const NullDeviceStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  SimulatedGpuTimeline timeline_;
+  NullDeviceStats stats_;
+  // Keeps the walk over the packets from being optimized away
+  uint32_t checksum_{0};
+};
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/builtin_meshes.h"
+#include "core/job_system.h"
+#include "core/occlusion_culling.h"
+
+namespace {
+// Quarter resolution of a 1280x720 view
+const uint32_t kBufferWidth = 320;
+const uint32_t kBufferHeight = 180;
+// Large quad grids scattered over the view at depths spread over the
+// objects' ones, so some objects are behind them and others in front
+const uint32_t kOccluderCount = 64;
+const uint32_t kOccluderQuadsPerSide = 16;
+const SimdLevel kSimdLevels[] = {SimdLevel::kScalar, SimdLevel::kAvx2};
+
+struct FrameResult {
+  uint64_t rasterize_ns;
+  uint64_t test_ns;
+  OcclusionStats stats;
+};
+}  // namespace
+
+void RunOcclusionBenchmark(const BenchmarkOptions &options) {
+  uint32_t max_threads = options.max_threads;
+  if (max_threads == 0) {
+    max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  const Mesh occluder_mesh = BuildQuadGridMesh(kOccluderQuadsPerSide);
+  const OccluderMesh occluder = {
+      occluder_mesh.vertices.data(),
+      static_cast<uint32_t>(occluder_mesh.vertices.size()),
+      occluder_mesh.index_data.data(),
+      static_cast<uint32_t>(occluder_mesh.index_data.size() /
+                            occluder_mesh.index_size),
+      occluder_mesh.index_size,
+      occluder_mesh.quantization};
+  std::vector<InstanceData> occluders =
+      BuildScatteredInstances(kOccluderCount, 1.0f);
+  for (InstanceData &instance : occluders) {
+    // 0.01 to 0.05 becomes 0.2 to 1.0 of the view
+    instance.scale = instance.scale * 20.0f;
+  }
+
+  const PositionQuantization object_bounds =
+      BuildTriangleMesh().quantization;
+  std::vector<OcclusionQuery> queries;
+  for (const InstanceData &instance :
+       BuildScatteredInstances(options.object_count, 1.0f)) {
+    // Positions are random, so the order of creation is a random depth
+    queries.push_back({instance, object_bounds,
+                       static_cast<float>(queries.size() + 1)});
+  }
+
+  std::vector<uint32_t> thread_counts;
+  for (uint32_t threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  std::cout << kOccluderCount << " occluders of "
+            << occluder.index_count / 3 << " triangles, "
+            << options.object_count << " objects, " << kBufferWidth << "x"
+            << kBufferHeight << " buffer, best of " << options.frame_count
+            << " frames" << std::endl;
+  std::cout << std::setw(8) << "ISA" << std::setw(10) << "threads"
+            << std::setw(14) << "raster ms" << std::setw(12) << "Mtris/sec"
+            << std::setw(10) << "test ms" << std::setw(16) << "Mobjects/sec"
+            << std::setw(10) << "occluded" << std::endl;
+  std::vector<uint8_t> reference;
+  for (SimdLevel level : kSimdLevels) {
+    if (level > GetSupportedSimdLevel()) {
+      std::cout << std::setw(8) << GetSimdLevelName(level)
+                << "  not supported" << std::endl;
+      continue;
+    }
+    for (uint32_t threads : thread_counts) {
+      JobSystem job_system(threads);
+      OcclusionCuller culler(&job_system, kBufferWidth, kBufferHeight, level);
+      std::vector<uint8_t> visible;
+      FrameResult best = {~uint64_t(0), ~uint64_t(0), {}};
+      for (uint32_t frame = 0; frame < options.frame_count; frame++) {
+        // Binning is part of rasterizing
+        const auto start = std::chrono::steady_clock::now();
+        culler.BeginFrame();
+        for (uint32_t i = 0; i < kOccluderCount; i++) {
+          const float depth = (i + 0.5f) / kOccluderCount * queries.size();
+          culler.AddOccluder(occluder, occluders[i], depth);
+        }
+        culler.Rasterize();
+        const uint64_t rasterize_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+        culler.Test(queries.data(), static_cast<uint32_t>(queries.size()),
+                    &visible);
+        best.rasterize_ns = std::min(best.rasterize_ns, rasterize_ns);
+        best.test_ns = std::min(best.test_ns, culler.GetStats().test_time_ns);
+        best.stats = culler.GetStats();
+      }
+
+      if (reference.empty()) {
+        reference = visible;
+      } else if (visible != reference) {
+        throw std::runtime_error(std::string(GetSimdLevelName(level)) +
+                                 " occlusion differs from scalar occlusion");
+      }
+      const uint32_t triangles =
+          best.stats.triangles - best.stats.triangles_culled;
+      std::cout << std::setw(8) << GetSimdLevelName(level) << std::setw(10)
+                << threads << std::setw(14) << best.rasterize_ns / 1e6
+                << std::setw(12) << triangles / (best.rasterize_ns / 1e9) / 1e6
+                << std::setw(10) << best.test_ns / 1e6 << std::setw(16)
+                << queries.size() / (best.test_ns / 1e9) / 1e6
+                << std::setw(10) << best.stats.occluded << std::endl;
+    }
+  }
+}
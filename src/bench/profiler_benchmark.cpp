@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/job_system.h"
+#include "core/profiler.h"
+
+namespace {
+// Each thread records this many scopes per frame, below the ring capacity so
+// that nothing is dropped between collections
+const uint32_t kScopesPerThread = 4096;
+}  // namespace
+
+void RunProfilerBenchmark(const BenchmarkOptions &options) {
+#ifndef ENABLE_PROFILER
+  (void)options;
+  std::cout << "Built without ENABLE_PROFILER, PROFILE_SCOPE costs nothing"
+            << std::endl;
+#else
+  uint32_t max_threads = options.max_threads;
+  if (max_threads == 0) {
+    max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  std::cout << "Scopes: " << kScopesPerThread << " per thread per frame, "
+            << options.frame_count << " frames" << std::endl;
+  std::cout << std::setw(10) << "threads" << std::setw(12) << "ns/scope"
+            << std::setw(16) << "ms/collect" << std::setw(10) << "dropped"
+            << std::endl;
+  for (uint32_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    JobSystem job_system(threads);
+    Profiler &profiler = Profiler::Get();
+    profiler.Collect();
+    const uint64_t dropped_before = profiler.GetStats().dropped_events;
+
+    uint64_t record_ns = 0;
+    uint64_t collect_ns = 0;
+    for (uint32_t frame = 0; frame < options.frame_count; frame++) {
+      const uint64_t start = Profiler::Now();
+      job_system.ParallelFor(threads, [](uint32_t, uint32_t) {
+        for (uint32_t i = 0; i < kScopesPerThread; i++) {
+          PROFILE_SCOPE("Scope");
+        }
+      });
+      const uint64_t recorded = Profiler::Now();
+      profiler.Collect();
+      record_ns += recorded - start;
+      collect_ns += Profiler::Now() - recorded;
+    }
+
+    // Every thread records in parallel, so the time per scope on one thread
+    // is the frame time over the scopes of one thread
+    const double scopes_per_thread =
+        double(kScopesPerThread) * options.frame_count;
+    std::cout << std::setw(10) << threads << std::setw(12)
+              << record_ns / scopes_per_thread << std::setw(16)
+              << collect_ns / 1e6 / options.frame_count << std::setw(10)
+              << profiler.GetStats().dropped_events - dropped_before
+              << std::endl;
+    if (threads == max_threads) {
+      break;
+    }
+  }
+#endif
+}
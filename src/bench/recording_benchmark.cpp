@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/draw_partition.h"
+#include "core/job_system.h"
+
+namespace {
+// Stand-in for a driver command list, so recording can be measured without a
+// GPU. Every call is encoded into a packet stream the way drivers translate
+// API calls into hardware commands, with redundant state filtered out.
+class EncodedCommandList {
+ public:
+  void Reset() {
+    packets_.clear();
+    vertex_buffer_ = ~uint64_t(0);
+  }
+
+  void SetVertexBuffer(uint64_t address) {
+    if (address == vertex_buffer_) {
+      return;
+    }
+    vertex_buffer_ = address;
+    Emit(1, &address, sizeof(address));
+  }
+
+  void SetRootConstants(const float *constants, uint32_t count) {
+    Emit(2, constants, count * sizeof(float));
+  }
+
+  void DrawInstanced(uint32_t vertex_count,
+                     uint32_t instance_count,
+                     uint32_t start_vertex,
+                     uint32_t start_instance) {
+    const uint32_t arguments[] = {vertex_count, instance_count, start_vertex,
+                                  start_instance};
+    Emit(3, arguments, sizeof(arguments));
+  }
+
+  size_t GetSize() const {
+    return packets_.size() * sizeof(uint32_t);
+  }
+
+ private:
+  void Emit(uint32_t opcode, const void *payload, size_t size) {
+    const size_t words = (size + 3) / 4;
+    const size_t offset = packets_.size();
+    packets_.resize(offset + 1 + words);
+    packets_[offset] = opcode << 24 | static_cast<uint32_t>(words);
+    memcpy(&packets_[offset + 1], payload, size);
+  }
+
+  std::vector<uint32_t> packets_;
+  uint64_t vertex_buffer_{~uint64_t(0)};
+};
+
+struct DrawData {
+  float transform[16];
+  uint64_t vertex_buffer;
+  uint32_t vertex_count;
+};
+
+void RecordChunk(const std::vector<DrawData> &draws,
+                 const DrawChunk &chunk,
+                 EncodedCommandList *command_list) {
+  command_list->Reset();
+  for (uint32_t i = chunk.first_draw; i < chunk.first_draw + chunk.draw_count;
+       i++) {
+    const DrawData &draw = draws[i];
+    command_list->SetVertexBuffer(draw.vertex_buffer);
+    command_list->SetRootConstants(draw.transform, 16);
+    command_list->DrawInstanced(draw.vertex_count, 1, 0, 0);
+  }
+}
+}  // namespace
+
+void RunRecordingBenchmark(const BenchmarkOptions &options) {
+  uint32_t max_threads = options.max_threads;
+  if (max_threads == 0) {
+    max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  // A few hundred meshes shared by the draws, like instanced scene content
+  std::vector<DrawData> draws(options.draw_count);
+  for (uint32_t i = 0; i < options.draw_count; i++) {
+    DrawData &draw = draws[i];
+    for (uint32_t j = 0; j < 16; j++) {
+      draw.transform[j] = static_cast<float>(i + j);
+    }
+    draw.vertex_buffer = 0x10000 * (i / 64 % 300);
+    draw.vertex_count = 3 * (1 + i % 100);
+  }
+
+  std::vector<uint32_t> thread_counts;
+  for (uint32_t threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  std::cout << "Draws per frame: " << options.draw_count
+            << ", frames: " << options.frame_count << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(10) << "chunks"
+            << std::setw(14) << "ms/frame" << std::setw(16) << "Mdraws/sec"
+            << std::setw(10) << "speedup" << std::endl;
+  double single_thread_rate = 0.0;
+  for (uint32_t threads : thread_counts) {
+    JobSystem job_system(threads);
+    const std::vector<DrawChunk> chunks =
+        PartitionDraws(options.draw_count, threads, 256);
+    std::vector<EncodedCommandList> command_lists(chunks.size());
+
+    const auto record_frame = [&] {
+      job_system.ParallelFor(static_cast<uint32_t>(chunks.size()),
+                             [&](uint32_t chunk, uint32_t) {
+                               RecordChunk(draws, chunks[chunk],
+                                           &command_lists[chunk]);
+                             });
+    };
+    // Warm up the packet buffers and the worker threads
+    record_frame();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < options.frame_count; frame++) {
+      record_frame();
+    }
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+    const double rate =
+        double(options.draw_count) * options.frame_count / seconds;
+    if (threads == 1) {
+      single_thread_rate = rate;
+    }
+    std::cout << std::setw(8) << threads << std::setw(10) << chunks.size()
+              << std::setw(14) << std::fixed << std::setprecision(3)
+              << seconds * 1000.0 / options.frame_count << std::setw(16)
+              << rate / 1e6 << std::setw(10) << std::setprecision(2)
+              << rate / single_thread_rate << std::endl;
+  }
+}
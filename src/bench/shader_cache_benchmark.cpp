@@ -0,0 +1,131 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "bench/stub_shader_compiler.h"
+#include "core/shader_cache.h"
+
+namespace {
+const char kDirectory[] = "shader_cache_benchmark";
+// Vertex and pixel shader of every variant
+const uint32_t kVariants = 8;
+const auto kCompileTime = std::chrono::milliseconds(2);
+
+void WriteSource(const std::filesystem::path &path, const std::string &text) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << text;
+  if (!file) {
+    throw std::runtime_error("Failed to write " + path.string());
+  }
+}
+
+class ShaderCacheRun {
+ public:
+  ShaderCacheRun(StubShaderCompiler *compiler,
+                 const std::vector<ShaderCompileRequest> *requests)
+      : compiler_(compiler), requests_(requests) {
+    std::cout << std::setw(18) << "pass" << std::setw(10) << "hits"
+              << std::setw(10) << "misses" << std::setw(10) << "ms"
+              << std::endl;
+  }
+
+  // Look every request up and check that expected_misses of them compiled
+  std::vector<std::vector<uint8_t>> Run(ShaderCache *cache,
+                                        const char *pass,
+                                        uint32_t expected_misses) {
+    const ShaderCacheStats before = cache->GetStats();
+    const uint64_t compiles_before = compiler_->GetCompileCount();
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<uint8_t>> bytecode;
+    for (const ShaderCompileRequest &request : *requests_) {
+      bytecode.push_back(cache->GetShader(request));
+    }
+    const double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    const ShaderCacheStats after = cache->GetStats();
+    const uint64_t misses = after.misses - before.misses;
+    std::cout << std::setw(18) << pass << std::setw(10)
+              << after.hits - before.hits << std::setw(10) << misses
+              << std::setw(10) << ms << std::endl;
+    if (misses != expected_misses ||
+        compiler_->GetCompileCount() - compiles_before != expected_misses) {
+      throw std::runtime_error(std::string("Shader cache ") + pass + ": " +
+                               std::to_string(misses) + " misses, expected " +
+                               std::to_string(expected_misses));
+    }
+    return bytecode;
+  }
+
+ private:
+  StubShaderCompiler *compiler_;
+  const std::vector<ShaderCompileRequest> *requests_;
+};
+}  // namespace
+
+void RunShaderCacheBenchmark(const BenchmarkOptions &) {
+  const std::filesystem::path directory = kDirectory;
+  const std::filesystem::path source_directory = directory / "shaders";
+  const std::string cache_directory = (directory / "cache").string();
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(source_directory);
+  WriteSource(source_directory / "common.hlsli",
+              "float4 Tint(float4 color) { return color * VARIANT; }\n");
+  WriteSource(source_directory / "main.hlsl",
+              "#include \"common.hlsli\"\n"
+              "float4 VSMain(float4 position : POSITION) : SV_POSITION {\n"
+              "  return position;\n"
+              "}\n"
+              "float4 PSMain(float4 color : COLOR) : SV_TARGET {\n"
+              "  return Tint(color);\n"
+              "}\n");
+
+  std::vector<ShaderCompileRequest> requests;
+  for (uint32_t variant = 0; variant < kVariants; variant++) {
+    const std::vector<ShaderDefine> defines = {
+        {"VARIANT", std::to_string(variant)}};
+    const std::string path = (source_directory / "main.hlsl").string();
+    requests.push_back({path, "VSMain", "vs_5_0", defines, 0});
+    requests.push_back({path, "PSMain", "ps_5_0", defines, 0});
+  }
+  const uint32_t count = static_cast<uint32_t>(requests.size());
+  StubShaderCompiler compiler(kCompileTime, "stub_1");
+  std::cout << count << " shaders of " << kVariants << " variants, "
+            << kCompileTime.count() << " ms per compile" << std::endl;
+  ShaderCacheRun run(&compiler, &requests);
+
+  const std::vector<std::vector<uint8_t>> compiled = [&] {
+    ShaderCache cache(cache_directory, &compiler);
+    return run.Run(&cache, "cold", count);
+  }();
+  // A new cache over the same directory, as the next start of the
+  // application sees it
+  ShaderCache cache(cache_directory, &compiler);
+  if (run.Run(&cache, "warm", 0) != compiled) {
+    throw std::runtime_error("Shader cache returned other bytecode warm");
+  }
+  const ShaderCacheStats warm_stats = cache.GetStats();
+
+  // Every part of the key invalidates exactly the shaders it covers
+  requests[0].defines[0].value = "16";
+  run.Run(&cache, "changed define", 1);
+  WriteSource(source_directory / "common.hlsli",
+              "float4 Tint(float4 color) { return color * VARIANT * 2; }\n");
+  run.Run(&cache, "edited include", count);
+  requests[1].compile_flags = 1;
+  run.Run(&cache, "changed flags", 1);
+  compiler.SetVersion("stub_2");
+  run.Run(&cache, "new compiler", count);
+  run.Run(&cache, "warm again", 0);
+
+  std::cout << "Warm lookups saved "
+            << warm_stats.time_saved_ns / 1e6 << " ms of compiling"
+            << std::endl;
+  std::filesystem::remove_all(directory);
+}
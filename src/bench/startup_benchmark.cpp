@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/job_system.h"
+#include "core/task_graph.h"
+
+namespace {
+// The startup of Application with every task replaced by a sleep of a
+// typical duration. Tasks only sleep, so threads beyond the hardware threads
+// still run them concurrently.
+struct SimulatedTask {
+  const char *name;
+  uint32_t duration_ms;
+  std::vector<uint32_t> dependencies;
+};
+
+const uint32_t kCreateDevice = 0;
+const uint32_t kCreateQueues = 1;
+const uint32_t kCreateRootSignature = 2;
+const uint32_t kOpenPipelineCache = 3;
+const uint32_t kCompileVertexShader = 4;
+const uint32_t kCompilePixelShader = 5;
+const uint32_t kLoadMesh = 7;
+const uint32_t kUploadMesh = 8;
+const uint32_t kBuildInstances = 9;
+
+const SimulatedTask kStartupTasks[] = {
+    {"CreateDevice", 60, {}},
+    {"CreateQueues", 8, {kCreateDevice}},
+    {"CreateRootSignature", 2, {kCreateDevice}},
+    {"OpenPipelineCache", 5, {kCreateDevice}},
+    {"CompileVertexShader", 45, {}},
+    {"CompilePixelShader", 40, {}},
+    {"CreateSolidPipeline",
+     25,
+     {kCreateRootSignature, kOpenPipelineCache, kCompileVertexShader,
+      kCompilePixelShader}},
+    {"LoadMesh", 30, {}},
+    {"UploadMesh", 12, {kLoadMesh, kCreateQueues}},
+    {"BuildInstances", 20, {}},
+    {"BuildScene", 10, {kUploadMesh, kBuildInstances}},
+};
+
+// Jobs that throw on any worker must neither end the process nor leave Wait
+// spinning, Wait rethrows once the whole group finished
+void CheckFailingJobs(uint32_t threads) {
+  const uint32_t kJobs = 64;
+  JobSystem job_system(threads);
+  JobCounter counter;
+  std::atomic<uint32_t> completed{0};
+  for (uint32_t i = 0; i < kJobs; i++) {
+    job_system.Schedule(&counter, [i, &completed](uint32_t) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      if (i % 8 == 0) {
+        throw std::runtime_error("job failed");
+      }
+      completed.fetch_add(1);
+    });
+  }
+  bool thrown = false;
+  try {
+    job_system.Wait(&counter);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  if (!thrown || completed.load() != kJobs - kJobs / 8 ||
+      counter.pending.load() != 0) {
+    throw std::runtime_error(
+        "Failing jobs on " + std::to_string(threads) + " threads: " +
+        (thrown ? "" : "no exception from Wait, ") +
+        std::to_string(completed.load()) + " jobs completed");
+  }
+  // The exception is consumed, the counter can be waited on again
+  job_system.Schedule(&counter, [](uint32_t) {});
+  job_system.Wait(&counter);
+}
+}  // namespace
+
+void RunStartupBenchmark(const BenchmarkOptions &options) {
+  const uint32_t max_threads = options.max_threads == 0
+                                   ? 4
+                                   : options.max_threads;
+  uint32_t serial_ms = 0;
+  for (const SimulatedTask &task : kStartupTasks) {
+    serial_ms += task.duration_ms;
+  }
+  std::cout << "Simulated startup, " << std::size(kStartupTasks)
+            << " tasks, " << serial_ms << " ms when run one after another"
+            << std::endl;
+  std::cout << std::setw(10) << "threads" << std::setw(12) << "ms"
+            << std::setw(12) << "speedup" << std::setw(18)
+            << "critical path ms" << std::endl;
+
+  CheckFailingJobs(max_threads);
+
+  TaskGraph graph;
+  for (const SimulatedTask &task : kStartupTasks) {
+    const uint32_t duration_ms = task.duration_ms;
+    graph.AddTask(task.name, task.dependencies, [duration_ms] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    });
+  }
+  for (uint32_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    JobSystem job_system(threads);
+    graph.Run(&job_system);
+    const double ms = graph.GetDurationNs() / 1e6;
+    std::cout << std::setw(10) << threads << std::setw(12) << ms
+              << std::setw(12) << serial_ms / ms << std::setw(18)
+              << graph.GetCriticalPathNs() / 1e6 << std::endl;
+    if (threads == max_threads) {
+      std::cout << graph.GetTimelineReport();
+      break;
+    }
+  }
+}
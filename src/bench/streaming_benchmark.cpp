@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/mapped_file.h"
+#include "core/streaming_manager.h"
+#include "core/string_utils.h"
+
+namespace {
+const char kPath[] = "streaming_benchmark.bin";
+// Grid of 256x256 RGBA textures with full mip chains
+const uint32_t kResourcesPerSide = 24;
+const uint32_t kTextureSize = 256;
+const uint32_t kFrames = 600;
+// Frames are paced like a 500 Hz loop, the I/O thread races them
+const auto kFrameTime = std::chrono::microseconds(2000);
+// The viewer walks a circle over the grid, resources one spacing away want
+// the full detail level and every doubling of the distance one level less
+const float kPathRadius = 8.0f;
+const float kFullDetailDistance = 1.0f;
+
+uint64_t GetLevelSize(uint32_t level) {
+  const uint64_t size = std::max(kTextureSize >> level, 1u);
+  return size * size * 4;
+}
+
+uint32_t GetLevelCount() {
+  uint32_t count = 1;
+  while ((kTextureSize >> count) > 0) {
+    count++;
+  }
+  return count;
+}
+
+// All levels of all resources back to back, with the pattern bytes varying
+// so the file is not sparse
+uint64_t WriteResourceFile(const std::string &path) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  uint64_t total = 0;
+  std::vector<char> level_data;
+  for (uint32_t resource = 0; resource < kResourcesPerSide * kResourcesPerSide;
+       resource++) {
+    for (uint32_t level = 0; level < GetLevelCount(); level++) {
+      level_data.assign(GetLevelSize(level),
+                        static_cast<char>(resource + level));
+      file.write(level_data.data(), level_data.size());
+      total += level_data.size();
+    }
+  }
+  if (!file) {
+    throw std::runtime_error(std::string("Failed to write ") + path);
+  }
+  return total;
+}
+
+struct RunResult {
+  StreamingStats stats;
+  double update_ms;
+  // Requests whose level was resident when the frame drew
+  double satisfied;
+};
+
+RunResult RunFrames(const MappedFile &file, uint64_t budget) {
+  StreamingSettings settings;
+  settings.budget = budget;
+  StreamingManager manager(settings);
+  const uint32_t level_count = GetLevelCount();
+  uint64_t offset = 0;
+  for (uint32_t i = 0; i < kResourcesPerSide * kResourcesPerSide; i++) {
+    std::vector<StreamingLevel> levels;
+    for (uint32_t level = 0; level < level_count; level++) {
+      levels.push_back({file.GetData() + offset, GetLevelSize(level)});
+      offset += GetLevelSize(level);
+    }
+    manager.AddResource(levels);
+  }
+
+  uint64_t update_ns = 0;
+  uint64_t requests = 0;
+  uint64_t satisfied = 0;
+  const float center = 0.5f * (kResourcesPerSide - 1);
+  auto deadline = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < kFrames; frame++) {
+    const float angle = 6.2831853f * frame / kFrames;
+    const float viewer_x = center + kPathRadius * std::cos(angle);
+    const float viewer_y = center + kPathRadius * std::sin(angle);
+    for (uint32_t y = 0; y < kResourcesPerSide; y++) {
+      for (uint32_t x = 0; x < kResourcesPerSide; x++) {
+        const float distance =
+            std::hypot(x - viewer_x, y - viewer_y) / kFullDetailDistance;
+        const uint32_t level = std::min(
+            static_cast<uint32_t>(std::max(std::log2(distance), 0.0f)),
+            level_count - 1);
+        const uint32_t resource = y * kResourcesPerSide + x;
+        manager.Request(resource, level, 1.0f / (1.0f + distance));
+        requests++;
+        satisfied += manager.GetResidentLevel(resource) <= level;
+      }
+    }
+    const auto start = std::chrono::steady_clock::now();
+    manager.Update();
+    update_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    deadline += kFrameTime;
+    std::this_thread::sleep_until(deadline);
+  }
+  return {manager.GetStats(), update_ns / 1e6 / kFrames,
+          static_cast<double>(satisfied) / requests};
+}
+}  // namespace
+
+void RunStreamingBenchmark(const BenchmarkOptions &) {
+  const uint64_t total = WriteResourceFile(kPath);
+  {
+    const MappedFile file(kPath);
+    std::cout << kResourcesPerSide * kResourcesPerSide << " resources of "
+              << GetLevelCount() << " levels, "
+              << DataSizeToStringNotation(total) << ", " << kFrames
+              << " frames" << std::endl;
+    std::cout << std::setw(12) << "budget" << std::setw(12) << "peak"
+              << std::setw(10) << "loads" << std::setw(11) << "evictions"
+              << std::setw(10) << "deferred" << std::setw(12) << "I/O MB/s"
+              << std::setw(12) << "update ms" << std::setw(12) << "satisfied"
+              << std::endl;
+    for (uint32_t divisor : {16u, 8u, 4u, 1u}) {
+      const RunResult result = RunFrames(file, total / divisor);
+      const StreamingStats &stats = result.stats;
+      std::cout << std::setw(12) << DataSizeToStringNotation(total / divisor)
+                << std::setw(12) << DataSizeToStringNotation(stats.peak_bytes)
+                << std::setw(10) << stats.loads << std::setw(11)
+                << stats.evictions << std::setw(10) << stats.deferred_loads
+                << std::setw(12)
+                << stats.bytes_loaded / 1e6 /
+                       std::max(stats.io_time_ns / 1e9, 1e-9)
+                << std::setw(12) << result.update_ms << std::setw(11)
+                << result.satisfied * 100.0 << "%" << std::endl;
+    }
+  }
+  std::remove(kPath);
+}
@@ -0,0 +1,56 @@
+#include "bench/stub_shader_compiler.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+#include "core/hash.h"
+
+namespace {
+// DXBC container header followed by this many words of hash output
+const uint32_t kBytecodeWords = 256;
+}  // namespace
+
+StubShaderCompiler::StubShaderCompiler(std::chrono::microseconds compile_time,
+                                       const std::string &version)
+    : compile_time_(compile_time), version_(version) {
+}
+
+std::vector<uint8_t> StubShaderCompiler::Compile(
+    const ShaderCompileRequest &request) {
+  std::ifstream file(request.path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error(request.path + ": cannot open source file");
+  }
+  const std::string source((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+
+  Hasher hasher;
+  hasher.Update(source);
+  for (const auto &define : request.defines) {
+    hasher.Update(define.name);
+    hasher.Update(define.value);
+  }
+  hasher.Update(request.entry_point);
+  hasher.Update(request.target);
+  hasher.Update(static_cast<uint64_t>(request.compile_flags));
+  hasher.Update(version_);
+
+  std::vector<uint8_t> bytecode = {'D', 'X', 'B', 'C'};
+  uint64_t state = hasher.GetHash();
+  for (uint32_t i = 0; i < kBytecodeWords; i++) {
+    // splitmix64, spreads the hash over the whole blob
+    state += 0x9e3779b97f4a7c15ull;
+    uint64_t word = state;
+    word = (word ^ (word >> 30)) * 0xbf58476d1ce4e5b9ull;
+    word = (word ^ (word >> 27)) * 0x94d049bb133111ebull;
+    word ^= word >> 31;
+    for (uint32_t byte = 0; byte < 4; byte++) {
+      bytecode.push_back(static_cast<uint8_t>(word >> (8 * byte)));
+    }
+  }
+  std::this_thread::sleep_for(compile_time_);
+  compile_count_.fetch_add(1, std::memory_order_relaxed);
+  return bytecode;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/shader_compiler.h"
+
+// Compiler for platforms without an HLSL compiler. Reads the source and
+// derives bytecode from a hash of it and the request, so equal requests
+// compile to equal bytes, and takes a fixed time per compile like a real
+// compiler would. Thread safe.
+class StubShaderCompiler : public ShaderCompiler {
+ public:
+  StubShaderCompiler(std::chrono::microseconds compile_time,
+                     const std::string &version);
+
+  std::vector<uint8_t> Compile(const ShaderCompileRequest &request) override;
+  std::string GetVersion() const override {
+    return version_;
+  }
+
+  // Stands in for updating the compiler, not while compiles run
+  void SetVersion(const std::string &version) {
+    version_ = version;
+  }
+  uint64_t GetCompileCount() const {
+    return compile_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::chrono::microseconds compile_time_;
+  std::string version_;
+  std::atomic<uint64_t> compile_count_{0};
+};
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/benchmarks.h"
+#include "core/frame_pacer.h"
+#include "core/frame_time_stats.h"
+#include "core/update_thread.h"
+
+namespace {
+// Costs are waited out rather than computed, like fence and present waits,
+// so the overlap shows on any number of cores
+struct Scenario {
+  const char *name;
+  std::chrono::microseconds update_time;
+  std::chrono::microseconds render_time;
+};
+
+const Scenario kScenarios[] = {
+    {"render bound", std::chrono::microseconds(2000),
+     std::chrono::microseconds(4000)},
+    {"update bound", std::chrono::microseconds(4000),
+     std::chrono::microseconds(2000)},
+};
+// Visible objects every snapshot carries, all set to the update number so
+// frames can tell a torn snapshot
+const uint32_t kSnapshotObjects = 10000;
+
+struct RunResult {
+  double frames_per_second;
+  double updates_per_second;
+  double p50_latency_ms;
+  double p99_latency_ms;
+};
+
+void FillSnapshot(const Scenario &scenario,
+                  uint64_t update,
+                  SceneSnapshot *snapshot) {
+  WaitUntil(snapshot->update_start + scenario.update_time);
+  snapshot->visible_objects.assign(kSnapshotObjects,
+                                   static_cast<uint32_t>(update));
+}
+
+// Render the snapshot and return when the frame is done
+std::chrono::steady_clock::time_point RenderSnapshot(
+    const Scenario &scenario,
+    const SceneSnapshot &snapshot) {
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t object : snapshot.visible_objects) {
+    if (object != snapshot.update) {
+      throw std::runtime_error("Frame drew a torn snapshot");
+    }
+  }
+  WaitUntil(start + scenario.render_time);
+  return std::chrono::steady_clock::now();
+}
+
+// Update and render one after another on one thread
+RunResult RunLockstep(const Scenario &scenario, uint32_t frame_count) {
+  FrameTimeStats latencies(frame_count);
+  SceneSnapshot snapshot;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < frame_count; frame++) {
+    snapshot.update = frame;
+    snapshot.update_start = std::chrono::steady_clock::now();
+    FillSnapshot(scenario, frame, &snapshot);
+    const auto frame_end = RenderSnapshot(scenario, snapshot);
+    latencies.AddFrame(std::chrono::duration<double, std::milli>(
+                           frame_end - snapshot.update_start)
+                           .count());
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  return {frame_count / seconds, frame_count / seconds,
+          latencies.GetPercentile(50.0), latencies.GetPercentile(99.0)};
+}
+
+// Update back to back on the update thread while the render thread draws
+// the newest snapshot every frame
+RunResult RunDecoupled(const Scenario &scenario, uint32_t frame_count) {
+  FrameTimeStats latencies(frame_count);
+  const auto start = std::chrono::steady_clock::now();
+  UpdateThreadStats update_stats;
+  {
+    UpdateThread update_thread(
+        [&scenario](uint64_t update, SceneSnapshot *snapshot) {
+          FillSnapshot(scenario, update, snapshot);
+        },
+        0.0, 0);
+    while (!update_thread.AcquireSnapshot()) {
+      std::this_thread::yield();
+    }
+    for (uint32_t frame = 0; frame < frame_count; frame++) {
+      update_thread.AcquireSnapshot();
+      const SceneSnapshot &snapshot = update_thread.GetSnapshot();
+      const auto frame_end = RenderSnapshot(scenario, snapshot);
+      latencies.AddFrame(std::chrono::duration<double, std::milli>(
+                             frame_end - snapshot.update_start)
+                             .count());
+    }
+    update_stats = update_thread.GetStats();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  return {frame_count / seconds, update_stats.updates / seconds,
+          latencies.GetPercentile(50.0), latencies.GetPercentile(99.0)};
+}
+}  // namespace
+
+void RunUpdateThreadBenchmark(const BenchmarkOptions &options) {
+  std::cout << options.frame_count << " frames, latency from the start of "
+            << "the update a frame draws to the frame being done"
+            << std::endl;
+  std::cout << std::setw(14) << "scenario" << std::setw(12) << "update ms"
+            << std::setw(12) << "render ms" << std::setw(11) << "threads"
+            << std::setw(12) << "frames/s" << std::setw(12) << "updates/s"
+            << std::setw(14) << "p50 latency" << std::setw(14)
+            << "p99 latency" << std::endl;
+  for (const Scenario &scenario : kScenarios) {
+    for (bool decoupled : {false, true}) {
+      const RunResult result =
+          decoupled ? RunDecoupled(scenario, options.frame_count)
+                    : RunLockstep(scenario, options.frame_count);
+      std::cout << std::setw(14) << scenario.name << std::setw(12)
+                << scenario.update_time.count() / 1e3 << std::setw(12)
+                << scenario.render_time.count() / 1e3 << std::setw(11)
+                << (decoupled ? "separate" : "one") << std::setw(12)
+                << result.frames_per_second << std::setw(12)
+                << result.updates_per_second << std::setw(14)
+                << result.p50_latency_ms << std::setw(14)
+                << result.p99_latency_ms << std::endl;
+    }
+  }
+}
@@ -0,0 +1,43 @@
+#include "bundle_cache.h"
+
+#include <chrono>
+#include <stdexcept>
+
+BundleCache::BundleCache(ID3D12Device *device, uint64_t max_unused_frames)
+    : device_(device), max_unused_frames_(max_unused_frames) {
+}
+
+ID3D12GraphicsCommandList *BundleCache::GetBundle(
+    const CommandStream &stream,
+    uint64_t frame,
+    const RecordFunction &record) {
+  if (const Bundle *bundle = cache_.Find(stream, frame)) {
+    return bundle->command_list.Get();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  Bundle bundle;
+  if (FAILED(device_->CreateCommandAllocator(
+          D3D12_COMMAND_LIST_TYPE_BUNDLE, IID_PPV_ARGS(&bundle.allocator)))) {
+    throw std::runtime_error("Failed to create bundle allocator");
+  }
+  if (FAILED(device_->CreateCommandList(
+          0, D3D12_COMMAND_LIST_TYPE_BUNDLE, bundle.allocator.Get(), nullptr,
+          IID_PPV_ARGS(&bundle.command_list)))) {
+    throw std::runtime_error("Failed to create bundle");
+  }
+  record(bundle.command_list.Get());
+  if (FAILED(bundle.command_list->Close())) {
+    throw std::runtime_error("Failed to close bundle");
+  }
+  const uint64_t record_time_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count();
+  return cache_.Insert(stream, std::move(bundle), record_time_ns, frame)
+      .command_list.Get();
+}
+
+void BundleCache::Collect(uint64_t frame) {
+  cache_.Collect(frame, max_unused_frames_);
+}
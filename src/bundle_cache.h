@@ -0,0 +1,47 @@
+#pragma once
+#include <functional>
+
+#include "core/command_stream.h"
+#include "core/replay_cache.h"
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Bundles recorded from command streams, reused by every later frame that
+// encodes the same stream. Each bundle owns its allocator, so it stays valid
+// until it is collected.
+class BundleCache {
+ public:
+  using RecordFunction = std::function<void(ID3D12GraphicsCommandList *)>;
+
+  // Bundles unused for max_unused_frames are released, which must be more
+  // than the number of frames in flight
+  BundleCache(ID3D12Device *device, uint64_t max_unused_frames);
+
+  // Bundle holding the commands of the stream, recorded by record on a miss.
+  // Thread safe.
+  ID3D12GraphicsCommandList *GetBundle(const CommandStream &stream,
+                                       uint64_t frame,
+                                       const RecordFunction &record);
+
+  // Release bundles the current frame no longer uses
+  void Collect(uint64_t frame);
+
+  ReplayCacheStats GetStats() const {
+    return cache_.GetStats();
+  }
+  size_t GetSize() const {
+    return cache_.GetSize();
+  }
+
+ private:
+  struct Bundle {
+    ComPtr<ID3D12CommandAllocator> allocator;
+    ComPtr<ID3D12GraphicsCommandList> command_list;
+  };
+
+  ComPtr<ID3D12Device> device_;
+  uint64_t max_unused_frames_;
+  ReplayCache<Bundle> cache_;
+};
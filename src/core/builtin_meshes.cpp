@@ -0,0 +1,70 @@
+#include "core/builtin_meshes.h"
+
+#include <random>
+
+Mesh BuildTriangleMesh() {
+  return BuildMesh({{{0.0f, 0.25f * 2, 0.0f}, {1.0f, 0.0f, 0.0f}},
+                    {{0.25f * 2, -0.25f * 2, 0.0f}, {0.0f, 1.0f, 0.0f}},
+                    {{-0.25f * 2, -0.25f * 2, 0.0f}, {0.0f, 0.0f, 1.0f}}},
+                   {0, 1, 2});
+}
+
+Mesh BuildQuadGridMesh(uint32_t quads_per_side) {
+  std::vector<SourceVertex> vertices;
+  std::vector<uint32_t> indices;
+  const uint32_t side = quads_per_side + 1;
+  const float step = 1.0f / static_cast<float>(quads_per_side);
+  vertices.reserve(side * side);
+  for (uint32_t y = 0; y < side; y++) {
+    for (uint32_t x = 0; x < side; x++) {
+      const float u = static_cast<float>(x) * step;
+      const float v = static_cast<float>(y) * step;
+      vertices.push_back({{u - 0.5f, v - 0.5f, 0.0f}, {u, v, 1.0f - u}});
+    }
+  }
+  indices.reserve(quads_per_side * quads_per_side * 6);
+  for (uint32_t y = 0; y < quads_per_side; y++) {
+    for (uint32_t x = 0; x < quads_per_side; x++) {
+      // Clockwise, the front face winding of the sample
+      const uint32_t bottom_left = y * side + x;
+      const uint32_t top_left = bottom_left + side;
+      indices.insert(indices.end(),
+                     {bottom_left, top_left, top_left + 1, bottom_left,
+                      top_left + 1, bottom_left + 1});
+    }
+  }
+  return BuildMesh(vertices, indices);
+}
+
+std::vector<InstanceData> BuildTriangleGridInstances(uint32_t grid_size) {
+  std::vector<InstanceData> instances;
+  instances.reserve(grid_size * grid_size);
+  const float cell = 2.0f / static_cast<float>(grid_size);
+  for (uint32_t y = 0; y < grid_size; y++) {
+    for (uint32_t x = 0; x < grid_size; x++) {
+      // The sample triangle spans [-0.5, 0.5] on both axes, center it in the
+      // cell and scale it to the cell size
+      const float left = -1.0f + cell * static_cast<float>(x);
+      const float bottom = -1.0f + cell * static_cast<float>(y);
+      instances.push_back(
+          {{left + cell * 0.5f, bottom + cell * 0.5f}, {cell, cell}});
+    }
+  }
+  return instances;
+}
+
+std::vector<InstanceData> BuildScatteredInstances(uint32_t count,
+                                                  float extent) {
+  std::mt19937 random(count);
+  std::uniform_real_distribution<float> position(-extent, extent);
+  std::uniform_real_distribution<float> size(0.01f, 0.05f);
+  std::vector<InstanceData> instances;
+  instances.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    const float x = position(random);
+    const float y = position(random);
+    const float scale = size(random);
+    instances.push_back({{x, y}, {scale, scale}});
+  }
+  return instances;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "core/mesh.h"
+#include "core/vertex.h"
+
+// The triangle rendered by the sample
+Mesh BuildTriangleMesh();
+
+// Square of quads_per_side^2 colored quads spanning [-0.5, 0.5] on x and y,
+// a large mesh for measuring ingestion
+Mesh BuildQuadGridMesh(uint32_t quads_per_side);
+
+// Instances of the sample triangle tiling clip space in a grid, used to stress
+// draw submission and rasterization
+std::vector<InstanceData> BuildTriangleGridInstances(uint32_t grid_size);
+
+// Instances scattered at random over [-extent, extent] on x and y, 0.01 to
+// 0.05 units in size. Seeded with the count, so runs are repeatable.
+std::vector<InstanceData> BuildScatteredInstances(uint32_t count,
+                                                  float extent);
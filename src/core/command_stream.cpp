@@ -0,0 +1,28 @@
+#include "core/command_stream.h"
+
+#include <stdexcept>
+
+void CommandStream::Append(const void *data, size_t size) {
+  const size_t offset = data_.size();
+  data_.resize(offset + size);
+  memcpy(&data_[offset], data, size);
+  hasher_.Update(data, size);
+}
+
+bool CommandStreamReader::Next(CommandType *type) {
+  if (next_offset_ >= data_.size()) {
+    return false;
+  }
+  CommandHeader header;
+  if (next_offset_ + sizeof(header) > data_.size()) {
+    throw std::runtime_error("Command stream ends inside a header");
+  }
+  memcpy(&header, &data_[next_offset_], sizeof(header));
+  payload_offset_ = next_offset_ + sizeof(header);
+  next_offset_ = payload_offset_ + header.size;
+  if (next_offset_ > data_.size()) {
+    throw std::runtime_error("Command stream ends inside a payload");
+  }
+  *type = header.type;
+  return true;
+}
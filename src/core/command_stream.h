@@ -0,0 +1,155 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "core/hash.h"
+
+enum class CommandType : uint16_t {
+  kSetRootSignature,
+  kSetPipelineState,
+  kSetPrimitiveTopology,
+  kSetVertexBuffers,
+  kSetIndexBuffer,
+  kSetGraphicsRoot32BitConstants,
+  kDrawInstanced,
+  kDrawIndexedInstanced,
+  kSetGraphicsRootDescriptorTable,
+};
+
+struct CommandHeader {
+  CommandType type;
+  // Payload size in bytes, the payload follows the header
+  uint16_t size;
+};
+
+// Commands are plain structs without padding, so equal commands hash equally.
+// Root signatures and pipelines are ids into tables of the replaying code.
+struct SetRootSignatureCommand {
+  uint32_t root_signature;
+};
+
+struct SetPipelineStateCommand {
+  uint32_t pipeline;
+};
+
+struct SetPrimitiveTopologyCommand {
+  uint32_t topology;
+};
+
+struct VertexBufferBinding {
+  uint64_t address;
+  uint32_t size;
+  uint32_t stride;
+};
+
+struct SetVertexBuffersCommand {
+  static const uint32_t kMaxBindings = 2;
+
+  uint32_t start_slot;
+  uint32_t count;
+  VertexBufferBinding bindings[kMaxBindings];
+};
+
+struct SetIndexBufferCommand {
+  uint64_t address;
+  uint32_t size;
+  uint32_t format;
+};
+
+struct SetGraphicsRoot32BitConstantsCommand {
+  static const uint32_t kMaxValues = 8;
+
+  uint32_t root_parameter;
+  uint32_t count;
+  uint32_t values[kMaxValues];
+};
+
+// The table is a GPU descriptor handle into the heap set by the command list
+struct SetGraphicsRootDescriptorTableCommand {
+  uint64_t base_descriptor;
+  uint32_t root_parameter;
+  uint32_t descriptor_count;
+};
+
+struct DrawInstancedCommand {
+  uint32_t vertex_count;
+  uint32_t instance_count;
+  uint32_t start_vertex;
+  uint32_t start_instance;
+};
+
+struct DrawIndexedInstancedCommand {
+  uint32_t index_count;
+  uint32_t instance_count;
+  uint32_t start_index;
+  int32_t base_vertex;
+  uint32_t start_instance;
+};
+
+// Compact CPU side encoding of a command sequence, hashed while it is
+// written. The stream is a linear arena, Reset keeps its capacity so streams
+// reused every frame stop allocating once they reached their peak size.
+class CommandStream {
+ public:
+  void Reset() {
+    data_.clear();
+    hasher_ = Hasher();
+    command_count_ = 0;
+  }
+
+  template <typename T>
+  void Encode(CommandType type, const T &command) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Commands must be plain structs");
+    const CommandHeader header = {type, static_cast<uint16_t>(sizeof(T))};
+    Append(&header, sizeof(header));
+    Append(&command, sizeof(T));
+    command_count_++;
+  }
+
+  uint64_t GetHash() const {
+    return hasher_.GetHash();
+  }
+  const std::vector<uint8_t> &GetData() const {
+    return data_;
+  }
+  uint32_t GetCommandCount() const {
+    return command_count_;
+  }
+  bool IsEmpty() const {
+    return data_.empty();
+  }
+
+ private:
+  void Append(const void *data, size_t size);
+
+  std::vector<uint8_t> data_;
+  Hasher hasher_;
+  uint32_t command_count_{0};
+};
+
+// Walks the commands of a stream in order
+class CommandStreamReader {
+ public:
+  explicit CommandStreamReader(const CommandStream &stream)
+      : data_(stream.GetData()) {
+  }
+
+  // Advance to the next command, returns false at the end of the stream
+  bool Next(CommandType *type);
+
+  // Payload of the current command, copied out since it may be unaligned
+  template <typename T>
+  T GetPayload() const {
+    T payload;
+    memcpy(&payload, &data_[payload_offset_], sizeof(T));
+    return payload;
+  }
+
+ private:
+  const std::vector<uint8_t> &data_;
+  size_t payload_offset_{0};
+  size_t next_offset_{0};
+};
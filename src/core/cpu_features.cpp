@@ -0,0 +1,65 @@
+#include "core/cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+#define CPU_FEATURES_X64
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+#ifdef CPU_FEATURES_X64
+bool IsAvxSupported() {
+#ifdef _MSC_VER
+  // The CPU has to support AVX and the OS has to save the YMM registers
+  int registers[4];
+  __cpuid(registers, 1);
+  const bool avx = (registers[2] & (1 << 28)) != 0;
+  const bool osxsave = (registers[2] & (1 << 27)) != 0;
+  return avx && osxsave && (_xgetbv(0) & 0x6) == 0x6;
+#else
+  // Checks the OS support as well
+  return __builtin_cpu_supports("avx");
+#endif
+}
+
+bool IsAvx2Supported() {
+#ifdef _MSC_VER
+  // Leaf 7 reports AVX2, the register state is the one AVX checks
+  int registers[4];
+  __cpuidex(registers, 7, 0);
+  return IsAvxSupported() && (registers[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+}  // namespace
+
+SimdLevel GetSupportedSimdLevel() {
+#ifdef CPU_FEATURES_X64
+  // SSE2 is part of x64
+  static const SimdLevel level =
+      IsAvx2Supported()  ? SimdLevel::kAvx2
+      : IsAvxSupported() ? SimdLevel::kAvx
+                         : SimdLevel::kSse2;
+  return level;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+const char *GetSimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::kScalar:
+      return "scalar";
+    case SimdLevel::kSse2:
+      return "SSE2";
+    case SimdLevel::kAvx:
+      return "AVX";
+    case SimdLevel::kAvx2:
+      return "AVX2";
+  }
+  return "unknown";
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Instruction set levels of the batch kernels, each implies the ones before
+enum class SimdLevel {
+  kScalar,
+  kSse2,
+  kAvx,
+  kAvx2,
+};
+
+// Highest level compiled in and supported by the CPU and the OS
+SimdLevel GetSupportedSimdLevel();
+
+const char *GetSimdLevelName(SimdLevel level);
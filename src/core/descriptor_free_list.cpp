@@ -0,0 +1,37 @@
+#include "core/descriptor_free_list.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+DescriptorFreeList::DescriptorFreeList(uint32_t capacity)
+    : allocated_(capacity, false) {
+  // Lowest indices on top, so a fresh heap fills from the start
+  free_indices_.reserve(capacity);
+  for (uint32_t i = capacity; i > 0; i--) {
+    free_indices_.push_back(i - 1);
+  }
+  stats_.capacity = capacity;
+}
+
+uint32_t DescriptorFreeList::Allocate() {
+  if (free_indices_.empty()) {
+    stats_.failed_allocations++;
+    return kInvalidIndex;
+  }
+  const uint32_t index = free_indices_.back();
+  free_indices_.pop_back();
+  allocated_[index] = true;
+  stats_.used++;
+  stats_.peak_used = std::max(stats_.peak_used, stats_.used);
+  stats_.allocations++;
+  return index;
+}
+
+void DescriptorFreeList::Free(uint32_t index) {
+  if (index >= allocated_.size() || !allocated_[index]) {
+    throw std::runtime_error("Freeing a descriptor that is not allocated");
+  }
+  allocated_[index] = false;
+  free_indices_.push_back(index);
+  stats_.used--;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct DescriptorAllocatorStats {
+  uint32_t capacity{0};
+  uint32_t used{0};
+  uint32_t peak_used{0};
+  uint64_t allocations{0};
+  // Allocations that found the heap full
+  uint64_t failed_allocations{0};
+};
+
+// Hands out single slots of a fixed size descriptor heap in O(1). Freed slots
+// go onto a stack and are reused first, which keeps the live slots dense.
+class DescriptorFreeList {
+ public:
+  static const uint32_t kInvalidIndex = ~uint32_t(0);
+
+  explicit DescriptorFreeList(uint32_t capacity);
+
+  // Returns kInvalidIndex when every slot is in use
+  uint32_t Allocate();
+  void Free(uint32_t index);
+
+  const DescriptorAllocatorStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  std::vector<uint32_t> free_indices_;
+  std::vector<bool> allocated_;
+  DescriptorAllocatorStats stats_;
+};
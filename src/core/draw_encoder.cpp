@@ -0,0 +1,76 @@
+#include "core/draw_encoder.h"
+
+#include <cstring>
+
+void EncodeDraws(const DrawQueue &draw_queue,
+                 const DrawBindings &bindings,
+                 const DrawChunk &chunk,
+                 CommandStream *stream) {
+  stream->Reset();
+  if (chunk.draw_count == 0) {
+    return;
+  }
+
+  stream->Encode(CommandType::kSetPrimitiveTopology,
+                 SetPrimitiveTopologyCommand{bindings.primitive_topology});
+  const std::vector<DrawBatch> &batches = draw_queue.GetBatches();
+  for (uint32_t i = chunk.first_draw; i < chunk.first_draw + chunk.draw_count;
+       i++) {
+    const DrawBatch &batch = batches[i];
+    const MeshRange &mesh = draw_queue.GetMesh(batch.mesh);
+    const bool first_batch = i == chunk.first_draw;
+    const bool mesh_changed = first_batch || batch.mesh != batches[i - 1].mesh;
+    if (first_batch || batch.root_signature_changed) {
+      // Setting the root signature the executing list set keeps the table
+      // it bound, a different one clears it
+      stream->Encode(CommandType::kSetRootSignature,
+                     SetRootSignatureCommand{batch.root_signature});
+      if (!first_batch) {
+        stream->Encode(CommandType::kSetGraphicsRootDescriptorTable,
+                       SetGraphicsRootDescriptorTableCommand{
+                           bindings.object_table,
+                           bindings.object_table_parameter, 1});
+      }
+    }
+    if (first_batch || batch.pipeline_changed) {
+      stream->Encode(CommandType::kSetPipelineState,
+                     SetPipelineStateCommand{batch.pipeline});
+    }
+    if (first_batch || batch.vertex_buffer_changed) {
+      const MeshBufferBindings &buffers =
+          bindings.mesh_buffers[mesh.vertex_buffer];
+      SetVertexBuffersCommand command = {};
+      command.count = 1;
+      command.bindings[0] = buffers.vertex_buffer;
+      stream->Encode(CommandType::kSetVertexBuffers, command);
+      stream->Encode(CommandType::kSetIndexBuffer, buffers.index_buffer);
+    }
+    if (mesh_changed || batch.root_signature_changed) {
+      // Root constants are lost with the root signature, set them again
+      const PositionQuantization &quantization =
+          bindings.mesh_quantizations[batch.mesh];
+      const float constants[kMeshConstantCount] = {
+          quantization.scale.x, quantization.scale.y, quantization.scale.z,
+          0.0f,                 quantization.bias.x,  quantization.bias.y,
+          quantization.bias.z,  0.0f};
+      SetGraphicsRoot32BitConstantsCommand command = {};
+      command.root_parameter = bindings.mesh_constants_parameter;
+      command.count = kMeshConstantCount;
+      memcpy(command.values, constants, sizeof(constants));
+      stream->Encode(CommandType::kSetGraphicsRoot32BitConstants, command);
+    }
+    // Objects are fetched from the buffer instead of an instance stream, so
+    // the start instance stays 0 and batches only differ in one constant
+    SetGraphicsRoot32BitConstantsCommand draw_constants = {};
+    draw_constants.root_parameter = bindings.draw_constants_parameter;
+    draw_constants.count = kDrawConstantCount;
+    draw_constants.values[0] = batch.first_instance;
+    stream->Encode(CommandType::kSetGraphicsRoot32BitConstants,
+                   draw_constants);
+    stream->Encode(CommandType::kDrawIndexedInstanced,
+                   DrawIndexedInstancedCommand{mesh.index_count,
+                                               batch.instance_count,
+                                               mesh.start_index,
+                                               mesh.base_vertex, 0});
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+
+#include "core/command_stream.h"
+#include "core/draw_partition.h"
+#include "core/draw_queue.h"
+#include "core/mesh.h"
+
+// Vertex and index buffer of a pair, indexed by MeshRange::vertex_buffer
+struct MeshBufferBindings {
+  VertexBufferBinding vertex_buffer;
+  SetIndexBufferCommand index_buffer;
+};
+
+// What the draws of a frame bind besides the batches of the draw queue.
+// Topology and index formats are values of the graphics API.
+struct DrawBindings {
+  uint32_t primitive_topology;
+  // Receives the PositionQuantization of the mesh as kMeshConstantCount
+  // values, scale and bias padded to float4
+  uint32_t mesh_constants_parameter;
+  const MeshBufferBindings *mesh_buffers;
+  // Indexed by draw queue mesh ids
+  const PositionQuantization *mesh_quantizations;
+  // Receives the first ObjectData of the batch as kDrawConstantCount values.
+  // SV_InstanceID does not include the start instance of the draw.
+  uint32_t draw_constants_parameter;
+  // Table with the SRV of the ObjectData buffer the batches index into. The
+  // list executing the stream binds it with the root signature of the first
+  // batch, so the stream and bundles recorded from it stay the same while
+  // the table moves every frame. Only a root signature change within the
+  // chunk encodes it.
+  uint32_t object_table_parameter;
+  uint64_t object_table;
+};
+
+const uint32_t kMeshConstantCount = 8;
+const uint32_t kDrawConstantCount = 1;
+
+// Encode the batches of the chunk as a stream that starts without state, as
+// bundles do. The first batch binds everything, later ones only what differs
+// from the batch before.
+void EncodeDraws(const DrawQueue &draw_queue,
+                 const DrawBindings &bindings,
+                 const DrawChunk &chunk,
+                 CommandStream *stream);
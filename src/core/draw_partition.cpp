@@ -0,0 +1,18 @@
+#include "core/draw_partition.h"
+
+#include <algorithm>
+
+std::vector<DrawChunk> PartitionDraws(uint32_t draw_count,
+                                      uint32_t max_chunks,
+                                      uint32_t min_draws_per_chunk) {
+  const uint32_t chunk_count = std::max(
+      1u, std::min(max_chunks,
+                   draw_count / std::max(min_draws_per_chunk, 1u)));
+  std::vector<DrawChunk> chunks(chunk_count);
+  for (uint32_t i = 0; i < chunk_count; i++) {
+    const uint32_t begin = uint64_t(draw_count) * i / chunk_count;
+    const uint32_t end = uint64_t(draw_count) * (i + 1) / chunk_count;
+    chunks[i] = {begin, end - begin};
+  }
+  return chunks;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Contiguous range of a frame's draws recorded into one command list
+struct DrawChunk {
+  uint32_t first_draw;
+  uint32_t draw_count;
+};
+
+// Split draw_count draws into at most max_chunks chunks of at least
+// min_draws_per_chunk draws each, chunk sizes differ by at most one. Every
+// command list has a fixed cost, so small frames stay in a single chunk.
+std::vector<DrawChunk> PartitionDraws(uint32_t draw_count,
+                                      uint32_t max_chunks,
+                                      uint32_t min_draws_per_chunk);
@@ -0,0 +1,125 @@
+#include "core/draw_queue.h"
+
+#include <cstring>
+#include <stdexcept>
+
+DrawQueue::DrawQueue(uint32_t instance_stride)
+    : instance_stride_(instance_stride) {
+}
+
+uint32_t DrawQueue::AddMesh(const MeshRange &mesh) {
+  if (meshes_.size() >= kMaxMeshes) {
+    throw std::runtime_error("Too many meshes in the draw queue");
+  }
+  if (mesh.vertex_buffer >= kMaxVertexBuffers) {
+    throw std::runtime_error("Vertex buffer id does not fit the sort key");
+  }
+  meshes_.push_back(mesh);
+  return static_cast<uint32_t>(meshes_.size() - 1);
+}
+
+void DrawQueue::Reset() {
+  items_.clear();
+  instance_data_.clear();
+}
+
+void DrawQueue::Push(const DrawItem &item, const void *instance_data) {
+  if (item.root_signature >= kMaxRootSignatures ||
+      item.pipeline >= kMaxPipelines || item.mesh >= meshes_.size()) {
+    throw std::runtime_error("Draw item does not fit the sort key");
+  }
+  items_.push_back(item);
+  const size_t offset = instance_data_.size();
+  instance_data_.resize(offset + instance_stride_);
+  memcpy(&instance_data_[offset], instance_data, instance_stride_);
+}
+
+uint64_t DrawQueue::GetSortKey(const DrawItem &item) const {
+  return uint64_t(item.root_signature) << 56 | uint64_t(item.pipeline) << 40 |
+         uint64_t(meshes_[item.mesh].vertex_buffer) << 24 | item.mesh;
+}
+
+void DrawQueue::Build() {
+  entries_.resize(items_.size());
+  for (uint32_t i = 0; i < items_.size(); i++) {
+    entries_[i].key = GetSortKey(items_[i]);
+    entries_[i].item = i;
+  }
+  RadixSort();
+
+  batches_.clear();
+  sorted_instance_data_.resize(instance_data_.size());
+  stats_ = DrawQueueStats{};
+  stats_.items = static_cast<uint32_t>(items_.size());
+  for (uint32_t i = 0; i < entries_.size(); i++) {
+    const DrawItem &item = items_[entries_[i].item];
+    memcpy(&sorted_instance_data_[size_t(i) * instance_stride_],
+           &instance_data_[size_t(entries_[i].item) * instance_stride_],
+           instance_stride_);
+
+    // Equal keys mean equal state and mesh, extend the current draw
+    if (i > 0 && entries_[i].key == entries_[i - 1].key) {
+      batches_.back().instance_count++;
+      continue;
+    }
+
+    DrawBatch batch;
+    batch.root_signature = item.root_signature;
+    batch.pipeline = item.pipeline;
+    batch.mesh = item.mesh;
+    batch.first_instance = i;
+    batch.instance_count = 1;
+    if (batches_.empty()) {
+      batch.root_signature_changed = true;
+      batch.pipeline_changed = true;
+      batch.vertex_buffer_changed = true;
+    } else {
+      const DrawBatch &previous = batches_.back();
+      batch.root_signature_changed =
+          item.root_signature != previous.root_signature;
+      batch.pipeline_changed = item.pipeline != previous.pipeline;
+      batch.vertex_buffer_changed = meshes_[item.mesh].vertex_buffer !=
+                                    meshes_[previous.mesh].vertex_buffer;
+    }
+    stats_.root_signature_changes += batch.root_signature_changed;
+    stats_.pipeline_changes += batch.pipeline_changed;
+    stats_.vertex_buffer_changes += batch.vertex_buffer_changed;
+    batches_.push_back(batch);
+  }
+  stats_.draw_calls = static_cast<uint32_t>(batches_.size());
+}
+
+void DrawQueue::RadixSort() {
+  if (entries_.empty()) {
+    return;
+  }
+  // Least significant digit first, one byte per pass. Every pass is stable,
+  // so items with equal keys keep their submission order.
+  uint32_t histograms[8][256] = {};
+  for (const auto &entry : entries_) {
+    for (int pass = 0; pass < 8; pass++) {
+      histograms[pass][(entry.key >> (pass * 8)) & 0xff]++;
+    }
+  }
+
+  scratch_.resize(entries_.size());
+  for (int pass = 0; pass < 8; pass++) {
+    uint32_t *histogram = histograms[pass];
+    // Frames tend to use few distinct ids, skip bytes that are all equal
+    const uint32_t first_digit = (entries_[0].key >> (pass * 8)) & 0xff;
+    if (histogram[first_digit] == entries_.size()) {
+      continue;
+    }
+
+    uint32_t offset = 0;
+    for (int digit = 0; digit < 256; digit++) {
+      const uint32_t count = histogram[digit];
+      histogram[digit] = offset;
+      offset += count;
+    }
+    for (const auto &entry : entries_) {
+      scratch_[histogram[(entry.key >> (pass * 8)) & 0xff]++] = entry;
+    }
+    entries_.swap(scratch_);
+  }
+}
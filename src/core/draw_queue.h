@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Indexed draw range of a mesh. Vertex and index buffers are bound together,
+// vertex_buffer is the caller's id of the pair.
+struct MeshRange {
+  uint32_t vertex_buffer;
+  uint32_t start_index;
+  uint32_t index_count;
+  int32_t base_vertex;
+};
+
+// Pipeline and root signature are ids into tables owned by the caller, the
+// mesh is an id returned by DrawQueue::AddMesh
+struct DrawItem {
+  uint32_t root_signature;
+  uint32_t pipeline;
+  uint32_t mesh;
+};
+
+// One instanced draw after sorting and merging. The changed flags tell which
+// bindings differ from the previous batch, so redundant calls can be skipped.
+struct DrawBatch {
+  uint32_t root_signature;
+  uint32_t pipeline;
+  uint32_t mesh;
+  uint32_t first_instance;
+  uint32_t instance_count;
+  bool root_signature_changed;
+  bool pipeline_changed;
+  bool vertex_buffer_changed;
+};
+
+struct DrawQueueStats {
+  uint32_t items{0};
+  uint32_t draw_calls{0};
+  uint32_t root_signature_changes{0};
+  uint32_t pipeline_changes{0};
+  uint32_t vertex_buffer_changes{0};
+};
+
+// Collects the draws of a frame and turns them into few instanced draws.
+// Items are sorted by a 64 bit key made of root signature, pipeline, vertex
+// buffer and mesh, from the most to the least expensive state to change, and
+// runs of the same mesh become one draw. The per-instance data of every item
+// is gathered in batch order, so batches index it with their first instance.
+class DrawQueue {
+ public:
+  static const uint32_t kMaxRootSignatures = 1 << 8;
+  static const uint32_t kMaxPipelines = 1 << 16;
+  static const uint32_t kMaxVertexBuffers = 1 << 16;
+  static const uint32_t kMaxMeshes = 1 << 24;
+
+  explicit DrawQueue(uint32_t instance_stride);
+
+  // Meshes persist across frames
+  uint32_t AddMesh(const MeshRange &mesh);
+  const MeshRange &GetMesh(uint32_t mesh) const {
+    return meshes_[mesh];
+  }
+
+  // Start a new frame, keeping the capacity of the previous one
+  void Reset();
+  void Push(const DrawItem &item, const void *instance_data);
+
+  // Sort and merge the pushed items, invalidates earlier batches
+  void Build();
+
+  // Items are drawn in the order of their keys, those with equal keys in
+  // the order they were pushed
+  uint64_t GetSortKey(const DrawItem &item) const;
+
+  const std::vector<DrawBatch> &GetBatches() const {
+    return batches_;
+  }
+  const std::vector<uint8_t> &GetInstanceData() const {
+    return sorted_instance_data_;
+  }
+  uint32_t GetInstanceStride() const {
+    return instance_stride_;
+  }
+  const DrawQueueStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  struct SortEntry {
+    uint64_t key;
+    uint32_t item;
+  };
+
+  void RadixSort();
+
+  uint32_t instance_stride_;
+  std::vector<MeshRange> meshes_;
+  std::vector<DrawItem> items_;
+  std::vector<uint8_t> instance_data_;
+  std::vector<SortEntry> entries_;
+  std::vector<SortEntry> scratch_;
+  std::vector<DrawBatch> batches_;
+  std::vector<uint8_t> sorted_instance_data_;
+  DrawQueueStats stats_;
+};
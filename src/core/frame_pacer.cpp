@@ -0,0 +1,91 @@
+#include "core/frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+// Sleeps are trusted to wake up no later than this before the deadline
+const auto kSleepSlack = std::chrono::milliseconds(2);
+}  // namespace
+
+FramePacer::FramePacer(const FramePacerSettings &settings)
+    : settings_(settings) {
+}
+
+void FramePacer::OnWaitEnd(uint64_t time_ns, bool blocked) {
+  if (blocked && last_wait_blocked_) {
+    gpu_time_.Add(static_cast<double>(time_ns - last_wait_end_ns_),
+                  settings_.smoothing);
+  }
+  // The GPU finished the previous frame before its successor was submitted
+  if (!blocked && last_frame_delayed_) {
+    stats_.late_frames++;
+  }
+  last_wait_end_ns_ = time_ns;
+  last_wait_blocked_ = blocked;
+}
+
+uint64_t FramePacer::GetDelay() const {
+  // Only a blocking wait tells when the GPU started the previous frame
+  if (!last_wait_blocked_ || gpu_time_.samples < settings_.warmup_frames ||
+      cpu_time_.samples < settings_.warmup_frames) {
+    return 0;
+  }
+  const double delay = static_cast<double>(PredictGpuTime()) -
+                       static_cast<double>(PredictCpuTime()) -
+                       static_cast<double>(settings_.margin_ns);
+  return delay > 0.0 ? static_cast<uint64_t>(delay) : 0;
+}
+
+void FramePacer::OnDelay(uint64_t delay_ns) {
+  stats_.frames++;
+  last_frame_delayed_ = delay_ns > 0;
+  if (delay_ns > 0) {
+    stats_.delayed_frames++;
+    stats_.delay_ns += delay_ns;
+  }
+}
+
+void FramePacer::OnFrameSubmitted(uint64_t cpu_ns) {
+  cpu_time_.Add(static_cast<double>(cpu_ns), settings_.smoothing);
+}
+
+uint64_t FramePacer::PredictGpuTime() const {
+  // Underestimating the GPU only costs latency while overestimating it
+  // starves the GPU, so the prediction errs low
+  return static_cast<uint64_t>(std::max(
+      gpu_time_.mean - settings_.deviation_weight * gpu_time_.deviation, 0.0));
+}
+
+uint64_t FramePacer::PredictCpuTime() const {
+  return static_cast<uint64_t>(
+      cpu_time_.mean + settings_.deviation_weight * cpu_time_.deviation);
+}
+
+void FramePacer::Predictor::Add(double sample, double smoothing) {
+  if (samples++ == 0) {
+    mean = sample;
+    deviation = 0.0;
+    return;
+  }
+  deviation += smoothing * (std::abs(sample - mean) - deviation);
+  mean += smoothing * (sample - mean);
+}
+
+void FrameStartWaits::OnWaitEnd(uint64_t time_ns, bool blocked) {
+  // A later wait that returned at once does not move the end
+  if (blocked || !blocked_) {
+    end_ns_ = time_ns;
+  }
+  blocked_ = blocked_ || blocked;
+}
+
+void WaitUntil(std::chrono::steady_clock::time_point deadline) {
+  if (deadline - std::chrono::steady_clock::now() > kSleepSlack) {
+    std::this_thread::sleep_until(deadline - kSleepSlack);
+  }
+  while (std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+struct FramePacerSettings {
+  // Left between the predicted submission of a frame and the GPU running
+  // out of work, absorbs what the predictions miss
+  uint64_t margin_ns{1000000};
+  // Weight of the newest sample in the moving averages
+  double smoothing{0.1};
+  // Mean absolute deviations subtracted from the GPU and added to the CPU
+  // prediction, higher trades latency for fewer late frames
+  double deviation_weight{2.0};
+  // Frames are not held back before this many were measured
+  uint32_t warmup_frames{8};
+};
+
+struct FramePacerStats {
+  uint64_t frames{0};
+  uint64_t delayed_frames{0};
+  uint64_t delay_ns{0};
+  // Delayed frames after which the next wait did not block, so the GPU may
+  // have run out of work
+  uint64_t late_frames{0};
+};
+
+// Holds the CPU work of a frame back so that it is submitted just before the
+// GPU needs it, which shortens the time from sampling input to the frame
+// being displayed without losing throughput. Pure logic fed with times the
+// caller measures on any clock, so it runs the same against a simulated
+// timeline as against a device.
+//
+// A frame starts by waiting for its frame slot, or for the swap chain as
+// well, see FrameStartWaits. While the GPU is the bottleneck that wait
+// blocks and ends when the GPU starts the previous frame, so the distance
+// between the ends of consecutive blocking waits is the GPU frame time.
+// Delaying the CPU work by the predicted GPU time less the predicted CPU time
+// and the margin submits the frame right as the GPU finishes the previous
+// one. Frames whose wait did not block, because the CPU or the display is
+// the bottleneck, are not delayed.
+class FramePacer {
+ public:
+  explicit FramePacer(const FramePacerSettings &settings = {});
+
+  // The frame slot wait at the start of a frame ended at time_ns, blocked
+  // tells whether it had to wait for the GPU at all
+  void OnWaitEnd(uint64_t time_ns, bool blocked);
+
+  // How long to hold back the CPU work of the frame whose wait ended last
+  uint64_t GetDelay() const;
+  void OnDelay(uint64_t delay_ns);
+
+  // CPU time from the end of the delay to the submission of the frame
+  void OnFrameSubmitted(uint64_t cpu_ns);
+
+  uint64_t PredictGpuTime() const;
+  uint64_t PredictCpuTime() const;
+  const FramePacerStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  // Exponential moving average of the samples and of their deviation
+  struct Predictor {
+    double mean{0.0};
+    double deviation{0.0};
+    uint32_t samples{0};
+
+    void Add(double sample, double smoothing);
+  };
+
+  FramePacerSettings settings_;
+  Predictor gpu_time_;
+  Predictor cpu_time_;
+  uint64_t last_wait_end_ns_{0};
+  bool last_wait_blocked_{false};
+  bool last_frame_delayed_{false};
+  FramePacerStats stats_;
+};
+
+// Merges the waits at the start of a frame into the one wait FramePacer is
+// told about. A swap chain's frame latency wait and the frame slot wait both
+// end once the GPU frees a frame, and whichever comes first absorbs the
+// other. The frame blocked when any wait did and its wait ended with the last
+// wait that blocked. Waits are polled first to tell whether they blocked.
+class FrameStartWaits {
+ public:
+  void OnWaitEnd(uint64_t time_ns, bool blocked);
+
+  uint64_t GetEndTime() const {
+    return end_ns_;
+  }
+  bool IsBlocked() const {
+    return blocked_;
+  }
+
+ private:
+  uint64_t end_ns_{0};
+  bool blocked_{false};
+};
+
+// Sleep until shortly before the deadline and yield for the rest, sleeps
+// alone overshoot by a scheduler quantum on some systems
+void WaitUntil(std::chrono::steady_clock::time_point deadline);
@@ -0,0 +1,37 @@
+#include "core/frame_scheduler.h"
+
+#include <stdexcept>
+
+FrameScheduler::FrameScheduler(GpuTimeline *timeline,
+                               uint32_t frames_in_flight)
+    : timeline_(timeline), frames_in_flight_(frames_in_flight) {
+  if (frames_in_flight < kMinFramesInFlight ||
+      frames_in_flight > kMaxFramesInFlight) {
+    throw std::runtime_error("Unsupported number of frames in flight");
+  }
+}
+
+uint32_t FrameScheduler::BeginFrame() {
+  frame_slot_ = static_cast<uint32_t>(frame_number_ % frames_in_flight_);
+
+  // The slot was last used frames_in_flight_ frames ago, only wait if the GPU
+  // has not caught up with that frame yet
+  const uint64_t fence_value = slot_fence_values_[frame_slot_];
+  if (timeline_->GetCompletedValue() < fence_value) {
+    stats_.stalls++;
+    timeline_->WaitForValue(fence_value);
+  }
+  return frame_slot_;
+}
+
+uint64_t FrameScheduler::EndFrame() {
+  const uint64_t fence_value = timeline_->Signal();
+  slot_fence_values_[frame_slot_] = fence_value;
+  frame_number_++;
+  stats_.frames++;
+  return fence_value;
+}
+
+void FrameScheduler::WaitForIdle() {
+  timeline_->WaitForValue(timeline_->Signal());
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+#include "core/gpu_timeline.h"
+
+struct FrameSchedulerStats {
+  uint64_t frames{0};
+  // Number of BeginFrame calls that had to block on the GPU
+  uint64_t stalls{0};
+};
+
+// Hands out per-frame resource slots in round robin. Each slot remembers the
+// fence value of the last frame that used it, so the CPU only blocks when the
+// oldest frame in flight still owns the slot that is about to be reused.
+class FrameScheduler {
+ public:
+  static const uint32_t kMinFramesInFlight = 2;
+  static const uint32_t kMaxFramesInFlight = 4;
+
+  FrameScheduler(GpuTimeline *timeline, uint32_t frames_in_flight);
+
+  // Wait until the next slot is retired and make it current, returns its index
+  uint32_t BeginFrame();
+
+  // Signal the end of the current frame's submissions, returns the fence value
+  uint64_t EndFrame();
+
+  // Block until every frame submitted so far has completed on the GPU
+  void WaitForIdle();
+
+  uint32_t GetFramesInFlight() const {
+    return frames_in_flight_;
+  }
+  uint32_t GetFrameSlot() const {
+    return frame_slot_;
+  }
+  uint64_t GetFrameNumber() const {
+    return frame_number_;
+  }
+  const FrameSchedulerStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  GpuTimeline *timeline_;
+  uint32_t frames_in_flight_;
+  uint32_t frame_slot_{0};
+  uint64_t frame_number_{0};
+  uint64_t slot_fence_values_[kMaxFramesInFlight]{};
+  FrameSchedulerStats stats_;
+};
@@ -0,0 +1,76 @@
+#include "core/frame_sink.h"
+
+#include <chrono>
+#include <stdexcept>
+
+FrameView GetFrameView(const Image &image) {
+  return {reinterpret_cast<const uint8_t *>(image.pixels.data()), image.width,
+          image.height, image.width * 4};
+}
+
+FrameSink::FrameSink(const std::string &path, FrameSinkFormat format)
+    : path_(path), format_(format), file_(fopen(path.c_str(), "wb")) {
+  if (!file_) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+}
+
+FrameSink::~FrameSink() {
+  fclose(file_);
+}
+
+FrameSinkFormat FrameSink::GetFormatForPath(const std::string &path) {
+  const std::string extension = ".ppm";
+  if (path.size() >= extension.size() &&
+      path.compare(path.size() - extension.size(), extension.size(),
+                   extension) == 0) {
+    return FrameSinkFormat::kPpm;
+  }
+  return FrameSinkFormat::kRawRgba;
+}
+
+void FrameSink::WriteFrame(const FrameView &frame) {
+  const auto start = std::chrono::steady_clock::now();
+  const size_t row_size = size_t(frame.width) * 4;
+  if (format_ == FrameSinkFormat::kRawRgba) {
+    if (frame.row_pitch == row_size) {
+      Write(frame.data, row_size * frame.height);
+    } else {
+      for (uint32_t y = 0; y < frame.height; y++) {
+        Write(frame.data + size_t(y) * frame.row_pitch, row_size);
+      }
+    }
+  } else {
+    char header[64];
+    const int header_size = snprintf(header, sizeof(header), "P6\n%u %u\n255\n",
+                                     frame.width, frame.height);
+    Write(header, header_size);
+    row_.resize(size_t(frame.width) * 3);
+    for (uint32_t y = 0; y < frame.height; y++) {
+      const uint8_t *pixels = frame.data + size_t(y) * frame.row_pitch;
+      for (uint32_t x = 0; x < frame.width; x++) {
+        row_[x * 3 + 0] = pixels[x * 4 + 0];
+        row_[x * 3 + 1] = pixels[x * 4 + 1];
+        row_[x * 3 + 2] = pixels[x * 4 + 2];
+      }
+      Write(row_.data(), row_.size());
+    }
+  }
+  stats_.frames++;
+  stats_.write_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+}
+
+void FrameSink::Flush() {
+  if (fflush(file_) != 0) {
+    throw std::runtime_error("Failed to write " + path_);
+  }
+}
+
+void FrameSink::Write(const void *data, size_t size) {
+  if (fwrite(data, 1, size, file_) != size) {
+    throw std::runtime_error("Failed to write " + path_);
+  }
+  stats_.bytes += size;
+}
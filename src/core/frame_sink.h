@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "core/image.h"
+
+enum class FrameSinkFormat {
+  // Tightly packed R8G8B8A8 rows, frame after frame without headers
+  kRawRgba,
+  // Concatenated binary PPM images, as read by ffmpeg -f image2pipe
+  kPpm,
+};
+
+// R8G8B8A8 pixels with rows row_pitch bytes apart, for example in a mapped
+// readback buffer
+struct FrameView {
+  const uint8_t *data;
+  uint32_t width;
+  uint32_t height;
+  uint32_t row_pitch;
+};
+
+FrameView GetFrameView(const Image &image);
+
+struct FrameSinkStats {
+  uint64_t frames{0};
+  uint64_t bytes{0};
+  uint64_t write_time_ns{0};
+};
+
+// Streams frames into one file, which may be a named pipe read by an
+// encoder. Raw frames are written straight from the view without a staging
+// copy, PPM frames drop alpha a row at a time.
+class FrameSink {
+ public:
+  FrameSink(const std::string &path, FrameSinkFormat format);
+  ~FrameSink();
+  FrameSink(const FrameSink &) = delete;
+  FrameSink &operator=(const FrameSink &) = delete;
+
+  // PPM for paths ending in .ppm, raw otherwise
+  static FrameSinkFormat GetFormatForPath(const std::string &path);
+
+  void WriteFrame(const FrameView &frame);
+  void Flush();
+
+  const FrameSinkStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  void Write(const void *data, size_t size);
+
+  std::string path_;
+  FrameSinkFormat format_;
+  FILE *file_;
+  std::vector<uint8_t> row_;
+  FrameSinkStats stats_;
+};
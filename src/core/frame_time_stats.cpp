@@ -0,0 +1,33 @@
+#include "core/frame_time_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+FrameTimeStats::FrameTimeStats(uint32_t window)
+    : window_(std::max(window, 1u)) {
+  frame_times_.reserve(window_);
+  sorted_.reserve(window_);
+}
+
+void FrameTimeStats::AddFrame(double milliseconds) {
+  if (frame_times_.size() < window_) {
+    frame_times_.push_back(milliseconds);
+  } else {
+    frame_times_[next_] = milliseconds;
+  }
+  next_ = (next_ + 1) % window_;
+}
+
+double FrameTimeStats::GetPercentile(double percentile) const {
+  if (frame_times_.empty()) {
+    return 0.0;
+  }
+  const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+  const size_t rank = static_cast<size_t>(
+      std::ceil(clamped / 100.0 * static_cast<double>(frame_times_.size())));
+  const size_t index = rank == 0 ? 0 : rank - 1;
+  // Selection on a copy keeps the window in arrival order
+  sorted_.assign(frame_times_.begin(), frame_times_.end());
+  std::nth_element(sorted_.begin(), sorted_.begin() + index, sorted_.end());
+  return sorted_[index];
+}
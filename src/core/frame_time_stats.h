@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Rolling window over the latest frame times, cheap enough to stay on in
+// every build
+class FrameTimeStats {
+ public:
+  static const uint32_t kDefaultWindow = 240;
+
+  explicit FrameTimeStats(uint32_t window = kDefaultWindow);
+
+  void AddFrame(double milliseconds);
+
+  // Nearest rank percentile in [0, 100] of the frames in the window, 0 when
+  // there are none
+  double GetPercentile(double percentile) const;
+
+  uint32_t GetCount() const {
+    return static_cast<uint32_t>(frame_times_.size());
+  }
+
+ private:
+  std::vector<double> frame_times_;
+  uint32_t window_;
+  uint32_t next_{0};
+  mutable std::vector<double> sorted_;
+};
@@ -0,0 +1,183 @@
+#include "core/frustum_culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_X64
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// GCC and Clang only emit AVX in functions that enable it, MSVC always can
+#if defined(FRUSTUM_CULLING_X64) && defined(__GNUC__)
+#define FRUSTUM_CULLING_AVX_TARGET __attribute__((target("avx")))
+#else
+#define FRUSTUM_CULLING_AVX_TARGET
+#endif
+
+namespace {
+uint32_t FindLowestBit(uint32_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return index;
+#else
+  return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+}
+
+// Append base + i for every set bit i of the mask
+void AppendMask(uint32_t base, uint32_t mask, std::vector<uint32_t> *visible) {
+  while (mask != 0) {
+    visible->push_back(base + FindLowestBit(mask));
+    mask &= mask - 1;
+  }
+}
+
+// The SIMD kernels evaluate the same expression in the same order
+bool IsSphereVisible(const Frustum &frustum,
+                     const SphereArrays &spheres,
+                     uint32_t i) {
+  for (const glm::vec4 &plane : frustum.planes) {
+    const float distance = plane.x * spheres.center_x[i] +
+                           plane.y * spheres.center_y[i] +
+                           plane.z * spheres.center_z[i] + plane.w;
+    if (!(distance >= -spheres.radius[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CullScalar(const Frustum &frustum,
+                const SphereArrays &spheres,
+                uint32_t begin,
+                uint32_t end,
+                std::vector<uint32_t> *visible) {
+  for (uint32_t i = begin; i < end; i++) {
+    if (IsSphereVisible(frustum, spheres, i)) {
+      visible->push_back(i);
+    }
+  }
+}
+
+#ifdef FRUSTUM_CULLING_X64
+// Returns the first index left for the scalar tail
+uint32_t CullSse2(const Frustum &frustum,
+                  const SphereArrays &spheres,
+                  uint32_t begin,
+                  uint32_t end,
+                  std::vector<uint32_t> *visible) {
+  __m128 planes[6][4];
+  for (int p = 0; p < 6; p++) {
+    for (int c = 0; c < 4; c++) {
+      planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+    }
+  }
+  uint32_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    const __m128 x = _mm_loadu_ps(spheres.center_x + i);
+    const __m128 y = _mm_loadu_ps(spheres.center_y + i);
+    const __m128 z = _mm_loadu_ps(spheres.center_z + i);
+    const __m128 negative_radius =
+        _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      const __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x),
+                                _mm_mul_ps(planes[p][1], y)),
+                     _mm_mul_ps(planes[p][2], z)),
+          planes[p][3]);
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+    }
+    AppendMask(i, static_cast<uint32_t>(_mm_movemask_ps(inside)), visible);
+  }
+  return i;
+}
+
+FRUSTUM_CULLING_AVX_TARGET uint32_t CullAvx(const Frustum &frustum,
+                                            const SphereArrays &spheres,
+                                            uint32_t begin,
+                                            uint32_t end,
+                                            std::vector<uint32_t> *visible) {
+  __m256 planes[6][4];
+  for (int p = 0; p < 6; p++) {
+    for (int c = 0; c < 4; c++) {
+      planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+    }
+  }
+  uint32_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    const __m256 x = _mm256_loadu_ps(spheres.center_x + i);
+    const __m256 y = _mm256_loadu_ps(spheres.center_y + i);
+    const __m256 z = _mm256_loadu_ps(spheres.center_z + i);
+    const __m256 negative_radius = _mm256_sub_ps(
+        _mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+    // Testing all planes without branching beats stopping once all eight
+    // spheres are outside, that branch is hard to predict
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      const __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x),
+                                      _mm256_mul_ps(planes[p][1], y)),
+                        _mm256_mul_ps(planes[p][2], z)),
+          planes[p][3]);
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ));
+    }
+    AppendMask(i, static_cast<uint32_t>(_mm256_movemask_ps(inside)), visible);
+  }
+  // Avoid the penalty of mixing AVX and SSE code in the caller
+  _mm256_zeroupper();
+  return i;
+}
+#endif
+}  // namespace
+
+Frustum ExtractFrustum(const glm::mat4 &view_projection) {
+  // Rows of the matrix, glm stores columns
+  glm::vec4 rows[4];
+  for (int row = 0; row < 4; row++) {
+    rows[row] = glm::vec4(view_projection[0][row], view_projection[1][row],
+                          view_projection[2][row], view_projection[3][row]);
+  }
+
+  Frustum frustum;
+  frustum.planes[0] = rows[3] + rows[0];
+  frustum.planes[1] = rows[3] - rows[0];
+  frustum.planes[2] = rows[3] + rows[1];
+  frustum.planes[3] = rows[3] - rows[1];
+  frustum.planes[4] = rows[2];
+  frustum.planes[5] = rows[3] - rows[2];
+  // Normalized planes give distances, which compare against radii
+  for (glm::vec4 &plane : frustum.planes) {
+    const float length =
+        std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if (length > 0.0f) {
+      plane = plane * (1.0f / length);
+    }
+  }
+  return frustum;
+}
+
+void CullSpheres(const Frustum &frustum,
+                 const SphereArrays &spheres,
+                 uint32_t begin,
+                 uint32_t end,
+                 SimdLevel level,
+                 std::vector<uint32_t> *visible) {
+  level = std::min(level, GetSupportedSimdLevel());
+#ifdef FRUSTUM_CULLING_X64
+  // AVX2 adds nothing the sphere tests use
+  if (level >= SimdLevel::kAvx) {
+    begin = CullAvx(frustum, spheres, begin, end, visible);
+  } else if (level == SimdLevel::kSse2) {
+    begin = CullSse2(frustum, spheres, begin, end, visible);
+  }
+#endif
+  CullScalar(frustum, spheres, begin, end, visible);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "core/cpu_features.h"
+#include "glm/glm.hpp"
+
+// Six normalized planes facing inwards, a point p is inside a plane when
+// dot(plane.xyz, p) + plane.w >= 0
+struct Frustum {
+  glm::vec4 planes[6];
+};
+
+// Planes of the D3D clip volume, -w <= x, y <= w and 0 <= z <= w, in the
+// space view_projection transforms from
+Frustum ExtractFrustum(const glm::mat4 &view_projection);
+
+// Bounding spheres in structure of arrays layout
+struct SphereArrays {
+  const float *center_x;
+  const float *center_y;
+  const float *center_z;
+  const float *radius;
+};
+
+// Append the indices in [begin, end) of the spheres that intersect the
+// frustum to visible, in increasing order. Levels above
+// GetSupportedSimdLevel() fall back to it.
+void CullSpheres(const Frustum &frustum,
+                 const SphereArrays &spheres,
+                 uint32_t begin,
+                 uint32_t end,
+                 SimdLevel level,
+                 std::vector<uint32_t> *visible);
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+// Monotonic fence timeline of a GPU queue. Abstracts the fence/queue pair so
+// frame scheduling can run against either a real device or a simulation.
+// Timelines of one device can order their queues against each other.
+class GpuTimeline {
+ public:
+  virtual ~GpuTimeline() = default;
+
+  // Enqueue a signal behind all previously submitted work, returns its value
+  virtual uint64_t Signal() = 0;
+
+  // Value of the most recent signal the GPU has reached
+  virtual uint64_t GetCompletedValue() = 0;
+
+  // Block the calling thread until the GPU reaches the value
+  virtual void WaitForValue(uint64_t value) = 0;
+
+  // Hold back work submitted to this queue from now on until the other
+  // timeline, of the same implementation, reaches the value. Only the GPU
+  // waits, the calling thread does not block.
+  virtual void WaitForTimeline(GpuTimeline *other, uint64_t value) = 0;
+};
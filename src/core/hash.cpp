@@ -0,0 +1,31 @@
+#include "core/hash.h"
+
+#include <cstdio>
+
+void Hasher::Update(const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash_ = (hash_ ^ bytes[i]) * 0x100000001b3ull;
+  }
+}
+
+void Hasher::Update(const std::string &value) {
+  // Length first so that consecutive strings can not alias each other
+  Update(static_cast<uint64_t>(value.size()));
+  Update(value.data(), value.size());
+}
+
+void Hasher::Update(uint64_t value) {
+  uint8_t bytes[8];
+  for (int i = 0; i < 8; i++) {
+    bytes[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+  Update(bytes, sizeof(bytes));
+}
+
+std::string HashToString(uint64_t hash) {
+  char text[17];
+  snprintf(text, sizeof(text), "%016llx",
+           static_cast<unsigned long long>(hash));
+  return text;
+}
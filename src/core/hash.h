@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Incremental 64 bit FNV-1a, stable across platforms and runs so it can key
+// on-disk caches
+class Hasher {
+ public:
+  void Update(const void *data, size_t size);
+  void Update(const std::string &value);
+  void Update(uint64_t value);
+
+  uint64_t GetHash() const {
+    return hash_;
+  }
+
+ private:
+  uint64_t hash_{0xcbf29ce484222325ull};
+};
+
+std::string HashToString(uint64_t hash);
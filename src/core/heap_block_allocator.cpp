@@ -0,0 +1,234 @@
+#include "core/heap_block_allocator.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "core/string_utils.h"
+
+HeapBlockAllocator::HeapBlockAllocator(uint64_t block_size, uint64_t budget)
+    : block_size_(block_size), budget_(budget) {
+}
+
+uint32_t HeapBlockAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  HeapRange range;
+  range.size = size;
+  range.offset = TlsfAllocator::kInvalidOffset;
+  for (uint32_t block = 0; block < blocks_.size(); block++) {
+    if (blocks_[block]) {
+      range.offset = blocks_[block]->Allocate(size, alignment);
+      if (range.offset != TlsfAllocator::kInvalidOffset) {
+        range.block = block;
+        break;
+      }
+    }
+  }
+
+  if (range.offset == TlsfAllocator::kInvalidOffset) {
+    // TLSF rounds block sizes down to its granularity, a dedicated block is
+    // rounded up so that the allocation fits at offset 0
+    const uint64_t granularity =
+        std::max(alignment, TlsfAllocator::kGranularity);
+    const uint64_t new_block_size =
+        (std::max(block_size_, size) + granularity - 1) / granularity *
+        granularity;
+    if (reserved_size_ + new_block_size > budget_) {
+      return kInvalidAllocation;
+    }
+    range.block = CreateBlock(new_block_size);
+    range.offset = blocks_[range.block]->Allocate(size, alignment);
+    if (range.offset == TlsfAllocator::kInvalidOffset) {
+      reserved_size_ -= blocks_[range.block]->GetSize();
+      blocks_[range.block].reset();
+      return kInvalidAllocation;
+    }
+  }
+
+  uint32_t id;
+  if (free_allocation_ids_.empty()) {
+    id = static_cast<uint32_t>(allocations_.size());
+    allocations_.push_back({});
+  } else {
+    id = free_allocation_ids_.back();
+    free_allocation_ids_.pop_back();
+  }
+  allocations_[id] = {range, alignment, true};
+  return id;
+}
+
+void HeapBlockAllocator::Free(uint32_t allocation) {
+  if (allocation >= allocations_.size() || !allocations_[allocation].live) {
+    throw std::runtime_error("Freeing an allocation that is not live");
+  }
+  FreeRange(allocations_[allocation].range);
+  allocations_[allocation].live = false;
+  free_allocation_ids_.push_back(allocation);
+}
+
+void HeapBlockAllocator::FreeRange(const HeapRange &range) {
+  blocks_[range.block]->Free(range.offset);
+}
+
+std::vector<HeapMove> HeapBlockAllocator::PlanDefragmentation(
+    uint64_t max_bytes) {
+  std::vector<HeapMove> moves;
+  if (GetBlockCount() < 2) {
+    return moves;
+  }
+
+  // The block with the lowest occupancy is the cheapest one to empty
+  uint32_t source = 0;
+  double lowest_occupancy = 2.0;
+  for (uint32_t block = 0; block < blocks_.size(); block++) {
+    if (!blocks_[block] || blocks_[block]->GetAllocationCount() == 0) {
+      continue;
+    }
+    const double occupancy = double(blocks_[block]->GetUsedSize()) /
+                             double(blocks_[block]->GetSize());
+    if (occupancy < lowest_occupancy) {
+      lowest_occupancy = occupancy;
+      source = block;
+    }
+  }
+  if (lowest_occupancy > 1.0) {
+    return moves;
+  }
+
+  // Move the largest allocations first, they are the hardest to place later
+  std::vector<uint32_t> candidates;
+  for (uint32_t id = 0; id < allocations_.size(); id++) {
+    if (allocations_[id].live && allocations_[id].range.block == source) {
+      candidates.push_back(id);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+    return allocations_[a].range.size > allocations_[b].range.size;
+  });
+
+  // Moving only part of the block costs copies without releasing anything,
+  // so wait until the other blocks have room for all of it
+  uint64_t live_bytes = 0;
+  for (uint32_t id : candidates) {
+    live_bytes += allocations_[id].range.size;
+  }
+  uint64_t free_bytes = 0;
+  for (uint32_t block = 0; block < blocks_.size(); block++) {
+    if (block != source && blocks_[block]) {
+      free_bytes += blocks_[block]->GetSize() - blocks_[block]->GetUsedSize();
+    }
+  }
+  if (live_bytes > free_bytes) {
+    return moves;
+  }
+
+  uint64_t moved_bytes = 0;
+  for (uint32_t id : candidates) {
+    Allocation &allocation = allocations_[id];
+    if (moved_bytes + allocation.range.size > max_bytes) {
+      break;
+    }
+    for (uint32_t block = 0; block < blocks_.size(); block++) {
+      if (block == source || !blocks_[block]) {
+        continue;
+      }
+      const uint64_t offset =
+          blocks_[block]->Allocate(allocation.range.size, allocation.alignment);
+      if (offset != TlsfAllocator::kInvalidOffset) {
+        HeapRange destination = {block, offset, allocation.range.size};
+        moves.push_back({id, allocation.range, destination});
+        allocation.range = destination;
+        moved_bytes += destination.size;
+        break;
+      }
+    }
+  }
+  return moves;
+}
+
+std::vector<uint32_t> HeapBlockAllocator::ReleaseEmptyBlocks() {
+  std::vector<uint32_t> released;
+  for (uint32_t block = 0; block < blocks_.size(); block++) {
+    if (blocks_[block] && blocks_[block]->GetAllocationCount() == 0) {
+      reserved_size_ -= blocks_[block]->GetSize();
+      blocks_[block].reset();
+      released.push_back(block);
+    }
+  }
+  return released;
+}
+
+uint32_t HeapBlockAllocator::GetBlockCount() const {
+  return static_cast<uint32_t>(
+      std::count_if(blocks_.begin(), blocks_.end(),
+                    [](const auto &block) { return block != nullptr; }));
+}
+
+uint64_t HeapBlockAllocator::GetUsedSize() const {
+  uint64_t used_size = 0;
+  for (const auto &block : blocks_) {
+    if (block) {
+      used_size += block->GetUsedSize();
+    }
+  }
+  return used_size;
+}
+
+std::string HeapBlockAllocator::GetUsageReport() const {
+  std::ostringstream report;
+  report << "Used " << DataSizeToStringNotation(GetUsedSize()) << " of "
+         << DataSizeToStringNotation(reserved_size_) << " reserved in "
+         << GetBlockCount() << " blocks, budget "
+         << DataSizeToStringNotation(budget_) << std::endl;
+  for (uint32_t block = 0; block < blocks_.size(); block++) {
+    if (!blocks_[block]) {
+      continue;
+    }
+    report << "  Block " << block << ": "
+           << DataSizeToStringNotation(blocks_[block]->GetUsedSize()) << " / "
+           << DataSizeToStringNotation(blocks_[block]->GetSize()) << ", "
+           << blocks_[block]->GetAllocationCount()
+           << " allocations, largest free "
+           << DataSizeToStringNotation(blocks_[block]->GetLargestFreeBlock())
+           << std::endl;
+  }
+  return report.str();
+}
+
+bool HeapBlockAllocator::Validate() const {
+  uint64_t reserved_size = 0;
+  for (const auto &block : blocks_) {
+    if (block) {
+      if (!block->Validate()) {
+        return false;
+      }
+      reserved_size += block->GetSize();
+    }
+  }
+  if (reserved_size != reserved_size_) {
+    return false;
+  }
+  for (const Allocation &allocation : allocations_) {
+    const HeapRange &range = allocation.range;
+    if (allocation.live &&
+        (!IsBlockAlive(range.block) ||
+         range.offset % std::max(allocation.alignment,
+                                 TlsfAllocator::kGranularity) !=
+             0 ||
+         range.offset + range.size > blocks_[range.block]->GetSize())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t HeapBlockAllocator::CreateBlock(uint64_t size) {
+  reserved_size_ += size;
+  for (uint32_t block = 0; block < blocks_.size(); block++) {
+    if (!blocks_[block]) {
+      blocks_[block] = std::make_unique<TlsfAllocator>(size);
+      return block;
+    }
+  }
+  blocks_.push_back(std::make_unique<TlsfAllocator>(size));
+  return static_cast<uint32_t>(blocks_.size() - 1);
+}
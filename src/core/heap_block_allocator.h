@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/tlsf_allocator.h"
+
+struct HeapRange {
+  uint32_t block{0};
+  uint64_t offset{0};
+  uint64_t size{0};
+};
+
+// Relocation of one allocation planned by defragmentation. The source range
+// stays reserved until FreeRange is called for it, after the GPU copy.
+struct HeapMove {
+  uint32_t allocation;
+  HeapRange source;
+  HeapRange destination;
+};
+
+// Bookkeeping of a set of large memory blocks, each sub-allocated by a TLSF
+// allocator. Allocations are referred to by stable ids because
+// defragmentation may move them between blocks. Nothing here touches the
+// memory itself, the owner creates and destroys the backing storage of each
+// block.
+class HeapBlockAllocator {
+ public:
+  static const uint32_t kInvalidAllocation = ~uint32_t(0);
+
+  HeapBlockAllocator(uint64_t block_size, uint64_t budget);
+
+  // Reserves a new block when no existing block has room. Allocations larger
+  // than the block size get a dedicated block. Returns kInvalidAllocation
+  // when a new block would exceed the budget.
+  uint32_t Allocate(uint64_t size, uint64_t alignment);
+  void Free(uint32_t allocation);
+  void FreeRange(const HeapRange &range);
+
+  const HeapRange &Get(uint32_t allocation) const {
+    return allocations_[allocation].range;
+  }
+
+  // Move allocations out of the least occupied block into the other blocks,
+  // up to max_bytes, so that the block can eventually be released. Plans
+  // nothing while the other blocks lack the room for the whole block.
+  std::vector<HeapMove> PlanDefragmentation(uint64_t max_bytes);
+
+  // Forget every block without live ranges and return their indices, the
+  // indices may be reused by later allocations
+  std::vector<uint32_t> ReleaseEmptyBlocks();
+
+  bool IsBlockAlive(uint32_t block) const {
+    return block < blocks_.size() && blocks_[block] != nullptr;
+  }
+  uint64_t GetBlockSize(uint32_t block) const {
+    return blocks_[block]->GetSize();
+  }
+  uint32_t GetBlockCount() const;
+  uint64_t GetReservedSize() const {
+    return reserved_size_;
+  }
+  uint64_t GetUsedSize() const;
+  uint64_t GetBudget() const {
+    return budget_;
+  }
+  void SetBudget(uint64_t budget) {
+    budget_ = budget;
+  }
+
+  // Human readable usage, one line for the totals and one per block
+  std::string GetUsageReport() const;
+
+  // Validate every block and check the live allocations against them, for
+  // fuzzing
+  bool Validate() const;
+
+ private:
+  struct Allocation {
+    HeapRange range;
+    uint64_t alignment;
+    bool live;
+  };
+
+  uint32_t CreateBlock(uint64_t size);
+
+  uint64_t block_size_;
+  uint64_t budget_;
+  uint64_t reserved_size_{0};
+  std::vector<std::unique_ptr<TlsfAllocator>> blocks_;
+  std::vector<Allocation> allocations_;
+  std::vector<uint32_t> free_allocation_ids_;
+};
@@ -0,0 +1,127 @@
+#include "core/image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+struct FileCloser {
+  void operator()(FILE *file) const {
+    fclose(file);
+  }
+};
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+FilePtr OpenFile(const std::string &path, const char *mode) {
+  FilePtr file(fopen(path.c_str(), mode));
+  if (!file) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+  return file;
+}
+
+// Reads the next whitespace separated header integer, skipping comments
+uint32_t ReadPpmHeaderValue(FILE *file) {
+  int c = fgetc(file);
+  while (c != EOF) {
+    if (c == '#') {
+      while (c != EOF && c != '\n') {
+        c = fgetc(file);
+      }
+    } else if (!isspace(c)) {
+      break;
+    }
+    c = fgetc(file);
+  }
+  uint32_t value = 0;
+  bool any_digit = false;
+  while (c != EOF && isdigit(c)) {
+    value = value * 10 + static_cast<uint32_t>(c - '0');
+    any_digit = true;
+    c = fgetc(file);
+  }
+  if (!any_digit) {
+    throw std::runtime_error("Malformed PPM header");
+  }
+  return value;
+}
+}  // namespace
+
+uint32_t PackRGBA8(const float color[4]) {
+  uint32_t packed = 0;
+  for (int i = 0; i < 4; i++) {
+    const float clamped = std::min(std::max(color[i], 0.0f), 1.0f);
+    packed |= static_cast<uint32_t>(std::lround(clamped * 255.0f)) << (i * 8);
+  }
+  return packed;
+}
+
+void WritePpm(const std::string &path, const Image &image) {
+  FilePtr file = OpenFile(path, "wb");
+  fprintf(file.get(), "P6\n%u %u\n255\n", image.width, image.height);
+  std::vector<uint8_t> row(size_t(image.width) * 3);
+  for (uint32_t y = 0; y < image.height; y++) {
+    const uint32_t *pixels = image.Row(y);
+    for (uint32_t x = 0; x < image.width; x++) {
+      row[x * 3 + 0] = static_cast<uint8_t>(pixels[x]);
+      row[x * 3 + 1] = static_cast<uint8_t>(pixels[x] >> 8);
+      row[x * 3 + 2] = static_cast<uint8_t>(pixels[x] >> 16);
+    }
+    if (fwrite(row.data(), 1, row.size(), file.get()) != row.size()) {
+      throw std::runtime_error("Failed to write " + path);
+    }
+  }
+}
+
+Image ReadPpm(const std::string &path) {
+  FilePtr file = OpenFile(path, "rb");
+  if (fgetc(file.get()) != 'P' || fgetc(file.get()) != '6') {
+    throw std::runtime_error(path + " is not a binary PPM file");
+  }
+  const uint32_t width = ReadPpmHeaderValue(file.get());
+  const uint32_t height = ReadPpmHeaderValue(file.get());
+  if (ReadPpmHeaderValue(file.get()) != 255) {
+    throw std::runtime_error(path + " is not an 8 bit PPM file");
+  }
+
+  Image image(width, height);
+  std::vector<uint8_t> row(size_t(width) * 3);
+  for (uint32_t y = 0; y < height; y++) {
+    if (fread(row.data(), 1, row.size(), file.get()) != row.size()) {
+      throw std::runtime_error("Unexpected end of " + path);
+    }
+    uint32_t *pixels = image.Row(y);
+    for (uint32_t x = 0; x < width; x++) {
+      pixels[x] = row[x * 3 + 0] | (row[x * 3 + 1] << 8) |
+                  (row[x * 3 + 2] << 16) | 0xff000000u;
+    }
+  }
+  return image;
+}
+
+ImageDifference CompareImages(const Image &image,
+                              const Image &reference,
+                              uint32_t tolerance) {
+  if (image.width != reference.width || image.height != reference.height) {
+    throw std::runtime_error("Compared images differ in size");
+  }
+  ImageDifference difference;
+  for (size_t i = 0; i < image.pixels.size(); i++) {
+    uint32_t pixel_difference = 0;
+    for (int channel = 0; channel < 3; channel++) {
+      const int a = (image.pixels[i] >> (channel * 8)) & 0xff;
+      const int b = (reference.pixels[i] >> (channel * 8)) & 0xff;
+      pixel_difference =
+          std::max(pixel_difference, static_cast<uint32_t>(std::abs(a - b)));
+    }
+    if (pixel_difference > tolerance) {
+      difference.mismatched_pixels++;
+    }
+    difference.max_channel_difference =
+        std::max(difference.max_channel_difference, pixel_difference);
+  }
+  return difference;
+}
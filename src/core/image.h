@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// R8G8B8A8_UNORM image, one packed uint32_t per pixel with red in the lowest
+// byte so the memory layout matches DXGI_FORMAT_R8G8B8A8_UNORM
+struct Image {
+  uint32_t width{0};
+  uint32_t height{0};
+  std::vector<uint32_t> pixels;
+
+  Image() = default;
+  Image(uint32_t width, uint32_t height)
+      : width(width), height(height), pixels(size_t(width) * height) {
+  }
+
+  uint32_t *Row(uint32_t y) {
+    return pixels.data() + size_t(y) * width;
+  }
+  const uint32_t *Row(uint32_t y) const {
+    return pixels.data() + size_t(y) * width;
+  }
+};
+
+struct ImageDifference {
+  uint64_t mismatched_pixels{0};
+  // Largest per channel difference over all pixels
+  uint32_t max_channel_difference{0};
+};
+
+uint32_t PackRGBA8(const float color[4]);
+
+// Binary PPM (P6), alpha is dropped on write and set to opaque on read
+void WritePpm(const std::string &path, const Image &image);
+Image ReadPpm(const std::string &path);
+
+// Pixels count as mismatched when any RGB channel differs by more than the
+// tolerance. Images of different sizes throw.
+ImageDifference CompareImages(const Image &image,
+                              const Image &reference,
+                              uint32_t tolerance);
@@ -0,0 +1,174 @@
+#include "core/job_system.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Batches per thread in ParallelFor, enough slack to balance uneven indices
+const uint32_t kBatchesPerThread = 4;
+
+struct CurrentWorker {
+  const void *job_system;
+  uint32_t thread_index;
+};
+
+thread_local CurrentWorker current_worker = {nullptr, 0};
+}  // namespace
+
+JobSystem::JobSystem(uint32_t thread_count)
+    : thread_count_(std::max(thread_count, 1u)) {
+  for (uint32_t i = 0; i < thread_count_; i++) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (uint32_t i = 1; i < thread_count_; i++) {
+    threads_.emplace_back(&JobSystem::WorkerMain, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_condition_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void JobSystem::Schedule(JobCounter *counter, Job job) {
+  counter->pending.fetch_add(1, std::memory_order_relaxed);
+  Worker &worker = *workers_[GetCurrentThreadIndex()];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.jobs.push_back({std::move(job), counter});
+  }
+
+  // Sleepers check the queued count after announcing themselves, so either
+  // they see this job or this sees them
+  queued_jobs_.fetch_add(1);
+  if (sleeping_threads_.load() > 0) {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    wake_condition_.notify_one();
+  }
+}
+
+void JobSystem::Wait(JobCounter *counter) {
+  const uint32_t thread_index = GetCurrentThreadIndex();
+  while (counter->pending.load(std::memory_order_acquire) > 0) {
+    if (!RunOneJob(thread_index)) {
+      // The remaining jobs are running on other threads
+      std::this_thread::yield();
+    }
+  }
+  // Clear it before throwing so the counter can be reused
+  std::exception_ptr exception;
+  {
+    std::lock_guard<std::mutex> lock(counter->exception_mutex);
+    std::swap(exception, counter->exception);
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void JobSystem::ParallelFor(
+    uint32_t count,
+    const std::function<void(uint32_t, uint32_t)> &fn) {
+  if (count == 0) {
+    return;
+  }
+  if (thread_count_ == 1 || count == 1) {
+    const uint32_t thread_index = GetCurrentThreadIndex();
+    for (uint32_t i = 0; i < count; i++) {
+      fn(i, thread_index);
+    }
+    return;
+  }
+
+  const uint32_t batch_count =
+      std::min(count, thread_count_ * kBatchesPerThread);
+  JobCounter counter;
+  for (uint32_t batch = 0; batch < batch_count; batch++) {
+    const uint32_t begin = uint64_t(count) * batch / batch_count;
+    const uint32_t end = uint64_t(count) * (batch + 1) / batch_count;
+    Schedule(&counter, [&fn, begin, end](uint32_t thread_index) {
+      for (uint32_t i = begin; i < end; i++) {
+        fn(i, thread_index);
+      }
+    });
+  }
+  Wait(&counter);
+}
+
+JobSystemStats JobSystem::GetStats() const {
+  JobSystemStats stats;
+  stats.jobs_executed = jobs_executed_.load(std::memory_order_relaxed);
+  stats.jobs_stolen = jobs_stolen_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void JobSystem::WorkerMain(uint32_t thread_index) {
+  current_worker = {this, thread_index};
+  while (true) {
+    if (RunOneJob(thread_index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleeping_threads_.fetch_add(1);
+    wake_condition_.wait(
+        lock, [this] { return stopping_ || queued_jobs_.load() > 0; });
+    sleeping_threads_.fetch_sub(1);
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+bool JobSystem::RunOneJob(uint32_t thread_index) {
+  QueuedJob job;
+  bool found = false;
+  {
+    // Newest job of our own queue first, its data is most likely cached
+    Worker &worker = *workers_[thread_index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.jobs.empty()) {
+      job = std::move(worker.jobs.back());
+      worker.jobs.pop_back();
+      found = true;
+    }
+  }
+  for (uint32_t i = 1; !found && i < thread_count_; i++) {
+    // Oldest job of a victim, it tends to be the largest remaining piece
+    Worker &victim = *workers_[(thread_index + i) % thread_count_];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      found = true;
+      jobs_stolen_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  if (!found) {
+    return false;
+  }
+
+  queued_jobs_.fetch_sub(1);
+  try {
+    job.job(thread_index);
+  } catch (...) {
+    // Escaping would end a worker thread and leave the counter pending
+    std::lock_guard<std::mutex> lock(job.counter->exception_mutex);
+    if (!job.counter->exception) {
+      job.counter->exception = std::current_exception();
+    }
+  }
+  jobs_executed_.fetch_add(1, std::memory_order_relaxed);
+  job.counter->pending.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+uint32_t JobSystem::GetCurrentThreadIndex() const {
+  // Threads other than the workers act as the creating thread
+  return current_worker.job_system == this ? current_worker.thread_index : 0;
+}
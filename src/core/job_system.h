@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of unfinished jobs of a group, Wait returns once it drops to zero.
+// The first exception a job of the group throws is kept for Wait.
+struct JobCounter {
+  std::atomic<uint32_t> pending{0};
+  std::mutex exception_mutex;
+  std::exception_ptr exception;
+};
+
+struct JobSystemStats {
+  uint64_t jobs_executed{0};
+  // Jobs taken from the queue of another worker
+  uint64_t jobs_stolen{0};
+};
+
+// Work-stealing scheduler over a fixed set of worker threads. Every worker
+// pushes and pops its own queue at the back and steals from the front of the
+// others when it runs dry. The thread that creates the system participates as
+// worker 0 while it waits, so a system of one thread spawns nothing.
+// Schedule and Wait may only be called from that thread or from inside jobs.
+class JobSystem {
+ public:
+  using Job = std::function<void(uint32_t thread_index)>;
+
+  explicit JobSystem(uint32_t thread_count);
+  ~JobSystem();
+
+  uint32_t GetThreadCount() const {
+    return thread_count_;
+  }
+
+  // Queue a job on the calling worker, it runs with the index of the worker
+  // that ends up executing it
+  void Schedule(JobCounter *counter, Job job);
+
+  // Execute queued jobs on the calling thread until the counter reaches zero,
+  // then rethrow the first exception of its jobs. A job that throws still
+  // counts as finished and the other jobs of the group run to completion.
+  void Wait(JobCounter *counter);
+
+  // Run fn(index, thread_index) for every index in [0, count) and block until
+  // all of them returned. Indices are queued in contiguous batches.
+  void ParallelFor(uint32_t count,
+                   const std::function<void(uint32_t, uint32_t)> &fn);
+
+  JobSystemStats GetStats() const;
+
+ private:
+  struct QueuedJob {
+    Job job;
+    JobCounter *counter;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<QueuedJob> jobs;
+  };
+
+  void WorkerMain(uint32_t thread_index);
+  bool RunOneJob(uint32_t thread_index);
+  uint32_t GetCurrentThreadIndex() const;
+
+  uint32_t thread_count_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  std::atomic<uint32_t> queued_jobs_{0};
+  std::atomic<uint32_t> sleeping_threads_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_condition_;
+  bool stopping_{false};
+
+  std::atomic<uint64_t> jobs_executed_{0};
+  std::atomic<uint64_t> jobs_stolen_{0};
+};
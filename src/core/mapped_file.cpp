@@ -0,0 +1,90 @@
+#include "core/mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path) {
+  file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    file_ = nullptr;
+    throw std::runtime_error("Failed to open " + path);
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_, &size)) {
+    CloseHandle(file_);
+    throw std::runtime_error("Failed to get the size of " + path);
+  }
+  size_ = static_cast<uint64_t>(size.QuadPart);
+  if (size_ == 0) {
+    return;
+  }
+
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping_) {
+    CloseHandle(file_);
+    throw std::runtime_error("Failed to create a file mapping of " + path);
+  }
+  data_ = static_cast<const uint8_t *>(
+      MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (!data_) {
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    throw std::runtime_error("Failed to map " + path);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+  }
+  if (file_) {
+    CloseHandle(file_);
+  }
+}
+#else
+MappedFile::MappedFile(const std::string &path) {
+  const int file = open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+  struct stat file_stat;
+  if (fstat(file, &file_stat) != 0) {
+    close(file);
+    throw std::runtime_error("Failed to get the size of " + path);
+  }
+  size_ = static_cast<uint64_t>(file_stat.st_size);
+  if (size_ == 0) {
+    close(file);
+    return;
+  }
+
+  // The mapping keeps its own reference to the file
+  void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Failed to map " + path);
+  }
+  data_ = static_cast<const uint8_t *>(data);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+  }
+}
+#endif
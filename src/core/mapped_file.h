@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Read only memory mapping of a whole file. Pages are read in by the OS on
+// first access, so only the parts of the file that are used cost I/O.
+class MappedFile {
+ public:
+  // Throws when the file can not be opened or mapped
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Null for empty files
+  const uint8_t *GetData() const {
+    return data_;
+  }
+  uint64_t GetSize() const {
+    return size_;
+  }
+
+ private:
+  const uint8_t *data_{nullptr};
+  uint64_t size_{0};
+#ifdef _WIN32
+  void *file_{nullptr};
+  void *mapping_{nullptr};
+#endif
+};
@@ -0,0 +1,132 @@
+#include "core/mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+int16_t QuantizeSnorm16(float value) {
+  return static_cast<int16_t>(
+      std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint8_t QuantizeUnorm8(float value) {
+  return static_cast<uint8_t>(
+      std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+}  // namespace
+
+MeshView Mesh::GetView() const {
+  MeshView view;
+  view.vertices = vertices.data();
+  view.vertex_count = static_cast<uint32_t>(vertices.size());
+  view.indices = index_data.data();
+  view.index_count = static_cast<uint32_t>(index_data.size() / index_size);
+  view.index_size = index_size;
+  view.quantization = quantization;
+  view.lods = lods.data();
+  view.lod_count = static_cast<uint32_t>(lods.size());
+  view.meshlets = meshlets.data();
+  view.meshlet_count = static_cast<uint32_t>(meshlets.size());
+  return view;
+}
+
+Mesh BuildMesh(const std::vector<SourceVertex> &vertices,
+               const std::vector<uint32_t> &indices) {
+  if (vertices.empty()) {
+    throw std::runtime_error("Mesh has no vertices");
+  }
+
+  Mesh mesh;
+  glm::vec3 min_position = vertices[0].position;
+  glm::vec3 max_position = vertices[0].position;
+  for (const auto &vertex : vertices) {
+    min_position = glm::min(min_position, vertex.position);
+    max_position = glm::max(max_position, vertex.position);
+  }
+  mesh.quantization.bias = (min_position + max_position) * 0.5f;
+  mesh.quantization.scale = (max_position - min_position) * 0.5f;
+  for (int axis = 0; axis < 3; axis++) {
+    // Flat axes only hold the bias, any scale restores them exactly
+    if (mesh.quantization.scale[axis] == 0.0f) {
+      mesh.quantization.scale[axis] = 1.0f;
+    }
+  }
+
+  mesh.vertices.reserve(vertices.size());
+  for (const auto &vertex : vertices) {
+    const glm::vec3 normalized = (vertex.position - mesh.quantization.bias) /
+                                 mesh.quantization.scale;
+    mesh.vertices.push_back(
+        {{{QuantizeSnorm16(normalized.x), QuantizeSnorm16(normalized.y),
+           QuantizeSnorm16(normalized.z), 0}},
+         {{QuantizeUnorm8(vertex.color.x), QuantizeUnorm8(vertex.color.y),
+           QuantizeUnorm8(vertex.color.z), 255}}});
+  }
+
+  mesh.index_size = vertices.size() <= 0x10000 ? 2 : 4;
+  mesh.index_data.resize(indices.size() * mesh.index_size);
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (indices[i] >= vertices.size()) {
+      throw std::runtime_error("Mesh index is out of range");
+    }
+    if (mesh.index_size == 2) {
+      const uint16_t index = static_cast<uint16_t>(indices[i]);
+      memcpy(&mesh.index_data[i * 2], &index, sizeof(index));
+    } else {
+      memcpy(&mesh.index_data[i * 4], &indices[i], sizeof(indices[i]));
+    }
+  }
+  mesh.lods.push_back({0, static_cast<uint32_t>(indices.size()), 0, 0, 0.0f});
+  return mesh;
+}
+
+BoundingSphere ComputeBoundingSphere(const MeshView &mesh) {
+  BoundingSphere sphere = {mesh.quantization.bias, 0.0f};
+  for (uint32_t i = 0; i < mesh.vertex_count; i++) {
+    const glm::vec3 position =
+        DequantizePosition(mesh.vertices[i].position, mesh.quantization);
+    sphere.radius =
+        std::max(sphere.radius, glm::length(position - sphere.center));
+  }
+  return sphere;
+}
+
+uint32_t SelectLod(const MeshLod *lods,
+                   uint32_t lod_count,
+                   float pixels_per_unit,
+                   float max_error_pixels) {
+  uint32_t lod = 0;
+  while (lod + 1 < lod_count &&
+         lods[lod + 1].error * pixels_per_unit <= max_error_pixels) {
+    lod++;
+  }
+  return lod;
+}
+
+bool IsMeshletBackfacing(const Meshlet &meshlet,
+                         const glm::vec3 &view_direction) {
+  if (meshlet.cone_cutoff <= 0.0f) {
+    return false;
+  }
+  // Every normal is within acos(cutoff) of the axis, so all of them face away
+  // once the view is within 90 degrees less that of the axis
+  const float sine =
+      std::sqrt(1.0f - meshlet.cone_cutoff * meshlet.cone_cutoff);
+  return glm::dot(view_direction, meshlet.cone_axis) > sine;
+}
+
+glm::vec3 DequantizePosition(const Snorm16x4 &position,
+                             const PositionQuantization &quantization) {
+  // -32768 and -32767 both read as -1
+  const glm::vec3 normalized =
+      glm::max(glm::vec3(position.v[0], position.v[1], position.v[2]) /
+                   32767.0f,
+               glm::vec3(-1.0f));
+  return normalized * quantization.scale + quantization.bias;
+}
+
+glm::vec4 DequantizeColor(const Unorm8x4 &color) {
+  return glm::vec4(color.v[0], color.v[1], color.v[2], color.v[3]) / 255.0f;
+}
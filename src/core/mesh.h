@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "core/vertex.h"
+#include "glm/glm.hpp"
+
+// Full precision vertex as produced by tools and generators
+struct SourceVertex {
+  glm::vec3 position;
+  glm::vec3 color;
+};
+
+// Restores quantized positions as snorm * scale + bias, the bias is the
+// center of the mesh bounds and the scale their half extent
+struct PositionQuantization {
+  glm::vec3 scale{1.0f};
+  glm::vec3 bias{0.0f};
+};
+
+struct BoundingSphere {
+  glm::vec3 center;
+  float radius;
+};
+
+// Level of detail of a mesh, a range of its index buffer drawn with the
+// shared vertex buffer. Level 0 is the full detail mesh.
+struct MeshLod {
+  uint32_t first_index;
+  uint32_t index_count;
+  uint32_t first_meshlet;
+  uint32_t meshlet_count;
+  // Farthest any vertex moved from its full detail position, in mesh units
+  float error;
+};
+
+// Cluster of a LOD's triangles sharing few vertices, the indices of a LOD are
+// laid out meshlet after meshlet. The cone holds the normals of the cluster,
+// front facing normals being cross(p1 - p0, p2 - p0) with the clockwise
+// winding of the sample.
+struct Meshlet {
+  uint32_t first_index;
+  uint32_t index_count;
+  uint32_t vertex_count;
+  glm::vec3 center;
+  float radius;
+  glm::vec3 cone_axis;
+  // Cosine of the largest angle between the axis and a normal, 0 or less when
+  // the normals spread too far for the cone to cull anything
+  float cone_cutoff;
+};
+
+// Non-owning view of a quantized mesh, either in memory or in a mapped file
+struct MeshView {
+  const Vertex *vertices{nullptr};
+  uint32_t vertex_count{0};
+  const void *indices{nullptr};
+  uint32_t index_count{0};
+  // 2 or 4 bytes
+  uint32_t index_size{2};
+  PositionQuantization quantization;
+  // At least one, ordered from full to least detail
+  const MeshLod *lods{nullptr};
+  uint32_t lod_count{0};
+  const Meshlet *meshlets{nullptr};
+  uint32_t meshlet_count{0};
+};
+
+// Quantized mesh owning its data. Indices are 16 bit when every vertex can be
+// addressed with them and 32 bit otherwise.
+struct Mesh {
+  std::vector<Vertex> vertices;
+  std::vector<uint8_t> index_data;
+  uint32_t index_size{2};
+  PositionQuantization quantization;
+  std::vector<MeshLod> lods;
+  std::vector<Meshlet> meshlets;
+
+  MeshView GetView() const;
+};
+
+// Quantize triangle list geometry against its own bounds, as a single LOD
+// without meshlets
+Mesh BuildMesh(const std::vector<SourceVertex> &vertices,
+               const std::vector<uint32_t> &indices);
+
+// Sphere around the dequantized positions, centered on the mesh bounds
+BoundingSphere ComputeBoundingSphere(const MeshView &mesh);
+
+// Coarsest LOD whose error covers at most max_error_pixels on screen when a
+// mesh unit covers pixels_per_unit pixels
+uint32_t SelectLod(const MeshLod *lods,
+                   uint32_t lod_count,
+                   float pixels_per_unit,
+                   float max_error_pixels);
+
+// Whether every triangle of the meshlet faces away from an orthographic view
+// looking along the direction
+bool IsMeshletBackfacing(const Meshlet &meshlet,
+                         const glm::vec3 &view_direction);
+
+// Same conversions as the input assembler does for SNORM and UNORM formats
+glm::vec3 DequantizePosition(const Snorm16x4 &position,
+                             const PositionQuantization &quantization);
+glm::vec4 DequantizeColor(const Unorm8x4 &color);
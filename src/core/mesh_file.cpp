@@ -0,0 +1,133 @@
+#include "core/mesh_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Whether [offset, offset + size) lies within the file, without overflowing
+bool IsInFile(uint64_t offset, uint64_t size, uint64_t file_size) {
+  return offset <= file_size && size <= file_size - offset;
+}
+}  // namespace
+
+MeshFile::MeshFile(const std::string &path) : file_(path) {
+  MeshFileHeader header;
+  if (file_.GetSize() < sizeof(header)) {
+    throw std::runtime_error(path + " is too small for a mesh file");
+  }
+  memcpy(&header, file_.GetData(), sizeof(header));
+  if (header.magic != MeshFileHeader::kMagic) {
+    throw std::runtime_error(path + " is not a mesh file");
+  }
+  if (header.version != MeshFileHeader::kVersion ||
+      header.vertex_stride != sizeof(Vertex)) {
+    throw std::runtime_error(path + " has an unsupported mesh file version");
+  }
+  if (header.index_size != 2 && header.index_size != 4) {
+    throw std::runtime_error(path + " has an invalid index size");
+  }
+  if (header.vertex_offset % kMeshFileAlignment != 0 ||
+      header.index_offset % kMeshFileAlignment != 0 ||
+      !IsInFile(header.vertex_offset,
+                uint64_t(header.vertex_count) * header.vertex_stride,
+                file_.GetSize()) ||
+      !IsInFile(header.index_offset,
+                uint64_t(header.index_count) * header.index_size,
+                file_.GetSize()) ||
+      header.lod_offset % kMeshFileAlignment != 0 ||
+      header.meshlet_offset % kMeshFileAlignment != 0 ||
+      !IsInFile(header.lod_offset,
+                uint64_t(header.lod_count) * sizeof(MeshLod),
+                file_.GetSize()) ||
+      !IsInFile(header.meshlet_offset,
+                uint64_t(header.meshlet_count) * sizeof(Meshlet),
+                file_.GetSize())) {
+    throw std::runtime_error(path + " has sections outside of the file");
+  }
+  const MeshLod *lods =
+      reinterpret_cast<const MeshLod *>(file_.GetData() + header.lod_offset);
+  if (header.lod_count == 0) {
+    throw std::runtime_error(path + " has no LODs");
+  }
+  for (uint32_t lod = 0; lod < header.lod_count; lod++) {
+    if (uint64_t(lods[lod].first_index) + lods[lod].index_count >
+            header.index_count ||
+        uint64_t(lods[lod].first_meshlet) + lods[lod].meshlet_count >
+            header.meshlet_count) {
+      throw std::runtime_error(path + " has LODs outside of its indices");
+    }
+  }
+
+  view_.vertices =
+      reinterpret_cast<const Vertex *>(file_.GetData() + header.vertex_offset);
+  view_.vertex_count = header.vertex_count;
+  view_.indices = file_.GetData() + header.index_offset;
+  view_.index_count = header.index_count;
+  view_.index_size = header.index_size;
+  view_.quantization.scale =
+      glm::vec3(header.position_scale[0], header.position_scale[1],
+                header.position_scale[2]);
+  view_.quantization.bias =
+      glm::vec3(header.position_bias[0], header.position_bias[1],
+                header.position_bias[2]);
+  view_.lods = lods;
+  view_.lod_count = header.lod_count;
+  view_.meshlets = reinterpret_cast<const Meshlet *>(file_.GetData() +
+                                                     header.meshlet_offset);
+  view_.meshlet_count = header.meshlet_count;
+}
+
+void WriteMeshFile(const std::string &path, const MeshView &mesh) {
+  const uint64_t vertex_size = uint64_t(mesh.vertex_count) * sizeof(Vertex);
+  const uint64_t index_size = uint64_t(mesh.index_count) * mesh.index_size;
+  const uint64_t lod_size = uint64_t(mesh.lod_count) * sizeof(MeshLod);
+  const uint64_t meshlet_size = uint64_t(mesh.meshlet_count) * sizeof(Meshlet);
+
+  MeshFileHeader header = {};
+  header.magic = MeshFileHeader::kMagic;
+  header.version = MeshFileHeader::kVersion;
+  header.vertex_count = mesh.vertex_count;
+  header.vertex_stride = sizeof(Vertex);
+  header.index_count = mesh.index_count;
+  header.index_size = mesh.index_size;
+  for (int axis = 0; axis < 3; axis++) {
+    header.position_scale[axis] = mesh.quantization.scale[axis];
+    header.position_bias[axis] = mesh.quantization.bias[axis];
+  }
+  header.vertex_offset = AlignUp(sizeof(header), kMeshFileAlignment);
+  header.index_offset =
+      AlignUp(header.vertex_offset + vertex_size, kMeshFileAlignment);
+  header.lod_count = mesh.lod_count;
+  header.meshlet_count = mesh.meshlet_count;
+  header.lod_offset =
+      AlignUp(header.index_offset + index_size, kMeshFileAlignment);
+  header.meshlet_offset =
+      AlignUp(header.lod_offset + lod_size, kMeshFileAlignment);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error("Failed to create " + path);
+  }
+  const std::vector<char> padding(kMeshFileAlignment, 0);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(padding.data(), header.vertex_offset - sizeof(header));
+  file.write(reinterpret_cast<const char *>(mesh.vertices), vertex_size);
+  file.write(padding.data(),
+             header.index_offset - header.vertex_offset - vertex_size);
+  file.write(static_cast<const char *>(mesh.indices), index_size);
+  file.write(padding.data(),
+             header.lod_offset - header.index_offset - index_size);
+  file.write(reinterpret_cast<const char *>(mesh.lods), lod_size);
+  file.write(padding.data(),
+             header.meshlet_offset - header.lod_offset - lod_size);
+  file.write(reinterpret_cast<const char *>(mesh.meshlets), meshlet_size);
+  if (!file) {
+    throw std::runtime_error("Failed to write " + path);
+  }
+}
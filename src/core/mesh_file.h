@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "core/mapped_file.h"
+#include "core/mesh.h"
+
+// Binary mesh file laid out to be used in place from a memory mapping: this
+// header, then the vertices and the indices exactly as the GPU reads them,
+// then the LOD and meshlet tables, each section aligned to
+// kMeshFileAlignment
+struct MeshFileHeader {
+  static const uint32_t kMagic = 0x4853454d;  // "MESH"
+  static const uint32_t kVersion = 2;
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vertex_count;
+  // sizeof(Vertex) of the writer, files of other vertex formats are rejected
+  uint32_t vertex_stride;
+  uint32_t index_count;
+  uint32_t index_size;
+  float position_scale[3];
+  float position_bias[3];
+  uint64_t vertex_offset;
+  uint64_t index_offset;
+  uint32_t lod_count;
+  uint32_t meshlet_count;
+  uint64_t lod_offset;
+  uint64_t meshlet_offset;
+};
+
+const uint64_t kMeshFileAlignment = 64;
+
+// Mesh file opened for reading. Nothing is parsed or copied, the view points
+// into the mapping, so uploads read straight from the page cache.
+class MeshFile {
+ public:
+  // Throws when the file is not a valid mesh file
+  explicit MeshFile(const std::string &path);
+
+  // Valid as long as the file is open
+  const MeshView &GetView() const {
+    return view_;
+  }
+  uint64_t GetFileSize() const {
+    return file_.GetSize();
+  }
+
+ private:
+  MappedFile file_;
+  MeshView view_;
+};
+
+void WriteMeshFile(const std::string &path, const MeshView &mesh);
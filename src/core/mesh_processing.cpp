@@ -0,0 +1,521 @@
+#include "core/mesh_processing.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace {
+// Cells per axis of the finest clustering grid, one per quantization step
+const uint32_t kMaxGridResolution = 1 << 16;
+// A LOD has to drop at least this fraction of the triangles before it
+const float kMinLodSavings = 1.0f / 6.0f;
+
+std::vector<uint32_t> ReadIndices(const MeshView &mesh,
+                                  uint32_t first_index,
+                                  uint32_t index_count) {
+  std::vector<uint32_t> indices(index_count);
+  const uint8_t *data = static_cast<const uint8_t *>(mesh.indices);
+  for (uint32_t i = 0; i < index_count; i++) {
+    if (mesh.index_size == 2) {
+      uint16_t index;
+      memcpy(&index, data + (first_index + i) * 2, sizeof(index));
+      indices[i] = index;
+    } else {
+      memcpy(&indices[i], data + (first_index + i) * 4, sizeof(indices[i]));
+    }
+  }
+  return indices;
+}
+
+void AppendIndices(const std::vector<uint32_t> &indices, Mesh *mesh) {
+  const size_t offset = mesh->index_data.size();
+  mesh->index_data.resize(offset + indices.size() * mesh->index_size);
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (mesh->index_size == 2) {
+      const uint16_t index = static_cast<uint16_t>(indices[i]);
+      memcpy(&mesh->index_data[offset + i * 2], &index, sizeof(index));
+    } else {
+      memcpy(&mesh->index_data[offset + i * 4], &indices[i],
+             sizeof(indices[i]));
+    }
+  }
+}
+
+struct LodIndices {
+  std::vector<uint32_t> indices;
+  float error;
+};
+
+// Cell of a quantized position in a grid of resolution cells per axis, the
+// three cell coordinates packed into one key
+uint64_t GetCellKey(const Snorm16x4 &position, uint32_t resolution) {
+  uint64_t key = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    const uint64_t normalized = uint64_t(int64_t(position.v[axis]) + 32768);
+    key = key << 17 | (normalized * resolution) >> 16;
+  }
+  return key;
+}
+
+uint32_t CountClusteredTriangles(const std::vector<uint32_t> &indices,
+                                 const std::vector<uint64_t> &cell_keys) {
+  uint32_t count = 0;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const uint64_t a = cell_keys[indices[i]];
+    const uint64_t b = cell_keys[indices[i + 1]];
+    const uint64_t c = cell_keys[indices[i + 2]];
+    count += a != b && b != c && a != c;
+  }
+  return count;
+}
+
+void ComputeCellKeys(const MeshView &mesh,
+                     const std::vector<uint32_t> &vertices,
+                     uint32_t resolution,
+                     std::vector<uint64_t> *cell_keys) {
+  for (uint32_t v : vertices) {
+    (*cell_keys)[v] = GetCellKey(mesh.vertices[v].position, resolution);
+  }
+}
+
+// Vertices the triangles reference, each once
+std::vector<uint32_t> GetUsedVertices(const std::vector<uint32_t> &indices,
+                                      std::vector<bool> *used) {
+  std::vector<uint32_t> vertices;
+  used->assign(used->size(), false);
+  for (uint32_t v : indices) {
+    if (!(*used)[v]) {
+      (*used)[v] = true;
+      vertices.push_back(v);
+    }
+  }
+  return vertices;
+}
+
+// Merge the vertices of every cell into the one closest to their center,
+// recorded in the remap table, and return the triangles that neither
+// collapse nor duplicate others
+std::vector<uint32_t> ClusterVertices(const std::vector<glm::vec3> &positions,
+                                      std::vector<uint32_t> vertices,
+                                      const std::vector<uint32_t> &indices,
+                                      const std::vector<uint64_t> &cell_keys,
+                                      std::vector<uint32_t> *remap) {
+  std::sort(vertices.begin(), vertices.end(), [&](uint32_t a, uint32_t b) {
+    return cell_keys[a] < cell_keys[b];
+  });
+  for (size_t begin = 0; begin < vertices.size();) {
+    size_t end = begin + 1;
+    glm::vec3 center = positions[vertices[begin]];
+    while (end < vertices.size() &&
+           cell_keys[vertices[end]] == cell_keys[vertices[begin]]) {
+      center = center + positions[vertices[end]];
+      end++;
+    }
+    center = center / static_cast<float>(end - begin);
+
+    uint32_t representative = vertices[begin];
+    float nearest = std::numeric_limits<float>::max();
+    for (size_t i = begin; i < end; i++) {
+      const float distance = glm::length(positions[vertices[i]] - center);
+      if (distance < nearest) {
+        nearest = distance;
+        representative = vertices[i];
+      }
+    }
+    for (size_t i = begin; i < end; i++) {
+      (*remap)[vertices[i]] = representative;
+    }
+    begin = end;
+  }
+
+  // Rotating the smallest index first keeps the winding and makes duplicates
+  // compare equal
+  std::vector<std::array<uint32_t, 3>> triangles;
+  triangles.reserve(indices.size() / 3);
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    std::array<uint32_t, 3> triangle = {(*remap)[indices[i]],
+                                        (*remap)[indices[i + 1]],
+                                        (*remap)[indices[i + 2]]};
+    if (triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+        triangle[0] == triangle[2]) {
+      continue;
+    }
+    std::rotate(triangle.begin(),
+                std::min_element(triangle.begin(), triangle.end()),
+                triangle.end());
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  triangles.erase(std::unique(triangles.begin(), triangles.end()),
+                  triangles.end());
+
+  std::vector<uint32_t> clustered;
+  clustered.reserve(triangles.size() * 3);
+  for (const auto &triangle : triangles) {
+    clustered.insert(clustered.end(), triangle.begin(), triangle.end());
+  }
+  return clustered;
+}
+
+// Finest grid whose clustering keeps at most target triangles, the count
+// mostly falls with the resolution so a binary search finds it
+uint32_t FindGridResolution(const MeshView &mesh,
+                            const std::vector<uint32_t> &vertices,
+                            const std::vector<uint32_t> &indices,
+                            uint32_t target,
+                            uint32_t max_resolution,
+                            std::vector<uint64_t> *cell_keys) {
+  uint32_t low = 1;
+  uint32_t high = max_resolution;
+  while (low < high) {
+    const uint32_t resolution = low + (high - low + 1) / 2;
+    ComputeCellKeys(mesh, vertices, resolution, cell_keys);
+    if (CountClusteredTriangles(indices, *cell_keys) <= target) {
+      low = resolution;
+    } else {
+      high = resolution - 1;
+    }
+  }
+  return low;
+}
+
+uint32_t NextFanningVertex(const std::vector<uint32_t> &candidates,
+                           const std::vector<uint32_t> &live_triangles,
+                           const std::vector<uint32_t> &cache_times,
+                           uint32_t time,
+                           uint32_t cache_size,
+                           std::vector<uint32_t> *dead_ends,
+                           uint32_t *cursor) {
+  // Prefer the candidate that entered the cache earliest among those whose
+  // remaining triangles still find it there
+  uint32_t best = UINT32_MAX;
+  int64_t best_priority = -1;
+  for (uint32_t v : candidates) {
+    if (live_triangles[v] == 0) {
+      continue;
+    }
+    int64_t priority = 0;
+    const int64_t age = int64_t(time) - cache_times[v];
+    if (age + 2 * int64_t(live_triangles[v]) <= int64_t(cache_size)) {
+      priority = age;
+    }
+    if (priority > best_priority) {
+      best_priority = priority;
+      best = v;
+    }
+  }
+  if (best != UINT32_MAX) {
+    return best;
+  }
+
+  // Dead end, continue with a recently used vertex or any left
+  while (!dead_ends->empty()) {
+    const uint32_t v = dead_ends->back();
+    dead_ends->pop_back();
+    if (live_triangles[v] > 0) {
+      return v;
+    }
+  }
+  while (*cursor < live_triangles.size()) {
+    if (live_triangles[*cursor] > 0) {
+      return *cursor;
+    }
+    (*cursor)++;
+  }
+  return UINT32_MAX;
+}
+
+Meshlet FinishMeshlet(const std::vector<uint32_t> &indices,
+                      const std::vector<glm::vec3> &positions,
+                      uint32_t first_index,
+                      uint32_t index_count,
+                      uint32_t vertex_count) {
+  Meshlet meshlet = {};
+  meshlet.first_index = first_index;
+  meshlet.index_count = index_count;
+  meshlet.vertex_count = vertex_count;
+
+  glm::vec3 min_position = positions[indices[first_index]];
+  glm::vec3 max_position = min_position;
+  for (uint32_t i = first_index; i < first_index + index_count; i++) {
+    min_position = glm::min(min_position, positions[indices[i]]);
+    max_position = glm::max(max_position, positions[indices[i]]);
+  }
+  meshlet.center = (min_position + max_position) * 0.5f;
+  meshlet.radius = 0.0f;
+  for (uint32_t i = first_index; i < first_index + index_count; i++) {
+    meshlet.radius = std::max(
+        meshlet.radius, glm::length(positions[indices[i]] - meshlet.center));
+  }
+
+  // The cone is around the average normal, degenerate triangles face nowhere
+  const auto get_normal = [&](uint32_t i) {
+    const glm::vec3 &p0 = positions[indices[i]];
+    const glm::vec3 normal = glm::cross(positions[indices[i + 1]] - p0,
+                                        positions[indices[i + 2]] - p0);
+    const float length = glm::length(normal);
+    return length > 0.0f ? normal / length : glm::vec3(0.0f);
+  };
+  glm::vec3 normal_sum(0.0f);
+  for (uint32_t i = first_index; i < first_index + index_count; i += 3) {
+    normal_sum = normal_sum + get_normal(i);
+  }
+  const float sum_length = glm::length(normal_sum);
+  if (sum_length == 0.0f) {
+    meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.cone_cutoff = -1.0f;
+    return meshlet;
+  }
+  meshlet.cone_axis = normal_sum / sum_length;
+  meshlet.cone_cutoff = 1.0f;
+  for (uint32_t i = first_index; i < first_index + index_count; i += 3) {
+    const glm::vec3 normal = get_normal(i);
+    if (glm::dot(normal, normal) > 0.0f) {
+      meshlet.cone_cutoff =
+          std::min(meshlet.cone_cutoff, glm::dot(normal, meshlet.cone_axis));
+    }
+  }
+  return meshlet;
+}
+
+// Split the triangles in their order into meshlets within the limits, their
+// index ranges start at the first of the indices
+void BuildMeshlets(const std::vector<uint32_t> &indices,
+                   const std::vector<glm::vec3> &positions,
+                   const MeshProcessingSettings &settings,
+                   std::vector<Meshlet> *meshlets) {
+  // Vertices already in the current meshlet carry its stamp
+  std::vector<uint32_t> stamps(positions.size(), UINT32_MAX);
+  uint32_t stamp = 0;
+  uint32_t first_index = 0;
+  uint32_t vertex_count = 0;
+  for (uint32_t i = 0; i < indices.size(); i += 3) {
+    uint32_t new_vertices = 0;
+    for (uint32_t j = 0; j < 3; j++) {
+      new_vertices += stamps[indices[i + j]] != stamp;
+    }
+    if (vertex_count + new_vertices > settings.max_meshlet_vertices ||
+        (i - first_index) / 3 + 1 > settings.max_meshlet_triangles) {
+      meshlets->push_back(FinishMeshlet(indices, positions, first_index,
+                                        i - first_index, vertex_count));
+      stamp++;
+      first_index = i;
+      vertex_count = 0;
+    }
+    for (uint32_t j = 0; j < 3; j++) {
+      if (stamps[indices[i + j]] != stamp) {
+        stamps[indices[i + j]] = stamp;
+        vertex_count++;
+      }
+    }
+  }
+  if (first_index < indices.size()) {
+    meshlets->push_back(
+        FinishMeshlet(indices, positions, first_index,
+                      static_cast<uint32_t>(indices.size()) - first_index,
+                      vertex_count));
+  }
+}
+}  // namespace
+
+void OptimizeVertexCache(uint32_t *indices,
+                         uint32_t index_count,
+                         uint32_t vertex_count,
+                         uint32_t cache_size) {
+  const uint32_t triangle_count = index_count / 3;
+  // Triangles of vertex v are adjacency[offsets[v]] up to the next offset
+  std::vector<uint32_t> offsets(vertex_count + 1, 0);
+  for (uint32_t i = 0; i < triangle_count * 3; i++) {
+    offsets[indices[i] + 1]++;
+  }
+  std::vector<uint32_t> live_triangles(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; v++) {
+    live_triangles[v] = offsets[v + 1];
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<uint32_t> adjacency(triangle_count * 3);
+  std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+  for (uint32_t i = 0; i < triangle_count * 3; i++) {
+    adjacency[fill[indices[i]]++] = i / 3;
+  }
+
+  std::vector<uint32_t> output;
+  output.reserve(triangle_count * 3);
+  std::vector<uint32_t> cache_times(vertex_count, 0);
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<uint32_t> dead_ends;
+  std::vector<uint32_t> candidates;
+  uint32_t time = cache_size + 1;
+  uint32_t cursor = 0;
+  uint32_t fanning = NextFanningVertex({}, live_triangles, cache_times, time,
+                                       cache_size, &dead_ends, &cursor);
+  while (fanning != UINT32_MAX) {
+    candidates.clear();
+    for (uint32_t k = offsets[fanning]; k < offsets[fanning + 1]; k++) {
+      const uint32_t triangle = adjacency[k];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (uint32_t j = 0; j < 3; j++) {
+        const uint32_t v = indices[triangle * 3 + j];
+        output.push_back(v);
+        dead_ends.push_back(v);
+        candidates.push_back(v);
+        live_triangles[v]--;
+        if (time - cache_times[v] > cache_size) {
+          cache_times[v] = time;
+          time++;
+        }
+      }
+    }
+    fanning = NextFanningVertex(candidates, live_triangles, cache_times, time,
+                                cache_size, &dead_ends, &cursor);
+  }
+  std::copy(output.begin(), output.end(), indices);
+}
+
+float ComputeAcmr(const uint32_t *indices,
+                  uint32_t index_count,
+                  uint32_t vertex_count,
+                  uint32_t cache_size) {
+  if (index_count < 3) {
+    return 0.0f;
+  }
+  // A vertex is cached while fewer than cache_size misses followed its own
+  std::vector<uint64_t> inserted_at(vertex_count, 0);
+  uint64_t misses = 0;
+  for (uint32_t i = 0; i < index_count; i++) {
+    const uint32_t v = indices[i];
+    if (inserted_at[v] == 0 || misses - inserted_at[v] >= cache_size) {
+      misses++;
+      inserted_at[v] = misses;
+    }
+  }
+  return static_cast<float>(misses) / static_cast<float>(index_count / 3);
+}
+
+Mesh ProcessMesh(const MeshView &mesh,
+                 const MeshProcessingSettings &settings,
+                 MeshProcessingStats *stats) {
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<glm::vec3> positions(mesh.vertex_count);
+  for (uint32_t v = 0; v < mesh.vertex_count; v++) {
+    positions[v] =
+        DequantizePosition(mesh.vertices[v].position, mesh.quantization);
+  }
+  const uint32_t first_index =
+      mesh.lod_count > 0 ? mesh.lods[0].first_index : 0;
+  const uint32_t index_count =
+      mesh.lod_count > 0 ? mesh.lods[0].index_count : mesh.index_count;
+  const std::vector<uint32_t> source_indices =
+      ReadIndices(mesh, first_index, index_count - index_count % 3);
+
+  // Each LOD clusters the vertices of the one before, which keeps the cost
+  // of the chain near twice that of its first LOD. The full detail vertices
+  // are tracked to the vertices standing in for them, so errors are measured
+  // against the full detail positions.
+  std::vector<LodIndices> lods;
+  lods.push_back({source_indices, 0.0f});
+  std::vector<uint64_t> cell_keys(mesh.vertex_count);
+  std::vector<uint32_t> remap(mesh.vertex_count);
+  std::vector<uint32_t> full_detail_remap(mesh.vertex_count);
+  for (uint32_t v = 0; v < mesh.vertex_count; v++) {
+    full_detail_remap[v] = v;
+  }
+  std::vector<bool> used(mesh.vertex_count);
+  uint32_t resolution = kMaxGridResolution;
+  while (lods.size() < settings.max_lods) {
+    const uint32_t triangles =
+        static_cast<uint32_t>(lods.back().indices.size() / 3);
+    const uint32_t target =
+        static_cast<uint32_t>(static_cast<float>(triangles) *
+                              settings.lod_reduction);
+    if (target < settings.min_lod_triangles) {
+      break;
+    }
+    const std::vector<uint32_t> &previous = lods.back().indices;
+    const std::vector<uint32_t> vertices = GetUsedVertices(previous, &used);
+    resolution = FindGridResolution(mesh, vertices, previous, target,
+                                    resolution, &cell_keys);
+    ComputeCellKeys(mesh, vertices, resolution, &cell_keys);
+    LodIndices lod = {
+        ClusterVertices(positions, vertices, previous, cell_keys, &remap),
+        lods.back().error};
+    const uint32_t lod_triangles =
+        static_cast<uint32_t>(lod.indices.size() / 3);
+    if (lod_triangles < settings.min_lod_triangles ||
+        lod_triangles > triangles * (1.0f - kMinLodSavings)) {
+      break;
+    }
+    for (uint32_t v = 0; v < mesh.vertex_count; v++) {
+      // Vertices whose triangles all collapsed earlier keep their stand-in
+      if (used[full_detail_remap[v]]) {
+        full_detail_remap[v] = remap[full_detail_remap[v]];
+      }
+      lod.error =
+          std::max(lod.error, glm::length(positions[v] -
+                                          positions[full_detail_remap[v]]));
+    }
+    lods.push_back(std::move(lod));
+  }
+
+  Mesh result;
+  result.vertices.assign(mesh.vertices, mesh.vertices + mesh.vertex_count);
+  result.index_size = mesh.index_size;
+  result.quantization = mesh.quantization;
+  uint32_t total_indices = 0;
+  for (LodIndices &lod : lods) {
+    OptimizeVertexCache(lod.indices.data(),
+                        static_cast<uint32_t>(lod.indices.size()),
+                        mesh.vertex_count, settings.cache_size);
+    const uint32_t first_meshlet =
+        static_cast<uint32_t>(result.meshlets.size());
+    BuildMeshlets(lod.indices, positions, settings, &result.meshlets);
+    for (size_t m = first_meshlet; m < result.meshlets.size(); m++) {
+      result.meshlets[m].first_index += total_indices;
+    }
+    result.lods.push_back(
+        {total_indices, static_cast<uint32_t>(lod.indices.size()),
+         first_meshlet,
+         static_cast<uint32_t>(result.meshlets.size()) - first_meshlet,
+         lod.error});
+    AppendIndices(lod.indices, &result);
+    total_indices += static_cast<uint32_t>(lod.indices.size());
+  }
+
+  if (stats) {
+    stats->triangles = static_cast<uint32_t>(source_indices.size() / 3);
+    stats->lod_triangles = total_indices / 3;
+    stats->lods = static_cast<uint32_t>(result.lods.size());
+    stats->meshlets = static_cast<uint32_t>(result.meshlets.size());
+    stats->acmr_before = ComputeAcmr(
+        source_indices.data(), static_cast<uint32_t>(source_indices.size()),
+        mesh.vertex_count, settings.cache_size);
+    stats->acmr_after = ComputeAcmr(
+        lods[0].indices.data(), static_cast<uint32_t>(lods[0].indices.size()),
+        mesh.vertex_count, settings.cache_size);
+    stats->time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+  return result;
+}
+
+std::vector<Mesh> ProcessMeshes(JobSystem *job_system,
+                                const std::vector<MeshView> &meshes,
+                                const MeshProcessingSettings &settings,
+                                std::vector<MeshProcessingStats> *stats) {
+  std::vector<Mesh> results(meshes.size());
+  if (stats) {
+    stats->assign(meshes.size(), {});
+  }
+  job_system->ParallelFor(
+      static_cast<uint32_t>(meshes.size()), [&](uint32_t index, uint32_t) {
+        results[index] = ProcessMesh(meshes[index], settings,
+                                     stats ? &(*stats)[index] : nullptr);
+      });
+  return results;
+}
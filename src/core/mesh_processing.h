@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "core/job_system.h"
+#include "core/mesh.h"
+
+struct MeshProcessingSettings {
+  // Levels including the full detail one
+  uint32_t max_lods{8};
+  // Each LOD aims for this fraction of the triangles of the one before
+  float lod_reduction{0.5f};
+  // The chain ends before a LOD with fewer triangles than this, or one that
+  // saves less than a sixth of the triangles of the one before
+  uint32_t min_lod_triangles{32};
+  // Entries of the post-transform cache the triangle order is optimized for
+  uint32_t cache_size{16};
+  // Meshlets small enough for mesh shaders to process one per group
+  uint32_t max_meshlet_vertices{64};
+  uint32_t max_meshlet_triangles{124};
+};
+
+struct MeshProcessingStats {
+  uint32_t triangles{0};
+  // Triangles of every LOD, the full detail one included
+  uint32_t lod_triangles{0};
+  uint32_t lods{0};
+  uint32_t meshlets{0};
+  // Vertices transformed per triangle of the full detail LOD by a FIFO cache
+  // of cache_size entries, in the input order and the optimized one
+  float acmr_before{0.0f};
+  float acmr_after{0.0f};
+  uint64_t time_ns{0};
+};
+
+// Reorder the triangles in place so that consecutive ones reuse the vertices
+// the post-transform cache still holds, with the Tipsify fan walk. Runs in
+// linear time, which keeps it usable when meshes load.
+void OptimizeVertexCache(uint32_t *indices,
+                         uint32_t index_count,
+                         uint32_t vertex_count,
+                         uint32_t cache_size);
+
+// Average cache misses per triangle of a FIFO post-transform cache, 0.5 at
+// best for large regular meshes and 3 at worst
+float ComputeAcmr(const uint32_t *indices,
+                  uint32_t index_count,
+                  uint32_t vertex_count,
+                  uint32_t cache_size);
+
+// Build the LOD chain of a mesh and optimize it for drawing. Coarser LODs
+// cluster vertices on a grid, as fine as still reaches the triangle target,
+// and keep the vertex closest to the center of every cell, so every LOD
+// indexes the vertices of the input. The triangles of each LOD are ordered
+// for the vertex cache and split into meshlets with bounds and normal cones.
+// LODs already in the input are replaced, its first one is the full detail.
+Mesh ProcessMesh(const MeshView &mesh,
+                 const MeshProcessingSettings &settings = {},
+                 MeshProcessingStats *stats = nullptr);
+
+// ProcessMesh over many meshes, one job each
+std::vector<Mesh> ProcessMeshes(JobSystem *job_system,
+                                const std::vector<MeshView> &meshes,
+                                const MeshProcessingSettings &settings = {},
+                                std::vector<MeshProcessingStats> *stats =
+                                    nullptr);
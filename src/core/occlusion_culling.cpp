@@ -0,0 +1,512 @@
+#include "core/occlusion_culling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+#include <immintrin.h>
+#define OCCLUSION_CULLING_X64
+#endif
+
+// GCC and Clang only emit AVX2 in functions that enable it, MSVC always can
+#if defined(OCCLUSION_CULLING_X64) && defined(__GNUC__)
+#define OCCLUSION_CULLING_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define OCCLUSION_CULLING_AVX2_TARGET
+#endif
+
+namespace {
+const float kFarDepth = std::numeric_limits<float>::max();
+// Pixel squares have to be inside the triangle by this much more, which
+// absorbs the rounding of the edge functions and the sub-pixel snapping of
+// the rasterizers
+const float kEdgeMargin = 1.0f / 64.0f;
+const uint32_t kFullRow = ~0u;
+
+uint32_t ReadIndex(const void *indices, uint32_t index_size, uint32_t i) {
+  if (index_size == 2) {
+    uint16_t index;
+    memcpy(&index, static_cast<const uint8_t *>(indices) + i * 2,
+           sizeof(index));
+    return index;
+  }
+  uint32_t index;
+  memcpy(&index, static_cast<const uint8_t *>(indices) + i * 4,
+         sizeof(index));
+  return index;
+}
+
+// Bits [x0, x1) of a row of a tile, in tile pixels
+uint32_t GetRowMask(int32_t x0, int32_t x1) {
+  x0 = std::max(x0, 0);
+  x1 = std::min<int32_t>(x1, OcclusionCuller::kTileWidth);
+  if (x1 <= x0) {
+    return 0;
+  }
+  const uint64_t all = 0xffffffffull;
+  return static_cast<uint32_t>((all << x0) & ~(all << x1));
+}
+
+uint64_t GetElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+OcclusionCuller::OcclusionCuller(JobSystem *job_system,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 SimdLevel level)
+    : job_system_(job_system),
+      width_(width),
+      height_(height),
+      tiles_x_((width + kTileWidth - 1) / kTileWidth),
+      tiles_y_((height + kTileHeight - 1) / kTileHeight),
+      level_(std::min(level, GetSupportedSimdLevel())),
+      tiles_(size_t(tiles_x_) * tiles_y_),
+      tile_row_triangles_(tiles_y_) {
+  BeginFrame();
+}
+
+void OcclusionCuller::BeginFrame() {
+  for (Tile &tile : tiles_) {
+    std::fill(tile.mask, tile.mask + kTileHeight, 0u);
+    tile.reference_depth = kFarDepth;
+    tile.working_depth = 0.0f;
+  }
+  triangles_.clear();
+  for (auto &row_triangles : tile_row_triangles_) {
+    row_triangles.clear();
+  }
+  stats_ = OcclusionStats{};
+}
+
+void OcclusionCuller::AddOccluder(const OccluderMesh &mesh,
+                                  const InstanceData &transform,
+                                  float depth) {
+  stats_.occluders++;
+  // Pixels of the vertices, NaN for the ones the depth range clips
+  transformed_.resize(mesh.vertex_count);
+  for (uint32_t i = 0; i < mesh.vertex_count; i++) {
+    const glm::vec3 position =
+        DequantizePosition(mesh.vertices[i].position, mesh.quantization);
+    if (!(position.z >= 0.0f && position.z <= 1.0f)) {
+      transformed_[i] = glm::vec2(std::numeric_limits<float>::quiet_NaN());
+      continue;
+    }
+    const float clip_x = position.x * transform.scale.x + transform.offset.x;
+    const float clip_y = position.y * transform.scale.y + transform.offset.y;
+    transformed_[i] = glm::vec2((clip_x * 0.5f + 0.5f) * width_,
+                                (0.5f - clip_y * 0.5f) * height_);
+  }
+
+  for (uint32_t i = 0; i + 2 < mesh.index_count; i += 3) {
+    stats_.triangles++;
+    glm::vec2 pixels[3];
+    bool clipped = false;
+    for (uint32_t k = 0; k < 3; k++) {
+      const uint32_t index = ReadIndex(mesh.indices, mesh.index_size, i + k);
+      clipped |=
+          index >= mesh.vertex_count || std::isnan(transformed_[index].x);
+      if (!clipped) {
+        pixels[k] = transformed_[index];
+      }
+    }
+    if (clipped) {
+      stats_.triangles_culled++;
+      continue;
+    }
+    AddTriangle(pixels, depth);
+  }
+}
+
+void OcclusionCuller::AddTriangle(const glm::vec2 *pixels, float depth) {
+  Triangle triangle;
+  for (int i = 0; i < 3; i++) {
+    const glm::vec2 &a = pixels[(i + 1) % 3];
+    const glm::vec2 &b = pixels[(i + 2) % 3];
+    triangle.edge_a[i] = a.y - b.y;
+    triangle.edge_b[i] = b.x - a.x;
+    triangle.edge_c[i] =
+        -(triangle.edge_a[i] * a.x + triangle.edge_b[i] * a.y);
+  }
+  // Clockwise on screen is front facing, as in the rasterizers
+  const float area = triangle.edge_a[0] * pixels[0].x +
+                     triangle.edge_b[0] * pixels[0].y + triangle.edge_c[0];
+  const float min_x = std::min({pixels[0].x, pixels[1].x, pixels[2].x});
+  const float min_y = std::min({pixels[0].y, pixels[1].y, pixels[2].y});
+  const float max_x = std::max({pixels[0].x, pixels[1].x, pixels[2].x});
+  const float max_y = std::max({pixels[0].y, pixels[1].y, pixels[2].y});
+  triangle.min_x = static_cast<int32_t>(
+      std::max(std::floor(min_x), 0.0f));
+  triangle.min_y = static_cast<int32_t>(
+      std::max(std::floor(min_y), 0.0f));
+  triangle.max_x = static_cast<int32_t>(
+      std::min(std::ceil(max_x), static_cast<float>(width_)));
+  triangle.max_y = static_cast<int32_t>(
+      std::min(std::ceil(max_y), static_cast<float>(height_)));
+  if (!(area > 0.0f) || triangle.min_x >= triangle.max_x ||
+      triangle.min_y >= triangle.max_y) {
+    stats_.triangles_culled++;
+    return;
+  }
+
+  // A pixel square is inside an edge when its center is at least half the
+  // square's extent along the edge normal inside
+  for (int i = 0; i < 3; i++) {
+    triangle.edge_c[i] -= (0.5f + kEdgeMargin) * (std::abs(triangle.edge_a[i]) +
+                                                  std::abs(triangle.edge_b[i]));
+  }
+  triangle.depth = depth;
+  const uint32_t index = static_cast<uint32_t>(triangles_.size());
+  triangles_.push_back(triangle);
+  for (int32_t row = triangle.min_y / kTileHeight;
+       row <= (triangle.max_y - 1) / static_cast<int32_t>(kTileHeight);
+       row++) {
+    tile_row_triangles_[row].push_back(index);
+  }
+}
+
+void OcclusionCuller::Rasterize() {
+  const auto start = std::chrono::steady_clock::now();
+  job_system_->ParallelFor(tiles_y_, [this](uint32_t tile_row, uint32_t) {
+#ifdef OCCLUSION_CULLING_X64
+    if (level_ >= SimdLevel::kAvx2) {
+      RasterizeTileRowAvx2(tile_row);
+      return;
+    }
+#endif
+    RasterizeTileRow(tile_row);
+  });
+  stats_.rasterize_time_ns += GetElapsedNs(start);
+}
+
+void OcclusionCuller::ComputeSpans(const Triangle &triangle,
+                                   uint32_t tile_row,
+                                   int32_t *x0,
+                                   int32_t *x1) const {
+  for (uint32_t r = 0; r < kTileHeight; r++) {
+    const int32_t y = static_cast<int32_t>(tile_row * kTileHeight + r);
+    x0[r] = 0;
+    x1[r] = 0;
+    if (y < triangle.min_y || y >= triangle.max_y) {
+      continue;
+    }
+    // Pixel centers x + 0.5 inside every edge form one interval
+    const float center_y = y + 0.5f;
+    float low = static_cast<float>(triangle.min_x);
+    float high = static_cast<float>(triangle.max_x);
+    bool empty = false;
+    for (int i = 0; i < 3; i++) {
+      const float value =
+          triangle.edge_b[i] * center_y + triangle.edge_c[i];
+      if (triangle.edge_a[i] > 0.0f) {
+        low = std::max(low, -value / triangle.edge_a[i]);
+      } else if (triangle.edge_a[i] < 0.0f) {
+        high = std::min(high, -value / triangle.edge_a[i]);
+      } else {
+        empty |= value < 0.0f;
+      }
+    }
+    if (empty || low > high) {
+      continue;
+    }
+    x0[r] = static_cast<int32_t>(std::ceil(low - 0.5f));
+    x1[r] = static_cast<int32_t>(std::floor(high - 0.5f)) + 1;
+  }
+}
+
+void OcclusionCuller::RasterizeTileRow(uint32_t tile_row) {
+  int32_t x0[kTileHeight];
+  int32_t x1[kTileHeight];
+  uint32_t coverage[kTileHeight];
+  for (uint32_t index : tile_row_triangles_[tile_row]) {
+    const Triangle &triangle = triangles_[index];
+    ComputeSpans(triangle, tile_row, x0, x1);
+    const uint32_t first_tile = triangle.min_x / kTileWidth;
+    const uint32_t last_tile = (triangle.max_x - 1) / kTileWidth;
+    for (uint32_t tile_x = first_tile; tile_x <= last_tile; tile_x++) {
+      const int32_t base = static_cast<int32_t>(tile_x * kTileWidth);
+      uint32_t any = 0;
+      for (uint32_t r = 0; r < kTileHeight; r++) {
+        coverage[r] = GetRowMask(x0[r] - base, x1[r] - base);
+        any |= coverage[r];
+      }
+      if (any != 0) {
+        UpdateTile(&tiles_[tile_row * tiles_x_ + tile_x], coverage,
+                   triangle.depth);
+      }
+    }
+  }
+}
+
+void OcclusionCuller::UpdateTile(Tile *tile,
+                                 const uint32_t *coverage,
+                                 float depth) {
+  if (depth >= tile->reference_depth) {
+    return;
+  }
+  // A triangle further in front of the working layer than the working layer
+  // is in front of the reference starts a new working layer, merging would
+  // push its depth back
+  if (tile->working_depth - depth >
+      tile->reference_depth - tile->working_depth) {
+    std::fill(tile->mask, tile->mask + kTileHeight, 0u);
+    tile->working_depth = 0.0f;
+  }
+  tile->working_depth = std::max(tile->working_depth, depth);
+  uint32_t full = kFullRow;
+  for (uint32_t r = 0; r < kTileHeight; r++) {
+    tile->mask[r] |= coverage[r];
+    full &= tile->mask[r];
+  }
+  if (full == kFullRow) {
+    tile->reference_depth = tile->working_depth;
+    std::fill(tile->mask, tile->mask + kTileHeight, 0u);
+    tile->working_depth = 0.0f;
+  }
+}
+
+bool OcclusionCuller::IsVisible(const OcclusionQuery &query) const {
+  // Pixels the box of the mesh touches at all
+  const glm::vec3 &scale = query.mesh_bounds.scale;
+  const glm::vec3 extent(std::abs(scale.x), std::abs(scale.y),
+                         std::abs(scale.z));
+  const glm::vec3 low = query.mesh_bounds.bias - extent;
+  const glm::vec3 high = query.mesh_bounds.bias + extent;
+  const InstanceData &transform = query.transform;
+  const float clip_x0 = low.x * transform.scale.x + transform.offset.x;
+  const float clip_x1 = high.x * transform.scale.x + transform.offset.x;
+  const float clip_y0 = low.y * transform.scale.y + transform.offset.y;
+  const float clip_y1 = high.y * transform.scale.y + transform.offset.y;
+  const float pixel_x0 = (std::min(clip_x0, clip_x1) * 0.5f + 0.5f) * width_;
+  const float pixel_x1 = (std::max(clip_x0, clip_x1) * 0.5f + 0.5f) * width_;
+  const float pixel_y0 =
+      (0.5f - std::max(clip_y0, clip_y1) * 0.5f) * height_;
+  const float pixel_y1 =
+      (0.5f - std::min(clip_y0, clip_y1) * 0.5f) * height_;
+  const int32_t min_x =
+      static_cast<int32_t>(std::max(std::floor(pixel_x0), 0.0f));
+  const int32_t min_y =
+      static_cast<int32_t>(std::max(std::floor(pixel_y0), 0.0f));
+  const int32_t max_x = static_cast<int32_t>(
+      std::min(std::floor(pixel_x1) + 1.0f, static_cast<float>(width_)));
+  const int32_t max_y = static_cast<int32_t>(
+      std::min(std::floor(pixel_y1) + 1.0f, static_cast<float>(height_)));
+  if (min_x >= max_x || min_y >= max_y) {
+    return false;
+  }
+#ifdef OCCLUSION_CULLING_X64
+  if (level_ >= SimdLevel::kAvx2) {
+    return IsVisibleAvx2(min_x, min_y, max_x, max_y, query.depth);
+  }
+#endif
+
+  uint32_t coverage[kTileHeight];
+  for (int32_t tile_y = min_y / kTileHeight;
+       tile_y <= (max_y - 1) / static_cast<int32_t>(kTileHeight); tile_y++) {
+    for (int32_t tile_x = min_x / kTileWidth;
+         tile_x <= (max_x - 1) / static_cast<int32_t>(kTileWidth); tile_x++) {
+      const uint32_t row_mask = GetRowMask(min_x - tile_x * kTileWidth,
+                                           max_x - tile_x * kTileWidth);
+      for (uint32_t r = 0; r < kTileHeight; r++) {
+        const int32_t y = tile_y * kTileHeight + r;
+        coverage[r] = y >= min_y && y < max_y ? row_mask : 0;
+      }
+      if (IsTileVisible(tiles_[tile_y * tiles_x_ + tile_x], coverage,
+                        query.depth)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool OcclusionCuller::IsTileVisible(const Tile &tile,
+                                    const uint32_t *coverage,
+                                    float depth) {
+  // Covered pixels are at most as far as the working layer, the others at
+  // most as far as the reference
+  uint32_t masked = 0;
+  uint32_t unmasked = 0;
+  for (uint32_t r = 0; r < kTileHeight; r++) {
+    masked |= coverage[r] & tile.mask[r];
+    unmasked |= coverage[r] & ~tile.mask[r];
+  }
+  return (masked != 0 && depth <= tile.working_depth) ||
+         (unmasked != 0 && depth <= tile.reference_depth);
+}
+
+void OcclusionCuller::Test(const OcclusionQuery *queries,
+                           uint32_t count,
+                           std::vector<uint8_t> *visible) {
+  const auto start = std::chrono::steady_clock::now();
+  visible->resize(count);
+  const uint32_t chunk_count =
+      (count + kQueriesPerChunk - 1) / kQueriesPerChunk;
+  job_system_->ParallelFor(chunk_count, [&](uint32_t chunk, uint32_t) {
+    const uint32_t end = std::min(count, (chunk + 1) * kQueriesPerChunk);
+    for (uint32_t i = chunk * kQueriesPerChunk; i < end; i++) {
+      (*visible)[i] = IsVisible(queries[i]) ? 1 : 0;
+    }
+  });
+  stats_.objects += count;
+  for (uint32_t i = 0; i < count; i++) {
+    stats_.occluded += (*visible)[i] == 0;
+  }
+  stats_.test_time_ns += GetElapsedNs(start);
+}
+
+#ifdef OCCLUSION_CULLING_X64
+OCCLUSION_CULLING_AVX2_TARGET void OcclusionCuller::RasterizeTileRowAvx2(
+    uint32_t tile_row) {
+  const int32_t first_y = static_cast<int32_t>(tile_row * kTileHeight);
+  const __m256i rows =
+      _mm256_add_epi32(_mm256_set1_epi32(first_y),
+                       _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  const __m256 centers_y = _mm256_add_ps(_mm256_cvtepi32_ps(rows),
+                                         _mm256_set1_ps(0.5f));
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256i ones = _mm256_set1_epi32(-1);
+  const __m256i zero = _mm256_setzero_si256();
+  for (uint32_t index : tile_row_triangles_[tile_row]) {
+    const Triangle &triangle = triangles_[index];
+    // The spans of all eight rows at once, as ComputeSpans does
+    const __m256 min_x = _mm256_set1_ps(static_cast<float>(triangle.min_x));
+    const __m256 max_x = _mm256_set1_ps(static_cast<float>(triangle.max_x));
+    __m256 low = min_x;
+    __m256 high = max_x;
+    __m256 empty = _mm256_setzero_ps();
+    for (int i = 0; i < 3; i++) {
+      const __m256 value =
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edge_b[i]),
+                                      centers_y),
+                        _mm256_set1_ps(triangle.edge_c[i]));
+      const float a = triangle.edge_a[i];
+      if (a > 0.0f) {
+        low = _mm256_max_ps(low, _mm256_div_ps(value, _mm256_set1_ps(-a)));
+      } else if (a < 0.0f) {
+        high = _mm256_min_ps(high, _mm256_div_ps(value, _mm256_set1_ps(-a)));
+      } else {
+        empty = _mm256_or_ps(
+            empty, _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_LT_OQ));
+      }
+    }
+    // Clamping keeps the conversions in range, empty rows get x1 == x0
+    low = _mm256_min_ps(low, max_x);
+    high = _mm256_max_ps(high, min_x);
+    const __m256i x0 = _mm256_cvttps_epi32(
+        _mm256_ceil_ps(_mm256_sub_ps(low, half)));
+    __m256i x1 = _mm256_add_epi32(
+        _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_sub_ps(high, half))),
+        _mm256_set1_epi32(1));
+    const __m256i in_rows = _mm256_andnot_si256(
+        _mm256_or_si256(
+            _mm256_cmpgt_epi32(_mm256_set1_epi32(triangle.min_y), rows),
+            _mm256_cmpgt_epi32(rows, _mm256_set1_epi32(triangle.max_y - 1))),
+        ones);
+    const __m256i filled =
+        _mm256_andnot_si256(_mm256_castps_si256(empty), in_rows);
+    x1 = _mm256_blendv_epi8(x0, x1, filled);
+
+    const uint32_t first_tile = triangle.min_x / kTileWidth;
+    const uint32_t last_tile = (triangle.max_x - 1) / kTileWidth;
+    for (uint32_t tile_x = first_tile; tile_x <= last_tile; tile_x++) {
+      // Shifts by 32 or more give zero, so only negative counts need
+      // clamping
+      const __m256i base =
+          _mm256_set1_epi32(static_cast<int32_t>(tile_x * kTileWidth));
+      const __m256i local0 = _mm256_max_epi32(_mm256_sub_epi32(x0, base), zero);
+      const __m256i local1 = _mm256_max_epi32(_mm256_sub_epi32(x1, base), zero);
+      const __m256i coverage =
+          _mm256_andnot_si256(_mm256_sllv_epi32(ones, local1),
+                              _mm256_sllv_epi32(ones, local0));
+      if (_mm256_testz_si256(coverage, coverage)) {
+        continue;
+      }
+      Tile &tile = tiles_[tile_row * tiles_x_ + tile_x];
+      if (triangle.depth >= tile.reference_depth) {
+        continue;
+      }
+      __m256i mask =
+          _mm256_load_si256(reinterpret_cast<const __m256i *>(tile.mask));
+      if (tile.working_depth - triangle.depth >
+          tile.reference_depth - tile.working_depth) {
+        mask = zero;
+        tile.working_depth = 0.0f;
+      }
+      tile.working_depth = std::max(tile.working_depth, triangle.depth);
+      mask = _mm256_or_si256(mask, coverage);
+      if (_mm256_testc_si256(mask, ones)) {
+        tile.reference_depth = tile.working_depth;
+        tile.working_depth = 0.0f;
+        mask = zero;
+      }
+      _mm256_store_si256(reinterpret_cast<__m256i *>(tile.mask), mask);
+    }
+  }
+  // Avoid the penalty of mixing AVX and SSE code in the caller
+  _mm256_zeroupper();
+}
+
+OCCLUSION_CULLING_AVX2_TARGET bool OcclusionCuller::IsVisibleAvx2(
+    int32_t min_x,
+    int32_t min_y,
+    int32_t max_x,
+    int32_t max_y,
+    float depth) const {
+  const __m256i row_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i ones = _mm256_set1_epi32(-1);
+  bool visible = false;
+  for (int32_t tile_y = min_y / kTileHeight;
+       !visible && tile_y <= (max_y - 1) / static_cast<int32_t>(kTileHeight);
+       tile_y++) {
+    const __m256i rows =
+        _mm256_add_epi32(_mm256_set1_epi32(tile_y * kTileHeight), row_offsets);
+    const __m256i in_rows = _mm256_andnot_si256(
+        _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(min_y), rows),
+                        _mm256_cmpgt_epi32(rows, _mm256_set1_epi32(max_y - 1))),
+        ones);
+    for (int32_t tile_x = min_x / kTileWidth;
+         tile_x <= (max_x - 1) / static_cast<int32_t>(kTileWidth); tile_x++) {
+      const __m256i coverage = _mm256_and_si256(
+          in_rows,
+          _mm256_set1_epi32(static_cast<int32_t>(
+              GetRowMask(min_x - tile_x * kTileWidth,
+                         max_x - tile_x * kTileWidth))));
+      const Tile &tile = tiles_[tile_y * tiles_x_ + tile_x];
+      const __m256i mask =
+          _mm256_load_si256(reinterpret_cast<const __m256i *>(tile.mask));
+      if ((depth <= tile.working_depth &&
+           !_mm256_testz_si256(coverage, mask)) ||
+          (depth <= tile.reference_depth &&
+           !_mm256_testc_si256(mask, coverage))) {
+        visible = true;
+        break;
+      }
+    }
+  }
+  _mm256_zeroupper();
+  return visible;
+}
+#endif
+
+void ComputeDrawOrderDepths(const DrawQueue &draw_queue,
+                            const DrawItem *items,
+                            uint32_t count,
+                            float *depths) {
+  // Sorting by key and then by position is the order the queue draws in
+  std::vector<std::pair<uint64_t, uint32_t>> order(count);
+  for (uint32_t i = 0; i < count; i++) {
+    order[i] = {draw_queue.GetSortKey(items[i]), i};
+  }
+  std::sort(order.begin(), order.end());
+  for (uint32_t rank = 0; rank < count; rank++) {
+    depths[order[rank].second] = static_cast<float>(count - rank);
+  }
+}
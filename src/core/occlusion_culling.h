@@ -0,0 +1,163 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "core/cpu_features.h"
+#include "core/draw_queue.h"
+#include "core/job_system.h"
+#include "core/mesh.h"
+#include "core/vertex.h"
+
+struct OcclusionStats {
+  uint32_t occluders{0};
+  uint32_t triangles{0};
+  // Back facing, or outside of the buffer or of the depth range
+  uint32_t triangles_culled{0};
+  uint32_t objects{0};
+  uint32_t occluded{0};
+  uint64_t rasterize_time_ns{0};
+  uint64_t test_time_ns{0};
+};
+
+// Triangles of an occluder as they are drawn
+struct OccluderMesh {
+  const Vertex *vertices;
+  uint32_t vertex_count;
+  // 2 or 4 bytes
+  const void *indices;
+  uint32_t index_count;
+  uint32_t index_size;
+  PositionQuantization quantization;
+};
+
+// Object tested against the occluders by the bounding box of its mesh
+struct OcclusionQuery {
+  // Clip space transform, as in ObjectData
+  InstanceData transform;
+  PositionQuantization mesh_bounds;
+  float depth;
+};
+
+// Masked software occlusion culling. Occluders are rasterized into a low
+// resolution buffer of 32x8 pixel tiles, each holding a reference depth for
+// the whole tile and a working layer of a coverage bit per pixel and the
+// farthest depth that covered them. A tile whose mask fills up makes the
+// working layer its reference, and a triangle far in front of the working
+// layer starts a new one, so a tile never stores more than two depths.
+// Tiles are updated with whole rows of 32 pixels at a time, with AVX2 eight
+// rows at once, and rows of tiles are rasterized in parallel.
+//
+// Occluders are rasterized inner conservatively, a pixel is only covered
+// when its whole square is, and objects are tested outer conservatively, so
+// an object is only reported occluded when it is at any resolution. Every
+// occluder and object lies at a single depth, which grows with distance.
+class OcclusionCuller {
+ public:
+  static const uint32_t kTileWidth = 32;
+  static const uint32_t kTileHeight = 8;
+  // Objects tested per job
+  static const uint32_t kQueriesPerChunk = 4096;
+
+  OcclusionCuller(JobSystem *job_system,
+                  uint32_t width,
+                  uint32_t height,
+                  SimdLevel level = GetSupportedSimdLevel());
+
+  // Empty the buffer and forget the occluders of the previous frame
+  void BeginFrame();
+
+  // Bin the triangles of the mesh, transformed like VSMain does. Like the
+  // rasterizers only triangles clockwise on screen are drawn, and those with
+  // a vertex outside of the depth range are skipped as they get clipped.
+  void AddOccluder(const OccluderMesh &mesh,
+                   const InstanceData &transform,
+                   float depth);
+
+  // Rasterize the binned triangles, one job per row of tiles
+  void Rasterize();
+
+  // Whether any pixel of the object's box shows in front of the occluders.
+  // Objects entirely outside of the buffer are occluded. Thread safe once
+  // rasterized.
+  bool IsVisible(const OcclusionQuery &query) const;
+
+  // IsVisible of every query in parallel chunks, visible[i] is 0 for the
+  // occluded ones
+  void Test(const OcclusionQuery *queries,
+            uint32_t count,
+            std::vector<uint8_t> *visible);
+
+  uint32_t GetWidth() const {
+    return width_;
+  }
+  uint32_t GetHeight() const {
+    return height_;
+  }
+  SimdLevel GetSimdLevel() const {
+    return level_;
+  }
+  const OcclusionStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  struct alignas(32) Tile {
+    uint32_t mask[kTileHeight];
+    // Everything in the tile is at most this far
+    float reference_depth;
+    // Covered pixels are at most this far
+    float working_depth;
+  };
+
+  // Edge functions a * x + b * y + c of buffer pixel coordinates, already
+  // moved inwards by half a pixel square
+  struct Triangle {
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    float depth;
+    int32_t min_x;
+    int32_t min_y;
+    int32_t max_x;
+    int32_t max_y;
+  };
+
+  void AddTriangle(const glm::vec2 *pixels, float depth);
+  void RasterizeTileRow(uint32_t tile_row);
+  void RasterizeTileRowAvx2(uint32_t tile_row);
+  // Spans [x0, x1) of the triangle in the pixel rows of the tile row
+  void ComputeSpans(const Triangle &triangle,
+                    uint32_t tile_row,
+                    int32_t *x0,
+                    int32_t *x1) const;
+  static void UpdateTile(Tile *tile, const uint32_t *coverage, float depth);
+  static bool IsTileVisible(const Tile &tile,
+                            const uint32_t *coverage,
+                            float depth);
+  bool IsVisibleAvx2(int32_t min_x,
+                     int32_t min_y,
+                     int32_t max_x,
+                     int32_t max_y,
+                     float depth) const;
+
+  JobSystem *job_system_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t tiles_x_;
+  uint32_t tiles_y_;
+  SimdLevel level_;
+  std::vector<Tile> tiles_;
+  std::vector<Triangle> triangles_;
+  // Triangles overlapping every row of tiles, in the order they were added
+  std::vector<std::vector<uint32_t>> tile_row_triangles_;
+  std::vector<glm::vec2> transformed_;
+  OcclusionStats stats_;
+};
+
+// Depth of every item in a renderer without a depth buffer, where what is
+// drawn later covers what was drawn before. Items the draw queue draws
+// first are the farthest.
+void ComputeDrawOrderDepths(const DrawQueue &draw_queue,
+                            const DrawItem *items,
+                            uint32_t count,
+                            float *depths);
@@ -0,0 +1,50 @@
+#include "core/pipeline_readiness.h"
+
+#include <stdexcept>
+
+uint32_t PipelineReadiness::Add(uint32_t fallback) {
+  const uint32_t id = static_cast<uint32_t>(entries_.size());
+  if (fallback != kNoPipeline && fallback >= id) {
+    throw std::runtime_error("Pipeline fallbacks must be added first");
+  }
+  entries_.emplace_back();
+  entries_.back().fallback = fallback;
+  return id;
+}
+
+void PipelineReadiness::MarkReady(uint32_t pipeline) {
+  entries_[pipeline].state.store(State::kReady, std::memory_order_release);
+}
+
+void PipelineReadiness::MarkFailed(uint32_t pipeline) {
+  entries_[pipeline].state.store(State::kFailed, std::memory_order_release);
+}
+
+bool PipelineReadiness::IsReady(uint32_t pipeline) const {
+  return entries_[pipeline].state.load(std::memory_order_acquire) ==
+         State::kReady;
+}
+
+uint32_t PipelineReadiness::Resolve(uint32_t pipeline) {
+  for (uint32_t candidate = pipeline; candidate != kNoPipeline;
+       candidate = entries_[candidate].fallback) {
+    if (IsReady(candidate)) {
+      if (candidate != pipeline) {
+        fallbacks_.fetch_add(1, std::memory_order_relaxed);
+      }
+      return candidate;
+    }
+  }
+  return kNoPipeline;
+}
+
+PipelineReadinessStats PipelineReadiness::GetStats() const {
+  PipelineReadinessStats stats;
+  for (const Entry &entry : entries_) {
+    const State state = entry.state.load(std::memory_order_acquire);
+    stats.ready += state == State::kReady;
+    stats.failed += state == State::kFailed;
+  }
+  stats.fallbacks = fallbacks_.load(std::memory_order_relaxed);
+  return stats;
+}
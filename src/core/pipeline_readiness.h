@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+struct PipelineReadinessStats {
+  uint64_t ready{0};
+  uint64_t failed{0};
+  // Resolve calls answered with a fallback instead of the pipeline asked for
+  uint64_t fallbacks{0};
+};
+
+// Tracks pipelines that are created in the background. Every pipeline may
+// name a fallback, and draws asking for a pipeline that is not ready yet get
+// the first ready one along the fallback chain, so frames never wait for a
+// compilation. Pipelines are added up front, readiness is then updated and
+// queried from any thread.
+class PipelineReadiness {
+ public:
+  static const uint32_t kNoPipeline = ~0u;
+
+  // Returns the id of the pipeline, ids count up from 0. The fallback must
+  // have been added before or be kNoPipeline.
+  uint32_t Add(uint32_t fallback = kNoPipeline);
+
+  // Publishes the pipeline object stored before the call to the threads that
+  // see it ready
+  void MarkReady(uint32_t pipeline);
+  // The pipeline stays on its fallback for good
+  void MarkFailed(uint32_t pipeline);
+
+  bool IsReady(uint32_t pipeline) const;
+  // The pipeline or its first ready fallback, kNoPipeline when neither is
+  uint32_t Resolve(uint32_t pipeline);
+
+  uint32_t GetPipelineCount() const {
+    return static_cast<uint32_t>(entries_.size());
+  }
+  PipelineReadinessStats GetStats() const;
+
+ private:
+  enum class State : uint8_t { kPending, kReady, kFailed };
+
+  struct Entry {
+    uint32_t fallback;
+    std::atomic<State> state{State::kPending};
+  };
+
+  // Entries hold atomics, a deque never moves them
+  std::deque<Entry> entries_;
+  std::atomic<uint64_t> fallbacks_{0};
+};
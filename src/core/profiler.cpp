@@ -0,0 +1,158 @@
+#include "core/profiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+// Chrome trace timestamps are microseconds
+void WriteMicroseconds(FILE *file, uint64_t nanoseconds) {
+  fprintf(file, "%llu.%03u",
+          static_cast<unsigned long long>(nanoseconds / 1000),
+          static_cast<unsigned>(nanoseconds % 1000));
+}
+
+void WriteJsonString(FILE *file, const char *text) {
+  fputc('"', file);
+  for (const char *c = text; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      fputc('\\', file);
+    }
+    fputc(*c, file);
+  }
+  fputc('"', file);
+}
+}  // namespace
+
+void ProfileEventRing::Drain(std::vector<ProfileEvent> *events) {
+  const uint32_t tail = tail_.load(std::memory_order_relaxed);
+  const uint32_t head = head_.load(std::memory_order_acquire);
+  for (uint32_t i = tail; i != head; i++) {
+    events->push_back(events_[i & (kCapacity - 1)]);
+  }
+  tail_.store(head, std::memory_order_release);
+}
+
+struct Profiler::ThreadRingHandle {
+  ThreadRing *ring{nullptr};
+
+  ~ThreadRingHandle() {
+    if (ring != nullptr) {
+      Profiler::Get().ReleaseRing(ring);
+    }
+  }
+};
+
+Profiler &Profiler::Get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+uint64_t Profiler::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Profiler::Record(const char *name, uint64_t start_ns, uint64_t end_ns) {
+  thread_local ThreadRingHandle handle;
+  if (handle.ring == nullptr) {
+    handle.ring = AcquireRing();
+  }
+  handle.ring->ring.Push({name, start_ns, end_ns});
+}
+
+void Profiler::RecordGpu(const char *name,
+                         uint64_t start_ns,
+                         uint64_t end_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Capture({name, start_ns, end_ns}, kGpuThreadId);
+}
+
+void Profiler::Collect() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t dropped = 0;
+  for (const std::unique_ptr<ThreadRing> &ring : rings_) {
+    drained_.clear();
+    ring->ring.Drain(&drained_);
+    for (const ProfileEvent &event : drained_) {
+      Capture(event, ring->thread_id);
+    }
+    dropped += ring->ring.GetDroppedCount();
+  }
+  stats_.dropped_events = dropped;
+}
+
+void Profiler::WriteChromeTrace(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+
+  // CPU threads in one process and the GPU queue in another, so the viewer
+  // draws them as separate groups
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(file,
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+          "\"args\":{\"name\":\"CPU\"}},\n"
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,"
+          "\"args\":{\"name\":\"GPU\"}},\n"
+          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,"
+          "\"args\":{\"name\":\"Direct queue\"}}");
+  for (const std::unique_ptr<ThreadRing> &ring : rings_) {
+    fprintf(file,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+            ring->thread_id, ring->thread_id);
+  }
+  for (const CapturedEvent &captured : captured_) {
+    const bool gpu = captured.thread_id == kGpuThreadId;
+    fprintf(file, ",\n{\"name\":");
+    WriteJsonString(file, captured.event.name);
+    fprintf(file, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":", gpu ? 2 : 1,
+            gpu ? 0 : captured.thread_id);
+    WriteMicroseconds(file, captured.event.start_ns);
+    fprintf(file, ",\"dur\":");
+    WriteMicroseconds(file,
+                      captured.event.end_ns - captured.event.start_ns);
+    fputc('}', file);
+  }
+  fprintf(file, "\n]}\n");
+
+  const bool failed = ferror(file) != 0;
+  if (fclose(file) != 0 || failed) {
+    throw std::runtime_error("Failed to write " + path);
+  }
+}
+
+ProfilerStats Profiler::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+Profiler::ThreadRing *Profiler::AcquireRing() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!free_rings_.empty()) {
+    ThreadRing *ring = free_rings_.back();
+    free_rings_.pop_back();
+    return ring;
+  }
+  rings_.push_back(std::make_unique<ThreadRing>());
+  rings_.back()->thread_id = static_cast<uint32_t>(rings_.size() - 1);
+  return rings_.back().get();
+}
+
+void Profiler::ReleaseRing(ThreadRing *ring) {
+  // Collect still drains the events left in it
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_rings_.push_back(ring);
+}
+
+void Profiler::Capture(const ProfileEvent &event, uint32_t thread_id) {
+  if (captured_.size() == kMaxCapturedEvents) {
+    captured_.pop_front();
+  }
+  captured_.push_back({event, thread_id});
+  stats_.collected_events++;
+}
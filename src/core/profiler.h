@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Instrumentation of the frame loop. With ENABLE_PROFILER undefined the
+// macros expand to nothing, so instrumented code pays nothing at all.
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing scope, name must be a string literal
+#define PROFILE_SCOPE(name) \
+  ScopedTimer PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+struct ProfileEvent {
+  const char *name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+};
+
+// Single producer, single consumer ring of events. The owning thread pushes
+// without locks, Profiler::Collect drains it from another thread.
+class ProfileEventRing {
+ public:
+  static const uint32_t kCapacity = 1 << 14;
+
+  // Returns false and drops the event when the consumer fell behind
+  bool Push(const ProfileEvent &event) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == kCapacity) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    events_[head & (kCapacity - 1)] = event;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Append every pushed event to events, oldest first
+  void Drain(std::vector<ProfileEvent> *events);
+
+  uint64_t GetDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  ProfileEvent events_[kCapacity];
+  // On their own cache lines, each is written by one side only
+  alignas(64) std::atomic<uint32_t> head_{0};
+  alignas(64) std::atomic<uint32_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+struct ProfilerStats {
+  uint64_t collected_events{0};
+  uint64_t dropped_events{0};
+};
+
+// Gathers the events of every thread into a capture of the latest events and
+// exports it as Chrome trace JSON, for chrome://tracing or Perfetto. Threads
+// get their ring on their first event and give it back when they exit.
+class Profiler {
+ public:
+  // Events kept for export, older ones are discarded
+  static const uint32_t kMaxCapturedEvents = 1 << 20;
+
+  static Profiler &Get();
+
+  // Monotonic nanoseconds, the time base of every event
+  static uint64_t Now();
+
+  void Record(const char *name, uint64_t start_ns, uint64_t end_ns);
+  // GPU work already converted to the CPU time base
+  void RecordGpu(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+  // Move the events of every thread into the capture, call once per frame
+  void Collect();
+
+  // Throws when the file can not be written
+  void WriteChromeTrace(const std::string &path);
+
+  ProfilerStats GetStats();
+
+ private:
+  struct ThreadRing {
+    uint32_t thread_id;
+    ProfileEventRing ring;
+  };
+
+  struct CapturedEvent {
+    ProfileEvent event;
+    // kGpuThreadId for GPU events
+    uint32_t thread_id;
+  };
+
+  // Returns the ring to the profiler when its thread exits
+  struct ThreadRingHandle;
+
+  static const uint32_t kGpuThreadId = ~uint32_t(0);
+
+  ThreadRing *AcquireRing();
+  void ReleaseRing(ThreadRing *ring);
+  void Capture(const ProfileEvent &event, uint32_t thread_id);
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadRing>> rings_;
+  std::vector<ThreadRing *> free_rings_;
+  std::vector<ProfileEvent> drained_;
+  std::deque<CapturedEvent> captured_;
+  ProfilerStats stats_;
+};
+
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(const char *name)
+      : name_(name), start_ns_(Profiler::Now()) {
+  }
+  ~ScopedTimer() {
+    Profiler::Get().Record(name_, start_ns_, Profiler::Now());
+  }
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+ private:
+  const char *name_;
+  uint64_t start_ns_;
+};
@@ -0,0 +1,30 @@
+#include "core/queue_sync.h"
+
+#include <algorithm>
+
+QueueSync::QueueSync(GpuTimeline *producer, GpuTimeline *consumer)
+    : producer_(producer), consumer_(consumer) {
+}
+
+bool QueueSync::IsComplete(uint64_t producer_value) {
+  return producer_->GetCompletedValue() >= producer_value;
+}
+
+void QueueSync::Require(uint64_t producer_value) {
+  required_value_ = std::max(required_value_, producer_value);
+}
+
+void QueueSync::BeforeSubmit() {
+  if (required_value_ == 0) {
+    return;
+  }
+  stats_.submissions++;
+  if (required_value_ <= waited_value_ || IsComplete(required_value_)) {
+    stats_.skipped_waits++;
+  } else {
+    consumer_->WaitForTimeline(producer_, required_value_);
+    waited_value_ = required_value_;
+    stats_.gpu_waits++;
+  }
+  required_value_ = 0;
+}
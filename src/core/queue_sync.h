@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+#include "core/gpu_timeline.h"
+
+struct QueueSyncStats {
+  // Consumer submissions that required producer work
+  uint64_t submissions{0};
+  // GPU waits inserted for producer work still in flight
+  uint64_t gpu_waits{0};
+  // Submissions whose requirements had completed or were already waited on
+  uint64_t skipped_waits{0};
+};
+
+// Orders submissions of a consumer queue, such as the graphics queue, after
+// the producer submissions they use, such as uploads on a copy queue. Each
+// consumer submission waits on the GPU for the highest producer value it
+// requires, and only when that work is still in flight and no earlier wait
+// covered it, so unrelated producer work never delays the consumer.
+class QueueSync {
+ public:
+  QueueSync(GpuTimeline *producer, GpuTimeline *consumer);
+
+  // Whether the producer finished the work signaled with the value
+  bool IsComplete(uint64_t producer_value);
+
+  // The next consumer submission uses what the producer signaled with the
+  // value, 0 requires nothing
+  void Require(uint64_t producer_value);
+
+  // Call right before submitting to the consumer queue
+  void BeforeSubmit();
+
+  const QueueSyncStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  GpuTimeline *producer_;
+  GpuTimeline *consumer_;
+  uint64_t required_value_{0};
+  // Waits are cumulative, later consumer work is ordered after them too
+  uint64_t waited_value_{0};
+  QueueSyncStats stats_;
+};
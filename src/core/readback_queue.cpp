@@ -0,0 +1,55 @@
+#include "core/readback_queue.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ReadbackQueue::ReadbackQueue(GpuTimeline *timeline, uint32_t depth)
+    : timeline_(timeline), depth_(depth) {
+  if (depth == 0) {
+    throw std::runtime_error("Readback queue needs at least one slot");
+  }
+}
+
+uint32_t ReadbackQueue::Acquire(const ReadFunction &read) {
+  if (pending_.size() == depth_) {
+    if (timeline_->GetCompletedValue() < pending_.front().fence_value) {
+      stats_.stalls++;
+      timeline_->WaitForValue(pending_.front().fence_value);
+    }
+    ReadOldest(read);
+  }
+  acquired_slot_ = next_slot_;
+  next_slot_ = (next_slot_ + 1) % depth_;
+  return acquired_slot_;
+}
+
+void ReadbackQueue::Submit(uint64_t frame, uint64_t fence_value) {
+  pending_.push_back({acquired_slot_, frame, fence_value});
+  last_submitted_frame_ = frame;
+}
+
+void ReadbackQueue::ReadCompleted(const ReadFunction &read) {
+  const uint64_t completed_value = timeline_->GetCompletedValue();
+  while (!pending_.empty() &&
+         pending_.front().fence_value <= completed_value) {
+    ReadOldest(read);
+  }
+}
+
+void ReadbackQueue::Flush(const ReadFunction &read) {
+  if (!pending_.empty()) {
+    timeline_->WaitForValue(pending_.back().fence_value);
+  }
+  while (!pending_.empty()) {
+    ReadOldest(read);
+  }
+}
+
+void ReadbackQueue::ReadOldest(const ReadFunction &read) {
+  const PendingFrame pending = pending_.front();
+  pending_.pop_front();
+  stats_.max_latency_frames = std::max(
+      stats_.max_latency_frames, last_submitted_frame_ - pending.frame);
+  read(pending.slot, pending.frame);
+  stats_.frames_read++;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+#include "core/gpu_timeline.h"
+
+struct ReadbackQueueStats {
+  uint64_t frames_read{0};
+  // Acquires that blocked on the GPU because the slot still held a frame
+  // whose copy had not completed
+  uint64_t stalls{0};
+  // Most frames submitted after a frame before it was read
+  uint64_t max_latency_frames{0};
+};
+
+// Bookkeeping of a ring of readback slots, the buffers themselves belong to
+// the caller. Each captured frame copies into the next slot and is read once
+// the fence of its submission completed. With more slots than frames in
+// flight the copy of the oldest slot has always completed by the time the
+// slot comes around again, so capturing never waits for the GPU.
+class ReadbackQueue {
+ public:
+  // Receives the slot and the frame number it holds
+  using ReadFunction = std::function<void(uint32_t slot, uint64_t frame)>;
+
+  ReadbackQueue(GpuTimeline *timeline, uint32_t depth);
+
+  // Slot for the copy of the next frame. A frame still in the slot is read
+  // first, waiting for its copy if it did not complete yet.
+  uint32_t Acquire(const ReadFunction &read);
+
+  // The copy into the slot acquired last executes before fence_value
+  void Submit(uint64_t frame, uint64_t fence_value);
+
+  // Read every slot whose copy completed, oldest first, without waiting
+  void ReadCompleted(const ReadFunction &read);
+
+  // Wait for every submitted copy and read it
+  void Flush(const ReadFunction &read);
+
+  uint32_t GetDepth() const {
+    return depth_;
+  }
+  const ReadbackQueueStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  struct PendingFrame {
+    uint32_t slot;
+    uint64_t frame;
+    uint64_t fence_value;
+  };
+
+  void ReadOldest(const ReadFunction &read);
+
+  GpuTimeline *timeline_;
+  uint32_t depth_;
+  uint32_t next_slot_{0};
+  uint32_t acquired_slot_{0};
+  uint64_t last_submitted_frame_{0};
+  // Oldest first, slots are handed out in order so the front is always the
+  // slot acquired next
+  std::deque<PendingFrame> pending_;
+  ReadbackQueueStats stats_;
+};
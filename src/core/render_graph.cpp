@@ -0,0 +1,387 @@
+#include "core/render_graph.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "core/string_utils.h"
+
+namespace {
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+const char *GetResourceStateName(ResourceState state) {
+  switch (state) {
+    case ResourceState::kUndefined:
+      return "undefined";
+    case ResourceState::kPresent:
+      return "present";
+    case ResourceState::kRenderTarget:
+      return "render target";
+    case ResourceState::kDepthWrite:
+      return "depth write";
+    case ResourceState::kDepthRead:
+      return "depth read";
+    case ResourceState::kShaderResource:
+      return "shader resource";
+    case ResourceState::kUnorderedAccess:
+      return "unordered access";
+    case ResourceState::kCopySource:
+      return "copy source";
+    case ResourceState::kCopyDest:
+      return "copy dest";
+    case ResourceState::kVertexBuffer:
+      return "vertex buffer";
+  }
+  return "";
+}
+
+bool IsWriteState(ResourceState state) {
+  return state == ResourceState::kRenderTarget ||
+         state == ResourceState::kDepthWrite ||
+         state == ResourceState::kUnorderedAccess ||
+         state == ResourceState::kCopyDest;
+}
+
+void RenderGraph::Reset() {
+  resources_.clear();
+  passes_.clear();
+  uses_.clear();
+  schedule_.clear();
+  barriers_.clear();
+  batch_offsets_.clear();
+  stats_ = {};
+}
+
+uint32_t RenderGraph::ImportResource(const char *name,
+                                     ResourceState state,
+                                     ResourceState final_state) {
+  if (state == ResourceState::kUndefined ||
+      final_state == ResourceState::kUndefined) {
+    throw std::runtime_error(std::string("Imported resource ") + name +
+                             " needs a defined state");
+  }
+  Resource resource = {};
+  resource.name = name;
+  resource.initial_state = state;
+  resource.final_state = final_state;
+  resources_.push_back(resource);
+  return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+uint32_t RenderGraph::CreateTransient(const char *name,
+                                      const TransientResourceDesc &desc) {
+  Resource resource = {};
+  resource.name = name;
+  resource.transient = true;
+  resource.desc = desc;
+  resource.desc.alignment = std::max<uint64_t>(desc.alignment, 1);
+  resources_.push_back(resource);
+  return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+uint32_t RenderGraph::AddPass(const char *name,
+                              std::initializer_list<ResourceUse> uses,
+                              bool has_side_effects) {
+  Pass pass = {};
+  pass.name = name;
+  pass.first_use = static_cast<uint32_t>(uses_.size());
+  pass.use_count = static_cast<uint32_t>(uses.size());
+  pass.has_side_effects = has_side_effects;
+  for (const ResourceUse &use : uses) {
+    if (use.resource >= resources_.size() ||
+        use.state == ResourceState::kUndefined) {
+      throw std::runtime_error(std::string("Invalid resource use in pass ") +
+                               name);
+    }
+    for (uint32_t i = pass.first_use; i < uses_.size(); i++) {
+      if (uses_[i].resource == use.resource) {
+        throw std::runtime_error(std::string("Pass ") + name + " uses " +
+                                 resources_[use.resource].name + " twice");
+      }
+    }
+    uses_.push_back(use);
+  }
+  passes_.push_back(pass);
+  return static_cast<uint32_t>(passes_.size() - 1);
+}
+
+void RenderGraph::Compile() {
+  stats_ = {};
+  stats_.passes = static_cast<uint32_t>(passes_.size());
+  CullPasses();
+  ComputeLifetimes();
+  PlaceTransients();
+  ComputeBarriers();
+}
+
+GraphBarrierBatch RenderGraph::GetBarriers(uint32_t step) const {
+  return {barriers_.data() + batch_offsets_[step],
+          batch_offsets_[step + 1] - batch_offsets_[step]};
+}
+
+void RenderGraph::CullPasses() {
+  // Walk back from the outputs. A pass is needed when it has side effects or
+  // writes an imported resource or one a later needed pass uses. Writes may
+  // keep earlier contents, as blending does, so every use of a needed pass
+  // counts.
+  needed_.assign(resources_.size(), false);
+  for (uint32_t pass_index = static_cast<uint32_t>(passes_.size());
+       pass_index-- > 0;) {
+    Pass &pass = passes_[pass_index];
+    bool needed = pass.has_side_effects;
+    for (uint32_t i = 0; i < pass.use_count && !needed; i++) {
+      const ResourceUse &use = uses_[pass.first_use + i];
+      needed = IsWriteState(use.state) &&
+               (!resources_[use.resource].transient || needed_[use.resource]);
+    }
+    pass.culled = !needed;
+    if (!needed) {
+      stats_.culled_passes++;
+      continue;
+    }
+    for (uint32_t i = 0; i < pass.use_count; i++) {
+      needed_[uses_[pass.first_use + i].resource] = true;
+    }
+  }
+
+  schedule_.clear();
+  for (uint32_t pass = 0; pass < passes_.size(); pass++) {
+    if (!passes_[pass].culled) {
+      schedule_.push_back(pass);
+    }
+  }
+}
+
+void RenderGraph::ComputeLifetimes() {
+  for (Resource &resource : resources_) {
+    resource.first_step = kNoStep;
+    resource.last_step = kNoStep;
+  }
+  for (uint32_t step = 0; step < schedule_.size(); step++) {
+    const Pass &pass = passes_[schedule_[step]];
+    for (uint32_t i = 0; i < pass.use_count; i++) {
+      Resource &resource = resources_[uses_[pass.first_use + i].resource];
+      if (resource.first_step == kNoStep) {
+        resource.first_step = step;
+      }
+      resource.last_step = step;
+    }
+  }
+}
+
+void RenderGraph::PlaceTransients() {
+  placement_order_.clear();
+  for (uint32_t index = 0; index < resources_.size(); index++) {
+    const Resource &resource = resources_[index];
+    if (resource.transient && resource.first_step != kNoStep) {
+      placement_order_.push_back(index);
+      stats_.transient_resources++;
+      stats_.unaliased_bytes =
+          AlignUp(stats_.unaliased_bytes, resource.desc.alignment) +
+          resource.desc.size;
+    }
+  }
+
+  // Largest first, each at the lowest offset that no resource alive at the
+  // same time occupies
+  std::stable_sort(placement_order_.begin(), placement_order_.end(),
+                   [&](uint32_t a, uint32_t b) {
+                     return resources_[a].desc.size > resources_[b].desc.size;
+                   });
+  for (uint32_t i = 0; i < placement_order_.size(); i++) {
+    Resource &resource = resources_[placement_order_[i]];
+    conflicts_.clear();
+    for (uint32_t j = 0; j < i; j++) {
+      const Resource &placed = resources_[placement_order_[j]];
+      if (placed.first_step <= resource.last_step &&
+          resource.first_step <= placed.last_step) {
+        conflicts_.push_back(
+            {placed.offset, placed.offset + placed.desc.size});
+      }
+    }
+    std::sort(conflicts_.begin(), conflicts_.end(),
+              [](const Interval &a, const Interval &b) {
+                return a.begin < b.begin;
+              });
+    uint64_t offset = 0;
+    for (const Interval &conflict : conflicts_) {
+      if (conflict.begin >= offset + resource.desc.size) {
+        break;
+      }
+      if (conflict.end > offset) {
+        offset = AlignUp(conflict.end, resource.desc.alignment);
+      }
+    }
+    resource.offset = offset;
+    stats_.aliased_bytes =
+        std::max(stats_.aliased_bytes, offset + resource.desc.size);
+  }
+}
+
+void RenderGraph::ComputeBarriers() {
+  for (Resource &resource : resources_) {
+    resource.state = resource.transient ? ResourceState::kUndefined
+                                        : resource.initial_state;
+    resource.previous_step = kNoStep;
+  }
+  pending_barriers_.clear();
+
+  const uint32_t step_count = static_cast<uint32_t>(schedule_.size());
+  for (uint32_t step = 0; step < step_count; step++) {
+    const Pass &pass = passes_[schedule_[step]];
+    for (uint32_t i = 0; i < pass.use_count; i++) {
+      const ResourceUse &use = uses_[pass.first_use + i];
+      Resource &resource = resources_[use.resource];
+      if (resource.transient && resource.first_step == step) {
+        // The memory of every resource that ended before is taken over, with
+        // a single predecessor the barrier can name it
+        uint32_t aliased_resource = kNoResource;
+        uint32_t predecessors = 0;
+        for (uint32_t other : placement_order_) {
+          const Resource &previous = resources_[other];
+          if (previous.last_step < step && SharesMemory(resource, previous)) {
+            aliased_resource = other;
+            predecessors++;
+          }
+        }
+        if (predecessors > 0) {
+          AddBarrier(step, {GraphBarrierType::kAliasing,
+                            GraphBarrierSplit::kNone, ResourceState::kUndefined,
+                            use.state, use.resource,
+                            predecessors == 1 ? aliased_resource
+                                              : kNoResource});
+        }
+        // From whatever state the backend left it in
+        AddBarrier(step, {GraphBarrierType::kTransition,
+                          GraphBarrierSplit::kNone, ResourceState::kUndefined,
+                          use.state, use.resource, kNoResource});
+      } else if (resource.state != use.state) {
+        GraphBarrier barrier = {GraphBarrierType::kTransition,
+                                GraphBarrierSplit::kNone, resource.state,
+                                use.state, use.resource, kNoResource};
+        if (resource.previous_step != kNoStep &&
+            resource.previous_step + 1 < step) {
+          barrier.split = GraphBarrierSplit::kBegin;
+          AddBarrier(resource.previous_step + 1, barrier);
+          barrier.split = GraphBarrierSplit::kEnd;
+        }
+        AddBarrier(step, barrier);
+      } else if (use.state == ResourceState::kUnorderedAccess) {
+        AddBarrier(step, {GraphBarrierType::kUav, GraphBarrierSplit::kNone,
+                          use.state, use.state, use.resource, kNoResource});
+      }
+      resource.state = use.state;
+      resource.previous_step = step;
+    }
+  }
+
+  // Hand imported resources back in the state their owner expects
+  for (uint32_t index = 0; index < resources_.size(); index++) {
+    Resource &resource = resources_[index];
+    if (resource.transient || resource.state == resource.final_state) {
+      continue;
+    }
+    GraphBarrier barrier = {GraphBarrierType::kTransition,
+                            GraphBarrierSplit::kNone, resource.state,
+                            resource.final_state, index, kNoResource};
+    if (resource.previous_step != kNoStep &&
+        resource.previous_step + 1 < step_count) {
+      barrier.split = GraphBarrierSplit::kBegin;
+      AddBarrier(resource.previous_step + 1, barrier);
+      barrier.split = GraphBarrierSplit::kEnd;
+    }
+    AddBarrier(step_count, barrier);
+    resource.state = resource.final_state;
+  }
+
+  // Counting sort by step, keeping the order barriers were added in
+  batch_offsets_.assign(step_count + 2, 0);
+  for (const PendingBarrier &pending : pending_barriers_) {
+    batch_offsets_[pending.step + 1]++;
+  }
+  for (uint32_t step = 0; step <= step_count; step++) {
+    if (batch_offsets_[step + 1] > 0) {
+      stats_.barrier_batches++;
+    }
+    batch_offsets_[step + 1] += batch_offsets_[step];
+  }
+  barriers_.resize(pending_barriers_.size());
+  for (const PendingBarrier &pending : pending_barriers_) {
+    // batch_offsets_[step] is advanced to the end of the batch while filling,
+    // which leaves it at the start of the next batch
+    barriers_[batch_offsets_[pending.step]++] = pending.barrier;
+  }
+  for (uint32_t step = step_count + 1; step > 0; step--) {
+    batch_offsets_[step] = batch_offsets_[step - 1];
+  }
+  batch_offsets_[0] = 0;
+
+  stats_.barriers = static_cast<uint32_t>(barriers_.size());
+  for (const GraphBarrier &barrier : barriers_) {
+    stats_.split_barriers += barrier.split == GraphBarrierSplit::kBegin;
+    stats_.aliasing_barriers += barrier.type == GraphBarrierType::kAliasing;
+  }
+}
+
+void RenderGraph::AddBarrier(uint32_t step, const GraphBarrier &barrier) {
+  pending_barriers_.push_back({step, barrier});
+}
+
+bool RenderGraph::SharesMemory(const Resource &a, const Resource &b) const {
+  return &a != &b && a.offset < b.offset + b.desc.size &&
+         b.offset < a.offset + a.desc.size;
+}
+
+std::string RenderGraph::GetReport() const {
+  std::ostringstream report;
+  for (uint32_t step = 0; step <= schedule_.size(); step++) {
+    // Culled passes are listed where they would have run
+    const uint32_t first_pass = step == 0 ? 0 : schedule_[step - 1] + 1;
+    const uint32_t end_pass =
+        step == schedule_.size() ? static_cast<uint32_t>(passes_.size())
+                                 : schedule_[step];
+    for (uint32_t pass = first_pass; pass < end_pass; pass++) {
+      report << "  (culled) " << passes_[pass].name << std::endl;
+    }
+    const GraphBarrierBatch batch = GetBarriers(step);
+    for (uint32_t i = 0; i < batch.count; i++) {
+      const GraphBarrier &barrier = batch.barriers[i];
+      report << "    " << resources_[barrier.resource].name << ": ";
+      if (barrier.type == GraphBarrierType::kAliasing) {
+        report << "aliases "
+               << (barrier.aliased_resource == kNoResource
+                       ? "several resources"
+                       : resources_[barrier.aliased_resource].name);
+      } else if (barrier.type == GraphBarrierType::kUav) {
+        report << "UAV barrier";
+      } else {
+        report << GetResourceStateName(barrier.before) << " -> "
+               << GetResourceStateName(barrier.after);
+      }
+      if (barrier.split == GraphBarrierSplit::kBegin) {
+        report << ", split begin";
+      } else if (barrier.split == GraphBarrierSplit::kEnd) {
+        report << ", split end";
+      }
+      report << std::endl;
+    }
+    if (step < schedule_.size()) {
+      report << "  " << passes_[schedule_[step]].name << std::endl;
+    }
+  }
+
+  report << stats_.passes - stats_.culled_passes << " of " << stats_.passes
+         << " passes, " << stats_.barriers << " barriers in "
+         << stats_.barrier_batches << " batches, " << stats_.split_barriers
+         << " split, " << stats_.aliasing_barriers << " aliasing" << std::endl;
+  report << "Transient memory: " << stats_.transient_resources
+         << " resources, peak "
+         << DataSizeToStringNotation(stats_.unaliased_bytes)
+         << " without aliasing, "
+         << DataSizeToStringNotation(stats_.aliased_bytes) << " aliased"
+         << std::endl;
+  return report.str();
+}
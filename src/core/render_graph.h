@@ -0,0 +1,217 @@
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Resource states as D3D12 names them, the backend maps them one to one
+enum class ResourceState : uint8_t {
+  // Contents and state of a transient resource before its first use in the
+  // frame, the backend substitutes the state it left the resource in
+  kUndefined,
+  // PRESENT, which D3D12 also calls COMMON
+  kPresent,
+  kRenderTarget,
+  kDepthWrite,
+  kDepthRead,
+  kShaderResource,
+  kUnorderedAccess,
+  kCopySource,
+  kCopyDest,
+  kVertexBuffer,
+};
+
+const char *GetResourceStateName(ResourceState state);
+// Render target, depth write, unordered access and copy destination
+bool IsWriteState(ResourceState state);
+
+// A pass accesses each resource in one state, which tells whether it reads
+// or writes it
+struct ResourceUse {
+  uint32_t resource;
+  ResourceState state;
+};
+
+// Memory requirements of a transient resource, as the device reports them
+struct TransientResourceDesc {
+  uint64_t size;
+  uint64_t alignment;
+};
+
+enum class GraphBarrierType : uint8_t {
+  kTransition,
+  // The memory of resource was used by aliased_resource before
+  kAliasing,
+  // Unordered access of one pass completes before the next one starts
+  kUav,
+};
+
+// Transitions whose resource is idle for passes in between are split, the
+// begin half is recorded right after the last use and the end half before
+// the next one, so the GPU can transition while the passes in between run
+enum class GraphBarrierSplit : uint8_t {
+  kNone,
+  kBegin,
+  kEnd,
+};
+
+struct GraphBarrier {
+  GraphBarrierType type;
+  GraphBarrierSplit split;
+  ResourceState before;
+  ResourceState after;
+  uint32_t resource;
+  // Previous user of the memory of an aliasing barrier, kNoResource when
+  // several resources used it
+  uint32_t aliased_resource;
+};
+
+struct GraphBarrierBatch {
+  const GraphBarrier *barriers;
+  uint32_t count;
+};
+
+struct RenderGraphStats {
+  uint32_t passes{0};
+  uint32_t culled_passes{0};
+  uint32_t transient_resources{0};
+  // Transient memory with every resource in its own range, and the size of
+  // the heap they alias in
+  uint64_t unaliased_bytes{0};
+  uint64_t aliased_bytes{0};
+  uint32_t barriers{0};
+  // ResourceBarrier calls, one per non-empty batch instead of one per barrier
+  uint32_t barrier_batches{0};
+  uint32_t split_barriers{0};
+  uint32_t aliasing_barriers{0};
+};
+
+// Passes of one frame with the resources they read and write, rebuilt every
+// frame. Compiling culls passes whose results nobody uses, places transient
+// resources with disjoint lifetimes at overlapping offsets of one heap and
+// computes the barriers before every pass as one batch. Passes run in the
+// order they were added, the graph only reorders barriers. Imported
+// resources live outside the graph and are left in their final state, their
+// writes and passes with side effects are what keeps passes alive.
+class RenderGraph {
+ public:
+  static const uint32_t kNoResource = UINT32_MAX;
+
+  // Start a new frame, keeping the capacity of the previous one. Names must
+  // outlive the frame, string literals usually.
+  void Reset();
+
+  uint32_t ImportResource(const char *name,
+                          ResourceState state,
+                          ResourceState final_state);
+  uint32_t CreateTransient(const char *name, const TransientResourceDesc &desc);
+  // Side effects keep the pass even when none of its writes are used
+  uint32_t AddPass(const char *name,
+                   std::initializer_list<ResourceUse> uses,
+                   bool has_side_effects = false);
+
+  void Compile();
+
+  // Passes left after culling, in execution order. Step i runs pass
+  // GetSchedule()[i].
+  const std::vector<uint32_t> &GetSchedule() const {
+    return schedule_;
+  }
+  uint32_t GetStepCount() const {
+    return static_cast<uint32_t>(schedule_.size());
+  }
+  // Barriers recorded before the pass of the step, the step count gives the
+  // transitions of imported resources into their final state
+  GraphBarrierBatch GetBarriers(uint32_t step) const;
+
+  uint32_t GetResourceCount() const {
+    return static_cast<uint32_t>(resources_.size());
+  }
+  bool IsTransient(uint32_t resource) const {
+    return resources_[resource].transient;
+  }
+  // False for transient resources no scheduled pass uses, they get no memory
+  bool IsUsed(uint32_t resource) const {
+    return resources_[resource].first_step != kNoStep;
+  }
+  uint64_t GetTransientOffset(uint32_t resource) const {
+    return resources_[resource].offset;
+  }
+  // State a resource is left in at the end of the frame
+  ResourceState GetFinalState(uint32_t resource) const {
+    return resources_[resource].state;
+  }
+  uint64_t GetTransientHeapSize() const {
+    return stats_.aliased_bytes;
+  }
+  const char *GetResourceName(uint32_t resource) const {
+    return resources_[resource].name;
+  }
+  const char *GetPassName(uint32_t pass) const {
+    return passes_[pass].name;
+  }
+  const RenderGraphStats &GetStats() const {
+    return stats_;
+  }
+  // Passes in order with their barriers and the culled ones marked, then the
+  // transient memory before and after aliasing
+  std::string GetReport() const;
+
+ private:
+  static const uint32_t kNoStep = UINT32_MAX;
+
+  struct Resource {
+    const char *name;
+    bool transient;
+    ResourceState initial_state;
+    ResourceState final_state;
+    TransientResourceDesc desc;
+    // Compile results, the state is the current one while barriers are
+    // computed
+    ResourceState state;
+    uint32_t first_step;
+    uint32_t last_step;
+    uint32_t previous_step;
+    uint64_t offset;
+  };
+
+  struct Pass {
+    const char *name;
+    uint32_t first_use;
+    uint32_t use_count;
+    bool has_side_effects;
+    bool culled;
+  };
+
+  struct Interval {
+    uint64_t begin;
+    uint64_t end;
+  };
+
+  struct PendingBarrier {
+    uint32_t step;
+    GraphBarrier barrier;
+  };
+
+  void CullPasses();
+  void ComputeLifetimes();
+  void PlaceTransients();
+  void ComputeBarriers();
+  void AddBarrier(uint32_t step, const GraphBarrier &barrier);
+  bool SharesMemory(const Resource &a, const Resource &b) const;
+
+  std::vector<Resource> resources_;
+  std::vector<Pass> passes_;
+  std::vector<ResourceUse> uses_;
+  std::vector<uint32_t> schedule_;
+  std::vector<PendingBarrier> pending_barriers_;
+  // Barriers sorted by step, batch i spans batch_offsets_[i] to
+  // batch_offsets_[i + 1]
+  std::vector<GraphBarrier> barriers_;
+  std::vector<uint32_t> batch_offsets_;
+  // Scratch of the culling and placement
+  std::vector<bool> needed_;
+  std::vector<uint32_t> placement_order_;
+  std::vector<Interval> conflicts_;
+  RenderGraphStats stats_;
+};
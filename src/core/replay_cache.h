@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "core/command_stream.h"
+
+struct ReplayCacheStats {
+  uint64_t lookups{0};
+  uint64_t hits{0};
+  uint64_t evictions{0};
+  // Time spent recording the cached values on misses
+  uint64_t record_time_ns{0};
+  // Recording time of every hit, the work replaying skipped
+  uint64_t time_saved_ns{0};
+};
+
+// Values recorded from command streams, such as bundles, looked up by the
+// content of the stream. Streams are compared byte for byte after the hash
+// matched, so collisions only cost a lookup. Lookups and inserts are thread
+// safe, references stay valid until their entry is collected.
+template <typename T>
+class ReplayCache {
+ public:
+  // Returns nullptr when no equal stream was recorded
+  const T *Find(const CommandStream &stream, uint64_t frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.lookups++;
+    Entry *entry = FindEntry(stream);
+    if (!entry) {
+      return nullptr;
+    }
+    entry->last_used_frame = frame;
+    stats_.hits++;
+    stats_.time_saved_ns += entry->record_time_ns;
+    return &entry->value;
+  }
+
+  // Keeps the existing value when an equal stream was inserted meanwhile
+  const T &Insert(const CommandStream &stream,
+                  T value,
+                  uint64_t record_time_ns,
+                  uint64_t frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.record_time_ns += record_time_ns;
+    if (Entry *entry = FindEntry(stream)) {
+      entry->last_used_frame = frame;
+      return entry->value;
+    }
+    auto it = entries_.emplace(
+        stream.GetHash(),
+        Entry{stream.GetData(), std::move(value), record_time_ns, frame});
+    return it->second.value;
+  }
+
+  // Drop the values not used within the last max_unused_frames frames
+  void Collect(uint64_t frame, uint64_t max_unused_frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.last_used_frame + max_unused_frames < frame) {
+        it = entries_.erase(it);
+        stats_.evictions++;
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  size_t GetSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+  }
+  ReplayCacheStats GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  struct Entry {
+    std::vector<uint8_t> commands;
+    T value;
+    uint64_t record_time_ns;
+    uint64_t last_used_frame;
+  };
+
+  Entry *FindEntry(const CommandStream &stream) {
+    auto range = entries_.equal_range(stream.GetHash());
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second.commands == stream.GetData()) {
+        return &it->second;
+      }
+    }
+    return nullptr;
+  }
+
+  mutable std::mutex mutex_;
+  std::unordered_multimap<uint64_t, Entry> entries_;
+  ReplayCacheStats stats_;
+};
@@ -0,0 +1,71 @@
+#include "core/ring_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+RingAllocator::RingAllocator(uint64_t capacity, GpuTimeline *timeline)
+    : capacity_(capacity), timeline_(timeline) {
+  if (capacity == 0) {
+    throw std::runtime_error("Ring allocator capacity must not be zero");
+  }
+}
+
+uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  if (size > capacity_) {
+    throw std::runtime_error("Allocation is larger than the ring");
+  }
+
+  Retire();
+  uint64_t offset = TryAllocate(size, alignment);
+  if (offset == kInvalidOffset && !batches_.empty()) {
+    stats_.full_stalls++;
+    while (offset == kInvalidOffset && !batches_.empty()) {
+      timeline_->WaitForValue(batches_.front().fence_value);
+      Retire();
+      offset = TryAllocate(size, alignment);
+    }
+  }
+  return offset;
+}
+
+void RingAllocator::FinishBatch(uint64_t fence_value) {
+  if (!HasOpenBatch()) {
+    return;
+  }
+  batches_.push_back({fence_value, head_});
+  open_batch_begin_ = head_;
+  stats_.batches++;
+}
+
+void RingAllocator::Retire() {
+  const uint64_t completed_value = timeline_->GetCompletedValue();
+  while (!batches_.empty() &&
+         batches_.front().fence_value <= completed_value) {
+    tail_ = batches_.front().end;
+    batches_.pop_front();
+  }
+  if (batches_.empty() && !HasOpenBatch()) {
+    // Nothing is in flight, restart at the beginning to avoid wrapping
+    head_ = tail_ = open_batch_begin_ = 0;
+  }
+}
+
+uint64_t RingAllocator::TryAllocate(uint64_t size, uint64_t alignment) {
+  const uint64_t offset = head_ % capacity_;
+  uint64_t aligned_offset = (offset + alignment - 1) / alignment * alignment;
+  uint64_t padding = aligned_offset - offset;
+  if (aligned_offset + size > capacity_) {
+    // Skip the tail end of the ring and wrap around to offset 0
+    padding = capacity_ - offset;
+    aligned_offset = 0;
+  }
+  if (head_ + padding + size - tail_ > capacity_) {
+    return kInvalidOffset;
+  }
+
+  head_ += padding + size;
+  stats_.allocations++;
+  stats_.allocated_bytes += size;
+  stats_.peak_usage = std::max(stats_.peak_usage, GetUsedSize());
+  return aligned_offset;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+#include "core/gpu_timeline.h"
+
+struct RingAllocatorStats {
+  uint64_t allocations{0};
+  uint64_t allocated_bytes{0};
+  uint64_t batches{0};
+  // Highest amount of the ring in use at once, alignment padding included
+  uint64_t peak_usage{0};
+  // Allocations that had to wait for the GPU because the ring was full
+  uint64_t full_stalls{0};
+};
+
+// Sub-allocates a fixed size ring of staging memory. Allocations are grouped
+// into batches, each batch is tagged with the fence value of the submission
+// that consumes it and is reclaimed in order once the timeline passes it.
+class RingAllocator {
+ public:
+  static const uint64_t kInvalidOffset = ~uint64_t(0);
+
+  RingAllocator(uint64_t capacity, GpuTimeline *timeline);
+
+  // Returns the offset of the allocation in the ring. Waits for older batches
+  // to retire when the ring is full, and returns kInvalidOffset if it is
+  // still full once only the open batch is left.
+  uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+  // Close the open batch, it is reclaimed once fence_value completes
+  void FinishBatch(uint64_t fence_value);
+
+  // Reclaim every batch the GPU has finished with
+  void Retire();
+
+  bool HasOpenBatch() const {
+    return head_ != open_batch_begin_;
+  }
+  uint64_t GetCapacity() const {
+    return capacity_;
+  }
+  uint64_t GetUsedSize() const {
+    return head_ - tail_;
+  }
+  const RingAllocatorStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  struct Batch {
+    uint64_t fence_value;
+    uint64_t end;
+  };
+
+  uint64_t TryAllocate(uint64_t size, uint64_t alignment);
+
+  uint64_t capacity_;
+  GpuTimeline *timeline_;
+  // Monotonic positions, the physical offset is taken modulo the capacity
+  uint64_t head_{0};
+  uint64_t tail_{0};
+  uint64_t open_batch_begin_{0};
+  std::deque<Batch> batches_;
+  RingAllocatorStats stats_;
+};
@@ -0,0 +1,94 @@
+#include "core/scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "core/draw_partition.h"
+#include "core/profiler.h"
+
+glm::mat4 Camera2D::GetViewProjection() const {
+  glm::mat4 view_projection(1.0f);
+  view_projection[0][0] = zoom;
+  view_projection[1][1] = zoom;
+  view_projection[3][0] = -position.x * zoom;
+  view_projection[3][1] = -position.y * zoom;
+  return view_projection;
+}
+
+InstanceData Camera2D::ToClipSpace(const InstanceData &instance) const {
+  return {{(instance.offset.x - position.x) * zoom,
+           (instance.offset.y - position.y) * zoom},
+          {instance.scale.x * zoom, instance.scale.y * zoom}};
+}
+
+uint32_t Scene::AddObject(uint32_t mesh,
+                          const InstanceData &instance,
+                          const BoundingSphere &mesh_bounds,
+                          const glm::vec4 &color) {
+  center_x_.push_back(mesh_bounds.center.x * instance.scale.x +
+                      instance.offset.x);
+  center_y_.push_back(mesh_bounds.center.y * instance.scale.y +
+                      instance.offset.y);
+  center_z_.push_back(mesh_bounds.center.z);
+  radius_.push_back(mesh_bounds.radius * std::max(std::abs(instance.scale.x),
+                                                  std::abs(instance.scale.y)));
+  meshes_.push_back(mesh);
+  instances_.push_back(instance);
+  colors_.push_back(color);
+  return static_cast<uint32_t>(meshes_.size() - 1);
+}
+
+void Scene::Clear() {
+  center_x_.clear();
+  center_y_.clear();
+  center_z_.clear();
+  radius_.clear();
+  meshes_.clear();
+  instances_.clear();
+  colors_.clear();
+}
+
+SceneCuller::SceneCuller(JobSystem *job_system, SimdLevel level)
+    : job_system_(job_system),
+      level_(std::min(level, GetSupportedSimdLevel())) {
+}
+
+const std::vector<uint32_t> &SceneCuller::Cull(const Scene &scene,
+                                               const Frustum &frustum) {
+  PROFILE_SCOPE("Cull");
+  const auto start = std::chrono::steady_clock::now();
+
+  // More chunks than threads, so workers that hit mostly culled chunks steal
+  // from the others
+  const std::vector<DrawChunk> chunks =
+      PartitionDraws(scene.GetObjectCount(), job_system_->GetThreadCount() * 4,
+                     kMinObjectsPerChunk);
+  if (chunk_visible_.size() < chunks.size()) {
+    chunk_visible_.resize(chunks.size());
+  }
+  const SphereArrays bounds = scene.GetBounds();
+  job_system_->ParallelFor(
+      static_cast<uint32_t>(chunks.size()), [&](uint32_t chunk, uint32_t) {
+        PROFILE_SCOPE("CullChunk");
+        std::vector<uint32_t> &visible = chunk_visible_[chunk];
+        visible.clear();
+        CullSpheres(frustum, bounds, chunks[chunk].first_draw,
+                    chunks[chunk].first_draw + chunks[chunk].draw_count,
+                    level_, &visible);
+      });
+
+  visible_.clear();
+  for (uint32_t chunk = 0; chunk < chunks.size(); chunk++) {
+    visible_.insert(visible_.end(), chunk_visible_[chunk].begin(),
+                    chunk_visible_[chunk].end());
+  }
+
+  stats_.objects = scene.GetObjectCount();
+  stats_.visible = static_cast<uint32_t>(visible_.size());
+  stats_.chunks = static_cast<uint32_t>(chunks.size());
+  stats_.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return visible_;
+}
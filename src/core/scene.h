@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "core/cpu_features.h"
+#include "core/frustum_culling.h"
+#include "core/job_system.h"
+#include "core/mesh.h"
+#include "core/vertex.h"
+#include "glm/glm.hpp"
+
+// Orthographic camera looking at the xy plane, zoom scales world units to
+// clip space around the camera position
+struct Camera2D {
+  glm::vec2 position{0.0f, 0.0f};
+  float zoom{1.0f};
+
+  glm::mat4 GetViewProjection() const;
+  // Instance transform of an object seen through the camera
+  InstanceData ToClipSpace(const InstanceData &instance) const;
+};
+
+// Objects of the frame in structure of arrays layout. Culling only streams
+// through the tightly packed bounding sphere arrays, transforms and meshes
+// are touched for the visible objects alone.
+class Scene {
+ public:
+  // Bounds are in mesh space and follow the instance transform. The color
+  // tints the vertex colors of the mesh.
+  uint32_t AddObject(uint32_t mesh,
+                     const InstanceData &instance,
+                     const BoundingSphere &mesh_bounds,
+                     const glm::vec4 &color = glm::vec4(1.0f));
+  void Clear();
+
+  uint32_t GetObjectCount() const {
+    return static_cast<uint32_t>(meshes_.size());
+  }
+  uint32_t GetMesh(uint32_t object) const {
+    return meshes_[object];
+  }
+  const InstanceData &GetInstance(uint32_t object) const {
+    return instances_[object];
+  }
+  const glm::vec4 &GetColor(uint32_t object) const {
+    return colors_[object];
+  }
+  SphereArrays GetBounds() const {
+    return {center_x_.data(), center_y_.data(), center_z_.data(),
+            radius_.data()};
+  }
+
+ private:
+  std::vector<float> center_x_;
+  std::vector<float> center_y_;
+  std::vector<float> center_z_;
+  std::vector<float> radius_;
+  std::vector<uint32_t> meshes_;
+  std::vector<InstanceData> instances_;
+  std::vector<glm::vec4> colors_;
+};
+
+struct CullingStats {
+  uint32_t objects{0};
+  uint32_t visible{0};
+  uint32_t chunks{0};
+  uint64_t time_ns{0};
+};
+
+// Frustum culls a scene in parallel chunks on the job system with the SIMD
+// kernel of the chosen level. Every chunk collects its visible objects on its
+// own and the lists are joined in chunk order, so the result is sorted.
+class SceneCuller {
+ public:
+  // Below this a chunk costs more in scheduling than it saves
+  static const uint32_t kMinObjectsPerChunk = 16384;
+
+  explicit SceneCuller(JobSystem *job_system,
+                       SimdLevel level = GetSupportedSimdLevel());
+
+  // Returns the visible objects, valid until the next call
+  const std::vector<uint32_t> &Cull(const Scene &scene,
+                                    const Frustum &frustum);
+
+  SimdLevel GetSimdLevel() const {
+    return level_;
+  }
+  const CullingStats &GetStats() const {
+    return stats_;
+  }
+
+ private:
+  JobSystem *job_system_;
+  SimdLevel level_;
+  std::vector<std::vector<uint32_t>> chunk_visible_;
+  std::vector<uint32_t> visible_;
+  CullingStats stats_;
+};
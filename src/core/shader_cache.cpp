@@ -0,0 +1,179 @@
+#include "core/shader_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "core/hash.h"
+
+namespace {
+const uint32_t kShaderEntryMagic = 0x31435348;  // "HSC1"
+
+struct ShaderEntryHeader {
+  uint32_t magic;
+  uint32_t reserved;
+  uint64_t key;
+  uint64_t compile_time_ns;
+  uint64_t size;
+};
+
+bool ReadFile(const std::filesystem::path &path, std::vector<uint8_t> *data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  data->assign(std::istreambuf_iterator<char>(file),
+               std::istreambuf_iterator<char>());
+  return true;
+}
+
+// Write next to the destination and rename, readers never see partial files
+void WriteFileAtomically(const std::filesystem::path &path,
+                         const void *header,
+                         size_t header_size,
+                         const std::vector<uint8_t> &data) {
+  static std::atomic<uint32_t> temporary_index{0};
+  std::filesystem::create_directories(path.parent_path());
+  std::filesystem::path temporary_path = path;
+  temporary_path += ".tmp" + std::to_string(temporary_index++);
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    file.write(static_cast<const char *>(header), header_size);
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    if (!file) {
+      throw std::runtime_error("Failed to write " + temporary_path.string());
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary_path, path, error);
+  if (error) {
+    std::filesystem::remove(temporary_path, error);
+  }
+}
+
+// Hash a source file followed by everything it includes, depth first in
+// order of appearance
+void HashSourceFile(const std::filesystem::path &path,
+                    std::set<std::filesystem::path> *visited,
+                    Hasher *hasher) {
+  const std::filesystem::path normalized = path.lexically_normal();
+  if (!visited->insert(normalized).second) {
+    return;
+  }
+  std::vector<uint8_t> source;
+  if (!ReadFile(normalized, &source)) {
+    throw std::runtime_error("Failed to read shader source " +
+                             normalized.string());
+  }
+  hasher->Update(normalized.filename().string());
+  hasher->Update(static_cast<uint64_t>(source.size()));
+  hasher->Update(source.data(), source.size());
+
+  std::istringstream lines(std::string(source.begin(), source.end()));
+  std::string line;
+  while (std::getline(lines, line)) {
+    const size_t directive = line.find_first_not_of(" \t");
+    if (directive == std::string::npos ||
+        line.compare(directive, 8, "#include") != 0) {
+      continue;
+    }
+    const size_t open = line.find_first_of("\"<", directive + 8);
+    const size_t close =
+        line.find_first_of("\">", open == std::string::npos ? open : open + 1);
+    if (open == std::string::npos || close == std::string::npos) {
+      continue;
+    }
+    HashSourceFile(
+        normalized.parent_path() / line.substr(open + 1, close - open - 1),
+        visited, hasher);
+  }
+}
+}  // namespace
+
+ShaderCache::ShaderCache(const std::string &directory,
+                         ShaderCompiler *compiler)
+    : directory_(directory), compiler_(compiler) {
+}
+
+std::vector<uint8_t> ShaderCache::GetShader(
+    const ShaderCompileRequest &request) {
+  const auto start = std::chrono::steady_clock::now();
+  const uint64_t key = ComputeKey(request);
+  const std::filesystem::path path =
+      std::filesystem::path(directory_) / (HashToString(key) + ".cso");
+
+  std::vector<uint8_t> entry;
+  if (ReadFile(path, &entry) && entry.size() >= sizeof(ShaderEntryHeader)) {
+    ShaderEntryHeader header;
+    memcpy(&header, entry.data(), sizeof(header));
+    if (header.magic == kShaderEntryMagic && header.key == key &&
+        header.size == entry.size() - sizeof(header)) {
+      std::vector<uint8_t> bytecode(entry.begin() + sizeof(header),
+                                    entry.end());
+      const uint64_t load_time_ns =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count();
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      stats_.hits++;
+      if (header.compile_time_ns > load_time_ns) {
+        stats_.time_saved_ns += header.compile_time_ns - load_time_ns;
+      }
+      return bytecode;
+    }
+  }
+
+  const auto compile_start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> bytecode = compiler_->Compile(request);
+  const uint64_t compile_time_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - compile_start)
+          .count();
+
+  ShaderEntryHeader header = {kShaderEntryMagic, 0, key, compile_time_ns,
+                              bytecode.size()};
+  WriteFileAtomically(path, &header, sizeof(header), bytecode);
+
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats_.misses++;
+  stats_.compile_time_ns += compile_time_ns;
+  return bytecode;
+}
+
+uint64_t ShaderCache::ComputeKey(const ShaderCompileRequest &request) const {
+  Hasher hasher;
+  std::set<std::filesystem::path> visited;
+  HashSourceFile(request.path, &visited, &hasher);
+  hasher.Update(static_cast<uint64_t>(request.defines.size()));
+  for (const auto &define : request.defines) {
+    hasher.Update(define.name);
+    hasher.Update(define.value);
+  }
+  hasher.Update(request.entry_point);
+  hasher.Update(request.target);
+  hasher.Update(static_cast<uint64_t>(request.compile_flags));
+  hasher.Update(compiler_->GetVersion());
+  return hasher.GetHash();
+}
+
+bool ShaderCache::LoadBlob(const std::string &name,
+                           std::vector<uint8_t> *data) const {
+  return ReadFile(std::filesystem::path(directory_) / name, data);
+}
+
+void ShaderCache::StoreBlob(const std::string &name,
+                            const std::vector<uint8_t> &data) const {
+  WriteFileAtomically(std::filesystem::path(directory_) / name, nullptr, 0,
+                      data);
+}
+
+ShaderCacheStats ShaderCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  return stats_;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/shader_compiler.h"
+
+struct ShaderCacheStats {
+  uint64_t hits{0};
+  uint64_t misses{0};
+  uint64_t compile_time_ns{0};
+  // Recorded compile time of every hit minus the time it took to load it
+  uint64_t time_saved_ns{0};
+};
+
+// Content addressed on-disk cache of shader bytecode. Keys hash the source
+// with every file it includes, the defines, entry point, target, compile
+// flags and the compiler version, so any change produces a new entry. Named
+// blobs such as serialized pipeline libraries share the same directory.
+// Safe to use from several threads at once.
+class ShaderCache {
+ public:
+  ShaderCache(const std::string &directory, ShaderCompiler *compiler);
+
+  // Loads the bytecode from disk, compiling and storing it on a miss
+  std::vector<uint8_t> GetShader(const ShaderCompileRequest &request);
+
+  uint64_t ComputeKey(const ShaderCompileRequest &request) const;
+
+  bool LoadBlob(const std::string &name, std::vector<uint8_t> *data) const;
+  void StoreBlob(const std::string &name,
+                 const std::vector<uint8_t> &data) const;
+
+  ShaderCacheStats GetStats() const;
+
+ private:
+  std::string directory_;
+  ShaderCompiler *compiler_;
+  mutable std::mutex stats_mutex_;
+  ShaderCacheStats stats_;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShaderDefine {
+  std::string name;
+  std::string value;
+};
+
+struct ShaderCompileRequest {
+  std::string path;
+  std::string entry_point;
+  std::string target;
+  std::vector<ShaderDefine> defines;
+  uint32_t compile_flags{0};
+};
+
+// Turns HLSL source into bytecode. Implemented by the D3D compiler on Windows
+// and by stubs wherever shaders only need to be cached, not run.
+class ShaderCompiler {
+ public:
+  virtual ~ShaderCompiler() = default;
+
+  // Throws std::runtime_error carrying the diagnostics on failure
+  virtual std::vector<uint8_t> Compile(const ShaderCompileRequest &request) = 0;
+
+  // Identifies the compiler build, entries of other builds are never reused
+  virtual std::string GetVersion() const = 0;
+};
@@ -0,0 +1,80 @@
+#include "core/simulated_gpu_timeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+SimulatedGpuTimeline::SimulatedGpuTimeline(SimulatedCpuClock *clock)
+    : clock_(clock != nullptr ? clock : &own_clock_) {
+}
+
+uint64_t SimulatedGpuTimeline::Signal() {
+  // A signal completes once all work queued in front of it has finished
+  gpu_free_at_ns_ = std::max(gpu_free_at_ns_, clock_->time_ns);
+  pending_signals_.push_back({++last_signaled_value_, gpu_free_at_ns_});
+  return last_signaled_value_;
+}
+
+uint64_t SimulatedGpuTimeline::GetCompletedValue() {
+  Retire();
+  return completed_value_;
+}
+
+void SimulatedGpuTimeline::WaitForValue(uint64_t value) {
+  if (value > last_signaled_value_) {
+    throw std::runtime_error("Waiting on a fence value that is never signaled");
+  }
+  Retire();
+  while (completed_value_ < value) {
+    const PendingSignal &signal = pending_signals_.front();
+    clock_->wait_ns += signal.time_ns - clock_->time_ns;
+    clock_->time_ns = signal.time_ns;
+    Retire();
+  }
+}
+
+void SimulatedGpuTimeline::WaitForTimeline(GpuTimeline *other,
+                                           uint64_t value) {
+  SimulatedGpuTimeline *other_timeline =
+      static_cast<SimulatedGpuTimeline *>(other);
+  if (other_timeline->clock_ != clock_) {
+    throw std::runtime_error("Waiting on a timeline of another device");
+  }
+  // Work queued from now on starts no earlier than the signal
+  const uint64_t start_ns = std::max(gpu_free_at_ns_, clock_->time_ns);
+  const uint64_t signal_ns = other_timeline->GetSignalTime(value);
+  if (signal_ns > start_ns) {
+    gpu_wait_ns_ += signal_ns - start_ns;
+    gpu_free_at_ns_ = signal_ns;
+  }
+}
+
+void SimulatedGpuTimeline::Submit(uint64_t gpu_duration_ns) {
+  gpu_free_at_ns_ =
+      std::max(gpu_free_at_ns_, clock_->time_ns) + gpu_duration_ns;
+  gpu_busy_ns_ += gpu_duration_ns;
+}
+
+void SimulatedGpuTimeline::AdvanceCpu(uint64_t cpu_duration_ns) {
+  clock_->time_ns += cpu_duration_ns;
+}
+
+void SimulatedGpuTimeline::Retire() {
+  while (!pending_signals_.empty() &&
+         pending_signals_.front().time_ns <= clock_->time_ns) {
+    completed_value_ = pending_signals_.front().value;
+    pending_signals_.pop_front();
+  }
+}
+
+uint64_t SimulatedGpuTimeline::GetSignalTime(uint64_t value) {
+  if (value > last_signaled_value_) {
+    throw std::runtime_error("Waiting on a fence value that is never signaled");
+  }
+  Retire();
+  for (const PendingSignal &signal : pending_signals_) {
+    if (signal.value >= value) {
+      return signal.time_ns;
+    }
+  }
+  return 0;
+}
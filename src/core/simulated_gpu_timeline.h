@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+#include "core/gpu_timeline.h"
+
+// CPU side of a simulated device, shared by the timelines of its queues
+struct SimulatedCpuClock {
+  uint64_t time_ns{0};
+  // Time spent blocked in WaitForValue on any of the queues
+  uint64_t wait_ns{0};
+};
+
+// Deterministic GPU timeline driven by a virtual clock. The CPU side advances
+// time with AdvanceCpu, submitted work occupies the GPU for its duration and
+// waits jump the clock forward to the completion of the awaited signal.
+// Queues that run in parallel are timelines sharing one clock.
+class SimulatedGpuTimeline : public GpuTimeline {
+ public:
+  // Without a clock the timeline uses one of its own
+  explicit SimulatedGpuTimeline(SimulatedCpuClock *clock = nullptr);
+
+  SimulatedGpuTimeline(const SimulatedGpuTimeline &) = delete;
+  SimulatedGpuTimeline &operator=(const SimulatedGpuTimeline &) = delete;
+
+  uint64_t Signal() override;
+  uint64_t GetCompletedValue() override;
+  void WaitForValue(uint64_t value) override;
+  // The other timeline has to share the clock and to have signaled the value
+  // already, the simulation can not wait on future signals
+  void WaitForTimeline(GpuTimeline *other, uint64_t value) override;
+
+  // Queue GPU work that starts once the GPU is free and the CPU submitted it
+  void Submit(uint64_t gpu_duration_ns);
+
+  // Spend CPU time on the calling thread
+  void AdvanceCpu(uint64_t cpu_duration_ns);
+
+  uint64_t GetCpuTime() const {
+    return clock_->time_ns;
+  }
+  uint64_t GetGpuBusyTime() const {
+    return gpu_busy_ns_;
+  }
+  uint64_t GetCpuWaitTime() const {
+    return clock_->wait_ns;
+  }
+  // Time the queue sat idle waiting on other queues
+  uint64_t GetGpuWaitTime() const {
+    return gpu_wait_ns_;
+  }
+
+ private:
+  struct PendingSignal {
+    uint64_t value;
+    uint64_t time_ns;
+  };
+
+  void Retire();
+  // Time at which the value is reached, 0 when it already was
+  uint64_t GetSignalTime(uint64_t value);
+
+  SimulatedCpuClock own_clock_;
+  SimulatedCpuClock *clock_;
+  std::deque<PendingSignal> pending_signals_;
+  uint64_t gpu_free_at_ns_{0};
+  uint64_t gpu_busy_ns_{0};
+  uint64_t gpu_wait_ns_{0};
+  uint64_t last_signaled_value_{0};
+  uint64_t completed_value_{0};
+};
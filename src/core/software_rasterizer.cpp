@@ -0,0 +1,558 @@
+#include "core/software_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "core/profiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE2
+#endif
+
+namespace {
+// Sub-pixel precision of the fixed point screen coordinates, same as D3D
+const int32_t kSubPixelBits = 4;
+const int32_t kSubPixelScale = 1 << kSubPixelBits;
+
+// Edge values are clamped into this range before being stepped in 32 bits.
+// Stepping across a tile moves a value by less than half of it, so clamping
+// never flips the sign of a pixel inside the tile.
+const int64_t kEdgeClamp = int64_t(1) << 29;
+
+const uint8_t kBitCount[16] = {0, 1, 1, 2, 1, 2, 2, 3,
+                               1, 2, 2, 3, 2, 3, 3, 4};
+
+// Signed distance to the clip volume planes, inside when not negative
+float PlaneDistance(const glm::vec4 &position, int plane) {
+  switch (plane) {
+    case 0:
+      return position.w + position.x;
+    case 1:
+      return position.w - position.x;
+    case 2:
+      return position.w + position.y;
+    case 3:
+      return position.w - position.y;
+    case 4:
+      return position.z;
+    default:
+      return position.w - position.z;
+  }
+}
+
+int32_t ClampEdge(int64_t value) {
+  return static_cast<int32_t>(
+      std::min(std::max(value, -kEdgeClamp), kEdgeClamp));
+}
+
+#ifndef SOFTWARE_RASTERIZER_SSE2
+uint32_t PackColor(float r, float g, float b, float a) {
+  const float color[4] = {r, g, b, a};
+  return PackRGBA8(color);
+}
+#endif
+}  // namespace
+
+SoftwareRasterizer::SoftwareRasterizer(JobSystem *job_system)
+    : job_system_(job_system) {
+}
+
+void SoftwareRasterizer::OMSetRenderTarget(Image *render_target) {
+  if (render_target->width > kMaxRenderTargetSize ||
+      render_target->height > kMaxRenderTargetSize) {
+    throw std::runtime_error("Render target is too large");
+  }
+  render_target_ = render_target;
+  tiles_x_ = (render_target->width + kTileSize - 1) / kTileSize;
+  tiles_y_ = (render_target->height + kTileSize - 1) / kTileSize;
+}
+
+void SoftwareRasterizer::RSSetViewport(const RasterViewport &viewport) {
+  viewport_ = viewport;
+}
+
+void SoftwareRasterizer::RSSetScissorRect(const RasterRect &scissor_rect) {
+  scissor_rect_ = scissor_rect;
+}
+
+void SoftwareRasterizer::IASetVertexBuffer(const Vertex *vertices,
+                                           uint32_t vertex_count) {
+  vertices_ = vertices;
+  vertex_count_ = vertex_count;
+}
+
+void SoftwareRasterizer::IASetIndexBuffer(const void *indices,
+                                          uint32_t index_count,
+                                          uint32_t index_size) {
+  if (index_size != 2 && index_size != 4) {
+    throw std::runtime_error("Index size must be 2 or 4 bytes");
+  }
+  indices_ = static_cast<const uint8_t *>(indices);
+  index_count_ = index_count;
+  index_size_ = index_size;
+}
+
+void SoftwareRasterizer::SetPositionQuantization(
+    const PositionQuantization &quantization) {
+  quantization_ = quantization;
+}
+
+void SoftwareRasterizer::SetObjectBuffer(const ObjectData *objects,
+                                         uint32_t object_count) {
+  objects_ = objects;
+  object_count_ = object_count;
+}
+
+void SoftwareRasterizer::SetFirstObject(uint32_t first_object) {
+  first_object_ = first_object;
+}
+
+void SoftwareRasterizer::ClearRenderTargetView(const float color[4]) {
+  const uint32_t packed = PackRGBA8(color);
+  job_system_->ParallelFor(tiles_y_, [&](uint32_t tile_y, uint32_t) {
+    const uint32_t y_end =
+        std::min((tile_y + 1) * kTileSize, render_target_->height);
+    for (uint32_t y = tile_y * kTileSize; y < y_end; y++) {
+      std::fill_n(render_target_->Row(y), render_target_->width, packed);
+    }
+  });
+}
+
+void SoftwareRasterizer::DrawInstanced(uint32_t vertex_count_per_instance,
+                                       uint32_t instance_count,
+                                       uint32_t start_vertex_location,
+                                       uint32_t /*start_instance_location*/) {
+  if (start_vertex_location + vertex_count_per_instance > vertex_count_) {
+    throw std::runtime_error("Draw reads past the end of the vertex buffer");
+  }
+  Draw(vertex_count_per_instance, instance_count, start_vertex_location, 0,
+       false);
+}
+
+void SoftwareRasterizer::DrawIndexedInstanced(
+    uint32_t index_count_per_instance,
+    uint32_t instance_count,
+    uint32_t start_index_location,
+    int32_t base_vertex_location,
+    uint32_t /*start_instance_location*/) {
+  if (!indices_ ||
+      start_index_location + index_count_per_instance > index_count_) {
+    throw std::runtime_error("Draw reads past the end of the index buffer");
+  }
+  Draw(index_count_per_instance, instance_count, start_index_location,
+       base_vertex_location, true);
+}
+
+void SoftwareRasterizer::Draw(uint32_t vertex_count_per_instance,
+                              uint32_t instance_count,
+                              uint32_t start_location,
+                              int32_t base_vertex_location,
+                              bool indexed) {
+  if (objects_ && uint64_t(first_object_) + instance_count > object_count_) {
+    throw std::runtime_error("Draw reads past the end of the object buffer");
+  }
+
+  const uint32_t triangles_per_instance = vertex_count_per_instance / 3;
+  const uint64_t triangle_count =
+      uint64_t(triangles_per_instance) * instance_count;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  clip_rect_ = GetClipRect();
+
+  // Front end: shade, clip, set up and bin contiguous triangle ranges, so
+  // walking the bins in order keeps the API submission order
+  const uint32_t bin_count = std::min<uint64_t>(
+      job_system_->GetThreadCount() * 4, (triangle_count + 255) / 256);
+  bins_.resize(std::max(bin_count, 1u));
+  const uint32_t tile_count = tiles_x_ * tiles_y_;
+  job_system_->ParallelFor(
+      static_cast<uint32_t>(bins_.size()), [&](uint32_t bin_index, uint32_t) {
+        PROFILE_SCOPE("BinTriangles");
+        Bin &bin = bins_[bin_index];
+        bin.triangles.clear();
+        bin.tile_triangles.resize(tile_count);
+        for (auto &tile : bin.tile_triangles) {
+          tile.clear();
+        }
+        bin.triangles_culled = 0;
+
+        const uint64_t begin = triangle_count * bin_index / bins_.size();
+        const uint64_t end = triangle_count * (bin_index + 1) / bins_.size();
+        for (uint64_t i = begin; i < end; i++) {
+          const uint32_t first_location =
+              start_location +
+              static_cast<uint32_t>(i % triangles_per_instance) * 3;
+          const uint32_t object =
+              first_object_ +
+              static_cast<uint32_t>(i / triangles_per_instance);
+          ClipVertex triangle[3];
+          for (uint32_t corner = 0; corner < 3; corner++) {
+            const uint32_t vertex =
+                indexed ? FetchIndex(first_location + corner) +
+                              static_cast<uint32_t>(base_vertex_location)
+                        : first_location + corner;
+            triangle[corner] = ShadeVertex(vertex, object);
+          }
+          ClipVertex polygon[kMaxClipVertices];
+          const uint32_t polygon_size = ClipTriangle(triangle, polygon);
+          if (polygon_size < 3) {
+            bin.triangles_culled++;
+            continue;
+          }
+          for (uint32_t j = 2; j < polygon_size; j++) {
+            SetupTriangle(polygon[0], polygon[j - 1], polygon[j], &bin);
+          }
+        }
+      });
+
+  // Back end: every tile is owned by exactly one worker
+  pixels_shaded_.assign(job_system_->GetThreadCount(), 0);
+  {
+    PROFILE_SCOPE("RasterizeTiles");
+    job_system_->ParallelFor(tile_count, [&](uint32_t tile, uint32_t thread) {
+      pixels_shaded_[thread] +=
+          RasterizeTile(tile % tiles_x_, tile / tiles_x_);
+    });
+  }
+
+  stats_.triangles_submitted += triangle_count;
+  for (const auto &bin : bins_) {
+    stats_.triangles_culled += bin.triangles_culled;
+    stats_.triangles_rasterized += bin.triangles.size();
+  }
+  for (uint64_t pixels : pixels_shaded_) {
+    stats_.pixels_shaded += pixels;
+  }
+}
+
+uint32_t SoftwareRasterizer::FetchIndex(uint32_t location) const {
+  if (index_size_ == 2) {
+    uint16_t index;
+    memcpy(&index, indices_ + location * 2, sizeof(index));
+    return index;
+  }
+  uint32_t index;
+  memcpy(&index, indices_ + location * 4, sizeof(index));
+  return index;
+}
+
+SoftwareRasterizer::ClipVertex SoftwareRasterizer::ShadeVertex(
+    uint32_t vertex_index,
+    uint32_t object_index) const {
+  // VSMain: positions are dequantized with the mesh constants, then the
+  // object scales and offsets x and y and tints the color. Like the input
+  // assembler, indices past the end of the vertex buffer read zeros.
+  const Vertex vertex =
+      vertex_index < vertex_count_ ? vertices_[vertex_index] : Vertex{};
+  glm::vec4 position(DequantizePosition(vertex.position, quantization_),
+                     1.0f);
+  glm::vec4 color = DequantizeColor(vertex.color);
+  if (objects_) {
+    const ObjectData &object = objects_[object_index];
+    position.x =
+        position.x * object.transform.scale.x + object.transform.offset.x;
+    position.y =
+        position.y * object.transform.scale.y + object.transform.offset.y;
+    color *= object.color;
+  }
+  return {position, color};
+}
+
+uint32_t SoftwareRasterizer::ClipTriangle(const ClipVertex *triangle,
+                                          ClipVertex *polygon) {
+  uint32_t outside_planes = 0;
+  for (int plane = 0; plane < 6; plane++) {
+    for (int i = 0; i < 3; i++) {
+      if (PlaneDistance(triangle[i].position, plane) < 0.0f) {
+        outside_planes |= 1u << plane;
+      }
+    }
+  }
+  std::copy(triangle, triangle + 3, polygon);
+  if (outside_planes == 0) {
+    return 3;
+  }
+
+  // Sutherland-Hodgman against every plane a vertex lies outside of
+  ClipVertex scratch[kMaxClipVertices];
+  uint32_t size = 3;
+  for (int plane = 0; plane < 6 && size >= 3; plane++) {
+    if (!(outside_planes & (1u << plane))) {
+      continue;
+    }
+    uint32_t clipped_size = 0;
+    for (uint32_t i = 0; i < size; i++) {
+      const ClipVertex &a = polygon[i];
+      const ClipVertex &b = polygon[(i + 1) % size];
+      const float distance_a = PlaneDistance(a.position, plane);
+      const float distance_b = PlaneDistance(b.position, plane);
+      if (distance_a >= 0.0f) {
+        scratch[clipped_size++] = a;
+      }
+      if ((distance_a >= 0.0f) != (distance_b >= 0.0f)) {
+        const float t = distance_a / (distance_a - distance_b);
+        scratch[clipped_size++] = {
+            a.position + (b.position - a.position) * t,
+            a.color + (b.color - a.color) * t};
+      }
+    }
+    std::copy(scratch, scratch + clipped_size, polygon);
+    size = clipped_size;
+  }
+  return size;
+}
+
+void SoftwareRasterizer::SetupTriangle(const ClipVertex &v0,
+                                       const ClipVertex &v1,
+                                       const ClipVertex &v2,
+                                       Bin *bin) {
+  const ClipVertex *vertices[3] = {&v0, &v1, &v2};
+  int64_t x[3], y[3];
+  float inv_w[3];
+  for (int i = 0; i < 3; i++) {
+    const glm::vec4 &position = vertices[i]->position;
+    inv_w[i] = 1.0f / position.w;
+    const float screen_x = viewport_.top_left_x +
+                           (position.x * inv_w[i] * 0.5f + 0.5f) *
+                               viewport_.width;
+    const float screen_y = viewport_.top_left_y +
+                           (0.5f - position.y * inv_w[i] * 0.5f) *
+                               viewport_.height;
+    x[i] = std::llround(screen_x * kSubPixelScale);
+    y[i] = std::llround(screen_y * kSubPixelScale);
+  }
+
+  TriangleSetup triangle;
+  for (int i = 0; i < 3; i++) {
+    const int a = (i + 1) % 3;
+    const int b = (i + 2) % 3;
+    triangle.edge_a[i] = y[a] - y[b];
+    triangle.edge_b[i] = x[b] - x[a];
+    triangle.edge_c[i] =
+        -(triangle.edge_a[i] * x[a] + triangle.edge_b[i] * y[a]);
+  }
+
+  // Clockwise on screen is front facing, the rest is culled like
+  // D3D12_CULL_MODE_BACK does
+  const int64_t area = triangle.edge_a[0] * x[0] + triangle.edge_b[0] * y[0] +
+                       triangle.edge_c[0];
+  if (area <= 0) {
+    bin->triangles_culled++;
+    return;
+  }
+
+  const RasterRect &clip_rect = clip_rect_;
+  triangle.min_x = std::max<int32_t>(
+      static_cast<int32_t>(std::min({x[0], x[1], x[2]}) >> kSubPixelBits),
+      clip_rect.left);
+  triangle.min_y = std::max<int32_t>(
+      static_cast<int32_t>(std::min({y[0], y[1], y[2]}) >> kSubPixelBits),
+      clip_rect.top);
+  triangle.max_x = std::min<int32_t>(
+      static_cast<int32_t>(std::max({x[0], x[1], x[2]}) >> kSubPixelBits) + 1,
+      clip_rect.right);
+  triangle.max_y = std::min<int32_t>(
+      static_cast<int32_t>(std::max({y[0], y[1], y[2]}) >> kSubPixelBits) + 1,
+      clip_rect.bottom);
+  if (triangle.min_x >= triangle.max_x || triangle.min_y >= triangle.max_y) {
+    bin->triangles_culled++;
+    return;
+  }
+
+  // Attribute planes, evaluated at pixel centers in perspective correct form
+  const double inv_area = 1.0 / static_cast<double>(area);
+  const int64_t half_pixel = kSubPixelScale / 2;
+  for (int k = 0; k < 5; k++) {
+    double *plane = triangle.attribute_planes[k];
+    plane[0] = plane[1] = plane[2] = 0.0;
+    for (int i = 0; i < 3; i++) {
+      const float value =
+          k == 0 ? inv_w[i] : vertices[i]->color[k - 1] * inv_w[i];
+      const double weight = value * inv_area;
+      plane[0] += triangle.edge_a[i] * kSubPixelScale * weight;
+      plane[1] += triangle.edge_b[i] * kSubPixelScale * weight;
+      plane[2] += (triangle.edge_a[i] * half_pixel +
+                   triangle.edge_b[i] * half_pixel + triangle.edge_c[i]) *
+                  weight;
+    }
+  }
+
+  // Top-left fill rule: pixels exactly on an edge only belong to the
+  // triangle when the edge is a top or a left edge
+  for (int i = 0; i < 3; i++) {
+    const bool top_left = triangle.edge_a[i] > 0 ||
+                          (triangle.edge_a[i] == 0 && triangle.edge_b[i] > 0);
+    if (!top_left) {
+      triangle.edge_c[i] -= 1;
+    }
+  }
+
+  const uint32_t index = static_cast<uint32_t>(bin->triangles.size());
+  bin->triangles.push_back(triangle);
+  const uint32_t tile_x0 = triangle.min_x / kTileSize;
+  const uint32_t tile_y0 = triangle.min_y / kTileSize;
+  const uint32_t tile_x1 = (triangle.max_x - 1) / kTileSize;
+  const uint32_t tile_y1 = (triangle.max_y - 1) / kTileSize;
+  for (uint32_t tile_y = tile_y0; tile_y <= tile_y1; tile_y++) {
+    for (uint32_t tile_x = tile_x0; tile_x <= tile_x1; tile_x++) {
+      bin->tile_triangles[tile_y * tiles_x_ + tile_x].push_back(index);
+    }
+  }
+}
+
+uint64_t SoftwareRasterizer::RasterizeTile(uint32_t tile_x, uint32_t tile_y) {
+  const int32_t tile_x0 = static_cast<int32_t>(tile_x * kTileSize);
+  const int32_t tile_y0 = static_cast<int32_t>(tile_y * kTileSize);
+  const int32_t tile_x1 = tile_x0 + static_cast<int32_t>(kTileSize);
+  const int32_t tile_y1 = tile_y0 + static_cast<int32_t>(kTileSize);
+  const uint32_t tile = tile_y * tiles_x_ + tile_x;
+
+  uint64_t pixels = 0;
+  for (const auto &bin : bins_) {
+    for (uint32_t index : bin.tile_triangles[tile]) {
+      const TriangleSetup &triangle = bin.triangles[index];
+      pixels += RasterizeTriangle(triangle, std::max(triangle.min_x, tile_x0),
+                                  std::max(triangle.min_y, tile_y0),
+                                  std::min(triangle.max_x, tile_x1),
+                                  std::min(triangle.max_y, tile_y1));
+    }
+  }
+  return pixels;
+}
+
+uint64_t SoftwareRasterizer::RasterizeTriangle(const TriangleSetup &triangle,
+                                               int32_t x0,
+                                               int32_t y0,
+                                               int32_t x1,
+                                               int32_t y1) {
+  const auto &planes = triangle.attribute_planes;
+  const int64_t center_x = int64_t(x0) * kSubPixelScale + kSubPixelScale / 2;
+  int32_t edge_step[3];
+  for (int i = 0; i < 3; i++) {
+    edge_step[i] = static_cast<int32_t>(triangle.edge_a[i] * kSubPixelScale);
+  }
+
+  uint64_t pixels = 0;
+  for (int32_t y = y0; y < y1; y++) {
+    uint32_t *row = render_target_->Row(y);
+    const int64_t center_y = int64_t(y) * kSubPixelScale + kSubPixelScale / 2;
+    int32_t edge[3];
+    for (int i = 0; i < 3; i++) {
+      edge[i] = ClampEdge(triangle.edge_a[i] * center_x +
+                          triangle.edge_b[i] * center_y + triangle.edge_c[i]);
+    }
+    float attribute[5];
+    for (int k = 0; k < 5; k++) {
+      attribute[k] = static_cast<float>(planes[k][0] * x0 + planes[k][1] * y +
+                                        planes[k][2]);
+    }
+
+#ifdef SOFTWARE_RASTERIZER_SSE2
+    const __m128 lane_offset = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128i edge_values[3];
+    __m128i edge_steps[3];
+    for (int i = 0; i < 3; i++) {
+      edge_values[i] = _mm_setr_epi32(edge[i], edge[i] + edge_step[i],
+                                      edge[i] + edge_step[i] * 2,
+                                      edge[i] + edge_step[i] * 3);
+      edge_steps[i] = _mm_set1_epi32(edge_step[i] * 4);
+    }
+    __m128 attribute_values[5];
+    __m128 attribute_steps[5];
+    for (int k = 0; k < 5; k++) {
+      const __m128 step = _mm_set1_ps(static_cast<float>(planes[k][0]));
+      attribute_values[k] =
+          _mm_add_ps(_mm_set1_ps(attribute[k]), _mm_mul_ps(step, lane_offset));
+      attribute_steps[k] = _mm_mul_ps(step, _mm_set1_ps(4.0f));
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (int32_t x = x0; x < x1; x += 4) {
+      const __m128i combined = _mm_or_si128(
+          _mm_or_si128(edge_values[0], edge_values[1]), edge_values[2]);
+      int mask = ~_mm_movemask_ps(_mm_castsi128_ps(combined)) & 0xf;
+      if (x1 - x < 4) {
+        mask &= (1 << (x1 - x)) - 1;
+      }
+      if (mask) {
+        // PSMain returns the interpolated color, written as UNORM8
+        const __m128 w = _mm_div_ps(_mm_set1_ps(1.0f), attribute_values[0]);
+        __m128i packed = _mm_setzero_si128();
+        for (int k = 1; k < 5; k++) {
+          __m128 channel =
+              _mm_mul_ps(_mm_mul_ps(attribute_values[k], w), scale);
+          channel = _mm_min_ps(_mm_max_ps(channel, zero), scale);
+          packed = _mm_or_si128(
+              packed, _mm_slli_epi32(_mm_cvtps_epi32(channel), (k - 1) * 8));
+        }
+        if (mask == 0xf) {
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(row + x), packed);
+        } else {
+          alignas(16) uint32_t colors[4];
+          _mm_store_si128(reinterpret_cast<__m128i *>(colors), packed);
+          for (int lane = 0; lane < 4; lane++) {
+            if (mask & (1 << lane)) {
+              row[x + lane] = colors[lane];
+            }
+          }
+        }
+        pixels += kBitCount[mask];
+      }
+      for (int i = 0; i < 3; i++) {
+        edge_values[i] = _mm_add_epi32(edge_values[i], edge_steps[i]);
+      }
+      for (int k = 0; k < 5; k++) {
+        attribute_values[k] =
+            _mm_add_ps(attribute_values[k], attribute_steps[k]);
+      }
+    }
+#else
+    float attribute_step[5];
+    for (int k = 0; k < 5; k++) {
+      attribute_step[k] = static_cast<float>(planes[k][0]);
+    }
+    for (int32_t x = x0; x < x1; x++) {
+      if ((edge[0] | edge[1] | edge[2]) >= 0) {
+        const float w = 1.0f / attribute[0];
+        row[x] = PackColor(attribute[1] * w, attribute[2] * w,
+                           attribute[3] * w, attribute[4] * w);
+        pixels++;
+      }
+      for (int i = 0; i < 3; i++) {
+        edge[i] += edge_step[i];
+      }
+      for (int k = 0; k < 5; k++) {
+        attribute[k] += attribute_step[k];
+      }
+    }
+#endif
+  }
+  return pixels;
+}
+
+RasterRect SoftwareRasterizer::GetClipRect() const {
+  // Rasterization is limited to the scissor rect, the viewport and the
+  // render target
+  RasterRect rect;
+  rect.left = std::max({scissor_rect_.left,
+                        static_cast<int32_t>(std::floor(viewport_.top_left_x)),
+                        0});
+  rect.top = std::max({scissor_rect_.top,
+                       static_cast<int32_t>(std::floor(viewport_.top_left_y)),
+                       0});
+  rect.right = std::min(
+      {scissor_rect_.right,
+       static_cast<int32_t>(std::ceil(viewport_.top_left_x + viewport_.width)),
+       static_cast<int32_t>(render_target_->width)});
+  rect.bottom = std::min(
+      {scissor_rect_.bottom,
+       static_cast<int32_t>(std::ceil(viewport_.top_left_y + viewport_.height)),
+       static_cast<int32_t>(render_target_->height)});
+  return rect;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "core/image.h"
+#include "core/job_system.h"
+#include "core/mesh.h"
+#include "core/vertex.h"
+
+struct RasterViewport {
+  float top_left_x{0.0f};
+  float top_left_y{0.0f};
+  float width{0.0f};
+  float height{0.0f};
+};
+
+struct RasterRect {
+  int32_t left{0};
+  int32_t top{0};
+  int32_t right{0};
+  int32_t bottom{0};
+};
+
+struct RasterStats {
+  uint64_t triangles_submitted{0};
+  // Back facing, degenerate or entirely outside of the view volume
+  uint64_t triangles_culled{0};
+  uint64_t triangles_rasterized{0};
+  uint64_t pixels_shaded{0};
+};
+
+// CPU implementation of the sample's graphics pipeline: the VSMain/PSMain
+// pair of main.hlsl with its dequantization and per-object transform and
+// tint, back face culling and no depth test, rendering into an R8G8B8A8 image.
+// Triangles are binned into screen tiles in parallel and every tile is
+// rasterized by one worker with integer edge functions evaluated four pixels
+// at a time.
+class SoftwareRasterizer {
+ public:
+  static const uint32_t kTileSize = 64;
+  static const uint32_t kMaxRenderTargetSize = 16384;
+
+  explicit SoftwareRasterizer(JobSystem *job_system);
+
+  void OMSetRenderTarget(Image *render_target);
+  void RSSetViewport(const RasterViewport &viewport);
+  void RSSetScissorRect(const RasterRect &scissor_rect);
+  void IASetVertexBuffer(const Vertex *vertices, uint32_t vertex_count);
+  // index_size is 2 or 4 bytes
+  void IASetIndexBuffer(const void *indices,
+                        uint32_t index_count,
+                        uint32_t index_size);
+  // The MeshConstants of VSMain, the identity until set
+  void SetPositionQuantization(const PositionQuantization &quantization);
+  // The objects buffer of VSMain. Without one every instance uses the
+  // identity transform and a white tint.
+  void SetObjectBuffer(const ObjectData *objects, uint32_t object_count);
+  // The DrawConstants of VSMain, instance i of a draw reads object
+  // first_object + i
+  void SetFirstObject(uint32_t first_object);
+
+  void ClearRenderTargetView(const float color[4]);
+  // Start instance locations would only offset per instance vertex input,
+  // which VSMain has none of, so they are ignored like in the shader
+  void DrawInstanced(uint32_t vertex_count_per_instance,
+                     uint32_t instance_count,
+                     uint32_t start_vertex_location,
+                     uint32_t start_instance_location);
+  void DrawIndexedInstanced(uint32_t index_count_per_instance,
+                            uint32_t instance_count,
+                            uint32_t start_index_location,
+                            int32_t base_vertex_location,
+                            uint32_t start_instance_location);
+
+  const RasterStats &GetStats() const {
+    return stats_;
+  }
+  void ResetStats() {
+    stats_ = RasterStats{};
+  }
+
+ private:
+  struct ClipVertex {
+    glm::vec4 position;
+    glm::vec4 color;
+  };
+
+  static const uint32_t kMaxClipVertices = 9;
+
+  // Fixed point edge equations and attribute planes of one screen space
+  // triangle. Edge i is opposite to vertex i, so its value is the barycentric
+  // weight of that vertex scaled by twice the triangle area.
+  struct TriangleSetup {
+    int64_t edge_a[3];
+    int64_t edge_b[3];
+    int64_t edge_c[3];
+    int32_t min_x, min_y, max_x, max_y;
+    // Per pixel x step, per pixel y step and value at the center of pixel
+    // (0, 0) of 1/w followed by color/w
+    double attribute_planes[5][3];
+  };
+
+  struct Bin {
+    std::vector<TriangleSetup> triangles;
+    std::vector<std::vector<uint32_t>> tile_triangles;
+    uint64_t triangles_culled{0};
+  };
+
+  void Draw(uint32_t vertex_count_per_instance,
+            uint32_t instance_count,
+            uint32_t start_location,
+            int32_t base_vertex_location,
+            bool indexed);
+  uint32_t FetchIndex(uint32_t location) const;
+  static uint32_t ClipTriangle(const ClipVertex *triangle,
+                               ClipVertex *polygon);
+  ClipVertex ShadeVertex(uint32_t vertex_index, uint32_t object_index) const;
+  void SetupTriangle(const ClipVertex &v0,
+                     const ClipVertex &v1,
+                     const ClipVertex &v2,
+                     Bin *bin);
+  uint64_t RasterizeTile(uint32_t tile_x, uint32_t tile_y);
+  uint64_t RasterizeTriangle(const TriangleSetup &triangle,
+                             int32_t x0,
+                             int32_t y0,
+                             int32_t x1,
+                             int32_t y1);
+  RasterRect GetClipRect() const;
+
+  JobSystem *job_system_;
+  Image *render_target_{nullptr};
+  RasterViewport viewport_;
+  RasterRect scissor_rect_;
+  const Vertex *vertices_{nullptr};
+  uint32_t vertex_count_{0};
+  const ObjectData *objects_{nullptr};
+  uint32_t object_count_{0};
+  uint32_t first_object_{0};
+  const uint8_t *indices_{nullptr};
+  uint32_t index_count_{0};
+  uint32_t index_size_{2};
+  PositionQuantization quantization_;
+
+  uint32_t tiles_x_{0};
+  uint32_t tiles_y_{0};
+  RasterRect clip_rect_;
+  std::vector<Bin> bins_;
+  std::vector<uint64_t> pixels_shaded_;
+  RasterStats stats_;
+};
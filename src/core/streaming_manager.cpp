@@ -0,0 +1,247 @@
+#include "core/streaming_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "core/profiler.h"
+#include "core/string_utils.h"
+
+namespace {
+// Keep priority of levels finer than any request wants, below every request
+const float kUnrequestedPriority = -1.0f;
+// Reading one byte of every page faults the whole level in
+const uint64_t kPageSize = 4096;
+}  // namespace
+
+StreamingManager::StreamingManager(const StreamingSettings &settings)
+    : settings_(settings) {
+  io_thread_ = std::thread(&StreamingManager::IoMain, this);
+}
+
+StreamingManager::~StreamingManager() {
+  {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    stopping_ = true;
+    io_requests_.clear();
+  }
+  io_condition_.notify_one();
+  io_thread_.join();
+}
+
+uint32_t StreamingManager::AddResource(
+    const std::vector<StreamingLevel> &levels) {
+  if (levels.empty()) {
+    throw std::runtime_error("Streamed resource without levels");
+  }
+  Resource resource;
+  resource.levels = levels;
+  resource.resident_level = static_cast<uint32_t>(levels.size() - 1);
+  resource.requested_level = resource.resident_level;
+
+  // The coarsest level is resident right away, resources are always
+  // drawable
+  stats_.resident_bytes += levels.back().size;
+  stats_.peak_bytes = std::max(stats_.peak_bytes,
+                               stats_.resident_bytes + stats_.pending_bytes);
+
+  resources_.push_back(std::move(resource));
+  return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+void StreamingManager::Request(uint32_t resource,
+                               uint32_t level,
+                               float priority) {
+  Resource &entry = resources_[resource];
+  entry.requested_level = std::min(
+      entry.requested_level,
+      std::min(level, static_cast<uint32_t>(entry.levels.size() - 1)));
+  entry.priority = std::max(entry.priority, priority);
+}
+
+void StreamingManager::Update() {
+  PROFILE_SCOPE("StreamingUpdate");
+  loaded_levels_.clear();
+  evicted_levels_.clear();
+
+  // Completed loads become resident even when the request that started them
+  // is gone, evicting below takes care of them
+  std::vector<IoResult> results;
+  {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    results.swap(io_results_);
+  }
+  for (IoResult &result : results) {
+    Resource &resource = resources_[result.resource];
+    const uint64_t size = resource.levels[result.level].size;
+    resource.resident_level = result.level;
+    resource.pending_level = kNoLevel;
+    pending_loads_--;
+    stats_.pending_bytes -= size;
+    stats_.resident_bytes += size;
+    stats_.loads++;
+    stats_.bytes_loaded += size;
+    stats_.io_time_ns += result.time_ns;
+    loaded_levels_.push_back({result.resource, result.level});
+  }
+
+  // A lowered budget evicts regardless of the requests
+  while (stats_.resident_bytes + stats_.pending_bytes > settings_.budget &&
+         EvictOne(std::numeric_limits<float>::infinity())) {
+  }
+
+  // Resources missing a requested level load the next finer one, most
+  // important first
+  load_candidates_.clear();
+  for (uint32_t i = 0; i < resources_.size(); i++) {
+    const Resource &resource = resources_[i];
+    if (resource.pending_level == kNoLevel &&
+        resource.requested_level < resource.resident_level) {
+      load_candidates_.push_back(i);
+    }
+  }
+  std::sort(load_candidates_.begin(), load_candidates_.end(),
+            [this](uint32_t a, uint32_t b) {
+              return resources_[a].priority > resources_[b].priority;
+            });
+  std::vector<IoRequest> requests;
+  for (uint32_t candidate : load_candidates_) {
+    if (pending_loads_ == settings_.max_pending_loads) {
+      break;
+    }
+    Resource &resource = resources_[candidate];
+    const uint32_t level = resource.resident_level - 1;
+    const uint64_t size = resource.levels[level].size;
+    bool fits = true;
+    while (stats_.resident_bytes + stats_.pending_bytes + size >
+           settings_.budget) {
+      if (!EvictOne(resource.priority)) {
+        fits = false;
+        break;
+      }
+    }
+    if (!fits) {
+      stats_.deferred_loads++;
+      continue;
+    }
+    resource.pending_level = level;
+    pending_loads_++;
+    stats_.pending_bytes += size;
+    stats_.peak_bytes = std::max(
+        stats_.peak_bytes, stats_.resident_bytes + stats_.pending_bytes);
+    requests.push_back({candidate, level, resource.levels[level]});
+  }
+  if (!requests.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(io_mutex_);
+      io_requests_.insert(io_requests_.end(), requests.begin(),
+                          requests.end());
+    }
+    io_condition_.notify_one();
+  }
+
+  // Requests only last one frame
+  for (Resource &resource : resources_) {
+    resource.requested_level =
+        static_cast<uint32_t>(resource.levels.size() - 1);
+    resource.priority = 0.0f;
+  }
+}
+
+const uint8_t *StreamingManager::GetLevelData(uint32_t resource,
+                                              uint32_t level) const {
+  const Resource &entry = resources_[resource];
+  return level >= entry.resident_level ? entry.levels[level].source
+                                       : nullptr;
+}
+
+std::string StreamingManager::GetUsageReport() const {
+  std::ostringstream report;
+  report << DataSizeToStringNotation(stats_.resident_bytes) << " resident, "
+         << DataSizeToStringNotation(stats_.pending_bytes) << " loading of "
+         << DataSizeToStringNotation(settings_.budget) << " budget, peak "
+         << DataSizeToStringNotation(stats_.peak_bytes) << ", "
+         << stats_.loads << " loads, " << stats_.evictions << " evictions";
+  return report.str();
+}
+
+void StreamingManager::IoMain() {
+  for (;;) {
+    IoRequest request;
+    {
+      std::unique_lock<std::mutex> lock(io_mutex_);
+      io_condition_.wait(lock,
+                         [this] { return stopping_ || !io_requests_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      request = io_requests_.front();
+      io_requests_.pop_front();
+    }
+
+    // Touching the mapping is what reads the file
+    const auto start = std::chrono::steady_clock::now();
+    IoResult result;
+    result.resource = request.resource;
+    result.level = request.level;
+    result.checksum = 0;
+    for (uint64_t offset = 0; offset < request.source.size;
+         offset += kPageSize) {
+      result.checksum += request.source.source[offset];
+    }
+    result.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    io_results_.push_back(std::move(result));
+  }
+}
+
+float StreamingManager::GetKeepPriority(const Resource &resource) const {
+  return resource.resident_level < resource.requested_level
+             ? kUnrequestedPriority
+             : resource.priority;
+}
+
+bool StreamingManager::EvictOne(float below) {
+  uint32_t victim = kNoLevel;
+  float victim_priority = below;
+  for (uint32_t i = 0; i < resources_.size(); i++) {
+    const Resource &resource = resources_[i];
+    // A pending load expects the levels coarser than it to stay resident
+    if (resource.resident_level + 1 == resource.levels.size() ||
+        resource.pending_level != kNoLevel) {
+      continue;
+    }
+    const float priority = GetKeepPriority(resource);
+    if (priority < victim_priority) {
+      victim = i;
+      victim_priority = priority;
+    }
+  }
+  if (victim == kNoLevel) {
+    return false;
+  }
+  Evict(victim);
+  return true;
+}
+
+void StreamingManager::Evict(uint32_t resource) {
+  Resource &entry = resources_[resource];
+  const uint32_t level = entry.resident_level;
+  stats_.resident_bytes -= entry.levels[level].size;
+  entry.resident_level = level + 1;
+  stats_.evictions++;
+  // A level loaded and evicted by the same update is reported as neither
+  for (size_t i = 0; i < loaded_levels_.size(); i++) {
+    if (loaded_levels_[i].resource == resource &&
+        loaded_levels_[i].level == level) {
+      loaded_levels_.erase(loaded_levels_.begin() + i);
+      return;
+    }
+  }
+  evicted_levels_.push_back({resource, level});
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StreamingSettings {
+  // Bytes of resident and loading levels the manager evicts down to
+  uint64_t budget{256ull * 1024 * 1024};
+  // Loads handed to the I/O thread and not yet completed, more only queue up
+  // work that priorities may have overtaken by the time it runs
+  uint32_t max_pending_loads{64};
+};
+
+struct StreamingStats {
+  uint64_t loads{0};
+  uint64_t evictions{0};
+  uint64_t bytes_loaded{0};
+  // Time the I/O thread spent reading, page faults of the mapping included
+  uint64_t io_time_ns{0};
+  // Loads that were due but found no lower priority level to evict
+  uint64_t deferred_loads{0};
+  uint64_t resident_bytes{0};
+  uint64_t pending_bytes{0};
+  uint64_t peak_bytes{0};
+};
+
+// Level of a resource, 0 is the most detailed one
+struct StreamingLevel {
+  // Usually a range of a memory mapped file, faulted in on the I/O thread
+  // before the calling one reads it
+  const uint8_t *source;
+  uint64_t size;
+};
+
+struct StreamedLevel {
+  uint32_t resource;
+  uint32_t level;
+};
+
+// Keeps the levels of resources, such as mips or LODs, resident within a
+// memory budget. Resources are requested every frame at the level they need
+// with a priority. Levels are loaded one at a time, coarse to fine, by a
+// background thread that touches every page of their source, so page faults
+// of file mappings rarely stall the caller. No copy is kept, callers upload
+// resident levels straight out of their source. When the budget does not fit
+// a load, levels no request needs and then those of lower priority resources
+// are evicted, finest first. The resident levels of a resource are always the
+// coarsest one up to some level, and the coarsest level is loaded when the
+// resource is added and never evicted, so every resource can be drawn.
+//
+// Everything but the I/O thread runs on the thread that owns the manager.
+class StreamingManager {
+ public:
+  explicit StreamingManager(const StreamingSettings &settings = {});
+  ~StreamingManager();
+
+  StreamingManager(const StreamingManager &) = delete;
+  StreamingManager &operator=(const StreamingManager &) = delete;
+
+  // The sources must stay valid while the manager lives
+  uint32_t AddResource(const std::vector<StreamingLevel> &levels);
+
+  // Ask for the level this frame, requests of one frame keep the finest
+  // level and the highest priority
+  void Request(uint32_t resource, uint32_t level, float priority);
+
+  // Take completed loads, evict down to the budget and start the loads the
+  // requests since the last update call for. The levels that became resident
+  // and those that stopped being resident are listed until the next update.
+  void Update();
+
+  uint32_t GetLevelCount(uint32_t resource) const {
+    return static_cast<uint32_t>(resources_[resource].levels.size());
+  }
+  // Finest resident level
+  uint32_t GetResidentLevel(uint32_t resource) const {
+    return resources_[resource].resident_level;
+  }
+  // Source of the level, null while the level is not resident
+  const uint8_t *GetLevelData(uint32_t resource, uint32_t level) const;
+  uint64_t GetLevelSize(uint32_t resource, uint32_t level) const {
+    return resources_[resource].levels[level].size;
+  }
+
+  const std::vector<StreamedLevel> &GetLoadedLevels() const {
+    return loaded_levels_;
+  }
+  const std::vector<StreamedLevel> &GetEvictedLevels() const {
+    return evicted_levels_;
+  }
+
+  // Takes effect at the next update, which evicts when usage exceeds it
+  void SetBudget(uint64_t budget) {
+    settings_.budget = budget;
+  }
+  uint64_t GetBudget() const {
+    return settings_.budget;
+  }
+  const StreamingStats &GetStats() const {
+    return stats_;
+  }
+  // Human readable usage against the budget
+  std::string GetUsageReport() const;
+
+ private:
+  static const uint32_t kNoLevel = ~0u;
+
+  struct Resource {
+    std::vector<StreamingLevel> levels;
+    uint32_t resident_level;
+    // Level being loaded, the one finer than resident_level, or kNoLevel
+    uint32_t pending_level{kNoLevel};
+    // Finest level and highest priority requested since the last update
+    uint32_t requested_level;
+    float priority{0.0f};
+  };
+
+  struct IoRequest {
+    uint32_t resource;
+    uint32_t level;
+    StreamingLevel source;
+  };
+
+  struct IoResult {
+    uint32_t resource;
+    uint32_t level;
+    uint64_t time_ns;
+    // Sum of the touched bytes, keeps the reads from being optimized away
+    uint8_t checksum;
+  };
+
+  void IoMain();
+  // How much a resource needs its finest resident level, lowest evicts first
+  float GetKeepPriority(const Resource &resource) const;
+  // Evict the finest level of the resource that needs it least, as long as
+  // it needs it less than below. Returns false when nothing qualified.
+  bool EvictOne(float below);
+  void Evict(uint32_t resource);
+
+  StreamingSettings settings_;
+  std::vector<Resource> resources_;
+  std::vector<StreamedLevel> loaded_levels_;
+  std::vector<StreamedLevel> evicted_levels_;
+  std::vector<uint32_t> load_candidates_;
+  uint32_t pending_loads_{0};
+  StreamingStats stats_;
+
+  std::thread io_thread_;
+  std::mutex io_mutex_;
+  std::condition_variable io_condition_;
+  std::deque<IoRequest> io_requests_;
+  std::vector<IoResult> io_results_;
+  bool stopping_{false};
+};
@@ -0,0 +1,18 @@
+#include "core/string_utils.h"
+
+std::string DataSizeToStringNotation(size_t sz) {
+  // Convert the size to human readable notation, from B to TB, reserve 2 digits
+  // after the decimal point
+  std::string notation;
+  if (sz < 1024) {
+    notation = std::to_string(sz) + " B";
+  } else if (sz < 1024 * 1024) {
+    notation = std::to_string(sz / 1024.0).substr(0, 6) + " KB";
+  } else if (sz < 1024 * 1024 * 1024) {
+    notation = std::to_string(sz / 1024.0 / 1024.0).substr(0, 6) + " MB";
+  } else {
+    notation =
+        std::to_string(sz / 1024.0 / 1024.0 / 1024.0).substr(0, 6) + " GB";
+  }
+  return notation;
+}
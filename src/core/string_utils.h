@@ -0,0 +1,5 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+std::string DataSizeToStringNotation(size_t sz);
@@ -0,0 +1,175 @@
+#include "core/task_graph.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "core/profiler.h"
+
+uint32_t TaskGraph::AddTask(const char *name,
+                            const std::vector<uint32_t> &dependencies,
+                            Task task) {
+  const uint32_t id = static_cast<uint32_t>(nodes_.size());
+  for (uint32_t dependency : dependencies) {
+    if (dependency >= id) {
+      throw std::runtime_error("Task dependencies must be added first");
+    }
+  }
+  nodes_.emplace_back();
+  Node &node = nodes_.back();
+  node.name = name;
+  node.task = std::move(task);
+  node.dependencies = dependencies;
+  for (uint32_t dependency : dependencies) {
+    nodes_[dependency].dependents.push_back(id);
+  }
+  return id;
+}
+
+void TaskGraph::Run(JobSystem *job_system) {
+  job_system_ = job_system;
+  first_exception_ = nullptr;
+  for (Node &node : nodes_) {
+    node.pending_dependencies.store(
+        static_cast<uint32_t>(node.dependencies.size()),
+        std::memory_order_relaxed);
+    node.dependency_failed.store(false, std::memory_order_relaxed);
+    node.failed = false;
+  }
+
+  run_start_ns_ = Profiler::Now();
+  for (uint32_t task = 0; task < nodes_.size(); task++) {
+    if (nodes_[task].dependencies.empty()) {
+      Schedule(task);
+    }
+  }
+  job_system->Wait(&counter_);
+  duration_ns_ = Profiler::Now() - run_start_ns_;
+
+  if (first_exception_) {
+    std::rethrow_exception(first_exception_);
+  }
+}
+
+void TaskGraph::Schedule(uint32_t task) {
+  job_system_->Schedule(&counter_, [this, task](uint32_t thread_index) {
+    Execute(task, thread_index);
+  });
+}
+
+void TaskGraph::Execute(uint32_t task, uint32_t thread_index) {
+  Node &node = nodes_[task];
+  node.thread_index = thread_index;
+  node.start_ns = Profiler::Now();
+  node.failed = node.dependency_failed.load(std::memory_order_relaxed);
+  if (!node.failed) {
+    try {
+      node.task();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(exception_mutex_);
+      if (!first_exception_) {
+        first_exception_ = std::current_exception();
+      }
+      node.failed = true;
+    }
+  }
+  node.end_ns = Profiler::Now();
+#ifdef ENABLE_PROFILER
+  Profiler::Get().Record(node.name, node.start_ns, node.end_ns);
+#endif
+
+  // The last dependency to finish schedules the dependent, the release of
+  // the decrement publishes this node's results and timing to it
+  for (uint32_t dependent : node.dependents) {
+    Node &next = nodes_[dependent];
+    if (node.failed) {
+      next.dependency_failed.store(true, std::memory_order_relaxed);
+    }
+    if (next.pending_dependencies.fetch_sub(1, std::memory_order_acq_rel) ==
+        1) {
+      Schedule(dependent);
+    }
+  }
+}
+
+TaskTiming TaskGraph::GetTiming(uint32_t task) const {
+  const Node &node = nodes_[task];
+  return {node.name, node.start_ns - run_start_ns_,
+          node.end_ns - run_start_ns_, node.thread_index, node.failed};
+}
+
+std::vector<uint32_t> TaskGraph::GetCriticalPath() const {
+  std::vector<uint32_t> path;
+  if (nodes_.empty()) {
+    return path;
+  }
+  // Dependencies have lower ids, so one pass in id order finds the longest
+  // chain ending at every task, ignoring the time tasks spent queued
+  std::vector<uint64_t> chain_ns(nodes_.size());
+  std::vector<uint32_t> previous(nodes_.size(), ~0u);
+  uint32_t task = 0;
+  for (uint32_t i = 0; i < nodes_.size(); i++) {
+    for (uint32_t dependency : nodes_[i].dependencies) {
+      if (previous[i] == ~0u ||
+          chain_ns[dependency] > chain_ns[previous[i]]) {
+        previous[i] = dependency;
+      }
+    }
+    chain_ns[i] = (previous[i] == ~0u ? 0 : chain_ns[previous[i]]) +
+                  nodes_[i].end_ns - nodes_[i].start_ns;
+    if (chain_ns[i] > chain_ns[task]) {
+      task = i;
+    }
+  }
+  for (; task != ~0u; task = previous[task]) {
+    path.push_back(task);
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+uint64_t TaskGraph::GetCriticalPathNs() const {
+  uint64_t critical_path_ns = 0;
+  for (uint32_t task : GetCriticalPath()) {
+    critical_path_ns += nodes_[task].end_ns - nodes_[task].start_ns;
+  }
+  return critical_path_ns;
+}
+
+std::string TaskGraph::GetTimelineReport() const {
+  const std::vector<uint32_t> critical_path = GetCriticalPath();
+  std::vector<bool> on_critical_path(nodes_.size(), false);
+  for (uint32_t task : critical_path) {
+    on_critical_path[task] = true;
+  }
+  std::vector<uint32_t> order(nodes_.size());
+  for (uint32_t task = 0; task < order.size(); task++) {
+    order[task] = task;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return nodes_[a].start_ns < nodes_[b].start_ns;
+  });
+
+  std::ostringstream report;
+  report << std::fixed << std::setprecision(2);
+  uint64_t busy_ns = 0;
+  for (uint32_t task : order) {
+    const TaskTiming timing = GetTiming(task);
+    busy_ns += timing.end_ns - timing.start_ns;
+    report << (on_critical_path[task] ? "* " : "  ") << std::left
+           << std::setw(24) << timing.name << std::right << std::setw(9)
+           << timing.start_ns / 1e6 << " ms +" << std::setw(9)
+           << (timing.end_ns - timing.start_ns) / 1e6 << " ms on thread "
+           << timing.thread_index << (timing.failed ? ", failed" : "")
+           << std::endl;
+  }
+
+  report << "Critical path:";
+  for (uint32_t i = 0; i < critical_path.size(); i++) {
+    report << (i == 0 ? " " : " -> ") << nodes_[critical_path[i]].name;
+  }
+  report << ", " << GetCriticalPathNs() / 1e6 << " ms of " << duration_ns_ / 1e6
+         << " ms, " << busy_ns / 1e6 << " ms of work in total" << std::endl;
+  return report.str();
+}
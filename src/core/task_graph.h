@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/job_system.h"
+
+// When and where a task of the last run executed, in nanoseconds since the
+// start of the run
+struct TaskTiming {
+  const char *name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+  uint32_t thread_index;
+  // The task threw or one of its dependencies failed
+  bool failed;
+};
+
+// One-shot tasks with dependencies, executed on the job system. A task is
+// scheduled by whichever dependency finishes last, so independent chains run
+// concurrently without a thread waiting on them. The run is timed, which
+// gives its critical path: the chain of dependent tasks with the largest
+// total duration, which no run takes less time than however many threads
+// execute it.
+class TaskGraph {
+ public:
+  using Task = std::function<void()>;
+
+  // Dependencies are ids returned earlier, so the graph is acyclic. The name
+  // must be a string literal, it is also the profiler scope of the task.
+  uint32_t AddTask(const char *name,
+                   const std::vector<uint32_t> &dependencies,
+                   Task task);
+
+  // Execute every task and block until all of them finished, the calling
+  // thread runs tasks meanwhile. Tasks depending on a task that threw are
+  // skipped, the first exception is rethrown once the rest completed.
+  void Run(JobSystem *job_system);
+
+  uint32_t GetTaskCount() const {
+    return static_cast<uint32_t>(nodes_.size());
+  }
+  TaskTiming GetTiming(uint32_t task) const;
+  uint64_t GetDurationNs() const {
+    return duration_ns_;
+  }
+  // Tasks of the critical path of the last run, in execution order
+  std::vector<uint32_t> GetCriticalPath() const;
+  // Summed durations of the critical path tasks
+  uint64_t GetCriticalPathNs() const;
+  // One line per task in start order with the critical path marked, then the
+  // path itself and how much of the run it covers
+  std::string GetTimelineReport() const;
+
+ private:
+  struct Node {
+    const char *name;
+    Task task;
+    std::vector<uint32_t> dependencies;
+    std::vector<uint32_t> dependents;
+    std::atomic<uint32_t> pending_dependencies{0};
+    std::atomic<bool> dependency_failed{false};
+    uint64_t start_ns{0};
+    uint64_t end_ns{0};
+    uint32_t thread_index{0};
+    bool failed{false};
+  };
+
+  void Schedule(uint32_t task);
+  void Execute(uint32_t task, uint32_t thread_index);
+
+  // Nodes hold atomics, a deque never moves them
+  std::deque<Node> nodes_;
+  JobSystem *job_system_{nullptr};
+  JobCounter counter_;
+  uint64_t run_start_ns_{0};
+  uint64_t duration_ns_{0};
+  std::mutex exception_mutex_;
+  std::exception_ptr first_exception_;
+};
@@ -0,0 +1,299 @@
+#include "core/tlsf_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+uint32_t FindLowestBit(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+uint32_t FindHighestBit(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return index;
+#else
+  return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+}  // namespace
+
+TlsfAllocator::TlsfAllocator(uint64_t size)
+    : size_(size / kGranularity * kGranularity) {
+  if (size_ == 0) {
+    throw std::runtime_error("TLSF allocator size must not be zero");
+  }
+  for (auto &free_list : free_lists_) {
+    std::fill(std::begin(free_list), std::end(free_list), kNull);
+  }
+  const uint32_t block = NewBlock();
+  blocks_[block] = {0, size_, kNull, kNull, kNull, kNull, true};
+  InsertFreeBlock(block);
+}
+
+uint64_t TlsfAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  if (alignment & (alignment - 1)) {
+    throw std::runtime_error("Alignment must be a power of two");
+  }
+  size = AlignUp(std::max<uint64_t>(size, 1), kGranularity);
+  alignment = std::max(alignment, kGranularity);
+  if (size > size_) {
+    return kInvalidOffset;
+  }
+
+  // Any block of this size holds an aligned range of the requested size
+  const uint64_t search_size = size + alignment - kGranularity;
+  uint32_t block = FindFreeBlock(search_size);
+  if (block == kNull) {
+    block = FindFreeBlockInClass(size, alignment);
+    if (block == kNull) {
+      return kInvalidOffset;
+    }
+  }
+  RemoveFreeBlock(block);
+
+  const uint64_t aligned_offset = AlignUp(blocks_[block].offset, alignment);
+  const uint64_t padding = aligned_offset - blocks_[block].offset;
+  if (padding > 0) {
+    const uint32_t aligned_block = SplitBlock(block, padding);
+    InsertFreeBlock(block);
+    block = aligned_block;
+  }
+  if (blocks_[block].size > size) {
+    InsertFreeBlock(SplitBlock(block, size));
+  }
+
+  blocks_[block].free = false;
+  used_size_ += size;
+  allocations_[aligned_offset] = block;
+  return aligned_offset;
+}
+
+void TlsfAllocator::Free(uint64_t offset) {
+  auto it = allocations_.find(offset);
+  if (it == allocations_.end()) {
+    throw std::runtime_error("Freeing an offset that is not allocated");
+  }
+  uint32_t block = it->second;
+  allocations_.erase(it);
+  used_size_ -= blocks_[block].size;
+  blocks_[block].free = true;
+
+  // Coalesce with free physical neighbors
+  const uint32_t next = blocks_[block].next_physical;
+  if (next != kNull && blocks_[next].free) {
+    RemoveFreeBlock(next);
+    MergeWithNext(block);
+  }
+  const uint32_t prev = blocks_[block].prev_physical;
+  if (prev != kNull && blocks_[prev].free) {
+    RemoveFreeBlock(prev);
+    MergeWithNext(prev);
+    block = prev;
+  }
+  InsertFreeBlock(block);
+}
+
+uint64_t TlsfAllocator::GetLargestFreeBlock() const {
+  if (first_level_bitmap_ == 0) {
+    return 0;
+  }
+  const uint32_t first = FindHighestBit(first_level_bitmap_);
+  const uint32_t second = FindHighestBit(second_level_bitmaps_[first]);
+  uint64_t largest = 0;
+  for (uint32_t block = free_lists_[first][second]; block != kNull;
+       block = blocks_[block].next_free) {
+    largest = std::max(largest, blocks_[block].size);
+  }
+  return largest;
+}
+
+bool TlsfAllocator::Validate() const {
+  uint64_t offset = 0;
+  uint64_t used_size = 0;
+  uint32_t used_blocks = 0;
+  uint32_t prev = kNull;
+  for (uint32_t block = 0; block != kNull;
+       block = blocks_[block].next_physical) {
+    const Block &b = blocks_[block];
+    if (b.offset != offset || b.prev_physical != prev || b.size == 0) {
+      return false;
+    }
+    if (b.free) {
+      if (prev != kNull && blocks_[prev].free) {
+        return false;
+      }
+      uint32_t first, second;
+      Mapping(b.size, &first, &second);
+      uint32_t it = free_lists_[first][second];
+      while (it != kNull && it != block) {
+        it = blocks_[it].next_free;
+      }
+      if (it == kNull) {
+        return false;
+      }
+    } else {
+      used_size += b.size;
+      used_blocks++;
+    }
+    offset += b.size;
+    prev = block;
+  }
+  if (offset != size_ || used_size != used_size_ ||
+      used_blocks != allocations_.size()) {
+    return false;
+  }
+  for (uint32_t first = 0; first < kFirstLevelCount; first++) {
+    const bool first_bit = (first_level_bitmap_ >> first) & 1;
+    if (first_bit != (second_level_bitmaps_[first] != 0)) {
+      return false;
+    }
+    for (uint32_t second = 0; second < kSecondLevelCount; second++) {
+      const bool second_bit = (second_level_bitmaps_[first] >> second) & 1;
+      if (second_bit != (free_lists_[first][second] != kNull)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t *first, uint32_t *second) {
+  if (size < (uint64_t(1) << kLinearBits)) {
+    *first = 0;
+    *second = static_cast<uint32_t>(size / kGranularity);
+  } else {
+    const uint32_t log2 = FindHighestBit(size);
+    *first = log2 - kLinearBits + 1;
+    *second = static_cast<uint32_t>(size >> (log2 - kSecondLevelBits)) -
+              kSecondLevelCount;
+  }
+}
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const {
+  // Round up to the next size class so any block found there is big enough
+  if (size >= (uint64_t(1) << kLinearBits)) {
+    size += (uint64_t(1) << (FindHighestBit(size) - kSecondLevelBits)) - 1;
+  }
+  uint32_t first, second;
+  Mapping(size, &first, &second);
+
+  uint32_t second_level_bitmap =
+      second_level_bitmaps_[first] & (~uint32_t(0) << second);
+  if (second_level_bitmap == 0) {
+    if (first + 1 >= kFirstLevelCount) {
+      return kNull;
+    }
+    const uint64_t first_level_bitmap =
+        first_level_bitmap_ & (~uint64_t(0) << (first + 1));
+    if (first_level_bitmap == 0) {
+      return kNull;
+    }
+    first = FindLowestBit(first_level_bitmap);
+    second_level_bitmap = second_level_bitmaps_[first];
+  }
+  second = FindLowestBit(second_level_bitmap);
+  return free_lists_[first][second];
+}
+
+uint32_t TlsfAllocator::FindFreeBlockInClass(uint64_t size,
+                                             uint64_t alignment) const {
+  // Blocks in the class of the requested size are skipped by the rounded up
+  // search even though some of them may fit, walk that one list before
+  // giving up
+  uint32_t first, second;
+  Mapping(size + alignment - kGranularity, &first, &second);
+  for (uint32_t block = free_lists_[first][second]; block != kNull;
+       block = blocks_[block].next_free) {
+    const Block &b = blocks_[block];
+    if (AlignUp(b.offset, alignment) + size <= b.offset + b.size) {
+      return block;
+    }
+  }
+  return kNull;
+}
+
+void TlsfAllocator::InsertFreeBlock(uint32_t block) {
+  uint32_t first, second;
+  Mapping(blocks_[block].size, &first, &second);
+  const uint32_t head = free_lists_[first][second];
+  blocks_[block].free = true;
+  blocks_[block].prev_free = kNull;
+  blocks_[block].next_free = head;
+  if (head != kNull) {
+    blocks_[head].prev_free = block;
+  }
+  free_lists_[first][second] = block;
+  first_level_bitmap_ |= uint64_t(1) << first;
+  second_level_bitmaps_[first] |= 1u << second;
+}
+
+void TlsfAllocator::RemoveFreeBlock(uint32_t block) {
+  const Block &b = blocks_[block];
+  if (b.prev_free != kNull) {
+    blocks_[b.prev_free].next_free = b.next_free;
+  }
+  if (b.next_free != kNull) {
+    blocks_[b.next_free].prev_free = b.prev_free;
+  }
+
+  uint32_t first, second;
+  Mapping(b.size, &first, &second);
+  if (free_lists_[first][second] == block) {
+    free_lists_[first][second] = b.next_free;
+    if (b.next_free == kNull) {
+      second_level_bitmaps_[first] &= ~(1u << second);
+      if (second_level_bitmaps_[first] == 0) {
+        first_level_bitmap_ &= ~(uint64_t(1) << first);
+      }
+    }
+  }
+}
+
+uint32_t TlsfAllocator::SplitBlock(uint32_t block, uint64_t size) {
+  const uint32_t remainder = NewBlock();
+  Block &b = blocks_[block];
+  blocks_[remainder] = {b.offset + size, b.size - size, block,
+                        b.next_physical, kNull, kNull, true};
+  if (b.next_physical != kNull) {
+    blocks_[b.next_physical].prev_physical = remainder;
+  }
+  b.next_physical = remainder;
+  b.size = size;
+  return remainder;
+}
+
+void TlsfAllocator::MergeWithNext(uint32_t block) {
+  const uint32_t next = blocks_[block].next_physical;
+  blocks_[block].size += blocks_[next].size;
+  blocks_[block].next_physical = blocks_[next].next_physical;
+  if (blocks_[next].next_physical != kNull) {
+    blocks_[blocks_[next].next_physical].prev_physical = block;
+  }
+  unused_blocks_.push_back(next);
+}
+
+uint32_t TlsfAllocator::NewBlock() {
+  if (!unused_blocks_.empty()) {
+    const uint32_t block = unused_blocks_.back();
+    unused_blocks_.pop_back();
+    return block;
+  }
+  blocks_.push_back({});
+  return static_cast<uint32_t>(blocks_.size() - 1);
+}
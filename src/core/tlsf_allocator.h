@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Two-level segregated fit allocator over an abstract range of offsets. It
+// keeps no pointers into the managed memory, so it can sub-allocate GPU heaps
+// as well as plain CPU memory. Allocation and free are O(1).
+class TlsfAllocator {
+ public:
+  static const uint64_t kInvalidOffset = ~uint64_t(0);
+  // Every allocation is rounded up to this size and aligned to it at least
+  static constexpr uint64_t kGranularity = 16;
+
+  explicit TlsfAllocator(uint64_t size);
+
+  // Returns kInvalidOffset when no free block is large enough
+  uint64_t Allocate(uint64_t size, uint64_t alignment);
+  void Free(uint64_t offset);
+
+  uint64_t GetSize() const {
+    return size_;
+  }
+  uint64_t GetUsedSize() const {
+    return used_size_;
+  }
+  uint32_t GetAllocationCount() const {
+    return static_cast<uint32_t>(allocations_.size());
+  }
+  uint64_t GetLargestFreeBlock() const;
+
+  // Check the block lists and bitmaps against each other, for fuzzing
+  bool Validate() const;
+
+ private:
+  static const uint32_t kSecondLevelBits = 4;
+  static const uint32_t kSecondLevelCount = 1 << kSecondLevelBits;
+  // Sizes below 2^kLinearBits share first level 0 and are split linearly
+  static const uint32_t kLinearBits = 8;
+  static const uint32_t kFirstLevelCount = 64 - kLinearBits + 1;
+  static constexpr uint32_t kNull = ~uint32_t(0);
+
+  struct Block {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t prev_physical;
+    uint32_t next_physical;
+    uint32_t prev_free;
+    uint32_t next_free;
+    bool free;
+  };
+
+  static void Mapping(uint64_t size, uint32_t *first, uint32_t *second);
+  uint32_t FindFreeBlock(uint64_t size) const;
+  uint32_t FindFreeBlockInClass(uint64_t size, uint64_t alignment) const;
+  void InsertFreeBlock(uint32_t block);
+  void RemoveFreeBlock(uint32_t block);
+  uint32_t SplitBlock(uint32_t block, uint64_t size);
+  void MergeWithNext(uint32_t block);
+  uint32_t NewBlock();
+
+  uint64_t size_;
+  uint64_t used_size_{0};
+  std::vector<Block> blocks_;
+  std::vector<uint32_t> unused_blocks_;
+  uint64_t first_level_bitmap_{0};
+  uint32_t second_level_bitmaps_[kFirstLevelCount]{};
+  uint32_t free_lists_[kFirstLevelCount][kSecondLevelCount];
+  // Offset of every live allocation to its block
+  std::unordered_map<uint64_t, uint32_t> allocations_;
+};
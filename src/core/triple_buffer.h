@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest of a stream of values from one producer thread to one
+// consumer thread without locks. The producer fills the back slot and
+// publishes it, the consumer takes the newest published slot. Neither ever
+// waits for the other, the consumer skips values published in between and
+// keeps its slot until it takes a newer one. Slots are reused, so values can
+// keep their capacity from one publish to the next.
+template <typename T>
+class TripleBuffer {
+ public:
+  // Slot the producer fills, the consumer does not see it until published
+  T &GetBack() {
+    return slots_[back_];
+  }
+
+  // Make the back slot the newest one and continue in the slot neither the
+  // consumer nor the newest value occupy
+  void Publish() {
+    back_ = middle_.exchange(back_ | kFreshBit, std::memory_order_acq_rel) &
+            kIndexMask;
+  }
+
+  // Take the newest slot published since the last call, returns false and
+  // keeps the current one when there is none
+  bool Acquire() {
+    if ((middle_.load(std::memory_order_relaxed) & kFreshBit) == 0) {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+
+  // Slot the consumer took last, a default constructed one before the first
+  // publish
+  const T &GetFront() const {
+    return slots_[front_];
+  }
+
+ private:
+  // The middle index carries whether it was published since the consumer
+  // last took it
+  static const uint32_t kIndexMask = 3;
+  static const uint32_t kFreshBit = 4;
+
+  T slots_[3];
+  uint32_t back_{0};
+  std::atomic<uint32_t> middle_{1};
+  uint32_t front_{2};
+};
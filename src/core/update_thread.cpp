@@ -0,0 +1,72 @@
+#include "core/update_thread.h"
+
+#include <utility>
+
+#include "core/frame_pacer.h"
+
+UpdateThread::UpdateThread(UpdateFunction update,
+                           double rate_hz,
+                           uint64_t update_count,
+                           StartFunction start)
+    : update_(std::move(update)),
+      start_(std::move(start)),
+      tick_(rate_hz > 0.0 ? std::chrono::nanoseconds(
+                                static_cast<int64_t>(1e9 / rate_hz))
+                          : std::chrono::nanoseconds(0)),
+      update_count_(update_count) {
+  thread_ = std::thread(&UpdateThread::ThreadMain, this);
+}
+
+UpdateThread::~UpdateThread() {
+  stopping_ = true;
+  thread_.join();
+}
+
+bool UpdateThread::AcquireSnapshot() {
+  return snapshots_.Acquire();
+}
+
+UpdateThreadStats UpdateThread::GetStats() const {
+  UpdateThreadStats stats;
+  stats.updates = updates_.load(std::memory_order_relaxed);
+  stats.update_time_ns = update_time_ns_.load(std::memory_order_relaxed);
+  stats.late_updates = late_updates_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void UpdateThread::ThreadMain() {
+  if (start_) {
+    start_();
+  }
+  auto next_tick = std::chrono::steady_clock::now();
+  for (uint64_t update = 0; update_count_ == 0 || update < update_count_;
+       update++) {
+    if (stopping_) {
+      return;
+    }
+    if (tick_.count() > 0) {
+      const auto now = std::chrono::steady_clock::now();
+      if (now < next_tick) {
+        WaitUntil(next_tick);
+      } else if (now - next_tick >= tick_) {
+        // Catching up would only publish snapshots nobody draws
+        late_updates_.fetch_add(1, std::memory_order_relaxed);
+        next_tick = now;
+      }
+      next_tick += tick_;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    SceneSnapshot &snapshot = snapshots_.GetBack();
+    snapshot.update = update;
+    snapshot.update_start = start;
+    update_(update, &snapshot);
+    snapshots_.Publish();
+    update_time_ns_.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count(),
+        std::memory_order_relaxed);
+    updates_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
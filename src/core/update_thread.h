@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "core/scene.h"
+#include "core/triple_buffer.h"
+
+// Everything a frame draws of the scene as one update left it, immutable
+// once published
+struct SceneSnapshot {
+  uint64_t update{0};
+  // When the update began, frames measure their latency from it
+  std::chrono::steady_clock::time_point update_start;
+  Camera2D camera;
+  std::vector<uint32_t> visible_objects;
+  CullingStats culling;
+};
+
+struct UpdateThreadStats {
+  uint64_t updates{0};
+  uint64_t update_time_ns{0};
+  // Updates that overran their tick, the ticks they missed were dropped
+  uint64_t late_updates{0};
+};
+
+// Runs the updates of the scene on a thread of its own at a fixed rate, so
+// they overlap the frames of the render thread instead of adding to them.
+// Every update fills a SceneSnapshot and publishes it through a
+// TripleBuffer, the render thread draws the newest one and neither ever
+// waits for the other. Snapshots the render thread was too slow for are
+// skipped.
+class UpdateThread {
+ public:
+  // Fills the snapshot of the update, which still holds an earlier update
+  // whose capacity it may reuse. Runs on the update thread.
+  using UpdateFunction =
+      std::function<void(uint64_t update, SceneSnapshot *snapshot)>;
+  // Runs on the update thread before the first update, for what has to be
+  // created there, such as a job system the updates schedule on
+  using StartFunction = std::function<void()>;
+
+  // A rate of 0 runs the updates back to back, an update count of 0 keeps
+  // updating until the thread is destroyed
+  UpdateThread(UpdateFunction update,
+               double rate_hz,
+               uint64_t update_count,
+               StartFunction start = {});
+  ~UpdateThread();
+
+  UpdateThread(const UpdateThread &) = delete;
+  UpdateThread &operator=(const UpdateThread &) = delete;
+
+  // Take the newest snapshot published since the last call, returns false
+  // and keeps the previous one when there is none. Render thread only.
+  bool AcquireSnapshot();
+  // Snapshot taken last, unchanged until the next acquire
+  const SceneSnapshot &GetSnapshot() const {
+    return snapshots_.GetFront();
+  }
+
+  // Safe from any thread
+  UpdateThreadStats GetStats() const;
+
+ private:
+  void ThreadMain();
+
+  UpdateFunction update_;
+  StartFunction start_;
+  std::chrono::nanoseconds tick_;
+  uint64_t update_count_;
+  TripleBuffer<SceneSnapshot> snapshots_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<uint64_t> updates_{0};
+  std::atomic<uint64_t> update_time_ns_{0};
+  std::atomic<uint64_t> late_updates_{0};
+  std::thread thread_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include "core/vertex_layout.h"
+#include "glm/glm.hpp"
+
+// Quantized vertex, 12 bytes instead of the 24 of float positions and colors.
+// Positions are relative to the bounds of their mesh, see
+// PositionQuantization, and their w component is padding since there is no
+// three component 16 bit format.
+struct Vertex {
+  Snorm16x4 position;
+  Unorm8x4 color;
+};
+
+template <>
+struct VertexLayout<Vertex> {
+  static constexpr VertexAttribute kAttributes[] = {
+      VERTEX_ATTRIBUTE(Vertex, position, "POSITION"),
+      VERTEX_ATTRIBUTE(Vertex, color, "COLOR")};
+};
+
+// Transform of an instance, positions are scaled and then offset in clip
+// space
+struct InstanceData {
+  glm::vec2 offset;
+  glm::vec2 scale;
+};
+
+// Element of the ObjectData structured buffer of main.hlsl, which VSMain
+// indexes with the first object of the draw plus SV_InstanceID. The layout
+// must match the HLSL struct, 16 byte members keep it free of packing rules.
+struct ObjectData {
+  InstanceData transform;
+  // Multiplies the vertex color
+  glm::vec4 color;
+};
+
+static_assert(sizeof(ObjectData) == 32, "ObjectData must match main.hlsl");
@@ -0,0 +1,27 @@
+#include "core/vertex_layout.h"
+
+#include <stdexcept>
+
+const char *GetHlslType(VertexFormat format) {
+  switch (format) {
+    case VertexFormat::kFloat32x2:
+      return "float2";
+    case VertexFormat::kFloat32x3:
+      return "float3";
+    case VertexFormat::kFloat32x4:
+    case VertexFormat::kSnorm16x4:
+    case VertexFormat::kUnorm8x4:
+      return "float4";
+  }
+  throw std::runtime_error("Unknown vertex format");
+}
+
+std::string BuildHlslInputMembers(const VertexAttribute *attributes,
+                                  size_t attribute_count) {
+  std::string members;
+  for (size_t i = 0; i < attribute_count; i++) {
+    members += std::string(GetHlslType(attributes[i].format)) + " " +
+               attributes[i].name + " : " + attributes[i].semantic + "; ";
+  }
+  return members;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "glm/glm.hpp"
+
+// Attribute formats the input assembler converts to floats
+enum class VertexFormat : uint32_t {
+  kFloat32x2,
+  kFloat32x3,
+  kFloat32x4,
+  kSnorm16x4,
+  kUnorm8x4,
+};
+
+// Signed normalized components, -32767 reads as -1.0 and 32767 as 1.0
+struct Snorm16x4 {
+  int16_t v[4];
+};
+
+// Unsigned normalized components, 255 reads as 1.0
+struct Unorm8x4 {
+  uint8_t v[4];
+};
+
+// Format of a member type, so layouts follow the struct definitions
+template <typename T>
+struct VertexFormatOf;
+
+template <>
+struct VertexFormatOf<glm::vec2> {
+  static constexpr VertexFormat kFormat = VertexFormat::kFloat32x2;
+};
+
+template <>
+struct VertexFormatOf<glm::vec3> {
+  static constexpr VertexFormat kFormat = VertexFormat::kFloat32x3;
+};
+
+template <>
+struct VertexFormatOf<glm::vec4> {
+  static constexpr VertexFormat kFormat = VertexFormat::kFloat32x4;
+};
+
+template <>
+struct VertexFormatOf<Snorm16x4> {
+  static constexpr VertexFormat kFormat = VertexFormat::kSnorm16x4;
+};
+
+template <>
+struct VertexFormatOf<Unorm8x4> {
+  static constexpr VertexFormat kFormat = VertexFormat::kUnorm8x4;
+};
+
+struct VertexAttribute {
+  // Member name, also used for the member of the HLSL input struct
+  const char *name;
+  const char *semantic;
+  VertexFormat format;
+  uint32_t offset;
+};
+
+// Specialized next to every struct read by the input assembler, with a
+// kAttributes array built from VERTEX_ATTRIBUTE entries
+template <typename T>
+struct VertexLayout;
+
+#define VERTEX_ATTRIBUTE(type, member, semantic)                        \
+  VertexAttribute {                                                     \
+    #member, semantic, VertexFormatOf<decltype(type::member)>::kFormat, \
+        static_cast<uint32_t>(offsetof(type, member))                   \
+  }
+
+// HLSL type an attribute of the format is read as
+const char *GetHlslType(VertexFormat format);
+
+// Member declarations of an HLSL input struct matching the attributes, for
+// the shaders to include through a define
+std::string BuildHlslInputMembers(const VertexAttribute *attributes,
+                                  size_t attribute_count);
+
+template <typename T>
+std::string BuildHlslInputMembers() {
+  return BuildHlslInputMembers(
+      VertexLayout<T>::kAttributes,
+      sizeof(VertexLayout<T>::kAttributes) / sizeof(VertexAttribute));
+}
@@ -0,0 +1,50 @@
+#include "d3d12_gpu_timeline.h"
+
+#include <stdexcept>
+
+D3D12GpuTimeline::D3D12GpuTimeline(ID3D12Device *device,
+                                   ID3D12CommandQueue *command_queue)
+    : command_queue_(command_queue) {
+  if (FAILED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE,
+                                 IID_PPV_ARGS(&fence_)))) {
+    throw std::runtime_error("Failed to create fence");
+  }
+  fence_event_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+  if (fence_event_ == nullptr) {
+    throw std::runtime_error("Failed to create fence event");
+  }
+}
+
+D3D12GpuTimeline::~D3D12GpuTimeline() {
+  CloseHandle(fence_event_);
+}
+
+uint64_t D3D12GpuTimeline::Signal() {
+  const uint64_t fence_value = fence_value_ + 1;
+  if (FAILED(command_queue_->Signal(fence_.Get(), fence_value))) {
+    throw std::runtime_error("Failed to signal fence");
+  }
+  fence_value_ = fence_value;
+  return fence_value;
+}
+
+uint64_t D3D12GpuTimeline::GetCompletedValue() {
+  return fence_->GetCompletedValue();
+}
+
+void D3D12GpuTimeline::WaitForValue(uint64_t value) {
+  if (fence_->GetCompletedValue() >= value) {
+    return;
+  }
+  if (FAILED(fence_->SetEventOnCompletion(value, fence_event_))) {
+    throw std::runtime_error("Failed to set event on completion");
+  }
+  WaitForSingleObjectEx(fence_event_, INFINITE, FALSE);
+}
+
+void D3D12GpuTimeline::WaitForTimeline(GpuTimeline *other, uint64_t value) {
+  ID3D12Fence *fence = static_cast<D3D12GpuTimeline *>(other)->GetFence();
+  if (FAILED(command_queue_->Wait(fence, value))) {
+    throw std::runtime_error("Failed to wait on another queue");
+  }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "core/gpu_timeline.h"
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+// GpuTimeline backed by an ID3D12Fence signaled from a command queue
+class D3D12GpuTimeline : public GpuTimeline {
+ public:
+  D3D12GpuTimeline(ID3D12Device *device, ID3D12CommandQueue *command_queue);
+  ~D3D12GpuTimeline() override;
+
+  uint64_t Signal() override;
+  uint64_t GetCompletedValue() override;
+  void WaitForValue(uint64_t value) override;
+  void WaitForTimeline(GpuTimeline *other, uint64_t value) override;
+
+  ID3D12Fence *GetFence() const {
+    return fence_.Get();
+  }
+
+ private:
+  ComPtr<ID3D12CommandQueue> command_queue_;
+  ComPtr<ID3D12Fence> fence_;
+  HANDLE fence_event_;
+  uint64_t fence_value_{0};
+};
@@ -0,0 +1,275 @@
+#include "d3d12_render_graph.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "d3dx12.h"
+
+namespace {
+// Placed resources start at multiples of it, and heaps are sized in it
+const uint64_t kHeapAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+D3D12_RESOURCE_STATES GetD3D12State(ResourceState state) {
+  switch (state) {
+    case ResourceState::kUndefined:
+    case ResourceState::kPresent:
+      return D3D12_RESOURCE_STATE_PRESENT;
+    case ResourceState::kRenderTarget:
+      return D3D12_RESOURCE_STATE_RENDER_TARGET;
+    case ResourceState::kDepthWrite:
+      return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+    case ResourceState::kDepthRead:
+      return D3D12_RESOURCE_STATE_DEPTH_READ;
+    case ResourceState::kShaderResource:
+      return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+             D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    case ResourceState::kUnorderedAccess:
+      return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    case ResourceState::kCopySource:
+      return D3D12_RESOURCE_STATE_COPY_SOURCE;
+    case ResourceState::kCopyDest:
+      return D3D12_RESOURCE_STATE_COPY_DEST;
+    case ResourceState::kVertexBuffer:
+      return D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+  }
+  return D3D12_RESOURCE_STATE_COMMON;
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+D3D12RenderGraph::D3D12RenderGraph(ID3D12Device *device,
+                                   GpuTimeline *timeline)
+    : device_(device), timeline_(timeline) {
+  D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+  mixed_heaps_supported_ =
+      SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS,
+                                            &options, sizeof(options))) &&
+      options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+}
+
+void D3D12RenderGraph::Reset() {
+  graph_.Reset();
+  frame_resources_.clear();
+  texture_descs_.clear();
+  pass_functions_.clear();
+}
+
+uint32_t D3D12RenderGraph::ImportResource(const char *name,
+                                          ID3D12Resource *resource,
+                                          ResourceState state,
+                                          ResourceState final_state) {
+  frame_resources_.push_back({resource, GetD3D12State(state), 0});
+  return graph_.ImportResource(name, state, final_state);
+}
+
+uint32_t D3D12RenderGraph::CreateTexture(const char *name,
+                                         const D3D12_RESOURCE_DESC &desc,
+                                         const D3D12_CLEAR_VALUE *clear_value) {
+  if (!mixed_heaps_supported_ &&
+      !(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET |
+                      D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))) {
+    throw std::runtime_error(std::string("Transient texture ") + name +
+                             " has to be a render or depth target");
+  }
+  TextureDesc texture = {desc, clear_value != nullptr, {}};
+  if (clear_value) {
+    texture.clear_value = *clear_value;
+  }
+  texture_descs_.push_back(texture);
+  frame_resources_.push_back(
+      {nullptr, D3D12_RESOURCE_STATE_COMMON,
+       static_cast<uint32_t>(texture_descs_.size() - 1)});
+
+  const D3D12_RESOURCE_ALLOCATION_INFO allocation_info =
+      device_->GetResourceAllocationInfo(0, 1, &desc);
+  return graph_.CreateTransient(
+      name, {allocation_info.SizeInBytes, allocation_info.Alignment});
+}
+
+uint32_t D3D12RenderGraph::AddPass(const char *name,
+                                   std::initializer_list<ResourceUse> uses,
+                                   PassFunction execute,
+                                   bool has_side_effects) {
+  pass_functions_.push_back(std::move(execute));
+  return graph_.AddPass(name, uses, has_side_effects);
+}
+
+void D3D12RenderGraph::Compile() {
+  graph_.Compile();
+
+  // Release what the GPU is done with before placing anything new
+  const uint64_t completed_value = timeline_->GetCompletedValue();
+  while (!retired_.empty() && retired_.front().fence_value <= completed_value) {
+    retired_.pop_front();
+  }
+  ReserveHeap(graph_.GetTransientHeapSize());
+
+  for (PlacedTexture &placed : placed_textures_) {
+    placed.used = false;
+  }
+  for (uint32_t resource = 0; resource < graph_.GetResourceCount();
+       resource++) {
+    if (!graph_.IsTransient(resource) || !graph_.IsUsed(resource)) {
+      continue;
+    }
+    FrameResource &frame_resource = frame_resources_[resource];
+    PlacedTexture *placed =
+        GetPlacedTexture(texture_descs_[frame_resource.texture],
+                         graph_.GetTransientOffset(resource));
+    placed->used = true;
+    frame_resource.resource = placed->resource.Get();
+    frame_resource.state = placed->state;
+    placed->state = GetD3D12State(graph_.GetFinalState(resource));
+  }
+  RetireUnusedTextures();
+  TranslateBarriers();
+}
+
+void D3D12RenderGraph::RecordBarriers(ID3D12GraphicsCommandList *command_list,
+                                      uint32_t step) const {
+  const uint32_t barrier_count =
+      barrier_offsets_[step + 1] - barrier_offsets_[step];
+  if (barrier_count > 0) {
+    command_list->ResourceBarrier(barrier_count,
+                                  barriers_.data() + barrier_offsets_[step]);
+  }
+  for (uint32_t i = discard_offsets_[step]; i < discard_offsets_[step + 1];
+       i++) {
+    command_list->DiscardResource(discards_[i], nullptr);
+  }
+}
+
+void D3D12RenderGraph::RecordPass(ID3D12GraphicsCommandList *command_list,
+                                  uint32_t step) const {
+  RecordBarriers(command_list, step);
+  const PassFunction &execute = pass_functions_[graph_.GetSchedule()[step]];
+  if (execute) {
+    execute(command_list);
+  }
+}
+
+void D3D12RenderGraph::ReserveHeap(uint64_t size) {
+  if (size <= heap_size_) {
+    return;
+  }
+  // Frames in flight may still use the old heap and the textures in it
+  if (heap_) {
+    const uint64_t fence_value = timeline_->Signal();
+    for (PlacedTexture &placed : placed_textures_) {
+      retired_.push_back({fence_value, placed.resource});
+    }
+    retired_.push_back({fence_value, heap_});
+    placed_textures_.clear();
+  }
+
+  heap_size_ = AlignUp(size, kHeapAlignment);
+  CD3DX12_HEAP_DESC heap_desc(
+      heap_size_, D3D12_HEAP_TYPE_DEFAULT, kHeapAlignment,
+      mixed_heaps_supported_ ? D3D12_HEAP_FLAG_NONE
+                             : D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+  if (FAILED(device_->CreateHeap(&heap_desc, IID_PPV_ARGS(&heap_)))) {
+    throw std::runtime_error("Failed to create transient heap");
+  }
+}
+
+D3D12RenderGraph::PlacedTexture *D3D12RenderGraph::GetPlacedTexture(
+    const TextureDesc &texture,
+    uint64_t offset) {
+  // Resources of the frame sharing an offset and description still get a
+  // texture each, so that every texture has one state to track
+  for (PlacedTexture &placed : placed_textures_) {
+    if (!placed.used && placed.offset == offset &&
+        memcmp(&placed.desc, &texture.desc, sizeof(texture.desc)) == 0) {
+      return &placed;
+    }
+  }
+
+  // New textures start in COMMON, the first barrier of the graph takes them
+  // to their first state
+  PlacedTexture placed = {};
+  placed.desc = texture.desc;
+  placed.offset = offset;
+  placed.state = D3D12_RESOURCE_STATE_COMMON;
+  if (FAILED(device_->CreatePlacedResource(
+          heap_.Get(), offset, &texture.desc, placed.state,
+          texture.has_clear_value ? &texture.clear_value : nullptr,
+          IID_PPV_ARGS(&placed.resource)))) {
+    throw std::runtime_error("Failed to create transient texture");
+  }
+  placed_textures_.push_back(placed);
+  return &placed_textures_.back();
+}
+
+void D3D12RenderGraph::RetireUnusedTextures() {
+  uint64_t fence_value = 0;
+  for (size_t i = 0; i < placed_textures_.size();) {
+    if (placed_textures_[i].used) {
+      i++;
+      continue;
+    }
+    if (fence_value == 0) {
+      fence_value = timeline_->Signal();
+    }
+    retired_.push_back({fence_value, placed_textures_[i].resource});
+    placed_textures_[i] = std::move(placed_textures_.back());
+    placed_textures_.pop_back();
+  }
+}
+
+void D3D12RenderGraph::TranslateBarriers() {
+  barriers_.clear();
+  barrier_offsets_.clear();
+  discards_.clear();
+  discard_offsets_.clear();
+  for (uint32_t step = 0; step <= graph_.GetStepCount(); step++) {
+    barrier_offsets_.push_back(static_cast<uint32_t>(barriers_.size()));
+    discard_offsets_.push_back(static_cast<uint32_t>(discards_.size()));
+    const GraphBarrierBatch batch = graph_.GetBarriers(step);
+    for (uint32_t i = 0; i < batch.count; i++) {
+      const GraphBarrier &barrier = batch.barriers[i];
+      const FrameResource &resource = frame_resources_[barrier.resource];
+      if (barrier.type == GraphBarrierType::kAliasing) {
+        barriers_.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(
+            barrier.aliased_resource == RenderGraph::kNoResource
+                ? nullptr
+                : frame_resources_[barrier.aliased_resource].resource,
+            resource.resource));
+        continue;
+      }
+      if (barrier.type == GraphBarrierType::kUav) {
+        barriers_.push_back(
+            CD3DX12_RESOURCE_BARRIER::UAV(resource.resource));
+        continue;
+      }
+
+      const D3D12_RESOURCE_STATES after = GetD3D12State(barrier.after);
+      D3D12_RESOURCE_STATES before = GetD3D12State(barrier.before);
+      if (barrier.before == ResourceState::kUndefined) {
+        // First use of a transient texture, whose contents are undefined
+        before = resource.state;
+        if (barrier.after == ResourceState::kRenderTarget ||
+            barrier.after == ResourceState::kDepthWrite) {
+          discards_.push_back(resource.resource);
+        }
+      }
+      if (before == after) {
+        continue;
+      }
+      D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+      if (barrier.split == GraphBarrierSplit::kBegin) {
+        flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+      } else if (barrier.split == GraphBarrierSplit::kEnd) {
+        flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+      }
+      barriers_.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+          resource.resource, before, after,
+          D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, flags));
+    }
+  }
+  barrier_offsets_.push_back(static_cast<uint32_t>(barriers_.size()));
+  discard_offsets_.push_back(static_cast<uint32_t>(discards_.size()));
+}
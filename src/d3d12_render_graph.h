@@ -0,0 +1,119 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+#include "core/gpu_timeline.h"
+#include "core/render_graph.h"
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Records a RenderGraph into D3D12 command lists. Transient textures are
+// placed resources in one heap of the aliased peak size, kept across frames
+// by offset and description since the graph is rebuilt every frame with
+// mostly the same resources. The barriers before a pass are recorded with
+// one ResourceBarrier call, and render targets whose memory was aliased are
+// discarded before their first use.
+class D3D12RenderGraph {
+ public:
+  using PassFunction = std::function<void(ID3D12GraphicsCommandList *)>;
+
+  D3D12RenderGraph(ID3D12Device *device, GpuTimeline *timeline);
+
+  // Start the graph of a new frame
+  void Reset();
+
+  uint32_t ImportResource(const char *name,
+                          ID3D12Resource *resource,
+                          ResourceState state,
+                          ResourceState final_state);
+  uint32_t CreateTexture(const char *name,
+                         const D3D12_RESOURCE_DESC &desc,
+                         const D3D12_CLEAR_VALUE *clear_value = nullptr);
+  // Passes without a function are recorded by the caller between the
+  // barriers of their step and the next, for example across parallel
+  // command lists
+  uint32_t AddPass(const char *name,
+                   std::initializer_list<ResourceUse> uses,
+                   PassFunction execute = nullptr,
+                   bool has_side_effects = false);
+
+  // Compile the graph, then place its transient textures
+  void Compile();
+
+  ID3D12Resource *GetResource(uint32_t resource) const {
+    return frame_resources_[resource].resource;
+  }
+  uint32_t GetStepCount() const {
+    return graph_.GetStepCount();
+  }
+  const RenderGraph &GetGraph() const {
+    return graph_;
+  }
+
+  // Record the barriers before the pass of the step, GetStepCount gives the
+  // final transitions. Thread safe once compiled.
+  void RecordBarriers(ID3D12GraphicsCommandList *command_list,
+                      uint32_t step) const;
+  // Record the barriers of the step and its pass
+  void RecordPass(ID3D12GraphicsCommandList *command_list,
+                  uint32_t step) const;
+
+ private:
+  struct TextureDesc {
+    D3D12_RESOURCE_DESC desc;
+    bool has_clear_value;
+    D3D12_CLEAR_VALUE clear_value;
+  };
+
+  struct PlacedTexture {
+    ComPtr<ID3D12Resource> resource;
+    D3D12_RESOURCE_DESC desc;
+    uint64_t offset;
+    D3D12_RESOURCE_STATES state;
+    bool used;
+  };
+
+  struct FrameResource {
+    ID3D12Resource *resource;
+    // State at the start of the frame, for transient textures the one the
+    // previous frame left them in
+    D3D12_RESOURCE_STATES state;
+    // Index into texture_descs_ of transient textures
+    uint32_t texture;
+  };
+
+  struct Retired {
+    uint64_t fence_value;
+    ComPtr<ID3D12Pageable> object;
+  };
+
+  void ReserveHeap(uint64_t size);
+  PlacedTexture *GetPlacedTexture(const TextureDesc &texture, uint64_t offset);
+  void RetireUnusedTextures();
+  void TranslateBarriers();
+
+  ComPtr<ID3D12Device> device_;
+  GpuTimeline *timeline_;
+  // Heaps of tier 1 devices hold either render targets or other textures,
+  // transient textures have to be render or depth targets there
+  bool mixed_heaps_supported_;
+  RenderGraph graph_;
+  std::vector<FrameResource> frame_resources_;
+  std::vector<TextureDesc> texture_descs_;
+  std::vector<PassFunction> pass_functions_;
+  ComPtr<ID3D12Heap> heap_;
+  uint64_t heap_size_{0};
+  std::vector<PlacedTexture> placed_textures_;
+  // Heaps and textures released once the frames using them completed
+  std::deque<Retired> retired_;
+  // D3D12 barriers and discards of every step, step i spans offsets i to
+  // i + 1
+  std::vector<D3D12_RESOURCE_BARRIER> barriers_;
+  std::vector<uint32_t> barrier_offsets_;
+  std::vector<ID3D12Resource *> discards_;
+  std::vector<uint32_t> discard_offsets_;
+};
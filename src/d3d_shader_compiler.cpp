@@ -0,0 +1,45 @@
+#include "d3d_shader_compiler.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+#include "D3Dcompiler.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+std::vector<uint8_t> D3DShaderCompiler::Compile(
+    const ShaderCompileRequest &request) {
+  // The macro array is terminated by a null entry
+  std::vector<D3D_SHADER_MACRO> macros;
+  for (const auto &define : request.defines) {
+    macros.push_back({define.name.c_str(), define.value.c_str()});
+  }
+  macros.push_back({nullptr, nullptr});
+
+  ComPtr<ID3DBlob> bytecode;
+  ComPtr<ID3DBlob> error;
+  const std::wstring path = std::filesystem::path(request.path).wstring();
+  if (FAILED(D3DCompileFromFile(path.c_str(), macros.data(),
+                                D3D_COMPILE_STANDARD_FILE_INCLUDE,
+                                request.entry_point.c_str(),
+                                request.target.c_str(), request.compile_flags,
+                                0, &bytecode, &error))) {
+    std::string message = "Failed to compile " + request.entry_point +
+                          " in " + request.path;
+    if (error) {
+      message += ": ";
+      message.append(static_cast<const char *>(error->GetBufferPointer()),
+                     error->GetBufferSize());
+    }
+    throw std::runtime_error(message);
+  }
+
+  const uint8_t *data =
+      static_cast<const uint8_t *>(bytecode->GetBufferPointer());
+  return std::vector<uint8_t>(data, data + bytecode->GetBufferSize());
+}
+
+std::string D3DShaderCompiler::GetVersion() const {
+  return "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION);
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include "core/shader_compiler.h"
+
+// Compiles through D3DCompileFromFile, includes are resolved relative to the
+// including file
+class D3DShaderCompiler : public ShaderCompiler {
+ public:
+  std::vector<uint8_t> Compile(const ShaderCompileRequest &request) override;
+  std::string GetVersion() const override;
+};
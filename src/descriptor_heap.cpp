@@ -0,0 +1,95 @@
+#include "descriptor_heap.h"
+
+#include <stdexcept>
+
+DescriptorHeap::DescriptorHeap(ID3D12Device *device,
+                               D3D12_DESCRIPTOR_HEAP_TYPE type,
+                               uint32_t capacity)
+    : free_list_(capacity) {
+  D3D12_DESCRIPTOR_HEAP_DESC heap_desc = {};
+  heap_desc.NumDescriptors = capacity;
+  heap_desc.Type = type;
+  heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+  if (FAILED(device->CreateDescriptorHeap(&heap_desc, IID_PPV_ARGS(&heap_)))) {
+    throw std::runtime_error("Failed to create descriptor heap");
+  }
+  heap_start_ = heap_->GetCPUDescriptorHandleForHeapStart();
+  descriptor_size_ = device->GetDescriptorHandleIncrementSize(type);
+}
+
+uint32_t DescriptorHeap::Allocate() {
+  const uint32_t index = free_list_.Allocate();
+  if (index == DescriptorFreeList::kInvalidIndex) {
+    throw std::runtime_error("Descriptor heap is full");
+  }
+  return index;
+}
+
+void DescriptorHeap::Free(uint32_t index) {
+  free_list_.Free(index);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::GetCpuHandle(
+    uint32_t index) const {
+  return {heap_start_.ptr + SIZE_T(index) * descriptor_size_};
+}
+
+ShaderVisibleDescriptorRing::ShaderVisibleDescriptorRing(
+    ID3D12Device *device,
+    GpuTimeline *timeline,
+    uint32_t capacity)
+    : device_(device), capacity_(capacity), ring_(capacity, timeline) {
+  D3D12_DESCRIPTOR_HEAP_DESC heap_desc = {};
+  heap_desc.NumDescriptors = capacity;
+  heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+  heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+  if (FAILED(device->CreateDescriptorHeap(&heap_desc, IID_PPV_ARGS(&heap_)))) {
+    throw std::runtime_error("Failed to create shader visible descriptor heap");
+  }
+  cpu_start_ = heap_->GetCPUDescriptorHandleForHeapStart();
+  gpu_start_ = heap_->GetGPUDescriptorHandleForHeapStart();
+  descriptor_size_ = device->GetDescriptorHandleIncrementSize(
+      D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+DescriptorTable ShaderVisibleDescriptorRing::AllocateTable(
+    const D3D12_CPU_DESCRIPTOR_HANDLE *sources,
+    uint32_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t offset = ring_.Allocate(count, 1);
+  if (offset == RingAllocator::kInvalidOffset) {
+    throw std::runtime_error("Descriptor ring is too small for one frame");
+  }
+
+  DescriptorTable table;
+  table.cpu_handle = {cpu_start_.ptr + SIZE_T(offset) * descriptor_size_};
+  table.gpu_handle = {gpu_start_.ptr + offset * descriptor_size_};
+  table.count = count;
+  if (count > 0) {
+    staged_destinations_.push_back(table.cpu_handle);
+    staged_destination_sizes_.push_back(count);
+    staged_sources_.insert(staged_sources_.end(), sources, sources + count);
+  }
+  return table;
+}
+
+void ShaderVisibleDescriptorRing::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (staged_destinations_.empty()) {
+    return;
+  }
+  staged_source_sizes_.resize(staged_sources_.size(), 1);
+  device_->CopyDescriptors(
+      static_cast<UINT>(staged_destinations_.size()),
+      staged_destinations_.data(), staged_destination_sizes_.data(),
+      static_cast<UINT>(staged_sources_.size()), staged_sources_.data(),
+      staged_source_sizes_.data(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  staged_destinations_.clear();
+  staged_destination_sizes_.clear();
+  staged_sources_.clear();
+}
+
+void ShaderVisibleDescriptorRing::FinishFrame(uint64_t fence_value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ring_.FinishBatch(fence_value);
+}
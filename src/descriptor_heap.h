@@ -0,0 +1,92 @@
+#pragma once
+#include <mutex>
+#include <vector>
+
+#include "core/descriptor_free_list.h"
+#include "core/gpu_timeline.h"
+#include "core/ring_allocator.h"
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+// CPU only heap of persistent descriptors of one type. Descriptors are
+// referred to by their index in the heap.
+class DescriptorHeap {
+ public:
+  DescriptorHeap(ID3D12Device *device,
+                 D3D12_DESCRIPTOR_HEAP_TYPE type,
+                 uint32_t capacity);
+
+  // Throws when the heap is full
+  uint32_t Allocate();
+  void Free(uint32_t index);
+
+  D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t index) const;
+  const DescriptorAllocatorStats &GetStats() const {
+    return free_list_.GetStats();
+  }
+
+ private:
+  ComPtr<ID3D12DescriptorHeap> heap_;
+  D3D12_CPU_DESCRIPTOR_HANDLE heap_start_;
+  uint32_t descriptor_size_;
+  DescriptorFreeList free_list_;
+};
+
+struct DescriptorTable {
+  D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle;
+  D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle;
+  uint32_t count;
+};
+
+// Shader visible CBV/SRV/UAV heap handed out linearly for transient tables.
+// Tables are filled from persistent descriptors, the copies are staged and
+// issued by one CopyDescriptors call per Flush. Each frame's tables are
+// reused once the GPU is done with the frame. Allocation is thread safe.
+class ShaderVisibleDescriptorRing {
+ public:
+  static const uint32_t kDefaultCapacity = 16384;
+
+  ShaderVisibleDescriptorRing(ID3D12Device *device,
+                              GpuTimeline *timeline,
+                              uint32_t capacity = kDefaultCapacity);
+
+  // Reserve a contiguous table and stage copies of the source descriptors
+  // into it. Waits for older frames when the ring is full.
+  DescriptorTable AllocateTable(const D3D12_CPU_DESCRIPTOR_HANDLE *sources,
+                                uint32_t count);
+
+  // Copy every staged descriptor, before the lists using the tables execute
+  void Flush();
+
+  // Tables allocated since the last call are reused once fence_value
+  // completes
+  void FinishFrame(uint64_t fence_value);
+
+  ID3D12DescriptorHeap *GetHeap() const {
+    return heap_.Get();
+  }
+  uint32_t GetCapacity() const {
+    return capacity_;
+  }
+  const RingAllocatorStats &GetStats() const {
+    return ring_.GetStats();
+  }
+
+ private:
+  ComPtr<ID3D12Device> device_;
+  ComPtr<ID3D12DescriptorHeap> heap_;
+  D3D12_CPU_DESCRIPTOR_HANDLE cpu_start_;
+  D3D12_GPU_DESCRIPTOR_HANDLE gpu_start_;
+  uint32_t descriptor_size_;
+  uint32_t capacity_;
+
+  std::mutex mutex_;
+  RingAllocator ring_;
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> staged_destinations_;
+  std::vector<UINT> staged_destination_sizes_;
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> staged_sources_;
+  // All ones, sources are copied one descriptor at a time
+  std::vector<UINT> staged_source_sizes_;
+};
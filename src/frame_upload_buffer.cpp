@@ -0,0 +1,60 @@
+#include "frame_upload_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "d3dx12.h"
+
+namespace {
+const uint64_t kMinCapacity = 64 * 1024;
+}  // namespace
+
+FrameUploadBuffer::FrameUploadBuffer(ID3D12Device *device,
+                                     uint32_t frames_in_flight)
+    : device_(device), slots_(frames_in_flight) {
+}
+
+FrameUploadBuffer::~FrameUploadBuffer() {
+  for (auto &slot : slots_) {
+    if (slot.buffer) {
+      slot.buffer->Unmap(0, nullptr);
+    }
+  }
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS FrameUploadBuffer::Write(uint32_t frame_slot,
+                                                   const void *data,
+                                                   uint64_t size) {
+  Slot &slot = slots_[frame_slot];
+  if (!slot.buffer || size > slot.capacity) {
+    // Double the capacity so a growing scene reallocates rarely
+    uint64_t capacity = std::max(slot.capacity * 2, kMinCapacity);
+    while (capacity < size) {
+      capacity *= 2;
+    }
+    if (slot.buffer) {
+      slot.buffer->Unmap(0, nullptr);
+      slot.buffer.Reset();
+    }
+
+    CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC buffer_desc =
+        CD3DX12_RESOURCE_DESC::Buffer(capacity);
+    if (FAILED(device_->CreateCommittedResource(
+            &heap_properties, D3D12_HEAP_FLAG_NONE, &buffer_desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+            IID_PPV_ARGS(&slot.buffer)))) {
+      throw std::runtime_error("Failed to create frame upload buffer");
+    }
+    CD3DX12_RANGE read_range(0, 0);
+    if (FAILED(slot.buffer->Map(
+            0, &read_range, reinterpret_cast<void **>(&slot.mapped_data)))) {
+      throw std::runtime_error("Failed to map frame upload buffer");
+    }
+    slot.capacity = capacity;
+  }
+
+  memcpy(slot.mapped_data, data, size);
+  return slot.buffer->GetGPUVirtualAddress();
+}
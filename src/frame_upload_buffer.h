@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Persistently mapped UPLOAD buffer per frame slot for data the CPU rewrites
+// every frame, read by the GPU in place. A slot is only written after the
+// frame scheduler retired it, so buffers can be grown without fences.
+class FrameUploadBuffer {
+ public:
+  FrameUploadBuffer(ID3D12Device *device, uint32_t frames_in_flight);
+  ~FrameUploadBuffer();
+
+  // Copy the data into the buffer of the slot and return its GPU address
+  D3D12_GPU_VIRTUAL_ADDRESS Write(uint32_t frame_slot,
+                                  const void *data,
+                                  uint64_t size);
+
+  // Buffer of the slot, replaced when a write outgrows it
+  ID3D12Resource *GetBuffer(uint32_t frame_slot) const {
+    return slots_[frame_slot].buffer.Get();
+  }
+  uint64_t GetCapacity(uint32_t frame_slot) const {
+    return slots_[frame_slot].capacity;
+  }
+
+ private:
+  struct Slot {
+    ComPtr<ID3D12Resource> buffer;
+    uint8_t *mapped_data{nullptr};
+    uint64_t capacity{0};
+  };
+
+  ComPtr<ID3D12Device> device_;
+  std::vector<Slot> slots_;
+};
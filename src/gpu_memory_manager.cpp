@@ -0,0 +1,133 @@
+#include "gpu_memory_manager.h"
+
+#include <stdexcept>
+
+#include "d3dx12.h"
+
+GpuMemoryManager::GpuMemoryManager(ID3D12Device *device,
+                                   GpuTimeline *timeline,
+                                   uint64_t budget,
+                                   uint64_t block_size)
+    : device_(device), timeline_(timeline), allocator_(block_size, budget) {
+}
+
+GpuBufferHandle GpuMemoryManager::CreateBuffer(uint64_t size,
+                                               uint64_t alignment) {
+  GpuBufferHandle buffer = allocator_.Allocate(size, alignment);
+  if (buffer == HeapBlockAllocator::kInvalidAllocation) {
+    // Give retired ranges a chance before reporting the budget as exhausted
+    Collect();
+    buffer = allocator_.Allocate(size, alignment);
+    if (buffer == HeapBlockAllocator::kInvalidAllocation) {
+      throw std::runtime_error("GPU memory budget exceeded");
+    }
+  }
+  const uint32_t block = allocator_.Get(buffer).block;
+  if (block >= blocks_.size() || !blocks_[block].heap) {
+    CreateBlock(block);
+  }
+  return buffer;
+}
+
+void GpuMemoryManager::ReleaseBuffer(GpuBufferHandle buffer) {
+  released_.push_back({0, buffer, {}});
+}
+
+void GpuMemoryManager::FinishFrame(uint64_t fence_value) {
+  for (PendingFree &released : released_) {
+    released.fence_value = fence_value;
+    pending_frees_.push_back(released);
+  }
+  released_.clear();
+}
+
+ID3D12Resource *GpuMemoryManager::GetResource(GpuBufferHandle buffer) const {
+  return blocks_[allocator_.Get(buffer).block].buffer.Get();
+}
+
+uint64_t GpuMemoryManager::GetOffset(GpuBufferHandle buffer) const {
+  return allocator_.Get(buffer).offset;
+}
+
+uint64_t GpuMemoryManager::GetSize(GpuBufferHandle buffer) const {
+  return allocator_.Get(buffer).size;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS GpuMemoryManager::GetGpuAddress(
+    GpuBufferHandle buffer) const {
+  return GetResource(buffer)->GetGPUVirtualAddress() + GetOffset(buffer);
+}
+
+uint32_t GpuMemoryManager::Defragment(UploadRing *upload_ring,
+                                      uint64_t max_bytes) {
+  const std::vector<HeapMove> moves =
+      allocator_.PlanDefragmentation(max_bytes);
+  if (moves.empty()) {
+    return 0;
+  }
+
+  ID3D12GraphicsCommandList *command_list = upload_ring->GetCommandList();
+  for (const auto &move : moves) {
+    command_list->CopyBufferRegion(
+        blocks_[move.destination.block].buffer.Get(), move.destination.offset,
+        blocks_[move.source.block].buffer.Get(), move.source.offset,
+        move.source.size);
+  }
+  // The ring may submit to another queue. Once this timeline waited for the
+  // copies its later work sees the moved buffers, and the frame's signal
+  // behind the wait means the sources are free.
+  timeline_->WaitForTimeline(upload_ring->GetTimeline(),
+                             upload_ring->Submit());
+  for (const auto &move : moves) {
+    released_.push_back({0, kInvalidBuffer, move.source});
+  }
+  return static_cast<uint32_t>(moves.size());
+}
+
+void GpuMemoryManager::Collect() {
+  const uint64_t completed_value = timeline_->GetCompletedValue();
+  while (!pending_frees_.empty() &&
+         pending_frees_.front().fence_value <= completed_value) {
+    const PendingFree &pending_free = pending_frees_.front();
+    if (pending_free.buffer != kInvalidBuffer) {
+      allocator_.Free(pending_free.buffer);
+    } else {
+      allocator_.FreeRange(pending_free.range);
+    }
+    pending_frees_.pop_front();
+  }
+
+  // Ranges are only freed after the GPU is done with them, so an empty block
+  // is no longer referenced by any work in flight
+  for (uint32_t block : allocator_.ReleaseEmptyBlocks()) {
+    blocks_[block] = Block{};
+  }
+}
+
+void GpuMemoryManager::CreateBlock(uint32_t block) {
+  if (block >= blocks_.size()) {
+    blocks_.resize(block + 1);
+  }
+  // Heap sizes are kept a multiple of the placement alignment
+  const uint64_t size =
+      (allocator_.GetBlockSize(block) +
+       D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) /
+      D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT *
+      D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+  CD3DX12_HEAP_DESC heap_desc(size, D3D12_HEAP_TYPE_DEFAULT,
+                              D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                              D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
+  if (FAILED(device_->CreateHeap(&heap_desc,
+                                 IID_PPV_ARGS(&blocks_[block].heap)))) {
+    throw std::runtime_error("Failed to create buffer heap");
+  }
+
+  CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+  if (FAILED(device_->CreatePlacedResource(
+          blocks_[block].heap.Get(), 0, &buffer_desc,
+          D3D12_RESOURCE_STATE_COMMON, nullptr,
+          IID_PPV_ARGS(&blocks_[block].buffer)))) {
+    throw std::runtime_error("Failed to create placed buffer");
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "core/gpu_timeline.h"
+#include "core/heap_block_allocator.h"
+#include "d3d12.h"
+#include "upload_ring.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+using GpuBufferHandle = uint32_t;
+
+// Reserves DEFAULT ID3D12Heap blocks and sub-allocates buffers out of them.
+// Every block is covered by one placed buffer and buffers are ranges of it,
+// so small buffers pay neither the 64KB placement alignment nor a resource
+// creation each. Block buffers stay in the COMMON state, copies and reads
+// rely on implicit promotion and decay between ExecuteCommandLists calls.
+class GpuMemoryManager {
+ public:
+  static const uint64_t kDefaultBlockSize = 64 * 1024 * 1024;
+  static const uint64_t kDefaultAlignment = 256;
+  static const GpuBufferHandle kInvalidBuffer =
+      HeapBlockAllocator::kInvalidAllocation;
+
+  GpuMemoryManager(ID3D12Device *device,
+                   GpuTimeline *timeline,
+                   uint64_t budget,
+                   uint64_t block_size = kDefaultBlockSize);
+
+  GpuBufferHandle CreateBuffer(uint64_t size,
+                               uint64_t alignment = kDefaultAlignment);
+
+  // The range is reused once the fence value passed to the next FinishFrame
+  // completes, the frames before it may still read the buffer
+  void ReleaseBuffer(GpuBufferHandle buffer);
+  // Buffers released since the last call are freed by Collect once
+  // fence_value completed
+  void FinishFrame(uint64_t fence_value);
+
+  ID3D12Resource *GetResource(GpuBufferHandle buffer) const;
+  uint64_t GetOffset(GpuBufferHandle buffer) const;
+  uint64_t GetSize(GpuBufferHandle buffer) const;
+  D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress(GpuBufferHandle buffer) const;
+
+  // Copy up to max_bytes of buffers out of the least occupied block through
+  // the upload ring's batch. Returns the number of moved buffers, whose
+  // addresses change and whose views have to be rebuilt. Call before the
+  // frame's work is submitted, the sources are freed with the buffers
+  // released during the frame.
+  uint32_t Defragment(UploadRing *upload_ring, uint64_t max_bytes);
+
+  // Reclaim released ranges and empty heaps the GPU is done with
+  void Collect();
+
+  std::string GetUsageReport() const {
+    return allocator_.GetUsageReport();
+  }
+
+ private:
+  struct Block {
+    ComPtr<ID3D12Heap> heap;
+    ComPtr<ID3D12Resource> buffer;
+  };
+
+  struct PendingFree {
+    uint64_t fence_value;
+    GpuBufferHandle buffer;
+    // Source range of a defragmentation move, used when buffer is invalid
+    HeapRange range;
+  };
+
+  void CreateBlock(uint32_t block);
+
+  ComPtr<ID3D12Device> device_;
+  GpuTimeline *timeline_;
+  HeapBlockAllocator allocator_;
+  std::vector<Block> blocks_;
+  std::deque<PendingFree> pending_frees_;
+  // Released buffers and move sources of the current frame, waiting for its
+  // fence value
+  std::vector<PendingFree> released_;
+};
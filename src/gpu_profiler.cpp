@@ -0,0 +1,112 @@
+#include "gpu_profiler.h"
+
+#include <stdexcept>
+
+#include "core/profiler.h"
+#include "d3dx12.h"
+
+GpuProfiler::GpuProfiler(ID3D12Device *device,
+                         ID3D12CommandQueue *command_queue,
+                         uint32_t frames_in_flight,
+                         uint32_t max_scopes)
+    : command_queue_(command_queue),
+      slots_(frames_in_flight),
+      max_scopes_(max_scopes) {
+  const uint32_t query_count = frames_in_flight * max_scopes * 2;
+  D3D12_QUERY_HEAP_DESC query_heap_desc = {};
+  query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+  query_heap_desc.Count = query_count;
+  if (FAILED(device->CreateQueryHeap(&query_heap_desc,
+                                     IID_PPV_ARGS(&query_heap_)))) {
+    throw std::runtime_error("Failed to create timestamp query heap");
+  }
+
+  CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_READBACK);
+  CD3DX12_RESOURCE_DESC buffer_desc =
+      CD3DX12_RESOURCE_DESC::Buffer(query_count * sizeof(uint64_t));
+  if (FAILED(device->CreateCommittedResource(
+          &heap_properties, D3D12_HEAP_FLAG_NONE, &buffer_desc,
+          D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+          IID_PPV_ARGS(&readback_buffer_)))) {
+    throw std::runtime_error("Failed to create timestamp readback buffer");
+  }
+
+  if (FAILED(command_queue->GetTimestampFrequency(&timestamp_frequency_))) {
+    throw std::runtime_error("Failed to get timestamp frequency");
+  }
+  for (Slot &slot : slots_) {
+    slot.names.resize(max_scopes);
+  }
+}
+
+void GpuProfiler::BeginScope(ID3D12GraphicsCommandList *command_list,
+                             uint32_t frame_slot,
+                             uint32_t scope,
+                             const char *name) {
+  slots_[frame_slot].names[scope] = name;
+  command_list->EndQuery(query_heap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+                         GetQueryIndex(frame_slot, scope));
+}
+
+void GpuProfiler::EndScope(ID3D12GraphicsCommandList *command_list,
+                           uint32_t frame_slot,
+                           uint32_t scope) {
+  command_list->EndQuery(query_heap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+                         GetQueryIndex(frame_slot, scope) + 1);
+}
+
+void GpuProfiler::ResolveFrame(ID3D12GraphicsCommandList *command_list,
+                               uint32_t frame_slot,
+                               uint32_t scope_count) {
+  const uint32_t first_query = GetQueryIndex(frame_slot, 0);
+  command_list->ResolveQueryData(
+      query_heap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first_query,
+      scope_count * 2, readback_buffer_.Get(),
+      first_query * sizeof(uint64_t));
+  slots_[frame_slot].resolved_count = scope_count;
+}
+
+void GpuProfiler::CollectFrame(uint32_t frame_slot) {
+  Slot &slot = slots_[frame_slot];
+  if (slot.resolved_count == 0) {
+    return;
+  }
+
+  // Map GPU ticks to the profiler clock through a pair of simultaneous
+  // readings, the profiler clock is read right after the calibration
+  uint64_t gpu_now = 0;
+  uint64_t cpu_counter = 0;
+  if (FAILED(command_queue_->GetClockCalibration(&gpu_now, &cpu_counter))) {
+    throw std::runtime_error("Failed to calibrate the GPU clock");
+  }
+  const uint64_t cpu_now_ns = Profiler::Now();
+  const auto to_cpu_ns = [&](uint64_t ticks) {
+    const double delta_ns = (static_cast<double>(gpu_now) -
+                             static_cast<double>(ticks)) *
+                            1e9 / static_cast<double>(timestamp_frequency_);
+    return cpu_now_ns - static_cast<uint64_t>(delta_ns);
+  };
+
+  const uint32_t first_query = GetQueryIndex(frame_slot, 0);
+  const CD3DX12_RANGE read_range(
+      first_query * sizeof(uint64_t),
+      (first_query + slot.resolved_count * 2) * sizeof(uint64_t));
+  uint8_t *mapped_data = nullptr;
+  if (FAILED(readback_buffer_->Map(0, &read_range,
+                                   reinterpret_cast<void **>(&mapped_data)))) {
+    throw std::runtime_error("Failed to map timestamp readback buffer");
+  }
+  const uint64_t *timestamps =
+      reinterpret_cast<const uint64_t *>(mapped_data) + first_query;
+  for (uint32_t scope = 0; scope < slot.resolved_count; scope++) {
+    const uint64_t begin = timestamps[scope * 2];
+    const uint64_t end = timestamps[scope * 2 + 1];
+    if (end >= begin && slot.names[scope] != nullptr) {
+      Profiler::Get().RecordGpu(slot.names[scope], to_cpu_ns(begin),
+                                to_cpu_ns(end));
+    }
+  }
+  const CD3DX12_RANGE written_range(0, 0);
+  readback_buffer_->Unmap(0, &written_range);
+  slot.resolved_count = 0;
+}
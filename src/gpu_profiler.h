@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Timestamp query pairs around GPU work, resolved into a readback buffer per
+// frame slot and handed to the Profiler once the frame scheduler retired the
+// slot. Scopes are indexed by the caller, so command lists recorded in
+// parallel never share state.
+class GpuProfiler {
+ public:
+  GpuProfiler(ID3D12Device *device,
+              ID3D12CommandQueue *command_queue,
+              uint32_t frames_in_flight,
+              uint32_t max_scopes);
+
+  // Begin and end may be recorded into different lists of the same queue,
+  // name must outlive the frame
+  void BeginScope(ID3D12GraphicsCommandList *command_list,
+                  uint32_t frame_slot,
+                  uint32_t scope,
+                  const char *name);
+  void EndScope(ID3D12GraphicsCommandList *command_list,
+                uint32_t frame_slot,
+                uint32_t scope);
+
+  // Copy the timestamps of scopes [0, scope_count) into the readback buffer,
+  // record after every EndScope of the frame
+  void ResolveFrame(ID3D12GraphicsCommandList *command_list,
+                    uint32_t frame_slot,
+                    uint32_t scope_count);
+
+  // Pass the timestamps the slot's previous frame resolved to the Profiler,
+  // call after FrameScheduler::BeginFrame returned the slot
+  void CollectFrame(uint32_t frame_slot);
+
+  uint32_t GetMaxScopes() const {
+    return max_scopes_;
+  }
+
+ private:
+  struct Slot {
+    std::vector<const char *> names;
+    uint32_t resolved_count{0};
+  };
+
+  uint32_t GetQueryIndex(uint32_t frame_slot, uint32_t scope) const {
+    return (frame_slot * max_scopes_ + scope) * 2;
+  }
+
+  ComPtr<ID3D12CommandQueue> command_queue_;
+  ComPtr<ID3D12QueryHeap> query_heap_;
+  ComPtr<ID3D12Resource> readback_buffer_;
+  std::vector<Slot> slots_;
+  uint32_t max_scopes_;
+  uint64_t timestamp_frequency_{0};
+};
@@ -0,0 +1,459 @@
+#include "headless/headless_application.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#include "core/builtin_meshes.h"
+#include "core/frame_time_stats.h"
+#include "core/mesh_processing.h"
+#include "core/profiler.h"
+#include "core/task_graph.h"
+
+namespace {
+// Half size of the scattered scene, the view covers [-1, 1] of it
+const float kScatteredSceneExtent = 8.0f;
+const float kCameraPathRadius = 4.0f;
+// The occlusion buffer has a pixel per 4x4 pixels of the render target
+const uint32_t kOcclusionBufferDivisor = 4;
+}  // namespace
+
+HeadlessApplication::HeadlessApplication(const HeadlessSettings &settings)
+    : settings_(settings), render_target_(settings.width, settings.height) {
+  uint32_t thread_count = settings.thread_count;
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  job_system_ = std::make_unique<JobSystem>(thread_count);
+  rasterizer_ = std::make_unique<SoftwareRasterizer>(job_system_.get());
+
+  scissor_rect_.right = static_cast<int32_t>(settings.width);
+  scissor_rect_.bottom = static_cast<int32_t>(settings.height);
+  viewport_.width = static_cast<float>(settings.width);
+  viewport_.height = static_cast<float>(settings.height);
+}
+
+bool HeadlessApplication::Run() {
+  LoadAssets();
+  if (!settings_.capture_path.empty()) {
+    frame_sink_ = std::make_unique<FrameSink>(
+        settings_.capture_path,
+        FrameSink::GetFormatForPath(settings_.capture_path));
+  }
+
+  std::vector<double> frame_times;
+  frame_times.reserve(settings_.frame_count);
+  FrameTimeStats frame_time_stats(std::max(settings_.frame_count, 1u));
+  FrameTimeStats latency_stats(std::max(settings_.frame_count, 1u));
+  const auto start = std::chrono::steady_clock::now();
+  // The update thread runs every update, frames draw the newest snapshot
+  // until the last update is drawn
+  if (settings_.update_rate_hz > 0.0 && settings_.frame_count > 0) {
+    update_thread_ = std::make_unique<UpdateThread>(
+        [this](uint64_t update, SceneSnapshot *snapshot) {
+          Update(update, snapshot);
+        },
+        settings_.update_rate_hz, settings_.frame_count,
+        [this] {
+          // As many workers as the frames get, culling overlaps them
+          update_job_system_ =
+              std::make_unique<JobSystem>(job_system_->GetThreadCount());
+          scene_culler_ =
+              std::make_unique<SceneCuller>(update_job_system_.get());
+        });
+  } else {
+    scene_culler_ = std::make_unique<SceneCuller>(job_system_.get());
+  }
+  SceneSnapshot lockstep_snapshot;
+  const SceneSnapshot *snapshot = nullptr;
+  UpdateThreadStats update_stats;
+  while (settings_.frame_count > 0 &&
+         (!snapshot || snapshot->update + 1 < settings_.frame_count)) {
+    if (update_thread_) {
+      // Redrawing an unchanged snapshot would only repeat the last frame
+      PROFILE_SCOPE("WaitForSnapshot");
+      while (!update_thread_->AcquireSnapshot()) {
+        std::this_thread::yield();
+      }
+    }
+    const auto frame_start = std::chrono::steady_clock::now();
+    {
+      PROFILE_SCOPE("Frame");
+      if (update_thread_) {
+        snapshot = &update_thread_->GetSnapshot();
+      } else {
+        const uint64_t update = snapshot ? snapshot->update + 1 : 0;
+        lockstep_snapshot.update_start = frame_start;
+        Update(update, &lockstep_snapshot);
+        lockstep_snapshot.update = update;
+        snapshot = &lockstep_snapshot;
+        update_stats.updates++;
+        update_stats.update_time_ns +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - frame_start)
+                .count();
+      }
+      PopulateCommandList(*snapshot);
+    }
+    if (frame_sink_) {
+      // The rasterizer finished the frame, nothing to wait for
+      PROFILE_SCOPE("CaptureFrame");
+      frame_sink_->WriteFrame(GetFrameView(render_target_));
+    }
+    const auto frame_end = std::chrono::steady_clock::now();
+    frame_times.push_back(
+        std::chrono::duration<double, std::milli>(frame_end - frame_start)
+            .count());
+    frame_time_stats.AddFrame(frame_times.back());
+    latency_stats.AddFrame(std::chrono::duration<double, std::milli>(
+                               frame_end - snapshot->update_start)
+                               .count());
+#ifdef ENABLE_PROFILER
+    Profiler::Get().Collect();
+#endif
+  }
+  const double total_seconds = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+  if (update_thread_) {
+    update_stats = update_thread_->GetStats();
+    update_thread_.reset();
+  }
+
+  const RasterStats &stats = rasterizer_->GetStats();
+  std::sort(frame_times.begin(), frame_times.end());
+  std::cout << "Threads: " << job_system_->GetThreadCount() << std::endl;
+  std::cout << "Resolution: " << settings_.width << "x" << settings_.height
+            << std::endl;
+  std::cout << "Frames: " << frame_times.size() << std::endl;
+  if (!frame_times.empty()) {
+    std::cout << "Frame time (ms): min " << frame_times.front() << ", median "
+              << frame_times[frame_times.size() / 2] << ", p99 "
+              << frame_time_stats.GetPercentile(99.0) << ", max "
+              << frame_times.back() << std::endl;
+  }
+  std::cout << "Triangles/sec: " << stats.triangles_submitted / total_seconds
+            << " (" << stats.triangles_culled << " culled)" << std::endl;
+  std::cout << "Pixels/sec: " << stats.pixels_shaded / total_seconds
+            << std::endl;
+  const CullingStats &culling_stats = scene_culler_->GetStats();
+  std::cout << "Culling (" << GetSimdLevelName(scene_culler_->GetSimdLevel())
+            << "): " << culling_stats.visible << " of "
+            << culling_stats.objects << " objects visible, "
+            << culling_time_ns_ / 1e6 /
+                   std::max<uint64_t>(update_stats.updates, 1)
+            << " ms/update" << std::endl;
+  // Decoupled updates overlap the frames, so the two together can be busy
+  // for longer than the run. Updates on the render thread are part of the
+  // frame times.
+  const double update_seconds = update_stats.update_time_ns / 1e9;
+  double render_seconds =
+      settings_.update_rate_hz > 0.0 ? 0.0 : -update_seconds;
+  for (double frame_time : frame_times) {
+    render_seconds += frame_time / 1e3;
+  }
+  std::cout << "Updates ("
+            << (settings_.update_rate_hz > 0.0 ? "update thread"
+                                                : "render thread")
+            << "): " << update_stats.updates << ", "
+            << update_stats.updates / total_seconds << "/sec, "
+            << update_seconds * 1e3 /
+                   std::max<uint64_t>(update_stats.updates, 1)
+            << " ms/update, " << update_stats.late_updates << " late, "
+            << update_stats.updates - frame_times.size()
+            << " never drawn" << std::endl;
+  std::cout << "Throughput: " << frame_times.size() / total_seconds
+            << " frames/sec, updating and rendering busy "
+            << (update_seconds + render_seconds) / total_seconds * 100.0
+            << "% of the run" << std::endl;
+  std::cout << "Update to frame latency (ms): median "
+            << latency_stats.GetPercentile(50.0) << ", p99 "
+            << latency_stats.GetPercentile(99.0) << std::endl;
+  if (frame_sink_) {
+    frame_sink_->Flush();
+    const FrameSinkStats &sink_stats = frame_sink_->GetStats();
+    std::cout << "Capture: " << sink_stats.frames << " frames, "
+              << sink_stats.bytes << " bytes, "
+              << sink_stats.write_time_ns / 1e6 /
+                     std::max<uint64_t>(sink_stats.frames, 1)
+              << " ms/frame writing" << std::endl;
+  }
+  const DrawQueueStats &queue_stats = draw_queue_.GetStats();
+  std::cout << "Draw queue: " << queue_stats.items << " items, "
+            << queue_stats.draw_calls << " draw calls, "
+            << queue_stats.pipeline_changes << " pipeline changes, "
+            << queue_stats.vertex_buffer_changes << " vertex buffer changes"
+            << std::endl;
+  std::cout << "LODs: " << mesh_view_.lod_count << ", " << lod_triangles_
+            << " of " << full_detail_triangles_
+            << " full detail triangles drawn" << std::endl;
+  if (streaming_) {
+    std::cout << "Streaming: " << streaming_->GetUsageReport() << std::endl;
+  }
+  if (occlusion_culler_) {
+    std::cout << "Occlusion ("
+              << GetSimdLevelName(occlusion_culler_->GetSimdLevel())
+              << "): " << occluded_objects_ << " of "
+              << occlusion_tested_objects_ << " objects occluded, "
+              << occlusion_time_ns_ / 1e6 /
+                     std::max<size_t>(frame_times.size(), 1)
+              << " ms/frame" << std::endl;
+  }
+
+#ifdef ENABLE_PROFILER
+  const ProfilerStats profiler_stats = Profiler::Get().GetStats();
+  std::cout << "Profiler: " << profiler_stats.collected_events
+            << " events, " << profiler_stats.dropped_events << " dropped"
+            << std::endl;
+  if (!settings_.trace_path.empty()) {
+    Profiler::Get().WriteChromeTrace(settings_.trace_path);
+  }
+#else
+  if (!settings_.trace_path.empty()) {
+    std::cerr << "Built without ENABLE_PROFILER, no trace written"
+              << std::endl;
+  }
+#endif
+
+  if (!settings_.output_path.empty()) {
+    WritePpm(settings_.output_path, render_target_);
+  }
+  if (!settings_.golden_path.empty()) {
+    const ImageDifference difference =
+        CompareImages(render_target_, ReadPpm(settings_.golden_path),
+                      settings_.golden_tolerance);
+    std::cout << "Golden image: " << difference.mismatched_pixels
+              << " mismatched pixels, max channel difference "
+              << difference.max_channel_difference << std::endl;
+    return difference.mismatched_pixels == 0;
+  }
+  return true;
+}
+
+void HeadlessApplication::LoadAssets() {
+  // Loading the mesh and placing the instances are independent, the scene
+  // needs both
+  BoundingSphere mesh_bounds;
+  std::vector<InstanceData> instances;
+  TaskGraph startup;
+  const uint32_t load_mesh = startup.AddTask("LoadMesh", {}, [&] {
+    if (settings_.mesh_path.empty()) {
+      builtin_mesh_ = BuildTriangleMesh();
+      mesh_view_ = builtin_mesh_.GetView();
+    } else {
+      mesh_file_ = std::make_unique<MeshFile>(settings_.mesh_path);
+      mesh_view_ = mesh_file_->GetView();
+    }
+    if (mesh_view_.lod_count < 2) {
+      processed_mesh_ = ProcessMesh(mesh_view_);
+      mesh_view_ = processed_mesh_.GetView();
+    }
+    for (uint32_t lod = 0; lod < mesh_view_.lod_count; lod++) {
+      const uint32_t mesh = draw_queue_.AddMesh(
+          {0, mesh_view_.lods[lod].first_index,
+           mesh_view_.lods[lod].index_count, 0});
+      if (lod == 0) {
+        scene_mesh_ = mesh;
+      }
+    }
+    if (settings_.streaming_budget > 0) {
+      StreamingSettings streaming_settings;
+      streaming_settings.budget = settings_.streaming_budget;
+      streaming_ = std::make_unique<StreamingManager>(streaming_settings);
+      const uint8_t *indices =
+          static_cast<const uint8_t *>(mesh_view_.indices);
+      std::vector<StreamingLevel> levels;
+      for (uint32_t lod = 0; lod < mesh_view_.lod_count; lod++) {
+        const MeshLod &mesh_lod = mesh_view_.lods[lod];
+        levels.push_back(
+            {indices + uint64_t(mesh_lod.first_index) * mesh_view_.index_size,
+             uint64_t(mesh_lod.index_count) * mesh_view_.index_size});
+      }
+      scene_resource_ = streaming_->AddResource(levels);
+    }
+    mesh_bounds = ComputeBoundingSphere(mesh_view_);
+  });
+  const uint32_t build_instances =
+      startup.AddTask("BuildInstances", {}, [&] {
+        if (settings_.scene_object_count > 0) {
+          instances = BuildScatteredInstances(settings_.scene_object_count,
+                                              kScatteredSceneExtent);
+        } else if (settings_.grid_size > 0) {
+          instances = BuildTriangleGridInstances(settings_.grid_size);
+        } else {
+          instances = {{{0.0f, 0.0f}, {1.0f, 1.0f}}};
+        }
+      });
+  startup.AddTask("BuildScene", {load_mesh, build_instances}, [&] {
+    for (const auto &instance : instances) {
+      scene_.AddObject(scene_mesh_, instance, mesh_bounds);
+    }
+  });
+  startup.Run(job_system_.get());
+  std::cout << "Startup timeline:" << std::endl
+            << startup.GetTimelineReport();
+  if (settings_.occluder_count > 0) {
+    occlusion_culler_ = std::make_unique<OcclusionCuller>(
+        job_system_.get(),
+        std::max(settings_.width / kOcclusionBufferDivisor, 1u),
+        std::max(settings_.height / kOcclusionBufferDivisor, 1u));
+  }
+}
+
+void HeadlessApplication::Update(uint64_t update, SceneSnapshot *snapshot) {
+  PROFILE_SCOPE("Update");
+  // Circle over the scattered scene at a fixed step per update, so frames
+  // are reproducible
+  if (settings_.scene_object_count > 0) {
+    const float time = static_cast<float>(update) / 60.0f;
+    snapshot->camera.position =
+        glm::vec2(std::cos(time * 0.5f) * kCameraPathRadius,
+                  std::sin(time * 0.5f) * kCameraPathRadius);
+  }
+  const std::vector<uint32_t> &visible = scene_culler_->Cull(
+      scene_, ExtractFrustum(snapshot->camera.GetViewProjection()));
+  snapshot->visible_objects.assign(visible.begin(), visible.end());
+  snapshot->culling = scene_culler_->GetStats();
+  culling_time_ns_ += snapshot->culling.time_ns;
+}
+
+void HeadlessApplication::PopulateCommandList(const SceneSnapshot &snapshot) {
+  PROFILE_SCOPE("PopulateCommandList");
+  rasterizer_->OMSetRenderTarget(&render_target_);
+  rasterizer_->RSSetViewport(viewport_);
+  rasterizer_->RSSetScissorRect(scissor_rect_);
+
+  const float clear_color[] = {0.0f, 0.2f, 0.4f, 1.0f};
+  rasterizer_->ClearRenderTargetView(clear_color);
+
+  // Levels loaded since the last frame become drawable, those evicted were
+  // last drawn by it
+  if (streaming_) {
+    streaming_->Update();
+  }
+
+  // Every visible object is drawn at the LOD its size on screen needs, or the
+  // finest resident one when streaming has not caught up yet
+  frame_items_.clear();
+  frame_objects_.clear();
+  for (uint32_t object : snapshot.visible_objects) {
+    const ObjectData object_data = {
+        snapshot.camera.ToClipSpace(scene_.GetInstance(object)),
+        scene_.GetColor(object)};
+    const float pixels_per_unit =
+        0.5f * std::max(std::abs(object_data.transform.scale.x) *
+                            viewport_.width,
+                        std::abs(object_data.transform.scale.y) *
+                            viewport_.height);
+    uint32_t lod =
+        SelectLod(mesh_view_.lods, mesh_view_.lod_count, pixels_per_unit,
+                  settings_.lod_error_pixels);
+    if (streaming_) {
+      streaming_->Request(scene_resource_, lod, pixels_per_unit);
+      lod = std::max(lod, streaming_->GetResidentLevel(scene_resource_));
+    }
+    frame_items_.push_back({0, 0, scene_.GetMesh(object) + lod});
+    frame_objects_.push_back(object_data);
+  }
+  if (occlusion_culler_) {
+    CullOccludedObjects();
+  }
+
+  // Submit the objects left separately, the queue merges objects of the same
+  // LOD into instances
+  draw_queue_.Reset();
+  for (size_t i = 0; i < frame_items_.size(); i++) {
+    if (occlusion_culler_ && !occlusion_visible_[i]) {
+      continue;
+    }
+    const uint32_t lod = frame_items_[i].mesh - scene_mesh_;
+    lod_triangles_ += mesh_view_.lods[lod].index_count / 3;
+    full_detail_triangles_ += mesh_view_.lods[0].index_count / 3;
+    draw_queue_.Push(frame_items_[i], &frame_objects_[i]);
+  }
+  draw_queue_.Build();
+
+  // Batches index the objects of the whole frame through a constant, as the
+  // draws of Application do
+  const std::vector<uint8_t> &object_data = draw_queue_.GetInstanceData();
+  rasterizer_->IASetVertexBuffer(mesh_view_.vertices, mesh_view_.vertex_count);
+  rasterizer_->IASetIndexBuffer(mesh_view_.indices, mesh_view_.index_count,
+                                mesh_view_.index_size);
+  rasterizer_->SetPositionQuantization(mesh_view_.quantization);
+  rasterizer_->SetObjectBuffer(
+      reinterpret_cast<const ObjectData *>(object_data.data()),
+      static_cast<uint32_t>(object_data.size() / sizeof(ObjectData)));
+  for (const auto &batch : draw_queue_.GetBatches()) {
+    const MeshRange &mesh = draw_queue_.GetMesh(batch.mesh);
+    uint32_t start_index = mesh.start_index;
+    if (streaming_) {
+      // Streamed LODs are buffers of their own
+      rasterizer_->IASetIndexBuffer(
+          streaming_->GetLevelData(scene_resource_, batch.mesh - scene_mesh_),
+          mesh.index_count, mesh_view_.index_size);
+      start_index = 0;
+    }
+    rasterizer_->SetFirstObject(batch.first_instance);
+    rasterizer_->DrawIndexedInstanced(mesh.index_count, batch.instance_count,
+                                      start_index, mesh.base_vertex, 0);
+  }
+}
+
+void HeadlessApplication::CullOccludedObjects() {
+  PROFILE_SCOPE("OcclusionCulling");
+  const uint32_t count = static_cast<uint32_t>(frame_items_.size());
+  // Without a depth buffer what is drawn later covers what was drawn before,
+  // so the draw order is the depth
+  frame_depths_.resize(count);
+  ComputeDrawOrderDepths(draw_queue_, frame_items_.data(), count,
+                         frame_depths_.data());
+
+  // The largest objects on screen hide the most
+  occluders_.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    occluders_[i] = i;
+  }
+  const auto screen_area = [this](uint32_t i) {
+    const InstanceData &transform = frame_objects_[i].transform;
+    return std::abs(transform.scale.x * transform.scale.y);
+  };
+  const uint32_t occluder_count = std::min(settings_.occluder_count, count);
+  std::nth_element(occluders_.begin(), occluders_.begin() + occluder_count,
+                   occluders_.end(), [&](uint32_t a, uint32_t b) {
+                     return screen_area(a) > screen_area(b);
+                   });
+  occlusion_culler_->BeginFrame();
+  for (uint32_t i = 0; i < occluder_count; i++) {
+    const uint32_t object = occluders_[i];
+    const uint32_t lod = frame_items_[object].mesh - scene_mesh_;
+    const MeshLod &mesh_lod = mesh_view_.lods[lod];
+    // The indices the object is drawn with, streamed LODs were faulted in
+    // since the LOD was clamped to the resident one
+    const void *indices = static_cast<const uint8_t *>(mesh_view_.indices) +
+                          uint64_t(mesh_lod.first_index) *
+                              mesh_view_.index_size;
+    const OccluderMesh occluder = {mesh_view_.vertices,
+                                   mesh_view_.vertex_count,
+                                   indices,
+                                   mesh_lod.index_count,
+                                   mesh_view_.index_size,
+                                   mesh_view_.quantization};
+    occlusion_culler_->AddOccluder(occluder, frame_objects_[object].transform,
+                                   frame_depths_[object]);
+  }
+  occlusion_culler_->Rasterize();
+
+  occlusion_queries_.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    occlusion_queries_[i] = {frame_objects_[i].transform,
+                             mesh_view_.quantization, frame_depths_[i]};
+  }
+  occlusion_culler_->Test(occlusion_queries_.data(), count,
+                          &occlusion_visible_);
+  const OcclusionStats &stats = occlusion_culler_->GetStats();
+  occlusion_tested_objects_ += stats.objects;
+  occluded_objects_ += stats.occluded;
+  occlusion_time_ns_ += stats.rasterize_time_ns + stats.test_time_ns;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/draw_queue.h"
+#include "core/frame_sink.h"
+#include "core/image.h"
+#include "core/mesh.h"
+#include "core/mesh_file.h"
+#include "core/scene.h"
+#include "core/software_rasterizer.h"
+#include "core/job_system.h"
+#include "core/occlusion_culling.h"
+#include "core/streaming_manager.h"
+#include "core/update_thread.h"
+#include "core/vertex.h"
+
+struct HeadlessSettings {
+  uint32_t width{1920};
+  uint32_t height{1080};
+  uint32_t frame_count{100};
+  // 0 uses every hardware thread
+  uint32_t thread_count{0};
+  // 0 renders the sample triangle, otherwise a grid of grid_size^2 instances
+  // of it
+  uint32_t grid_size{0};
+  // Objects scattered over a world larger than the view, replaces the grid
+  // and pans the camera so that culling has work to do
+  uint32_t scene_object_count{0};
+  // Mesh file drawn instead of the sample triangle
+  std::string mesh_path;
+  std::string output_path;
+  std::string golden_path;
+  // Every frame is streamed into this file or pipe, PPM for .ppm paths and
+  // raw R8G8B8A8 otherwise
+  std::string capture_path;
+  // Chrome trace of the run, needs ENABLE_PROFILER
+  std::string trace_path;
+  uint32_t golden_tolerance{1};
+  // Objects are drawn at the coarsest LOD whose error stays within this many
+  // pixels
+  float lod_error_pixels{1.0f};
+  // LODs finer than the coarsest one stream in within this many bytes, 0
+  // keeps the whole mesh resident
+  uint64_t streaming_budget{0};
+  // The largest objects on screen occlude the others, 0 disables occlusion
+  // culling
+  uint32_t occluder_count{32};
+  // Updates run on a thread of their own at this rate, overlapping the
+  // frames, which draw the newest snapshot. 0 updates on the render thread
+  // before every frame, so every update is drawn and captures reproduce.
+  double update_rate_hz{0.0};
+};
+
+// Runs the frame of Application on the software rasterizer instead of a D3D12
+// device, rendering into an offscreen R8G8B8A8 image
+class HeadlessApplication {
+ public:
+  explicit HeadlessApplication(const HeadlessSettings &settings);
+
+  // Returns false when the final frame does not match the golden image
+  bool Run();
+
+ private:
+  void LoadAssets();
+  // Fill the snapshot of the update, on the update thread when there is one
+  void Update(uint64_t update, SceneSnapshot *snapshot);
+  void PopulateCommandList(const SceneSnapshot &snapshot);
+  // Rasterize the largest frame objects as occluders and test every frame
+  // object against them into occlusion_visible_
+  void CullOccludedObjects();
+
+  HeadlessSettings settings_;
+  std::unique_ptr<JobSystem> job_system_;
+  std::unique_ptr<SoftwareRasterizer> rasterizer_;
+  Image render_target_;
+  std::unique_ptr<FrameSink> frame_sink_;
+  Mesh builtin_mesh_;
+  std::unique_ptr<MeshFile> mesh_file_;
+  // LODs and meshlets built at load time for meshes without them
+  Mesh processed_mesh_;
+  // Geometry of the scene object, in builtin_mesh_, mesh_file_ or
+  // processed_mesh_
+  MeshView mesh_view_;
+  // Draw queue mesh of the full detail LOD, LOD i is drawn as scene_mesh_ + i
+  uint32_t scene_mesh_{0};
+  // Streams the index data of the LODs when a budget is set, the vertices
+  // stay resident as every LOD indexes them
+  std::unique_ptr<StreamingManager> streaming_;
+  uint32_t scene_resource_{0};
+  // Triangles drawn over the run, and those full detail would have drawn
+  uint64_t lod_triangles_{0};
+  uint64_t full_detail_triangles_{0};
+  Scene scene_;
+  // Created on the update thread with workers of their own when updates
+  // are threaded, Schedule and Wait belong to the thread creating a system
+  std::unique_ptr<JobSystem> update_job_system_;
+  std::unique_ptr<SceneCuller> scene_culler_;
+  uint64_t culling_time_ns_{0};
+  std::unique_ptr<UpdateThread> update_thread_;
+  // Objects inside the frustum at the LOD they are drawn with, before
+  // occlusion culling
+  std::vector<DrawItem> frame_items_;
+  std::vector<ObjectData> frame_objects_;
+  // Null when occlusion culling is disabled
+  std::unique_ptr<OcclusionCuller> occlusion_culler_;
+  std::vector<float> frame_depths_;
+  std::vector<uint32_t> occluders_;
+  std::vector<OcclusionQuery> occlusion_queries_;
+  std::vector<uint8_t> occlusion_visible_;
+  // Objects tested and found occluded over the run
+  uint64_t occlusion_tested_objects_{0};
+  uint64_t occluded_objects_{0};
+  uint64_t occlusion_time_ns_{0};
+  DrawQueue draw_queue_{sizeof(ObjectData)};
+  RasterViewport viewport_;
+  RasterRect scissor_rect_;
+};
@@ -0,0 +1,78 @@
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "headless/headless_application.h"
+
+namespace {
+void PrintUsage() {
+  std::cout << "Usage: hello_d3d12_headless [--width N] [--height N] "
+               "[--frames N] [--threads N] [--grid N] [--scene N] "
+               "[--mesh file.mesh] [--output file.ppm] [--golden file.ppm] "
+               "[--tolerance N] [--trace file.json] [--capture file] "
+               "[--lod-error pixels] [--stream-budget bytes] "
+               "[--occluders N] [--update-rate hz]"
+            << std::endl;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  HeadlessSettings settings;
+  for (int i = 1; i < argc; i++) {
+    const std::string option = argv[i];
+    if (option == "--help") {
+      PrintUsage();
+      return 0;
+    }
+    if (i + 1 >= argc) {
+      PrintUsage();
+      return 1;
+    }
+    const char *value = argv[++i];
+    if (option == "--width") {
+      settings.width = std::stoul(value);
+    } else if (option == "--height") {
+      settings.height = std::stoul(value);
+    } else if (option == "--frames") {
+      settings.frame_count = std::stoul(value);
+    } else if (option == "--threads") {
+      settings.thread_count = std::stoul(value);
+    } else if (option == "--grid") {
+      settings.grid_size = std::stoul(value);
+    } else if (option == "--scene") {
+      settings.scene_object_count = std::stoul(value);
+    } else if (option == "--mesh") {
+      settings.mesh_path = value;
+    } else if (option == "--output") {
+      settings.output_path = value;
+    } else if (option == "--golden") {
+      settings.golden_path = value;
+    } else if (option == "--tolerance") {
+      settings.golden_tolerance = std::stoul(value);
+    } else if (option == "--trace") {
+      settings.trace_path = value;
+    } else if (option == "--capture") {
+      settings.capture_path = value;
+    } else if (option == "--lod-error") {
+      settings.lod_error_pixels = std::stof(value);
+    } else if (option == "--stream-budget") {
+      settings.streaming_budget = std::stoull(value);
+    } else if (option == "--occluders") {
+      settings.occluder_count = std::stoul(value);
+    } else if (option == "--update-rate") {
+      settings.update_rate_hz = std::stod(value);
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  try {
+    HeadlessApplication app(settings);
+    return app.Run() ? 0 : 2;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
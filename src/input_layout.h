@@ -0,0 +1,37 @@
+#pragma once
+#include <stdexcept>
+#include <vector>
+
+#include "core/vertex_layout.h"
+#include "d3d12.h"
+
+inline DXGI_FORMAT ToDxgiFormat(VertexFormat format) {
+  switch (format) {
+    case VertexFormat::kFloat32x2:
+      return DXGI_FORMAT_R32G32_FLOAT;
+    case VertexFormat::kFloat32x3:
+      return DXGI_FORMAT_R32G32B32_FLOAT;
+    case VertexFormat::kFloat32x4:
+      return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case VertexFormat::kSnorm16x4:
+      return DXGI_FORMAT_R16G16B16A16_SNORM;
+    case VertexFormat::kUnorm8x4:
+      return DXGI_FORMAT_R8G8B8A8_UNORM;
+  }
+  throw std::runtime_error("Unknown vertex format");
+}
+
+// Append the input elements of every attribute in the layout of T, read from
+// one input slot. Per-instance data advances once per instance.
+template <typename T>
+void AppendInputElements(uint32_t input_slot,
+                         D3D12_INPUT_CLASSIFICATION classification,
+                         std::vector<D3D12_INPUT_ELEMENT_DESC> *elements) {
+  const UINT step_rate =
+      classification == D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA ? 1 : 0;
+  for (const VertexAttribute &attribute : VertexLayout<T>::kAttributes) {
+    elements->push_back({attribute.semantic, 0,
+                         ToDxgiFormat(attribute.format), input_slot,
+                         attribute.offset, classification, step_rate});
+  }
+}
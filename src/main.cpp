@@ -1,7 +1,66 @@
+#include <string>
+
 #include "application.h"
 
-int main() {
+int main(int argc, char **argv) {
+  // --grid N replaces the sample triangle by N^2 triangles, one draw each.
+  // --scene N scatters N triangles over a world the camera flies over.
+  // --mesh file draws a mesh file instead of the triangle.
+  // --trace file.json writes a Chrome trace of the last frames on close.
+  // --fill wireframe draws edges only, once that pipeline is created.
+  // --offscreen N renders N frames without a window.
+  // --capture file streams the offscreen frames into a file or pipe.
+  // --capture-depth N reads frames back through N buffers.
+  // --present vsync|low-latency|unlocked picks how frames are presented and
+  // whether the frame pacer holds GPU bound frames back.
+  // --lod-error N draws LODs whose error stays within N pixels.
+  // --stream-budget N streams LODs within N bytes instead of the budget the
+  // adapter reports.
+  // --occluders N culls objects behind the N largest ones on screen, 0 turns
+  // occlusion culling off.
+  // --update-rate N updates N times a second on a thread of its own, 0 before
+  // every frame on the render thread.
+  ApplicationSettings settings;
+  for (int i = 1; i + 1 < argc; i++) {
+    const std::string option = argv[i];
+    if (option == "--grid") {
+      settings.grid_size = std::stoul(argv[++i]);
+    } else if (option == "--scene") {
+      settings.scene_object_count = std::stoul(argv[++i]);
+    } else if (option == "--mesh") {
+      settings.mesh_path = argv[++i];
+    } else if (option == "--trace") {
+      settings.trace_path = argv[++i];
+    } else if (option == "--fill") {
+      settings.wireframe = std::string(argv[++i]) == "wireframe";
+    } else if (option == "--offscreen") {
+      settings.offscreen = true;
+      settings.frame_count = std::stoul(argv[++i]);
+    } else if (option == "--capture") {
+      settings.capture_path = argv[++i];
+    } else if (option == "--capture-depth") {
+      settings.capture_depth = std::stoul(argv[++i]);
+    } else if (option == "--lod-error") {
+      settings.lod_error_pixels = std::stof(argv[++i]);
+    } else if (option == "--stream-budget") {
+      settings.streaming_budget = std::stoull(argv[++i]);
+    } else if (option == "--occluders") {
+      settings.occluder_count = std::stoul(argv[++i]);
+    } else if (option == "--update-rate") {
+      settings.update_rate_hz = std::stod(argv[++i]);
+    } else if (option == "--present") {
+      const std::string mode = argv[++i];
+      if (mode == "low-latency") {
+        settings.present_mode = PresentMode::kLowLatency;
+      } else if (mode == "unlocked") {
+        settings.present_mode = PresentMode::kUnlocked;
+      } else {
+        settings.present_mode = PresentMode::kVsync;
+      }
+    }
+  }
+
   // Create window by glfw for d3d12
-  Application app("D3D12", 1920, 1080);
+  Application app("D3D12", 1920, 1080, settings);
   app.Run();
 }
@@ -0,0 +1,77 @@
+#include "parallel_command_recorder.h"
+
+#include <stdexcept>
+#include <string>
+
+ParallelCommandRecorder::ParallelCommandRecorder(ID3D12Device *device,
+                                                 JobSystem *job_system,
+                                                 uint32_t frames_in_flight,
+                                                 uint32_t max_chunks)
+    : job_system_(job_system), max_chunks_(max_chunks) {
+  command_allocators_.resize(frames_in_flight * max_chunks);
+  for (auto &command_allocator : command_allocators_) {
+    if (FAILED(device->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_DIRECT,
+            IID_PPV_ARGS(&command_allocator)))) {
+      throw std::runtime_error("Failed to create command allocator");
+    }
+  }
+
+  // A list may be reset as soon as it was submitted, only its allocator has
+  // to outlive the GPU work, so one list per chunk serves every frame slot
+  command_lists_.resize(max_chunks);
+  for (uint32_t i = 0; i < max_chunks; i++) {
+    if (FAILED(device->CreateCommandList(
+            0, D3D12_COMMAND_LIST_TYPE_DIRECT, command_allocators_[i].Get(),
+            nullptr, IID_PPV_ARGS(&command_lists_[i])))) {
+      throw std::runtime_error("Failed to create command list");
+    }
+    if (FAILED(command_lists_[i]->Close())) {
+      throw std::runtime_error("Failed to close command list");
+    }
+  }
+}
+
+const std::vector<ID3D12CommandList *> &ParallelCommandRecorder::Record(
+    uint32_t frame_slot,
+    const std::vector<DrawChunk> &chunks,
+    ID3D12PipelineState *initial_state,
+    const RecordFunction &record) {
+  if (chunks.size() > max_chunks_) {
+    throw std::runtime_error("Frame has more chunks than command lists");
+  }
+
+  // Failures are reported after every worker finished, throwing out of a
+  // job would leave the others recording
+  std::vector<std::string> errors(chunks.size());
+  job_system_->ParallelFor(
+      static_cast<uint32_t>(chunks.size()), [&](uint32_t chunk, uint32_t) {
+        ID3D12CommandAllocator *command_allocator =
+            command_allocators_[frame_slot * max_chunks_ + chunk].Get();
+        ID3D12GraphicsCommandList *command_list = command_lists_[chunk].Get();
+        if (FAILED(command_allocator->Reset()) ||
+            FAILED(command_list->Reset(command_allocator, initial_state))) {
+          errors[chunk] = "Failed to reset command list";
+          return;
+        }
+        try {
+          record(command_list, chunk, chunks[chunk]);
+        } catch (const std::exception &e) {
+          errors[chunk] = e.what();
+        }
+        if (FAILED(command_list->Close()) && errors[chunk].empty()) {
+          errors[chunk] = "Failed to close command list";
+        }
+      });
+  for (const auto &error : errors) {
+    if (!error.empty()) {
+      throw std::runtime_error(error);
+    }
+  }
+
+  submission_.clear();
+  for (uint32_t i = 0; i < chunks.size(); i++) {
+    submission_.push_back(command_lists_[i].Get());
+  }
+  return submission_;
+}
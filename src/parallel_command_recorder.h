@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+#include "core/draw_partition.h"
+#include "core/job_system.h"
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Records the draws of a frame into one command list per chunk on the job
+// system. Every chunk owns an allocator per frame slot, so a slot's
+// allocators are only reset once the frame scheduler has retired the slot.
+class ParallelCommandRecorder {
+ public:
+  // Called on a worker with the open list of a chunk, recording must not
+  // touch state shared with other chunks
+  using RecordFunction = std::function<void(
+      ID3D12GraphicsCommandList *, uint32_t chunk_index, const DrawChunk &)>;
+
+  ParallelCommandRecorder(ID3D12Device *device,
+                          JobSystem *job_system,
+                          uint32_t frames_in_flight,
+                          uint32_t max_chunks);
+
+  uint32_t GetMaxChunks() const {
+    return max_chunks_;
+  }
+
+  // Record every chunk in parallel and return the closed lists in chunk
+  // order, ready for a single ExecuteCommandLists call
+  const std::vector<ID3D12CommandList *> &Record(
+      uint32_t frame_slot,
+      const std::vector<DrawChunk> &chunks,
+      ID3D12PipelineState *initial_state,
+      const RecordFunction &record);
+
+ private:
+  JobSystem *job_system_;
+  uint32_t max_chunks_;
+  // Indexed by frame_slot * max_chunks_ + chunk_index
+  std::vector<ComPtr<ID3D12CommandAllocator>> command_allocators_;
+  std::vector<ComPtr<ID3D12GraphicsCommandList>> command_lists_;
+  std::vector<ID3D12CommandList *> submission_;
+};
@@ -0,0 +1,77 @@
+#include "pipeline_cache.h"
+
+#include <stdexcept>
+
+const char PipelineCache::kLibraryName[] = "pipeline_library.bin";
+
+PipelineCache::PipelineCache(ID3D12Device *device, ShaderCache *shader_cache)
+    : device_(device), shader_cache_(shader_cache) {
+  // Pipeline libraries need ID3D12Device1, without it every pipeline is
+  // created directly
+  if (FAILED(device->QueryInterface(IID_PPV_ARGS(&device1_)))) {
+    return;
+  }
+  if (shader_cache_->LoadBlob(kLibraryName, &library_blob_) &&
+      !library_blob_.empty() &&
+      SUCCEEDED(device1_->CreatePipelineLibrary(library_blob_.data(),
+                                                library_blob_.size(),
+                                                IID_PPV_ARGS(&library_)))) {
+    return;
+  }
+  CreateEmptyLibrary();
+}
+
+ComPtr<ID3D12PipelineState> PipelineCache::GetGraphicsPipeline(
+    const std::string &name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc) {
+  ComPtr<ID3D12PipelineState> pipeline_state;
+  const std::wstring wide_name(name.begin(), name.end());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (library_ && SUCCEEDED(library_->LoadGraphicsPipeline(
+                        wide_name.c_str(), &desc,
+                        IID_PPV_ARGS(&pipeline_state)))) {
+      stats_.hits++;
+      return pipeline_state;
+    }
+  }
+
+  // Compilation is the slow part, it runs without the lock
+  if (FAILED(device_->CreateGraphicsPipelineState(
+          &desc, IID_PPV_ARGS(&pipeline_state)))) {
+    throw std::runtime_error("Failed to create graphics pipeline state");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.misses++;
+  if (library_ && SUCCEEDED(library_->StorePipeline(wide_name.c_str(),
+                                                    pipeline_state.Get()))) {
+    dirty_ = true;
+  }
+  return pipeline_state;
+}
+
+void PipelineCache::Save() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!library_ || !dirty_) {
+    return;
+  }
+  std::vector<uint8_t> blob(library_->GetSerializedSize());
+  if (FAILED(library_->Serialize(blob.data(), blob.size()))) {
+    throw std::runtime_error("Failed to serialize pipeline library");
+  }
+  shader_cache_->StoreBlob(kLibraryName, blob);
+  dirty_ = false;
+}
+
+PipelineCacheStats PipelineCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void PipelineCache::CreateEmptyLibrary() {
+  library_blob_.clear();
+  if (FAILED(device1_->CreatePipelineLibrary(nullptr, 0,
+                                             IID_PPV_ARGS(&library_)))) {
+    // Drivers may not support libraries at all, fall back to plain creation
+    library_.Reset();
+  }
+}
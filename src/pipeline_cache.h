@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/shader_cache.h"
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+struct PipelineCacheStats {
+  uint64_t hits{0};
+  uint64_t misses{0};
+};
+
+// Pipeline states backed by an ID3D12PipelineLibrary that is persisted in the
+// shader cache directory. The driver rejects libraries written by another
+// driver or adapter, the cache then starts over with an empty library.
+// Safe to use from several threads at once, pipelines missing from the
+// library are created concurrently.
+class PipelineCache {
+ public:
+  PipelineCache(ID3D12Device *device, ShaderCache *shader_cache);
+
+  // The name must identify everything in the description, including the
+  // shader bytecode, for example by combining shader cache keys
+  ComPtr<ID3D12PipelineState> GetGraphicsPipeline(
+      const std::string &name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc);
+
+  // Write the library back to disk when pipelines were added to it
+  void Save();
+
+  PipelineCacheStats GetStats() const;
+
+ private:
+  static const char kLibraryName[];
+
+  void CreateEmptyLibrary();
+
+  ComPtr<ID3D12Device> device_;
+  ComPtr<ID3D12Device1> device1_;
+  ShaderCache *shader_cache_;
+  ComPtr<ID3D12PipelineLibrary> library_;
+  // The library references the blob it was created from for its lifetime
+  std::vector<uint8_t> library_blob_;
+  // Guards the library, its dirty flag and the stats
+  mutable std::mutex mutex_;
+  bool dirty_{false};
+  PipelineCacheStats stats_;
+};
@@ -0,0 +1,79 @@
+#include "readback_ring.h"
+
+#include <stdexcept>
+
+#include "d3dx12.h"
+
+ReadbackRing::ReadbackRing(ID3D12Device *device,
+                           GpuTimeline *timeline,
+                           uint32_t depth,
+                           uint32_t width,
+                           uint32_t height)
+    : width_(width), height_(height), slots_(depth), queue_(timeline, depth) {
+  // Rows of texture copies are aligned to 256 bytes, the footprint gives the
+  // pitch and size of the buffer
+  const D3D12_RESOURCE_DESC texture_desc = CD3DX12_RESOURCE_DESC::Tex2D(
+      DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1);
+  uint64_t buffer_size = 0;
+  device->GetCopyableFootprints(&texture_desc, 0, 1, 0, &footprint_, nullptr,
+                                nullptr, &buffer_size);
+
+  CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_READBACK);
+  CD3DX12_RESOURCE_DESC buffer_desc =
+      CD3DX12_RESOURCE_DESC::Buffer(buffer_size);
+  for (Slot &slot : slots_) {
+    if (FAILED(device->CreateCommittedResource(
+            &heap_properties, D3D12_HEAP_FLAG_NONE, &buffer_desc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+            IID_PPV_ARGS(&slot.buffer)))) {
+      throw std::runtime_error("Failed to create readback buffer");
+    }
+    // Readback buffers stay mapped, the CPU only reads slots whose copy
+    // completed
+    CD3DX12_RANGE read_range(0, static_cast<SIZE_T>(buffer_size));
+    if (FAILED(slot.buffer->Map(
+            0, &read_range, reinterpret_cast<void **>(&slot.mapped_data)))) {
+      throw std::runtime_error("Failed to map readback buffer");
+    }
+  }
+}
+
+ReadbackRing::~ReadbackRing() {
+  for (Slot &slot : slots_) {
+    if (slot.mapped_data) {
+      CD3DX12_RANGE written_range(0, 0);
+      slot.buffer->Unmap(0, &written_range);
+    }
+  }
+}
+
+void ReadbackRing::BeginFrame(FrameSink *sink) {
+  slot_ = queue_.Acquire(
+      [&](uint32_t slot, uint64_t) { WriteSlot(slot, sink); });
+}
+
+void ReadbackRing::RecordCopy(ID3D12GraphicsCommandList *command_list,
+                              ID3D12Resource *texture) const {
+  CD3DX12_TEXTURE_COPY_LOCATION destination(slots_[slot_].buffer.Get(),
+                                            footprint_);
+  CD3DX12_TEXTURE_COPY_LOCATION source(texture, 0);
+  command_list->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+}
+
+void ReadbackRing::EndFrame(uint64_t frame,
+                            uint64_t fence_value,
+                            FrameSink *sink) {
+  queue_.Submit(frame, fence_value);
+  queue_.ReadCompleted(
+      [&](uint32_t slot, uint64_t) { WriteSlot(slot, sink); });
+}
+
+void ReadbackRing::Flush(FrameSink *sink) {
+  queue_.Flush([&](uint32_t slot, uint64_t) { WriteSlot(slot, sink); });
+  sink->Flush();
+}
+
+void ReadbackRing::WriteSlot(uint32_t slot, FrameSink *sink) const {
+  sink->WriteFrame({slots_[slot].mapped_data + footprint_.Offset, width_,
+                    height_, footprint_.Footprint.RowPitch});
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+
+#include "core/frame_sink.h"
+#include "core/gpu_timeline.h"
+#include "core/readback_queue.h"
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Ring of persistently mapped READBACK buffers that frames copy their render
+// target into. A frame is handed to the sink straight from mapped memory once
+// its copy completed, which with more slots than frames in flight is never
+// waited for. Used from the render thread, RecordCopy from any thread.
+class ReadbackRing {
+ public:
+  ReadbackRing(ID3D12Device *device,
+               GpuTimeline *timeline,
+               uint32_t depth,
+               uint32_t width,
+               uint32_t height);
+  ~ReadbackRing();
+
+  // Pick the slot of the next frame, writing out the frame it still holds
+  void BeginFrame(FrameSink *sink);
+
+  // Copy the R8G8B8A8 texture, in COPY_SOURCE state, into the slot
+  void RecordCopy(ID3D12GraphicsCommandList *command_list,
+                  ID3D12Resource *texture) const;
+
+  // The copy of the frame executes before fence_value. Writes out every
+  // earlier frame whose copy completed.
+  void EndFrame(uint64_t frame, uint64_t fence_value, FrameSink *sink);
+
+  // Wait for the remaining copies and write them out
+  void Flush(FrameSink *sink);
+
+  const ReadbackQueueStats &GetStats() const {
+    return queue_.GetStats();
+  }
+
+ private:
+  struct Slot {
+    ComPtr<ID3D12Resource> buffer;
+    uint8_t *mapped_data{nullptr};
+  };
+
+  void WriteSlot(uint32_t slot, FrameSink *sink) const;
+
+  D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint_;
+  uint32_t width_;
+  uint32_t height_;
+  std::vector<Slot> slots_;
+  ReadbackQueue queue_;
+  uint32_t slot_{0};
+};
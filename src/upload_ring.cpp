@@ -0,0 +1,129 @@
+#include "upload_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "d3dx12.h"
+
+namespace {
+const uint64_t kBufferCopyAlignment = 16;
+}  // namespace
+
+UploadRing::UploadRing(ID3D12Device *device,
+                       ID3D12CommandQueue *command_queue,
+                       GpuTimeline *timeline,
+                       uint64_t capacity)
+    : device_(device),
+      command_queue_(command_queue),
+      command_list_type_(command_queue->GetDesc().Type),
+      timeline_(timeline),
+      ring_(capacity, timeline) {
+  CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_UPLOAD);
+  CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(capacity);
+  if (FAILED(device->CreateCommittedResource(
+          &heap_properties, D3D12_HEAP_FLAG_NONE, &buffer_desc,
+          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+          IID_PPV_ARGS(&buffer_)))) {
+    throw std::runtime_error("Failed to create upload ring buffer");
+  }
+
+  // Upload heaps may stay mapped for their whole lifetime
+  CD3DX12_RANGE read_range(0, 0);
+  if (FAILED(buffer_->Map(0, &read_range,
+                          reinterpret_cast<void **>(&mapped_data_)))) {
+    throw std::runtime_error("Failed to map upload ring buffer");
+  }
+}
+
+UploadRing::~UploadRing() {
+  buffer_->Unmap(0, nullptr);
+}
+
+UploadAllocation UploadRing::Allocate(uint64_t size, uint64_t alignment) {
+  uint64_t offset = ring_.Allocate(size, alignment);
+  if (offset == RingAllocator::kInvalidOffset) {
+    // The open batch fills the ring on its own, it has to be submitted before
+    // any of it can be reclaimed
+    Submit();
+    offset = ring_.Allocate(size, alignment);
+    if (offset == RingAllocator::kInvalidOffset) {
+      throw std::runtime_error("Failed to allocate upload memory");
+    }
+  }
+  return {mapped_data_ + offset, buffer_.Get(), offset,
+          buffer_->GetGPUVirtualAddress() + offset};
+}
+
+void UploadRing::UploadBuffer(ID3D12Resource *destination,
+                              uint64_t destination_offset,
+                              const void *data,
+                              uint64_t size) {
+  // Large uploads go through the ring in parts, later parts wait for the GPU
+  // to copy earlier ones instead of needing the whole size at once
+  const uint64_t max_part_size =
+      ring_.GetCapacity() / 4 / kBufferCopyAlignment * kBufferCopyAlignment;
+  const uint8_t *source = static_cast<const uint8_t *>(data);
+  for (uint64_t offset = 0; offset < size; offset += max_part_size) {
+    const uint64_t part_size = std::min(max_part_size, size - offset);
+    const UploadAllocation allocation =
+        Allocate(part_size, kBufferCopyAlignment);
+    memcpy(allocation.cpu_address, source + offset, part_size);
+    GetCommandList()->CopyBufferRegion(destination, destination_offset + offset,
+                                       allocation.resource, allocation.offset,
+                                       part_size);
+  }
+}
+
+ID3D12GraphicsCommandList *UploadRing::GetCommandList() {
+  if (!recording_) {
+    BeginBatch();
+  }
+  return command_list_.Get();
+}
+
+uint64_t UploadRing::Submit() {
+  if (!recording_ && !ring_.HasOpenBatch()) {
+    return 0;
+  }
+  GetCommandList();
+  if (FAILED(command_list_->Close())) {
+    throw std::runtime_error("Failed to close upload command list");
+  }
+  ID3D12CommandList *command_lists[] = {command_list_.Get()};
+  command_queue_->ExecuteCommandLists(_countof(command_lists), command_lists);
+
+  const uint64_t fence_value = timeline_->Signal();
+  ring_.FinishBatch(fence_value);
+  submitted_allocators_.push_back({open_allocator_, fence_value});
+  open_allocator_.Reset();
+  recording_ = false;
+  return fence_value;
+}
+
+void UploadRing::BeginBatch() {
+  // Recycle the oldest allocator once the GPU is done with it
+  if (!submitted_allocators_.empty() &&
+      submitted_allocators_.front().fence_value <=
+          timeline_->GetCompletedValue()) {
+    open_allocator_ = submitted_allocators_.front().allocator;
+    submitted_allocators_.pop_front();
+    if (FAILED(open_allocator_->Reset())) {
+      throw std::runtime_error("Failed to reset upload command allocator");
+    }
+  } else if (FAILED(device_->CreateCommandAllocator(
+                 command_list_type_, IID_PPV_ARGS(&open_allocator_)))) {
+    throw std::runtime_error("Failed to create upload command allocator");
+  }
+
+  if (!command_list_) {
+    if (FAILED(device_->CreateCommandList(
+            0, command_list_type_, open_allocator_.Get(), nullptr,
+            IID_PPV_ARGS(&command_list_)))) {
+      throw std::runtime_error("Failed to create upload command list");
+    }
+  } else if (FAILED(command_list_->Reset(open_allocator_.Get(), nullptr))) {
+    throw std::runtime_error("Failed to reset upload command list");
+  }
+  recording_ = true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <deque>
+
+#include "core/gpu_timeline.h"
+#include "core/ring_allocator.h"
+#include "d3d12.h"
+#include "wrl.h"
+
+using Microsoft::WRL::ComPtr;
+
+struct UploadAllocation {
+  uint8_t *cpu_address;
+  ID3D12Resource *resource;
+  uint64_t offset;
+  D3D12_GPU_VIRTUAL_ADDRESS gpu_address;
+};
+
+// Persistently mapped UPLOAD heap buffer sub-allocated as a ring. Copies out
+// of it are recorded into one command list per batch and submitted together,
+// staging memory is reclaimed as the timeline passes each batch. Lists match
+// the type of the queue, on a COPY queue uploads run beside rendering and
+// consumers order themselves after the fence values Submit returns.
+class UploadRing {
+ public:
+  static const uint64_t kDefaultCapacity = 16 * 1024 * 1024;
+
+  UploadRing(ID3D12Device *device,
+             ID3D12CommandQueue *command_queue,
+             GpuTimeline *timeline,
+             uint64_t capacity = kDefaultCapacity);
+  ~UploadRing();
+
+  // Staging memory in the open batch. Submits the open batch first when the
+  // ring can not be reclaimed otherwise.
+  UploadAllocation Allocate(uint64_t size, uint64_t alignment);
+
+  // Stage the data and record a copy into the destination buffer. Data larger
+  // than the ring is staged in parts, submitting the batch in between.
+  void UploadBuffer(ID3D12Resource *destination,
+                    uint64_t destination_offset,
+                    const void *data,
+                    uint64_t size);
+
+  // Command list of the open batch, for commands that belong to the uploads
+  ID3D12GraphicsCommandList *GetCommandList();
+
+  // Execute everything recorded into the open batch, returns its fence value
+  uint64_t Submit();
+
+  GpuTimeline *GetTimeline() const {
+    return timeline_;
+  }
+  uint64_t GetCapacity() const {
+    return ring_.GetCapacity();
+  }
+  const RingAllocatorStats &GetStats() const {
+    return ring_.GetStats();
+  }
+
+ private:
+  struct SubmittedAllocator {
+    ComPtr<ID3D12CommandAllocator> allocator;
+    uint64_t fence_value;
+  };
+
+  void BeginBatch();
+
+  ComPtr<ID3D12Device> device_;
+  ComPtr<ID3D12CommandQueue> command_queue_;
+  D3D12_COMMAND_LIST_TYPE command_list_type_;
+  GpuTimeline *timeline_;
+  RingAllocator ring_;
+  ComPtr<ID3D12Resource> buffer_;
+  uint8_t *mapped_data_{nullptr};
+
+  ComPtr<ID3D12GraphicsCommandList> command_list_;
+  ComPtr<ID3D12CommandAllocator> open_allocator_;
+  // Allocators of submitted batches, oldest first
+  std::deque<SubmittedAllocator> submitted_allocators_;
+  bool recording_{false};
+};